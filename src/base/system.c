@@ -1,6 +1,7 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <ctype.h>
+#include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -24,6 +25,7 @@
 #include <netinet/in.h>
 #include <pthread.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 
 #include <dirent.h>
@@ -32,6 +34,11 @@
 #include <Carbon/Carbon.h>
 #endif
 
+#if defined(CONF_PLATFORM_LINUX)
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
 #elif defined(CONF_FAMILY_WINDOWS)
 #include <windows.h>
 #include <winsock2.h>
@@ -41,6 +48,7 @@
 
 #include <direct.h>
 #include <errno.h>
+#include <io.h>
 #include <process.h>
 #include <wincrypt.h>
 
@@ -76,20 +84,315 @@ typedef struct
 static DBG_LOGGER_DATA loggers[16];
 static int num_loggers = 0;
 
+#if !defined(CONF_FAMILY_WINDOWS)
+/* where the crash handler writes the queued lines to */
+static int log_crash_fds[16];
+static int num_log_crash_fds = 0;
+#endif
+
 static NETSTATS network_stats = {0};
 
 static NETSOCKET invalid_socket = {NETTYPE_INVALID, -1, -1};
 
-static void dbg_logger_finish(void)
+/* the asynchronous logger, a bounded queue with a sequence number per entry
+   that any thread can push lines into and the logger thread drains */
+#if defined(__GNUC__)
+static unsigned log_compswap(volatile unsigned *value, unsigned comperand, unsigned exchange) { return __sync_val_compare_and_swap(value, comperand, exchange); }
+static unsigned log_fetch_add(volatile unsigned *value, unsigned add) { return __sync_fetch_and_add(value, add); }
+static void log_barrier() { __sync_synchronize(); }
+#elif defined(_MSC_VER)
+static unsigned log_compswap(volatile unsigned *value, unsigned comperand, unsigned exchange) { return _InterlockedCompareExchange((volatile long *) value, (long) exchange, (long) comperand); }
+static unsigned log_fetch_add(volatile unsigned *value, unsigned add) { return _InterlockedExchangeAdd((volatile long *) value, (long) add); }
+static void log_barrier() { MemoryBarrier(); }
+#else
+#error missing atomic implementation for this compiler
+#endif
+
+#define LOG_QUEUE_SIZE 1024 /* a power of two, so the positions can wrap around */
+#define LOG_LINE_SIZE 512
+#define LOG_RATE_BUCKETS 64
+
+typedef struct
+{
+	volatile unsigned sequence;
+	char *long_line;
+	char line[LOG_LINE_SIZE];
+} LOG_ENTRY;
+
+typedef struct
+{
+	volatile unsigned hash;
+	volatile unsigned window;
+	volatile unsigned count;
+	volatile unsigned suppressed;
+} LOG_RATE;
+
+typedef struct
+{
+	LOG_ENTRY entries[LOG_QUEUE_SIZE];
+	volatile unsigned enqueue_pos;
+	unsigned dequeue_pos;
+
+	volatile unsigned running;
+	volatile unsigned sleeping;
+	volatile unsigned stop;
+	SEMAPHORE sphore;
+	LOCK drain_lock;
+	void *thread;
+
+	volatile int rate_limit;
+	LOG_RATE rates[LOG_RATE_BUCKETS];
+
+	volatile unsigned queued;
+	volatile unsigned dropped;
+	volatile unsigned suppressed;
+	unsigned reported_dropped;
+} LOG_QUEUE;
+
+static LOG_QUEUE *log_queue = 0;
+
+static void log_write(const char *line)
+{
+	int i;
+	for(i = 0; i < num_loggers; i++)
+	{
+		if(loggers[i].logger)
+			loggers[i].logger(line, loggers[i].user);
+	}
+}
+
+static void log_finish_loggers(void)
 {
 	int i;
 	for(i = 0; i < num_loggers; i++)
 	{
 		if(loggers[i].finish)
 		{
-			loggers[i].finish(loggers[i].user);
+			/* the data of a finished logger is gone, keep it from being called again */
+			DBG_LOGGER_FINISH finish = loggers[i].finish;
+			loggers[i].logger = 0;
+			loggers[i].finish = 0;
+			finish(loggers[i].user);
+		}
+	}
+}
+
+static int log_enqueue(const char *line)
+{
+	LOG_ENTRY *entry;
+	unsigned pos = log_queue->enqueue_pos;
+	int len;
+	while(1)
+	{
+		int diff;
+		entry = &log_queue->entries[pos % LOG_QUEUE_SIZE];
+		diff = (int) (entry->sequence - pos);
+		log_barrier();
+		if(diff == 0)
+		{
+			if(log_compswap(&log_queue->enqueue_pos, pos, pos + 1) == pos)
+				break;
+			pos = log_queue->enqueue_pos;
+		}
+		else if(diff < 0)
+		{
+			/* full, the logger thread reports the lost lines once it catches up */
+			log_fetch_add(&log_queue->dropped, 1);
+			return 0;
 		}
+		else
+			pos = log_queue->enqueue_pos;
+	}
+
+	len = str_length(line);
+	entry->long_line = 0;
+	if(len < LOG_LINE_SIZE)
+		mem_copy(entry->line, line, len + 1);
+	else if((entry->long_line = malloc(len + 1)))
+		mem_copy(entry->long_line, line, len + 1);
+	else
+	{
+		mem_copy(entry->line, line, LOG_LINE_SIZE - 1);
+		entry->line[LOG_LINE_SIZE - 1] = 0;
+	}
+
+	log_barrier();
+	entry->sequence = pos + 1;
+	log_fetch_add(&log_queue->queued, 1);
+	log_barrier();
+	if(log_compswap(&log_queue->sleeping, 1, 0) == 1)
+		sphore_signal(&log_queue->sphore);
+	return 1;
+}
+
+/* only called with the drain lock */
+static void log_drain(void)
+{
+	unsigned dropped;
+	while(1)
+	{
+		LOG_ENTRY *entry = &log_queue->entries[log_queue->dequeue_pos % LOG_QUEUE_SIZE];
+		if(entry->sequence != log_queue->dequeue_pos + 1)
+			break;
+		log_barrier();
+
+		log_write(entry->long_line ? entry->long_line : entry->line);
+		free(entry->long_line);
+		entry->long_line = 0;
+
+		log_barrier();
+		entry->sequence = log_queue->dequeue_pos + LOG_QUEUE_SIZE;
+		log_queue->dequeue_pos++;
+	}
+
+	dropped = log_queue->dropped;
+	if(dropped != log_queue->reported_dropped)
+	{
+		char timestr[80];
+		char str[256];
+		str_timestamp_format(timestr, sizeof(timestr), FORMAT_SPACE);
+		str_format(str, sizeof(str), "[%s][logger]: dropped %u lines, the log queue was full", timestr, dropped - log_queue->reported_dropped);
+		log_write(str);
+		log_queue->reported_dropped = dropped;
+	}
+}
+
+/* gives up on the lines after a second, the logger thread could be the one which crashed */
+static void log_drain_crash(void)
+{
+	int i;
+	for(i = 0; i < 100; i++)
+	{
+		if(lock_trylock(log_queue->drain_lock) == 0)
+		{
+			log_drain();
+			lock_unlock(log_queue->drain_lock);
+			return;
+		}
+		thread_sleep(10);
+	}
+}
+
+static void log_thread(void *user)
+{
+	while(1)
+	{
+		/* announce the sleep before looking at the queue, so no signal gets lost */
+		log_queue->sleeping = 1;
+		log_barrier();
+		lock_wait(log_queue->drain_lock);
+		log_drain();
+		lock_unlock(log_queue->drain_lock);
+		if(log_queue->stop)
+			break;
+		sphore_wait(&log_queue->sphore);
+	}
+}
+
+/* writes everything queued and the lines of the crashing thread right away */
+static void log_crash(void)
+{
+	if(log_queue && log_queue->running)
+	{
+		log_queue->running = 0;
+		log_barrier();
+		log_drain_crash();
+	}
+}
+
+#if !defined(CONF_FAMILY_WINDOWS)
+static int log_crash_write(int fd, const char *data, size_t len)
+{
+	while(len > 0)
+	{
+		ssize_t written = write(fd, data, len);
+		if(written <= 0)
+			return 0;
+		data += written;
+		len -= written;
+	}
+	return 1;
+}
+
+/* only write() from here, the crashed thread could hold any lock or be the logger thread.
+   the entries are left as they are, nothing runs after the handler anyway */
+static void log_crash_signal(int sig)
+{
+	unsigned pos;
+	int i;
+	log_queue->running = 0;
+	log_barrier();
+	for(pos = log_queue->dequeue_pos;; pos++)
+	{
+		LOG_ENTRY *entry = &log_queue->entries[pos % LOG_QUEUE_SIZE];
+		if(entry->sequence != pos + 1)
+			break;
+		log_barrier();
+		for(i = 0; i < num_log_crash_fds; i++)
+		{
+			const char *line = entry->long_line ? entry->long_line : entry->line;
+			if(log_crash_write(log_crash_fds[i], line, strlen(line)))
+				log_crash_write(log_crash_fds[i], "\n", 1);
+		}
+	}
+	raise(sig);
+}
+#endif
+
+static int log_rate_limited(const char *sys)
+{
+	unsigned hash, window, suppressed = 0;
+	LOG_RATE *rate;
+	int rate_limit = log_queue->rate_limit;
+	if(rate_limit <= 0)
+		return 0;
+
+	hash = str_quickhash(sys);
+	rate = &log_queue->rates[hash % LOG_RATE_BUCKETS];
+	window = (unsigned) (time_get() / time_freq());
+	if(rate->hash != hash || rate->window != window)
+	{
+		/* the first line of a second, racing threads only make the limit less exact */
+		if(rate->hash == hash)
+			suppressed = rate->suppressed;
+		rate->hash = hash;
+		rate->window = window;
+		rate->count = 0;
+		rate->suppressed = 0;
+	}
+	if(suppressed)
+	{
+		/* straight into the queue, the line must not count against the limit itself */
+		char timestr[80];
+		char str[256];
+		str_timestamp_format(timestr, sizeof(timestr), FORMAT_SPACE);
+		str_format(str, sizeof(str), "[%s][logger]: suppressed %u lines of '%s'", timestr, suppressed, sys);
+		log_enqueue(str);
+	}
+
+	if(log_fetch_add(&rate->count, 1) < (unsigned) rate_limit)
+		return 0;
+	log_fetch_add(&rate->suppressed, 1);
+	log_fetch_add(&log_queue->suppressed, 1);
+	return 1;
+}
+
+static void dbg_logger_finish(void)
+{
+	if(log_queue && log_queue->running)
+	{
+		/* lines logged from here on are written right away */
+		log_queue->stop = 1;
+		log_barrier();
+		sphore_signal(&log_queue->sphore);
+		thread_wait(log_queue->thread);
+		log_queue->running = 0;
+		log_barrier();
+		lock_wait(log_queue->drain_lock);
+		log_drain();
+		lock_unlock(log_queue->drain_lock);
 	}
+	log_finish_loggers();
 }
 
 void dbg_logger(DBG_LOGGER logger, DBG_LOGGER_FINISH finish, void *user)
@@ -103,14 +406,92 @@ void dbg_logger(DBG_LOGGER logger, DBG_LOGGER_FINISH finish, void *user)
 	data.finish = finish;
 	data.user = user;
 	loggers[num_loggers] = data;
+	log_barrier();
 	num_loggers++;
 }
 
+void dbg_logger_async()
+{
+	LOG_QUEUE *queue;
+	unsigned i;
+	if(log_queue)
+		return;
+
+	queue = calloc(1, sizeof(*queue));
+	if(!queue)
+		return;
+	for(i = 0; i < LOG_QUEUE_SIZE; i++)
+		queue->entries[i].sequence = i;
+	sphore_init(&queue->sphore);
+	queue->drain_lock = lock_create();
+	queue->running = 1;
+	log_queue = queue;
+	log_barrier();
+
+	queue->thread = thread_init(log_thread, 0);
+	if(!queue->thread)
+	{
+		queue->running = 0;
+		return;
+	}
+}
+
+void dbg_logger_crash_handler()
+{
+#if !defined(CONF_FAMILY_WINDOWS)
+	struct sigaction action;
+	if(!log_queue || !log_queue->running)
+		return;
+
+	mem_zero(&action, sizeof(action));
+	action.sa_handler = log_crash_signal;
+	sigemptyset(&action.sa_mask);
+	/* back to the default action, so raising the signal again ends the process */
+	action.sa_flags = SA_RESETHAND | SA_NODEFER;
+	sigaction(SIGSEGV, &action, 0);
+	sigaction(SIGILL, &action, 0);
+	sigaction(SIGFPE, &action, 0);
+	sigaction(SIGABRT, &action, 0);
+#if defined(SIGBUS)
+	sigaction(SIGBUS, &action, 0);
+#endif
+#endif
+}
+
+void dbg_logger_rate_limit(int lines_per_second)
+{
+	if(log_queue)
+		log_queue->rate_limit = lines_per_second;
+}
+
+void dbg_logger_flush()
+{
+	if(!log_queue)
+		return;
+	lock_wait(log_queue->drain_lock);
+	log_drain();
+	lock_unlock(log_queue->drain_lock);
+}
+
+void dbg_logger_stats(DBG_LOGGER_STATS *stats)
+{
+	if(!log_queue)
+	{
+		mem_zero(stats, sizeof(*stats));
+		return;
+	}
+	stats->queued = log_queue->queued;
+	stats->dropped = log_queue->dropped;
+	stats->suppressed = log_queue->suppressed;
+}
+
 void dbg_assert_imp(const char *filename, int line, int test, const char *msg)
 {
 	if(!test)
 	{
+		log_crash();
 		dbg_msg("assert", "%s(%d): %s", filename, line, msg);
+		log_finish_loggers();
 		dbg_break();
 	}
 }
@@ -129,9 +510,13 @@ void dbg_msg(const char *sys, const char *fmt, ...)
 	va_list args;
 	char str[1024 * 4];
 	char *msg;
-	int i, len;
+	int len;
 
 	char timestr[80];
+
+	if(log_queue && log_queue->running && log_rate_limited(sys))
+		return;
+
 	str_timestamp_format(timestr, sizeof(timestr), FORMAT_SPACE);
 
 	str_format(str, sizeof(str), "[%s][%s]: ", timestr, sys);
@@ -147,8 +532,10 @@ void dbg_msg(const char *sys, const char *fmt, ...)
 #endif
 	va_end(args);
 
-	for(i = 0; i < num_loggers; i++)
-		loggers[i].logger(str, loggers[i].user);
+	if(log_queue && log_queue->running)
+		log_enqueue(str);
+	else
+		log_write(str);
 }
 
 #if defined(CONF_FAMILY_WINDOWS)
@@ -288,6 +675,9 @@ void dbg_logger_stdout()
 	}
 #endif
 	dbg_logger(logger_stdout, 0, 0);
+#if !defined(CONF_FAMILY_WINDOWS)
+	log_crash_fds[num_log_crash_fds++] = STDOUT_FILENO;
+#endif
 }
 
 void dbg_logger_debugger()
@@ -300,6 +690,9 @@ void dbg_logger_debugger()
 void dbg_logger_file(IOHANDLE logfile)
 {
 	dbg_logger(logger_file, logger_file_finish, aio_new(logfile));
+#if !defined(CONF_FAMILY_WINDOWS)
+	log_crash_fds[num_log_crash_fds++] = fileno((FILE *) logfile);
+#endif
 }
 
 #if defined(CONF_FAMILY_WINDOWS)
@@ -515,6 +908,49 @@ long int io_length(IOHANDLE io)
 	return length;
 }
 
+void *io_map(IOHANDLE io, long int *size)
+{
+#if defined(CONF_FAMILY_WINDOWS)
+	HANDLE file = (HANDLE) _get_osfhandle(_fileno((FILE *) io));
+	LARGE_INTEGER length;
+	HANDLE mapping;
+	void *data;
+	if(file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &length) || length.QuadPart <= 0 || length.QuadPart > 0x7fffffff)
+		return 0;
+	mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(!mapping)
+		return 0;
+	data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if(!data)
+		return 0;
+	*size = length.QuadPart;
+	return data;
+#else
+	int fd = fileno((FILE *) io);
+	struct stat st;
+	void *data;
+	if(fstat(fd, &st) != 0 || st.st_size <= 0 || st.st_size > 0x7fffffff)
+		return 0;
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(data == MAP_FAILED)
+		return 0;
+	*size = st.st_size;
+	return data;
+#endif
+}
+
+void io_unmap(void *data, long int size)
+{
+	if(!data)
+		return;
+#if defined(CONF_FAMILY_WINDOWS)
+	UnmapViewOfFile(data);
+#else
+	munmap(data, size);
+#endif
+}
+
 unsigned io_write(IOHANDLE io, const void *buffer, unsigned size)
 {
 	return fwrite(buffer, 1, size, (FILE *) io);
@@ -2346,6 +2782,121 @@ int fs_file_time(const char *name, time_t *created, time_t *modified)
 	return 0;
 }
 
+#if defined(CONF_PLATFORM_LINUX)
+struct FS_WATCH
+{
+	int fd;
+	int wake_pipe[2];
+};
+
+FS_WATCH *fs_watch_create()
+{
+	FS_WATCH *watch = (FS_WATCH *) malloc(sizeof(FS_WATCH));
+	watch->fd = inotify_init1(IN_CLOEXEC);
+	if(watch->fd < 0)
+	{
+		free(watch);
+		return NULL;
+	}
+	if(pipe(watch->wake_pipe) != 0)
+	{
+		close(watch->fd);
+		free(watch);
+		return NULL;
+	}
+	return watch;
+}
+
+int fs_watch_add(FS_WATCH *watch, const char *dir)
+{
+	return inotify_add_watch(watch->fd, dir, IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+}
+
+int fs_watch_wait(FS_WATCH *watch, FS_WATCH_EVENT *events, int max_events)
+{
+	char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	struct pollfd fds[2];
+	int num_events = 0;
+	ssize_t bytes;
+	ssize_t offset;
+
+	fds[0].fd = watch->fd;
+	fds[0].events = POLLIN;
+	fds[1].fd = watch->wake_pipe[0];
+	fds[1].events = POLLIN;
+	while(poll(fds, 2, -1) < 0)
+	{
+		if(errno != EINTR)
+			return -1;
+	}
+
+	if(fds[1].revents & POLLIN)
+	{
+		char c;
+		if(read(watch->wake_pipe[0], &c, 1) < 0)
+			return -1;
+		return 0;
+	}
+
+	bytes = read(watch->fd, buffer, sizeof(buffer));
+	if(bytes <= 0)
+		return -1;
+	for(offset = 0; offset < bytes && num_events < max_events;)
+	{
+		const struct inotify_event *event = (const struct inotify_event *) (buffer + offset);
+		events[num_events].id = event->mask & IN_Q_OVERFLOW ? FS_WATCH_OVERFLOW : event->wd;
+		events[num_events].removed = (event->mask & (IN_IGNORED | IN_DELETE_SELF)) != 0;
+		num_events++;
+		offset += sizeof(struct inotify_event) + event->len;
+	}
+	// the remaining events of the buffer are lost
+	if(offset < bytes && max_events > 0)
+	{
+		events[max_events - 1].id = FS_WATCH_OVERFLOW;
+		events[max_events - 1].removed = 0;
+	}
+	return num_events;
+}
+
+void fs_watch_wake(FS_WATCH *watch)
+{
+	char c = 0;
+	if(write(watch->wake_pipe[1], &c, 1) < 0)
+		dbg_msg("fs", "failed to wake watcher");
+}
+
+void fs_watch_destroy(FS_WATCH *watch)
+{
+	close(watch->fd);
+	close(watch->wake_pipe[0]);
+	close(watch->wake_pipe[1]);
+	free(watch);
+}
+#else
+FS_WATCH *fs_watch_create()
+{
+	return NULL;
+}
+
+int fs_watch_add(FS_WATCH *watch, const char *dir)
+{
+	return -1;
+}
+
+int fs_watch_wait(FS_WATCH *watch, FS_WATCH_EVENT *events, int max_events)
+{
+	return -1;
+}
+
+void fs_watch_wake(FS_WATCH *watch)
+{
+}
+
+void fs_watch_destroy(FS_WATCH *watch)
+{
+}
+#endif
+
 void swap_endian(void *data, unsigned elem_size, unsigned num)
 {
 	char *src = (char *) data;
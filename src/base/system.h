@@ -349,6 +349,33 @@ long int io_tell(IOHANDLE io);
 */
 long int io_length(IOHANDLE io);
 
+/*
+	Function: io_map
+		Maps the whole file into memory for reading.
+
+	Parameters:
+		io - Handle to the file.
+		size - Pointer to a variable that receives the size of the mapping.
+
+	Returns:
+		Returns a pointer to the read-only memory, 0 if the file couldn't be mapped or is empty.
+
+	Remarks:
+		- The mapping stays valid after the file is closed.
+		- The memory has to be released with <io_unmap>.
+*/
+void *io_map(IOHANDLE io, long int *size);
+
+/*
+	Function: io_unmap
+		Releases memory mapped with <io_map>.
+
+	Parameters:
+		data - Pointer returned by <io_map>.
+		size - Size of the mapping.
+*/
+void io_unmap(void *data, long int size);
+
 /*
 	Function: io_close
 		Closes a file.
@@ -1698,6 +1725,84 @@ char *fs_read_str(const char *name);
 */
 int fs_file_time(const char *name, time_t *created, time_t *modified);
 
+typedef struct FS_WATCH FS_WATCH;
+
+enum
+{
+	FS_WATCH_OVERFLOW = -1,
+};
+
+typedef struct
+{
+	int id;
+	int removed; /* the directory is gone, the id isn't used anymore */
+} FS_WATCH_EVENT;
+
+/*
+	Function: fs_watch_create
+		Creates a watcher which reports when entries of directories are
+		created, removed or renamed.
+
+	Returns:
+		The watcher or NULL if watching isn't supported on the platform.
+
+	Remarks:
+		- Only implemented on Linux.
+*/
+FS_WATCH *fs_watch_create();
+
+/*
+	Function: fs_watch_add
+		Starts watching a directory. Adding the same directory again
+		returns the same id.
+
+	Parameters:
+		watch - Watcher to add the directory to.
+		dir - Directory to watch.
+
+	Returns:
+		The id of the directory or -1 on failure.
+*/
+int fs_watch_add(FS_WATCH *watch, const char *dir);
+
+/*
+	Function: fs_watch_wait
+		Waits until one of the watched directories changed or
+		<fs_watch_wake> is called.
+
+	Parameters:
+		watch - Watcher to wait for.
+		events - Receives the ids of the changed directories.
+		max_events - Size of the events array.
+
+	Returns:
+		The number of events, 0 when woken and -1 on failure.
+
+	Remarks:
+		- An id of FS_WATCH_OVERFLOW is reported if changes got lost,
+		  everything should be considered changed then.
+		- The same id can be reported several times.
+*/
+int fs_watch_wait(FS_WATCH *watch, FS_WATCH_EVENT *events, int max_events);
+
+/*
+	Function: fs_watch_wake
+		Wakes up a thread waiting in <fs_watch_wait>.
+
+	Parameters:
+		watch - Watcher to wake.
+*/
+void fs_watch_wake(FS_WATCH *watch);
+
+/*
+	Function: fs_watch_destroy
+		Stops watching and frees the watcher. Nothing may be waiting on it.
+
+	Parameters:
+		watch - Watcher to destroy.
+*/
+void fs_watch_destroy(FS_WATCH *watch);
+
 /*
 	Group: Undocumented
 */
@@ -1749,6 +1854,50 @@ void dbg_logger_stdout();
 void dbg_logger_debugger();
 void dbg_logger_file(IOHANDLE logfile);
 
+/*
+	Function: dbg_logger_async
+		Moves the loggers to a background thread, <dbg_msg> only queues
+		the line afterwards. Lines are dropped while the queue is full.
+		The queue is written out on exit and failed asserts.
+*/
+void dbg_logger_async();
+
+/*
+	Function: dbg_logger_crash_handler
+		Installs signal handlers that write the lines still queued by
+		the asynchronous logger to stdout and the log files when the
+		process crashes. Does nothing on Windows or without
+		<dbg_logger_async>.
+*/
+void dbg_logger_crash_handler();
+
+/*
+	Function: dbg_logger_rate_limit
+		Limits the lines a subsystem can log per second with the
+		asynchronous logger, 0 for no limit.
+*/
+void dbg_logger_rate_limit(int lines_per_second);
+
+/*
+	Function: dbg_logger_flush
+		Writes all lines queued by the asynchronous logger.
+*/
+void dbg_logger_flush();
+
+typedef struct
+{
+	unsigned queued;
+	unsigned dropped;
+	unsigned suppressed;
+} DBG_LOGGER_STATS;
+
+/*
+	Function: dbg_logger_stats
+		Gets the lines queued by the asynchronous logger, dropped
+		because the queue was full and suppressed by the rate limit.
+*/
+void dbg_logger_stats(DBG_LOGGER_STATS *stats);
+
 #if defined(CONF_FAMILY_WINDOWS)
 void dbg_console_init();
 void dbg_console_cleanup();
@@ -3,10 +3,6 @@
 #include <base/hash_ctxt.h>
 #include <base/system.h>
 
-static const Uuid TEEWORLDS_NAMESPACE = {{// "e05ddaaa-c4e6-4cfb-b642-5d48e80c0029"
-	0xe0, 0x5d, 0xda, 0xaa, 0xc4, 0xe6, 0x4c, 0xfb,
-	0xb6, 0x42, 0x5d, 0x48, 0xe8, 0x0c, 0x00, 0x29}};
-
 const Uuid UUID_ZEROED = {{// "00000000-0000-0000-0000-000000000000"
 	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
@@ -38,7 +34,7 @@ Uuid CalculateUuid(const char *pName)
 {
 	MD5_CTX Md5;
 	md5_init(&Md5);
-	md5_update(&Md5, TEEWORLDS_NAMESPACE.m_aData, sizeof(TEEWORLDS_NAMESPACE.m_aData));
+	md5_update(&Md5, uuid_detail::TEEWORLDS_NAMESPACE, sizeof(uuid_detail::TEEWORLDS_NAMESPACE));
 	// Without terminating NUL.
 	md5_update(&Md5, (const unsigned char *) pName, str_length(pName));
 	MD5_DIGEST Digest = md5_finish(&Md5);
@@ -60,6 +56,36 @@ Uuid CalculateUuid(const char *pName)
 	return Result;
 }
 
+CUuidCache::CUuidCache()
+{
+	// empty entries are valid for the empty name
+	constexpr Uuid EmptyUuid = CalculateConstUuid("");
+	for(auto &Entry : m_aEntries)
+	{
+		Entry.m_aName[0] = '\0';
+		Entry.m_Uuid = EmptyUuid;
+	}
+}
+
+Uuid CUuidCache::Get(const char *pName)
+{
+	unsigned Hash = 2166136261u;
+	int Length = 0;
+	for(; pName[Length]; Length++)
+		Hash = (Hash ^ (unsigned char) pName[Length]) * 16777619u;
+
+	if(Length >= MAX_NAME_LENGTH)
+		return CalculateUuid(pName);
+
+	CEntry *pEntry = &m_aEntries[Hash % NUM_ENTRIES];
+	if(str_comp(pEntry->m_aName, pName) != 0)
+	{
+		str_copy(pEntry->m_aName, pName, sizeof(pEntry->m_aName));
+		pEntry->m_Uuid = CalculateUuid(pName);
+	}
+	return pEntry->m_Uuid;
+}
+
 void FormatUuid(Uuid Uuid, char *pBuffer, unsigned BufferLength)
 {
 	unsigned char *p = Uuid.m_aData;
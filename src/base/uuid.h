@@ -27,6 +27,137 @@ extern const Uuid UUID_CARBON_NAMESPACE;
 
 Uuid RandomUuid();
 Uuid CalculateUuid(const char *pName);
+
+namespace uuid_detail {
+constexpr unsigned char TEEWORLDS_NAMESPACE[16] = {// "e05ddaaa-c4e6-4cfb-b642-5d48e80c0029"
+	0xe0, 0x5d, 0xda, 0xaa, 0xc4, 0xe6, 0x4c, 0xfb,
+	0xb6, 0x42, 0x5d, 0x48, 0xe8, 0x0c, 0x00, 0x29};
+
+constexpr unsigned MD5_K[64] = {
+	0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+	0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+	0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+	0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+	0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+	0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+	0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+	0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+	0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+	0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+	0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+	0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+	0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+	0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+	0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+	0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+constexpr unsigned MD5_SHIFT[16] = {7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21};
+
+constexpr unsigned RotateLeft(unsigned Value, unsigned Shift)
+{
+	return ((Value << Shift) | (Value >> (32 - Shift))) & 0xffffffffu;
+}
+
+// byte of the padded md5 message "namespace + name"
+constexpr unsigned char MessageByte(const char *pName, unsigned Length, unsigned long long Total, unsigned long long i)
+{
+	if(i < 16)
+		return TEEWORLDS_NAMESPACE[i];
+	if(i < 16 + Length)
+		return (unsigned char) pName[i - 16];
+	if(i == 16 + Length)
+		return 0x80;
+	if(i >= Total - 8)
+		return (unsigned char) (((16ull + Length) * 8) >> ((i - (Total - 8)) * 8));
+	return 0;
+}
+} // namespace uuid_detail
+
+// Same as CalculateUuid, but can be evaluated at compile time, e.g.
+// `constexpr Uuid WeaponID = CalculateConstUuid("Hammer");`
+constexpr Uuid CalculateConstUuid(const char *pName)
+{
+	unsigned Length = 0;
+	while(pName[Length])
+		Length++;
+	const unsigned long long Total = ((16ull + Length + 8) / 64 + 1) * 64;
+
+	unsigned aState[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+	for(unsigned long long Block = 0; Block < Total; Block += 64)
+	{
+		unsigned aWords[16] = {};
+		for(unsigned i = 0; i < 64; i++)
+			aWords[i / 4] |= (unsigned) uuid_detail::MessageByte(pName, Length, Total, Block + i) << ((i % 4) * 8);
+
+		unsigned A = aState[0], B = aState[1], C = aState[2], D = aState[3];
+		for(unsigned i = 0; i < 64; i++)
+		{
+			unsigned F = 0, g = 0;
+			if(i < 16)
+			{
+				F = (B & C) | (~B & D);
+				g = i;
+			}
+			else if(i < 32)
+			{
+				F = (D & B) | (~D & C);
+				g = (5 * i + 1) % 16;
+			}
+			else if(i < 48)
+			{
+				F = B ^ C ^ D;
+				g = (3 * i + 5) % 16;
+			}
+			else
+			{
+				F = C ^ (B | ~D);
+				g = (7 * i) % 16;
+			}
+			F = (F + A + uuid_detail::MD5_K[i] + aWords[g]) & 0xffffffffu;
+			A = D;
+			D = C;
+			C = B;
+			B = (B + uuid_detail::RotateLeft(F, uuid_detail::MD5_SHIFT[(i / 16) * 4 + i % 4])) & 0xffffffffu;
+		}
+		aState[0] = (aState[0] + A) & 0xffffffffu;
+		aState[1] = (aState[1] + B) & 0xffffffffu;
+		aState[2] = (aState[2] + C) & 0xffffffffu;
+		aState[3] = (aState[3] + D) & 0xffffffffu;
+	}
+
+	Uuid Result = {};
+	for(unsigned i = 0; i < 16; i++)
+		Result.m_aData[i] = (aState[i / 4] >> ((i % 4) * 8)) & 0xff;
+
+	// set version 3 and variant 1, see CalculateUuid
+	Result.m_aData[6] = (Result.m_aData[6] & 0x0f) | 0x30;
+	Result.m_aData[8] = (Result.m_aData[8] & 0x3f) | 0x80;
+	return Result;
+}
+
+// Small direct mapped cache for names that are only known at runtime.
+// Not thread safe, every user keeps its own instance.
+class CUuidCache
+{
+	enum
+	{
+		NUM_ENTRIES = 32,
+		MAX_NAME_LENGTH = 32,
+	};
+
+	struct CEntry
+	{
+		char m_aName[MAX_NAME_LENGTH];
+		Uuid m_Uuid;
+	};
+
+	CEntry m_aEntries[NUM_ENTRIES];
+
+public:
+	CUuidCache();
+	Uuid Get(const char *pName);
+};
 // The buffer length should be at least UUID_MAXSTRSIZE.
 void FormatUuid(Uuid Uuid, char *pBuffer, unsigned BufferLength);
 // Returns nonzero on failure.
@@ -2,10 +2,10 @@
 
 #include <engine/console.h>
 #include <engine/engine.h>
-#include <engine/external/json-parser/json.h>
 #include <engine/serverbrowser.h>
 #include <engine/shared/http.h>
 #include <engine/shared/jobs.h>
+#include <engine/shared/jsonparser.h>
 #include <engine/shared/linereader.h>
 #include <engine/shared/serverinfo.h>
 #include <engine/storage.h>
@@ -48,8 +48,8 @@ private:
 		STATE_REFRESHING,
 	};
 
-	static bool Validate(json_value *pJson);
-	static bool Parse(json_value *pJson, std::vector<CServerInfo> *pvServers);
+	static bool Validate(CJsonReader *pReader);
+	static bool Parse(CJsonReader *pReader, std::vector<CServerInfo> *pvServers);
 
 	IHttp *m_pHttp;
 	CConfig *m_pConfig;
@@ -96,11 +96,17 @@ void CServerBrowserHttp::Update()
 		std::shared_ptr<CHttpRequest> pGetServers = nullptr;
 		std::swap(m_pGetServers, pGetServers);
 
-		bool Success = true;
-		json_value *pJson = pGetServers->State() == EHttpState::DONE ? pGetServers->ResultJson() : nullptr;
-		Success = Success && pJson;
-		Success = Success && !Parse(pJson, &m_vServers);
-		json_value_free(pJson);
+		// the list is read straight into the servers, without a tree of the whole document in between
+		bool Success = pGetServers->State() == EHttpState::DONE;
+		if(Success)
+		{
+			unsigned char *pResult;
+			size_t ResultLength;
+			pGetServers->Result(&pResult, &ResultLength);
+			CJsonReader Reader;
+			Reader.SetData(pResult, ResultLength, "serverlist");
+			Success = !Parse(&Reader, &m_vServers);
+		}
 		if(!Success)
 		{
 			dbg_msg("serverbrowser_http", "failed getting serverlist");
@@ -118,37 +124,60 @@ void CServerBrowserHttp::Refresh()
 		m_State = STATE_WANTREFRESH;
 }
 
-bool CServerBrowserHttp::Validate(json_value *pJson)
+bool CServerBrowserHttp::Validate(CJsonReader *pReader)
 {
 	std::vector<CServerInfo> vServers;
-	return Parse(pJson, &vServers);
+	return Parse(pReader, &vServers);
 }
-bool CServerBrowserHttp::Parse(json_value *pJson, std::vector<CServerInfo> *pvServers)
+
+class CServerAddress
+{
+public:
+	char m_aAddress[NETADDR_MAXSTRSIZE] = {0};
+	int64 m_Port = -1;
+	bool m_Supported = false;
+	bool m_HasSupported = false;
+
+	bool Valid() const { return m_aAddress[0] && m_Port >= 0 && m_HasSupported; }
+
+	static bool ReadKey(CJsonReader *pReader, void *pUser)
+	{
+		CServerAddress *pSelf = static_cast<CServerAddress *>(pUser);
+		if(pReader->IsKey("ip"))
+			pReader->ReadString(pSelf->m_aAddress, sizeof(pSelf->m_aAddress));
+		else if(pReader->IsKey("port"))
+			pReader->ReadInteger(&pSelf->m_Port);
+		else if(pReader->IsKey("supports7"))
+			pSelf->m_HasSupported = pReader->ReadBoolean(&pSelf->m_Supported);
+		else
+			return false;
+		return true;
+	}
+};
+
+bool CServerBrowserHttp::Parse(CJsonReader *pReader, std::vector<CServerInfo> *pvServers)
 {
 	std::vector<CServerInfo> vServers;
 
-	const json_value &Servers = *pJson;
-	if(Servers.type != json_array)
+	if(!pReader->NextValue(CJsonReader::TOKEN_BEGIN_ARRAY))
 	{
 		return true;
 	}
-	for(unsigned int i = 0; i < Servers.u.array.length; i++)
+	while(pReader->Next() == CJsonReader::TOKEN_BEGIN_OBJECT)
 	{
-		const json_value &Server = Servers[i];
-		const json_value &Port = Server["port"];
-		const json_value &Addresses = Server["ip"];
-		const json_value &Supported = Server["supports7"];
+		CServerAddress Address;
 		CServerInfo2 ParsedInfo;
-		if(Addresses.type != json_string || Supported.type != json_boolean || Port.type != json_integer)
+		const bool InfoError = CServerInfo2::FromJsonReader(&ParsedInfo, pReader, CServerAddress::ReadKey, &Address);
+		if(pReader->Failed() || !Address.Valid())
 		{
 			return true;
 		}
 
-		if(Supported.u.boolean == 0)
+		if(!Address.m_Supported)
 		{
 			continue;
 		}
-		if(CServerInfo2::FromJson(&ParsedInfo, &Server))
+		if(InfoError)
 		{
 			// Only skip the current server on parsing
 			// failure; the server info is "user input" by
@@ -157,12 +186,16 @@ bool CServerBrowserHttp::Parse(json_value *pJson, std::vector<CServerInfo> *pvSe
 			continue;
 		}
 		CServerInfo SetInfo = ParsedInfo;
-		str_format(SetInfo.m_aAddress, sizeof(SetInfo.m_aAddress), "%s:%d", Addresses.u.string.ptr, static_cast<int>(Port.u.integer));
+		str_format(SetInfo.m_aAddress, sizeof(SetInfo.m_aAddress), "%s:%d", Address.m_aAddress, static_cast<int>(Address.m_Port));
 		net_addr_from_str(&SetInfo.m_NetAddr, SetInfo.m_aAddress);
 		SetInfo.m_InfoGotByHttp = true;
 		vServers.push_back(SetInfo);
 	}
-	*pvServers = vServers;
+	if(pReader->Token() != CJsonReader::TOKEN_END_ARRAY || pReader->Next() != CJsonReader::TOKEN_END)
+	{
+		return true;
+	}
+	*pvServers = std::move(vServers);
 	return false;
 }
 
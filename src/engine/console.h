@@ -64,6 +64,13 @@ public:
 		int GetAccessLevel() const { return m_AccessLevel; }
 	};
 
+	// a command line which was split and tokenized once, see ParseLine
+	class IParsedLine
+	{
+	public:
+		virtual ~IParsedLine() {}
+	};
+
 	typedef void (*FPrintCallback)(const char *pStr, void *pUser, bool Highlighted);
 	typedef void (*FPossibleCallback)(int Index, const char *pCmd, void *pUser);
 	typedef void (*FCommandCallback)(IResult *pResult, void *pUserData);
@@ -95,6 +102,10 @@ public:
 	virtual void ExecuteLineStroked(int Stroke, const char *pStr) = 0;
 	virtual bool ExecuteFile(const char *pFilename) = 0;
 
+	// the returned line has to be deleted by the caller, it is executed like ExecuteLine would do it with the source string
+	virtual IParsedLine *ParseLine(const char *pStr) = 0;
+	virtual void ExecuteParsedLine(IParsedLine *pLine) = 0;
+
 	virtual int RegisterPrintCallback(int OutputLevel, FPrintCallback pfnPrintCallback, void *pUserData) = 0;
 	virtual void SetPrintOutputLevel(int Index, int OutputLevel) = 0;
 	virtual void Print(int Level, const char *pFrom, const char *pStr, bool Highlighted = false) = 0;
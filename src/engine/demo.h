@@ -10,6 +10,12 @@ enum
 	MAX_TIMELINE_MARKERS = 64
 };
 
+// the keyframe index of a demo is written next to it
+inline void DemoIndexFilename(const char *pDemoFilename, char *pBuffer, int BufferSize)
+{
+	str_format(pBuffer, BufferSize, "%s.index", pDemoFilename);
+}
+
 struct CDemoHeader
 {
 	unsigned char m_aMarker[7];
@@ -18,6 +18,16 @@ public:
 	virtual void Init() = 0;
 	virtual const char *Localize(const char *pCode, const char *pStr, const char *pContext) = 0;
 
+	// handles stay valid for the lifetime of the localization, -1 is the untranslated source language
+	virtual int FindLanguage(const char *pCode) = 0;
+	// dense ids for source strings, the same string and context always get the same id.
+	// returns -1 once the table is full
+	virtual int RegisterString(const char *pStr, const char *pContext) = 0;
+	// the translation with the parent fallback applied, or the registered source string
+	virtual const char *Localize(int Language, int String) = 0;
+	// registers the string on first use, returns pStr itself if there is no translation
+	virtual const char *Localize(int Language, const char *pStr, const char *pContext) = 0;
+
 	// return: size of pInfo.
 	virtual int GetLanguagesInfo(SLanguageInfo **ppInfo) = 0;
 };
@@ -5,6 +5,8 @@
 #include "kernel.h"
 #include "message.h"
 
+#include <engine/shared/protocol.h>
+
 class IServer : public IInterface
 {
 	MACRO_INTERFACE("server", 0)
@@ -26,6 +28,8 @@ public:
 	int TickSpeed() const { return m_TickSpeed; }
 
 	virtual const char *ClientLanguage(int ClientID) const = 0;
+	// localization handle of the client language, -1 for the source language
+	virtual int ClientLanguageHandle(int ClientID) const = 0;
 	virtual const char *ClientName(int ClientID) const = 0;
 	virtual const char *ClientClan(int ClientID) const = 0;
 	virtual int ClientCountry(int ClientID) const = 0;
@@ -33,6 +37,8 @@ public:
 	virtual bool ClientIngame(int ClientID) const = 0;
 	virtual int GetClientInfo(int ClientID, CClientInfo *pInfo) const = 0;
 	virtual void GetClientAddr(int ClientID, char *pAddrStr, int Size) const = 0;
+	// false if the client isn't ingame
+	virtual bool GetClientAddr(int ClientID, NETADDR *pAddr) const = 0;
 	virtual int GetClientVersion(int ClientID) const = 0;
 	virtual int GetCarbonClientVersion(int ClientID) const = 0;
 
@@ -47,6 +53,49 @@ public:
 		return SendMsg(&Packer, Flags, ClientID);
 	}
 
+	// sends one packed message to every client in the mask
+	virtual int SendMsgMask(CMsgPacker *pMsg, int Flags, int64 Mask) = 0;
+
+	template<class T>
+	int SendPackMsgMask(T *pMsg, int Flags, int64 Mask)
+	{
+		CMsgPacker Packer(pMsg->MsgID(), false);
+		if(pMsg->Pack(&Packer))
+			return -1;
+		return SendMsgMask(&Packer, Flags, Mask);
+	}
+
+	// packs the message once per language of the recipients. pfnLocalize(pMsg, ClientID)
+	// fills in the localized fields for a client of that language before it gets packed,
+	// only the first group is recorded to the demo.
+	template<class T, class F>
+	int SendLocalizedPackMsg(T *pMsg, int Flags, int64 Mask, F &&pfnLocalize)
+	{
+		for(int i = 0; i < SERVER_MAX_CLIENTS && Mask; i++)
+		{
+			if(!(Mask & ((int64) 1 << i)))
+				continue;
+
+			const int Language = ClientLanguageHandle(i);
+			int64 Group = 0;
+			for(int j = i; j < SERVER_MAX_CLIENTS; j++)
+			{
+				if((Mask & ((int64) 1 << j)) && ClientLanguageHandle(j) == Language)
+					Group |= (int64) 1 << j;
+			}
+			Mask &= ~Group;
+
+			pfnLocalize(pMsg, i);
+			if(SendPackMsgMask(pMsg, Flags, Group))
+				return -1;
+			Flags |= MSGFLAG_NORECORD;
+		}
+		return 0;
+	}
+
+	// messages that were sent to more than one client with a single pack
+	virtual int64 NumPacksSaved() const = 0;
+
 	virtual void SetClientLanguage(int ClientID, char const *pLanguage) = 0;
 	virtual void SetClientName(int ClientID, char const *pName) = 0;
 	virtual void SetClientClan(int ClientID, char const *pClan) = 0;
@@ -77,6 +126,9 @@ public:
 
 	virtual const char *Localize(const char *pCode, const char *pStr, const char *pContext = "") = 0;
 	virtual const char *Localize(int ClientID, const char *pStr, const char *pContext = "") = 0;
+	// ids from RegisterLocalizedString index the per-language string tables directly
+	virtual int RegisterLocalizedString(const char *pStr, const char *pContext = "") = 0;
+	virtual const char *Localize(int ClientID, int String) = 0;
 
 	virtual int GetLanguagesInfo(struct SLanguageInfo **ppInfo) = 0;
 };
@@ -122,6 +174,9 @@ public:
 	 * @param i The client id.
 	 */
 	virtual void OnUpdatePlayerServerInfo(class CJsonStringWriter *pJSonWriter, int Id) = 0;
+
+	// adds the metrics of the game to the ones the server reports
+	virtual void OnMetrics(class CMetricsWriter *pWriter) = 0;
 };
 
 extern IGameServer *CreateGameServer();
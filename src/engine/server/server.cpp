@@ -172,27 +172,34 @@ int CServerBan::BanExt(T *pBanPool, const typename T::CDataType *pData, int Seco
 		}
 	}
 
-	int Result = Ban(pBanPool, pData, Seconds, pReason);
-	if(Result != 0)
-		return Result;
+	return Ban(pBanPool, pData, Seconds, pReason);
+}
 
-	// drop banned clients
-	typename T::CDataType Data = *pData;
+template<class T>
+void CServerBan::DropBanned(CBan<T> *pBan)
+{
 	for(int i = 0; i < SERVER_MAX_CLIENTS; ++i)
 	{
 		if(Server()->m_aClients[i].m_State == CServer::CClient::STATE_EMPTY)
 			continue;
 
-		if(NetMatch(&Data, Server()->m_NetServer.ClientAddr(i)))
+		if(NetMatch(&pBan->m_Data, Server()->m_NetServer.ClientAddr(i)))
 		{
-			CNetHash NetHash(&Data);
 			char aBuf[256];
-			MakeBanInfo(pBanPool->Find(&Data, &NetHash), aBuf, sizeof(aBuf), MSGTYPE_PLAYER);
+			MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_PLAYER);
 			Server()->m_NetServer.Drop(i, aBuf);
 		}
 	}
+}
 
-	return Result;
+void CServerBan::OnBan(CBanAddr *pBan)
+{
+	DropBanned(pBan);
+}
+
+void CServerBan::OnBan(CBanRange *pBan)
+{
+	DropBanned(pBan);
 }
 
 int CServerBan::BanAddr(const NETADDR *pAddr, int Seconds, const char *pReason)
@@ -269,6 +276,11 @@ CServer::CServer() :
 	m_GeneratedRconPassword = 0;
 
 	m_ServerInfoNeedsUpdate = false;
+	m_NumPacksSaved = 0;
+	// in seconds, a tick has 20ms
+	static const double s_aDurationBounds[] = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.02, 0.05};
+	m_TickDuration.Init(s_aDurationBounds, sizeof(s_aDurationBounds) / sizeof(s_aDurationBounds[0]));
+	m_SnapshotDuration.Init(s_aDurationBounds, sizeof(s_aDurationBounds) / sizeof(s_aDurationBounds[0]));
 	m_pRegister = nullptr;
 	m_pLocalization = nullptr;
 
@@ -280,6 +292,7 @@ void CServer::SetClientLanguage(int ClientID, const char *pLanguage)
 	if(ClientID < 0 || ClientID >= SERVER_MAX_CLIENTS || m_aClients[ClientID].m_State < CClient::STATE_READY || !pLanguage)
 		return;
 	str_copy(m_aClients[ClientID].m_aLanguage, pLanguage, sizeof(m_aClients[ClientID].m_aLanguage, pLanguage));
+	m_aClients[ClientID].m_LanguageHandle = m_pLocalization->FindLanguage(m_aClients[ClientID].m_aLanguage);
 }
 
 void CServer::SetClientName(int ClientID, const char *pName)
@@ -394,6 +407,16 @@ void CServer::GetClientAddr(int ClientID, char *pAddrStr, int Size) const
 		net_addr_str(m_NetServer.ClientAddr(ClientID), pAddrStr, Size, false);
 }
 
+bool CServer::GetClientAddr(int ClientID, NETADDR *pAddr) const
+{
+	if(ClientID >= 0 && ClientID < SERVER_MAX_CLIENTS && m_aClients[ClientID].m_State == CClient::STATE_INGAME)
+	{
+		*pAddr = *m_NetServer.ClientAddr(ClientID);
+		return true;
+	}
+	return false;
+}
+
 int CServer::GetClientVersion(int ClientID) const
 {
 	if(ClientID >= 0 && ClientID < SERVER_MAX_CLIENTS && m_aClients[ClientID].m_State == CClient::STATE_INGAME)
@@ -418,6 +441,14 @@ const char *CServer::ClientLanguage(int ClientID) const
 		return Config()->m_SvDefaultLanguage;
 }
 
+// same choice as ClientLanguage, but with the handle resolved in SetClientLanguage
+int CServer::ClientLanguageHandle(int ClientID) const
+{
+	if(ClientID >= 0 && ClientID < SERVER_MAX_CLIENTS && m_aClients[ClientID].m_State == CServer::CClient::STATE_INGAME)
+		return m_aClients[ClientID].m_LanguageHandle;
+	return m_pLocalization->FindLanguage(Config()->m_SvDefaultLanguage);
+}
+
 const char *CServer::ClientName(int ClientID) const
 {
 	if(ClientID < 0 || ClientID >= SERVER_MAX_CLIENTS || m_aClients[ClientID].m_State == CServer::CClient::STATE_EMPTY)
@@ -536,6 +567,42 @@ int CServer::SendMsg(CMsgPacker *pMsg, int Flags, int ClientID)
 	return 0;
 }
 
+int CServer::SendMsgMask(CMsgPacker *pMsg, int Flags, int64 Mask)
+{
+	if(!pMsg)
+		return -1;
+
+	CNetChunk Packet;
+	mem_zero(&Packet, sizeof(CNetChunk));
+	Packet.m_pData = pMsg->Data();
+	Packet.m_DataSize = pMsg->Size();
+
+	if(Flags & MSGFLAG_VITAL)
+		Packet.m_Flags |= NETSENDFLAG_VITAL;
+	if(Flags & MSGFLAG_FLUSH)
+		Packet.m_Flags |= NETSENDFLAG_FLUSH;
+
+	// write message to demo recorder
+	if(!(Flags & MSGFLAG_NORECORD))
+		m_DemoRecorder.RecordMessage(pMsg->Data(), pMsg->Size());
+
+	if(Flags & MSGFLAG_NOSEND)
+		return 0;
+
+	int NumSent = 0;
+	for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
+	{
+		if(!(Mask & ((int64) 1 << i)) || m_aClients[i].m_State == CClient::STATE_EMPTY || m_aClients[i].m_Quitting)
+			continue;
+		Packet.m_ClientID = i;
+		m_NetServer.Send(&Packet);
+		NumSent++;
+	}
+	if(NumSent > 1)
+		m_NumPacksSaved += NumSent - 1;
+	return 0;
+}
+
 void CServer::DoSnapshot()
 {
 	GameServer()->OnPreSnap();
@@ -625,6 +692,7 @@ void CServer::DoSnapshot()
 
 				SnapshotSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData, sizeof(aCompData));
 				NumPackets = (SnapshotSize + MaxSize - 1) / MaxSize;
+				m_aClients[i].m_SnapshotBytes += SnapshotSize;
 
 				for(int n = 0, Left = SnapshotSize; Left > 0; n++)
 				{
@@ -697,9 +765,11 @@ int CServer::NewClientCallback(int ClientID, void *pUser)
 	pThis->m_aClients[ClientID].m_Quitting = false;
 	pThis->m_aClients[ClientID].m_Latency = 0;
 	pThis->m_aClients[ClientID].m_CarbonVersion = 0;
+	pThis->m_aClients[ClientID].m_SnapshotBytes = 0;
 	pThis->m_aClients[ClientID].Reset();
 
 	str_copy(pThis->m_aClients[ClientID].m_aLanguage, pThis->Config()->m_SvDefaultLanguage, sizeof(pThis->m_aClients[ClientID].m_aLanguage));
+	pThis->m_aClients[ClientID].m_LanguageHandle = pThis->m_pLocalization->FindLanguage(pThis->m_aClients[ClientID].m_aLanguage);
 
 	return 0;
 }
@@ -1568,6 +1638,7 @@ int CServer::Run()
 			bool ShouldSnap = false;
 			while(Now > TickStartTime(m_CurrentGameTick + 1))
 			{
+				const int64 TickStart = time_get();
 				m_CurrentGameTick++;
 				NewTicks = true;
 				if((m_CurrentGameTick % 2) == 0)
@@ -1590,13 +1661,18 @@ int CServer::Run()
 				}
 
 				GameServer()->OnTick();
+				m_TickDuration.Observe((time_get() - TickStart) / (double) time_freq());
 			}
 
 			// snap game
 			if(NewTicks)
 			{
 				if(Config()->m_SvHighBandwidth || ShouldSnap)
+				{
+					const int64 SnapshotStart = time_get();
 					DoSnapshot();
+					m_SnapshotDuration.Observe((time_get() - SnapshotStart) / (double) time_freq());
+				}
 
 				UpdateClientRconCommands();
 				UpdateClientMapListEntries();
@@ -1769,6 +1845,7 @@ void CServer::DemoRecorder_HandleAutoStart()
 		char aDate[20];
 		str_timestamp(aDate, sizeof(aDate));
 		str_format(aFilename, sizeof(aFilename), "demos/%s_%s.demo", "auto/autorecord", aDate);
+		m_DemoRecorder.SetKeyframeInterval(Config()->m_SvDemoKeyframeInterval);
 		m_DemoRecorder.Start(aFilename, GameServer()->NetVersion(), m_aCurrentMap, m_CurrentMapSha256, m_CurrentMapCrc, "server");
 		if(Config()->m_SvAutoDemoMax)
 		{
@@ -1796,6 +1873,7 @@ void CServer::ConRecord(IConsole::IResult *pResult, void *pUser)
 		str_timestamp(aDate, sizeof(aDate));
 		str_format(aFilename, sizeof(aFilename), "demos/demo_%s.demo", aDate);
 	}
+	pServer->m_DemoRecorder.SetKeyframeInterval(pServer->Config()->m_SvDemoKeyframeInterval);
 	pServer->m_DemoRecorder.Start(aFilename, pServer->GameServer()->NetVersion(), pServer->m_aCurrentMap, pServer->m_CurrentMapSha256, pServer->m_CurrentMapCrc, "server");
 }
 
@@ -1928,6 +2006,92 @@ void CServer::ConNetworkStats(IConsole::IResult *pResult, void *pUser)
 	pServer->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "network", aBuf);
 }
 
+void CServer::SendMetricsLine(const char *pLine, void *pUser)
+{
+	CServer *pServer = (CServer *) pUser;
+	// only the econ or rcon client asking gets them, the others and the log stay readable
+	if(pServer->m_Econ.UserClientID() >= 0)
+		pServer->m_Econ.Send(pServer->m_Econ.UserClientID(), pLine);
+	else if(pServer->m_RconClientID >= 0 && pServer->m_RconClientID < SERVER_MAX_CLIENTS)
+		pServer->SendRconLine(pServer->m_RconClientID, pLine);
+	else
+		pServer->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "metrics", pLine);
+}
+
+void CServer::ConMetrics(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pServer = (CServer *) pUser;
+	CMetricsWriter Writer(SendMetricsLine, pServer);
+
+	Writer.Gauge("carbon_tick", "Current game tick", pServer->Tick());
+	Writer.Histogram("carbon_tick_duration_seconds", "Duration of the game ticks", &pServer->m_TickDuration);
+	Writer.Histogram("carbon_snapshot_duration_seconds", "Duration of creating and sending the snapshots of a tick", &pServer->m_SnapshotDuration);
+
+	int NumPlayers = 0, NumSpectators = 0, NumBots = 0;
+	for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
+	{
+		if(pServer->GameServer()->IsClientBot(i))
+			NumBots++;
+		else if(pServer->m_aClients[i].m_State == CClient::STATE_INGAME)
+		{
+			if(pServer->GameServer()->IsClientSpectator(i))
+				NumSpectators++;
+			else
+				NumPlayers++;
+		}
+	}
+	Writer.Describe("carbon_clients", "gauge", "Clients in the game");
+	Writer.Value("carbon_clients", "kind=\"player\"", (int64) NumPlayers);
+	Writer.Value("carbon_clients", "kind=\"spectator\"", (int64) NumSpectators);
+	Writer.Value("carbon_clients", "kind=\"bot\"", (int64) NumBots);
+
+	char aLabels[32];
+	Writer.Describe("carbon_snapshot_bytes_total", "counter", "Compressed snapshot bytes sent to a client");
+	for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
+	{
+		if(pServer->m_aClients[i].m_State == CClient::STATE_EMPTY)
+			continue;
+		str_format(aLabels, sizeof(aLabels), "client=\"%d\"", i);
+		Writer.Value("carbon_snapshot_bytes_total", aLabels, pServer->m_aClients[i].m_SnapshotBytes);
+	}
+	Writer.Describe("carbon_resends_total", "counter", "Chunks resent to a client");
+	for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
+	{
+		if(pServer->m_aClients[i].m_State == CClient::STATE_EMPTY)
+			continue;
+		str_format(aLabels, sizeof(aLabels), "client=\"%d\"", i);
+		Writer.Value("carbon_resends_total", aLabels, pServer->m_NetServer.ClientResends(i));
+	}
+
+	NETSTATS Stats;
+	net_stats(&Stats);
+	Writer.Describe("carbon_network_packets_total", "counter", "Packets sent and received");
+	Writer.Value("carbon_network_packets_total", "direction=\"sent\"", (int64) (unsigned) Stats.sent_packets);
+	Writer.Value("carbon_network_packets_total", "direction=\"recv\"", (int64) (unsigned) Stats.recv_packets);
+	Writer.Describe("carbon_network_bytes_total", "counter", "Bytes sent and received");
+	Writer.Value("carbon_network_bytes_total", "direction=\"sent\"", (int64) (unsigned) Stats.sent_bytes);
+	Writer.Value("carbon_network_bytes_total", "direction=\"recv\"", (int64) (unsigned) Stats.recv_bytes);
+	Writer.Counter("carbon_packs_saved_total", "Packs saved by sending a message to several clients at once", pServer->m_NumPacksSaved);
+
+	DBG_LOGGER_STATS LoggerStats;
+	dbg_logger_stats(&LoggerStats);
+	Writer.Describe("carbon_log_lines_total", "counter", "Lines given to the asynchronous logger");
+	Writer.Value("carbon_log_lines_total", "state=\"queued\"", (int64) LoggerStats.queued);
+	Writer.Value("carbon_log_lines_total", "state=\"dropped\"", (int64) LoggerStats.dropped);
+	Writer.Value("carbon_log_lines_total", "state=\"suppressed\"", (int64) LoggerStats.suppressed);
+
+	IStorage::CIndexStats IndexStats;
+	pServer->Storage()->GetIndexStats(&IndexStats);
+	Writer.Gauge("carbon_storage_index_directories", "Directories in the storage index", IndexStats.m_NumDirectories);
+	Writer.Counter("carbon_storage_lookups_total", "Lookups answered by the storage index", IndexStats.m_Lookups);
+	Writer.Counter("carbon_storage_hits_total", "Storage index lookups without listing a directory", IndexStats.m_Hits);
+	Writer.Counter("carbon_storage_saved_syscalls_total", "Opens and directory listings the storage index saved", IndexStats.m_SavedSyscalls);
+	Writer.Counter("carbon_storage_watch_failures_total", "Directories the storage index couldn't watch", IndexStats.m_WatchFailures);
+
+	pServer->GameServer()->OnMetrics(&Writer);
+	Writer.Finish();
+}
+
 void CServer::RegisterCommands()
 {
 	// register console commands
@@ -1953,6 +2117,7 @@ void CServer::RegisterCommands()
 	Console()->Chain("sv_map", ConchainMapUpdate, this);
 
 	Console()->Register("network_stats", "", CFGFLAG_SERVER, ConNetworkStats, this, "Print network stats");
+	Console()->Register("metrics", "", CFGFLAG_SERVER, ConMetrics, this, "Print the server metrics in the prometheus text format");
 
 	// register console commands in sub parts
 	m_ServerBan.InitServerBan(Console(), Storage(), this);
@@ -1989,7 +2154,17 @@ const char *CServer::Localize(const char *pCode, const char *pStr, const char *p
 
 const char *CServer::Localize(int ClientID, const char *pStr, const char *pContext)
 {
-	return m_pLocalization->Localize(ClientLanguage(ClientID), pStr, pContext);
+	return m_pLocalization->Localize(ClientLanguageHandle(ClientID), pStr, pContext);
+}
+
+int CServer::RegisterLocalizedString(const char *pStr, const char *pContext)
+{
+	return m_pLocalization->RegisterString(pStr, pContext);
+}
+
+const char *CServer::Localize(int ClientID, int String)
+{
+	return m_pLocalization->Localize(ClientLanguageHandle(ClientID), String);
 }
 
 int CServer::GetLanguagesInfo(SLanguageInfo **ppInfo)
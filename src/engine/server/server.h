@@ -9,6 +9,7 @@
 #include <engine/server.h>
 #include <engine/shared/http.h>
 #include <engine/shared/memheap.h>
+#include <engine/shared/metrics.h>
 
 class CSnapIDPool
 {
@@ -49,6 +50,13 @@ class CServerBan : public CNetBan
 
 	template<class T>
 	int BanExt(T *pBanPool, const typename T::CDataType *pData, int Seconds, const char *pReason);
+	// drops the clients the ban matches
+	template<class T>
+	void DropBanned(CBan<T> *pBan);
+
+protected:
+	void OnBan(CBanAddr *pBan) override;
+	void OnBan(CBanRange *pBan) override;
 
 public:
 	class CServer *Server() const { return m_pServer; }
@@ -127,6 +135,7 @@ public:
 		int m_CurrentInput;
 
 		char m_aLanguage[8];
+		int m_LanguageHandle;
 		char m_aName[MAX_NAME_ARRAY_SIZE];
 		char m_aClan[MAX_CLAN_ARRAY_SIZE];
 		int m_Version;
@@ -137,6 +146,7 @@ public:
 		int m_AuthTries;
 
 		int m_MapChunk;
+		int64 m_SnapshotBytes;
 		bool m_NoRconNote;
 		bool m_Quitting;
 		const IConsole::CCommandInfo *m_pRconCmdToSend;
@@ -200,6 +210,10 @@ public:
 
 	CDemoRecorder m_DemoRecorder;
 	bool m_ServerInfoNeedsUpdate;
+	int64 m_NumPacksSaved;
+
+	CMetricsHistogram m_TickDuration;
+	CMetricsHistogram m_SnapshotDuration;
 
 	CServer();
 
@@ -225,9 +239,11 @@ public:
 	bool IsBanned(int ClientID) override;
 	int GetClientInfo(int ClientID, CClientInfo *pInfo) const override;
 	void GetClientAddr(int ClientID, char *pAddrStr, int Size) const override;
+	bool GetClientAddr(int ClientID, NETADDR *pAddr) const override;
 	int GetClientVersion(int ClientID) const override;
 	int GetCarbonClientVersion(int ClientID) const override;
 	const char *ClientLanguage(int ClientID) const override;
+	int ClientLanguageHandle(int ClientID) const override;
 	const char *ClientName(int ClientID) const override;
 	const char *ClientClan(int ClientID) const override;
 	int ClientCountry(int ClientID) const override;
@@ -235,6 +251,8 @@ public:
 	bool ClientIngame(int ClientID) const override;
 
 	int SendMsg(CMsgPacker *pMsg, int Flags, int ClientID) override;
+	int SendMsgMask(CMsgPacker *pMsg, int Flags, int64 Mask) override;
+	int64 NumPacksSaved() const override { return m_NumPacksSaved; }
 
 	void DoSnapshot();
 
@@ -292,6 +310,8 @@ public:
 	static void ConchainMapUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 
 	static void ConNetworkStats(IConsole::IResult *pResult, void *pUser);
+	static void SendMetricsLine(const char *pLine, void *pUser);
+	static void ConMetrics(IConsole::IResult *pResult, void *pUser);
 
 	void RegisterCommands();
 
@@ -302,6 +322,8 @@ public:
 
 	const char *Localize(const char *pCode, const char *pStr, const char *pContext = "") override;
 	const char *Localize(int ClientID, const char *pStr, const char *pContext = "") override;
+	int RegisterLocalizedString(const char *pStr, const char *pContext = "") override;
+	const char *Localize(int ClientID, int String) override;
 	int GetLanguagesInfo(SLanguageInfo **ppInfo) override;
 };
 
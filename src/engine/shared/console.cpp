@@ -286,6 +286,38 @@ void CConsole::Print(int Level, const char *pFrom, const char *pStr, bool Highli
 	}
 }
 
+// returns the end of the command starting at pStr and sets pNextPart to the command following a separator
+static const char *FindPartEnd(const char *pStr, const char **ppNextPart)
+{
+	const char *pEnd = pStr;
+	int InString = 0;
+
+	*ppNextPart = 0;
+	while(*pEnd)
+	{
+		if(*pEnd == '"')
+			InString ^= 1;
+		else if(*pEnd == '\\') // escape sequences
+		{
+			if(pEnd[1] == '"')
+				pEnd++;
+		}
+		else if(!InString)
+		{
+			if(*pEnd == ';') // command separator
+			{
+				*ppNextPart = pEnd + 1;
+				break;
+			}
+			else if(*pEnd == '#') // comment, no need to do anything more
+				break;
+		}
+
+		pEnd++;
+	}
+	return pEnd;
+}
+
 bool CConsole::LineIsValid(const char *pStr)
 {
 	if(!pStr)
@@ -298,32 +330,8 @@ bool CConsole::LineIsValid(const char *pStr)
 	do
 	{
 		CResult Result;
-		const char *pEnd = pStr;
 		const char *pNextPart = 0;
-		int InString = 0;
-
-		while(*pEnd)
-		{
-			if(*pEnd == '"')
-				InString ^= 1;
-			else if(*pEnd == '\\') // escape sequences
-			{
-				if(pEnd[1] == '"')
-					pEnd++;
-			}
-			else if(!InString)
-			{
-				if(*pEnd == ';') // command separator
-				{
-					pNextPart = pEnd + 1;
-					break;
-				}
-				else if(*pEnd == '#') // comment, no need to do anything more
-					break;
-			}
-
-			pEnd++;
-		}
+		const char *pEnd = FindPartEnd(pStr, &pNextPart);
 
 		if(ParseStart(&Result, pStr, (pEnd - pStr) + 1) != 0)
 			return false;
@@ -343,32 +351,8 @@ void CConsole::ExecuteLineStroked(int Stroke, const char *pStr)
 	while(pStr && *pStr)
 	{
 		CResult Result;
-		const char *pEnd = pStr;
 		const char *pNextPart = 0;
-		int InString = 0;
-
-		while(*pEnd)
-		{
-			if(*pEnd == '"')
-				InString ^= 1;
-			else if(*pEnd == '\\') // escape sequences
-			{
-				if(pEnd[1] == '"')
-					pEnd++;
-			}
-			else if(!InString)
-			{
-				if(*pEnd == ';') // command separator
-				{
-					pNextPart = pEnd + 1;
-					break;
-				}
-				else if(*pEnd == '#') // comment, no need to do anything more
-					break;
-			}
-
-			pEnd++;
-		}
+		const char *pEnd = FindPartEnd(pStr, &pNextPart);
 
 		if(ParseStart(&Result, pStr, (pEnd - pStr) + 1) != 0)
 			return;
@@ -454,9 +438,47 @@ int CConsole::PossibleMaps(const char *pStr, FPossibleCallback pfnCallback, void
 	return Index;
 }
 
+unsigned CConsole::CommandHash(const char *pName)
+{
+	// fnv-1a over the lower case name
+	unsigned Hash = 2166136261u;
+	for(; *pName; pName++)
+	{
+		unsigned char c = *pName;
+		if(c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		Hash = (Hash ^ c) * 16777619u;
+	}
+	return Hash % COMMAND_HASH_SIZE;
+}
+
+void CConsole::AddCommandHash(CCommand *pCommand)
+{
+	// same position rule as AddCommandSorted, duplicate names resolve as they did with the list
+	CCommand **ppCommand = &m_apCommandHash[CommandHash(pCommand->m_pName)];
+	while(*ppCommand && str_comp(pCommand->m_pName, (*ppCommand)->m_pName) > 0)
+		ppCommand = &(*ppCommand)->m_pNextHash;
+	pCommand->m_pNextHash = *ppCommand;
+	*ppCommand = pCommand;
+	m_CommandGeneration++;
+}
+
+void CConsole::RemoveCommandHash(CCommand *pCommand)
+{
+	for(CCommand **ppCommand = &m_apCommandHash[CommandHash(pCommand->m_pName)]; *ppCommand; ppCommand = &(*ppCommand)->m_pNextHash)
+	{
+		if(*ppCommand == pCommand)
+		{
+			*ppCommand = pCommand->m_pNextHash;
+			break;
+		}
+	}
+	m_CommandGeneration++;
+}
+
 CConsole::CCommand *CConsole::FindCommand(const char *pName, int FlagMask)
 {
-	for(CCommand *pCommand = m_pFirstCommand; pCommand; pCommand = pCommand->m_pNext)
+	for(CCommand *pCommand = m_apCommandHash[CommandHash(pName)]; pCommand; pCommand = pCommand->m_pNextHash)
 	{
 		if(pCommand->m_Flags & FlagMask && str_comp_nocase(pCommand->m_pName, pName) == 0)
 		{
@@ -481,6 +503,127 @@ void CConsole::ExecuteLineFlag(const char *pStr, int FlagMask)
 	m_FlagMask = Temp;
 }
 
+IConsole::IParsedLine *CConsole::ParseLine(const char *pStr)
+{
+	CParsedLine *pLine = new CParsedLine();
+	pLine->m_Line = pStr ? pStr : "";
+	ParseLineParts(pLine);
+	return pLine;
+}
+
+void CConsole::ParseLineParts(CParsedLine *pLine)
+{
+	pLine->m_FlagMask = m_FlagMask;
+	pLine->m_Generation = m_CommandGeneration;
+	pLine->m_vStorage.clear();
+	pLine->m_vParts.clear();
+
+	const char *pStr = pLine->m_Line.c_str();
+	while(pStr && *pStr)
+	{
+		CResult Result;
+		const char *pNextPart = 0;
+		const char *pEnd = FindPartEnd(pStr, &pNextPart);
+
+		if(ParseStart(&Result, pStr, (pEnd - pStr) + 1) != 0)
+			return;
+
+		if(!*Result.m_pCommand)
+			return;
+
+		CParsedLine::CPart Part;
+		Part.m_pCommand = FindCommand(Result.m_pCommand, m_FlagMask);
+		Part.m_ArgsValid = false;
+		if(Part.m_pCommand)
+		{
+			// the stroke token is swapped in on execution
+			if(Result.m_pCommand[0] == '+')
+				Result.AddArgument(m_apStrokeStr[1]);
+			Part.m_ArgsValid = !ParseArgs(&Result, Part.m_pCommand->m_pParams);
+		}
+
+		Part.m_StorageOffset = pLine->m_vStorage.size();
+		Part.m_StorageSize = minimum((int) (pEnd - pStr) + 1, (int) sizeof(Result.m_aStringStorage));
+		pLine->m_vStorage.insert(pLine->m_vStorage.end(), Result.m_aStringStorage, Result.m_aStringStorage + Part.m_StorageSize);
+		Part.m_CommandOffset = Result.m_pCommand - Result.m_aStringStorage;
+		for(int i = 0; i < Result.NumArguments(); i++)
+			Part.m_vArgOffsets.push_back(Result.m_apArgs[i] == m_apStrokeStr[1] ? -1 : Result.m_apArgs[i] - Result.m_aStringStorage);
+		pLine->m_vParts.push_back(Part);
+
+		pStr = pNextPart;
+	}
+}
+
+void CConsole::ExecuteParsedPart(int Stroke, const CParsedLine *pLine, const CParsedLine::CPart *pPart)
+{
+	const char *pName = &pLine->m_vStorage[pPart->m_StorageOffset + pPart->m_CommandOffset];
+	CCommand *pCommand = pPart->m_pCommand;
+	char aBuf[256];
+
+	if(!pCommand)
+	{
+		if(Stroke)
+		{
+			str_format(aBuf, sizeof(aBuf), "No such command: %s.", pName);
+			Print(OUTPUT_LEVEL_STANDARD, "console", aBuf);
+		}
+		return;
+	}
+
+	if(pCommand->GetAccessLevel() < m_AccessLevel)
+	{
+		if(Stroke)
+		{
+			str_format(aBuf, sizeof(aBuf), "Access for command %s denied.", pName);
+			Print(OUTPUT_LEVEL_STANDARD, "console", aBuf);
+		}
+		return;
+	}
+
+	if(!Stroke && pName[0] != '+')
+		return;
+
+	if(!pPart->m_ArgsValid)
+	{
+		str_format(aBuf, sizeof(aBuf), "Invalid arguments... Usage: %s %s", pCommand->m_pName, pCommand->m_pParams);
+		Print(OUTPUT_LEVEL_STANDARD, "console", aBuf);
+		return;
+	}
+
+	// rebuild the result from the tokenized storage
+	CResult Result;
+	mem_copy(Result.m_aStringStorage, &pLine->m_vStorage[pPart->m_StorageOffset], pPart->m_StorageSize);
+	Result.m_pCommand = Result.m_aStringStorage + pPart->m_CommandOffset;
+	for(int Offset : pPart->m_vArgOffsets)
+		Result.AddArgument(Offset < 0 ? m_apStrokeStr[Stroke] : Result.m_aStringStorage + Offset);
+
+	if(m_StoreCommands && pCommand->m_Flags & CFGFLAG_STORE)
+	{
+		m_ExecutionQueue.AddEntry();
+		m_ExecutionQueue.m_pLast->m_pCommand = pCommand;
+		m_ExecutionQueue.m_pLast->m_Result = Result;
+	}
+	else
+		pCommand->m_pfnCallback(&Result, pCommand->m_pUserData);
+}
+
+void CConsole::ExecuteParsedLine(IParsedLine *pParsedLine)
+{
+	CParsedLine *pLine = static_cast<CParsedLine *>(pParsedLine);
+
+	// press it, then release it
+	for(int Stroke = 1; Stroke >= 0; Stroke--)
+	{
+		for(unsigned i = 0; i < pLine->m_vParts.size(); i++)
+		{
+			// commands might have been added or removed, even by the previous part
+			if(pLine->m_Generation != m_CommandGeneration || pLine->m_FlagMask != m_FlagMask)
+				ParseLineParts(pLine);
+			ExecuteParsedPart(Stroke, pLine, &pLine->m_vParts[i]);
+		}
+	}
+}
+
 bool CConsole::ExecuteFile(const char *pFilename)
 {
 	// make sure that this isn't being executed already
@@ -815,6 +958,8 @@ CConsole::CConsole(int FlagMask)
 	m_pLastMapEntry = 0;
 	m_ExecutionQueue.Reset();
 	m_pFirstCommand = 0;
+	mem_zero(m_apCommandHash, sizeof(m_apCommandHash));
+	m_CommandGeneration = 0;
 	m_pFirstExec = 0;
 	mem_zero(m_aPrintCB, sizeof(m_aPrintCB));
 	m_NumPrintCB = 0;
@@ -922,12 +1067,11 @@ void CConsole::ParseArguments(int NumArgs, const char **ppArguments)
 
 void CConsole::AddCommandSorted(CCommand *pCommand)
 {
+	AddCommandHash(pCommand);
+
 	if(!m_pFirstCommand || str_comp(pCommand->m_pName, m_pFirstCommand->m_pName) <= 0)
 	{
-		if(m_pFirstCommand && m_pFirstCommand->m_pNext)
-			pCommand->m_pNext = m_pFirstCommand;
-		else
-			pCommand->m_pNext = 0;
+		pCommand->m_pNext = m_pFirstCommand;
 		m_pFirstCommand = pCommand;
 	}
 	else
@@ -967,6 +1111,8 @@ void CConsole::Register(const char *pName, const char *pParams,
 
 	if(DoAdd)
 		AddCommandSorted(pCommand);
+	else
+		m_CommandGeneration++;
 }
 
 void CConsole::RegisterTemp(const char *pName, const char *pParams, int Flags, const char *pHelp)
@@ -1030,6 +1176,7 @@ void CConsole::DeregisterTemp(const char *pName)
 	// add to recycle list
 	if(pRemoved)
 	{
+		RemoveCommandHash(pRemoved);
 		pRemoved->m_pNext = m_pRecycleList;
 		m_pRecycleList = pRemoved;
 	}
@@ -1053,6 +1200,19 @@ void CConsole::DeregisterTempAll()
 		}
 	}
 
+	// remove temp entries from the index
+	for(int i = 0; i < COMMAND_HASH_SIZE; i++)
+	{
+		for(CCommand **ppCommand = &m_apCommandHash[i]; *ppCommand;)
+		{
+			if((*ppCommand)->m_Temp)
+				*ppCommand = (*ppCommand)->m_pNextHash;
+			else
+				ppCommand = &(*ppCommand)->m_pNextHash;
+		}
+	}
+	m_CommandGeneration++;
+
 	m_TempCommands.Reset();
 	m_pRecycleList = 0;
 }
@@ -1156,7 +1316,7 @@ void CConsole::StoreCommands(bool Store)
 
 const IConsole::CCommandInfo *CConsole::GetCommandInfo(const char *pName, int FlagMask, bool Temp)
 {
-	for(CCommand *pCommand = m_pFirstCommand; pCommand; pCommand = pCommand->m_pNext)
+	for(CCommand *pCommand = m_apCommandHash[CommandHash(pName)]; pCommand; pCommand = pCommand->m_pNextHash)
 	{
 		if(pCommand->m_Flags & FlagMask && pCommand->m_Temp == Temp)
 		{
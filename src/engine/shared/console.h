@@ -6,6 +6,8 @@
 #include <engine/console.h>
 #include "memheap.h"
 #include <new>
+#include <string>
+#include <vector>
 
 class CConsole : public IConsole
 {
@@ -15,6 +17,7 @@ class CConsole : public IConsole
 		CCommand(bool BasicAccess) :
 			CCommandInfo(BasicAccess) {}
 		CCommand *m_pNext;
+		CCommand *m_pNextHash;
 		int m_Flags;
 		bool m_Temp;
 		FCommandCallback m_pfnCallback;
@@ -34,10 +37,19 @@ class CConsole : public IConsole
 		void *m_pUserData;
 	};
 
+	enum
+	{
+		COMMAND_HASH_SIZE = 1024,
+	};
+
 	int m_FlagMask;
 	bool m_StoreCommands;
 	const char *m_apStrokeStr[2];
 	CCommand *m_pFirstCommand;
+	// case insensitive index over the command list, chained in the order of the list so lookups resolve like a list walk
+	CCommand *m_apCommandHash[COMMAND_HASH_SIZE];
+	// changes whenever commands are added or removed, parsed lines resolve their commands again then
+	unsigned m_CommandGeneration;
 
 	class CExecFile
 	{
@@ -167,6 +179,33 @@ class CConsole : public IConsole
 		}
 	} m_ExecutionQueue;
 
+	class CParsedLine : public IParsedLine
+	{
+	public:
+		struct CPart
+		{
+			CCommand *m_pCommand;
+			bool m_ArgsValid;
+			int m_StorageOffset;
+			int m_StorageSize;
+			int m_CommandOffset;
+			// offsets into the part storage, -1 is the stroke token of + commands
+			std::vector<int> m_vArgOffsets;
+		};
+
+		std::string m_Line;
+		int m_FlagMask;
+		unsigned m_Generation;
+		std::vector<char> m_vStorage;
+		std::vector<CPart> m_vParts;
+	};
+
+	void ParseLineParts(CParsedLine *pLine);
+	void ExecuteParsedPart(int Stroke, const CParsedLine *pLine, const CParsedLine::CPart *pPart);
+
+	static unsigned CommandHash(const char *pName);
+	void AddCommandHash(CCommand *pCommand);
+	void RemoveCommandHash(CCommand *pCommand);
 	void AddCommandSorted(CCommand *pCommand);
 	CCommand *FindCommand(const char *pName, int FlagMask);
 
@@ -208,6 +247,9 @@ public:
 	virtual void ExecuteLineFlag(const char *pStr, int FlagMask);
 	virtual bool ExecuteFile(const char *pFilename);
 
+	virtual IParsedLine *ParseLine(const char *pStr);
+	virtual void ExecuteParsedLine(IParsedLine *pLine);
+
 	virtual int RegisterPrintCallback(int OutputLevel, FPrintCallback pfnPrintCallback, void *pUserData);
 	virtual void SetPrintOutputLevel(int Index, int OutputLevel);
 	virtual void Print(int Level, const char *pFrom, const char *pStr, bool Highlighted = false);
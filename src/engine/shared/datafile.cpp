@@ -3,11 +3,16 @@
 #include "datafile.h"
 
 #include <base/hash_ctxt.h>
+#include <base/lock.h>
 #include <base/math.h>
 #include <base/system.h>
+#include <engine/engine.h>
 #include <engine/storage.h>
 #include <zlib.h>
 
+#include <atomic>
+#include <deque>
+
 static const int DEBUG = 0;
 
 struct CDatafileItemType
@@ -60,6 +65,8 @@ struct CDatafileInfo
 struct CDatafile
 {
 	IOHANDLE m_File;
+	const char *m_pMappedFile;
+	long int m_MappedSize;
 	SHA256_DIGEST m_Sha256;
 	unsigned m_Crc;
 	CDatafileInfo m_Info;
@@ -70,6 +77,222 @@ struct CDatafile
 	char *m_pData;
 };
 
+// decompressed data of the last opened files, so reloading a map doesn't need to decompress it again
+class CDatafileCacheEntry
+{
+public:
+	SHA256_DIGEST m_Sha256;
+	std::vector<std::shared_ptr<const std::vector<char>>> m_vpData GUARDED_BY(ms_Lock);
+	int64 m_Size GUARDED_BY(ms_Lock);
+	bool m_Cached GUARDED_BY(ms_Lock); // false once it was evicted, readers may still use it
+
+	static CLock ms_Lock;
+};
+
+CLock CDatafileCacheEntry::ms_Lock;
+
+enum
+{
+	DATAFILE_CACHE_ENTRIES = 2,
+	DATAFILE_CACHE_SIZE = 64 * 1024 * 1024,
+};
+
+// most recently opened first
+static std::deque<std::shared_ptr<CDatafileCacheEntry>> gs_vpDatafileCache GUARDED_BY(CDatafileCacheEntry::ms_Lock);
+static int64 gs_DatafileCacheSize GUARDED_BY(CDatafileCacheEntry::ms_Lock) = 0;
+
+static void EvictDatafileCacheEntry() REQUIRES(CDatafileCacheEntry::ms_Lock)
+{
+	std::shared_ptr<CDatafileCacheEntry> pEntry = gs_vpDatafileCache.back();
+	gs_vpDatafileCache.pop_back();
+	gs_DatafileCacheSize -= pEntry->m_Size;
+	pEntry->m_Size = 0;
+	pEntry->m_Cached = false;
+	for(auto &pData : pEntry->m_vpData)
+		pData = nullptr;
+}
+
+static std::shared_ptr<CDatafileCacheEntry> FindDatafileCacheEntry(const SHA256_DIGEST &Sha256, int NumData)
+{
+	const CLockScope LockScope(CDatafileCacheEntry::ms_Lock);
+	for(auto it = gs_vpDatafileCache.begin(); it != gs_vpDatafileCache.end(); ++it)
+	{
+		if((*it)->m_Sha256 == Sha256 && (int) (*it)->m_vpData.size() == NumData)
+		{
+			std::shared_ptr<CDatafileCacheEntry> pEntry = *it;
+			gs_vpDatafileCache.erase(it);
+			gs_vpDatafileCache.push_front(pEntry);
+			return pEntry;
+		}
+	}
+
+	std::shared_ptr<CDatafileCacheEntry> pEntry = std::make_shared<CDatafileCacheEntry>();
+	pEntry->m_Sha256 = Sha256;
+	pEntry->m_vpData.resize(NumData);
+	pEntry->m_Size = 0;
+	pEntry->m_Cached = true;
+	gs_vpDatafileCache.push_front(pEntry);
+	if(gs_vpDatafileCache.size() > DATAFILE_CACHE_ENTRIES)
+		EvictDatafileCacheEntry();
+	return pEntry;
+}
+
+// returns the data allocated with mem_alloc, taken from the cache if possible, or 0 if it is corrupt
+static char *DecompressData(CDatafileCacheEntry *pCacheEntry, int Index, const char *pCompressed, int CompressedSize, int UncompressedSize, int *pResultSize)
+{
+	char *pData = (char *) mem_alloc(UncompressedSize);
+
+	std::shared_ptr<const std::vector<char>> pCached;
+	{
+		const CLockScope LockScope(CDatafileCacheEntry::ms_Lock);
+		pCached = pCacheEntry->m_vpData[Index];
+	}
+	if(pCached)
+	{
+		*pResultSize = minimum((int) pCached->size(), UncompressedSize);
+		mem_copy(pData, pCached->data(), *pResultSize);
+		return pData;
+	}
+
+	// decompress the data, a corrupt block is never cached so a reload reads it again
+	unsigned long s = UncompressedSize;
+	int Result = uncompress((Bytef *) pData, &s, (const Bytef *) pCompressed, CompressedSize);
+	if(Result != Z_OK)
+	{
+		dbg_msg("datafile", "failed to decompress data index=%d, error %d", Index, Result);
+		mem_free(pData);
+		*pResultSize = 0;
+		return 0;
+	}
+	*pResultSize = s;
+
+	// older files make room for the newest one, a single file bigger than the cache only fills it
+	const CLockScope LockScope(CDatafileCacheEntry::ms_Lock);
+	if(!pCacheEntry->m_Cached || pCacheEntry->m_vpData[Index])
+		return pData;
+	while(gs_DatafileCacheSize + (int64) s > DATAFILE_CACHE_SIZE && gs_vpDatafileCache.back().get() != pCacheEntry)
+		EvictDatafileCacheEntry();
+	if(gs_DatafileCacheSize + (int64) s > DATAFILE_CACHE_SIZE)
+		return pData;
+	pCacheEntry->m_vpData[Index] = std::make_shared<const std::vector<char>>(pData, pData + s);
+	pCacheEntry->m_Size += s;
+	gs_DatafileCacheSize += s;
+	return pData;
+}
+
+// a job which the thread waiting for it takes over if it didn't start yet
+class CDatafileJob : public IJob
+{
+	std::atomic<bool> m_Claimed;
+	std::atomic<bool> m_Finished;
+	SEMAPHORE m_Done;
+
+	void Run() override
+	{
+		if(!m_Claimed.exchange(true))
+		{
+			Process();
+			m_Finished = true;
+			sphore_signal(&m_Done);
+		}
+	}
+
+protected:
+	virtual void Process() = 0;
+
+public:
+	CDatafileJob() :
+		m_Claimed(false), m_Finished(false)
+	{
+		sphore_init(&m_Done);
+	}
+
+	~CDatafileJob()
+	{
+		sphore_destroy(&m_Done);
+	}
+
+	bool Finished() const { return m_Finished; }
+
+	// runs the job here if no worker has started it yet
+	void Wait()
+	{
+		if(!m_Claimed.exchange(true))
+		{
+			Process();
+			m_Finished = true;
+		}
+		else if(!m_Finished)
+			sphore_wait(&m_Done);
+	}
+};
+
+class CDatafileLoadJob : public CDatafileJob
+{
+	std::shared_ptr<CDatafileCacheEntry> m_pCacheEntry;
+	int m_Index;
+	const char *m_pCompressed;
+	int m_CompressedSize;
+	int m_UncompressedSize;
+
+	void Process() override
+	{
+		m_pData = DecompressData(m_pCacheEntry.get(), m_Index, m_pCompressed, m_CompressedSize, m_UncompressedSize, &m_DataSize);
+	}
+
+public:
+	char *m_pData;
+	int m_DataSize;
+
+	CDatafileLoadJob(std::shared_ptr<CDatafileCacheEntry> pCacheEntry, int Index, const char *pCompressed, int CompressedSize, int UncompressedSize) :
+		m_pCacheEntry(std::move(pCacheEntry)), m_Index(Index), m_pCompressed(pCompressed), m_CompressedSize(CompressedSize), m_UncompressedSize(UncompressedSize), m_pData(0), m_DataSize(0)
+	{
+	}
+};
+
+class CDatafileCompressJob : public CDatafileJob
+{
+	void *m_pData;
+	int m_Size;
+	int m_Level;
+
+	void Process() override
+	{
+		unsigned long s = compressBound(m_Size);
+		void *pCompData = mem_alloc(s); // temporary buffer that we use during compression
+
+		int Result = compress2((Bytef *) pCompData, &s, (const Bytef *) m_pData, m_Size, m_Level);
+		if(Result != Z_OK)
+		{
+			dbg_msg("datafile", "compression error %d", Result);
+			dbg_assert(0, "zlib error");
+		}
+
+		m_CompressedSize = (int) s;
+		m_pCompressedData = mem_alloc(m_CompressedSize);
+		mem_copy(m_pCompressedData, pCompData, m_CompressedSize);
+		mem_free(pCompData);
+		mem_free(m_pData);
+		m_pData = 0;
+	}
+
+public:
+	void *m_pCompressedData;
+	int m_CompressedSize;
+
+	// takes ownership of the data
+	CDatafileCompressJob(void *pData, int Size, int Level) :
+		m_pData(pData), m_Size(Size), m_Level(Level), m_pCompressedData(0), m_CompressedSize(0)
+	{
+	}
+
+	~CDatafileCompressJob()
+	{
+		mem_free(m_pData);
+		mem_free(m_pCompressedData);
+	}
+};
+
 bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int StorageType)
 {
 	dbg_msg("datafile", "loading. filename='%s'", pFilename);
@@ -81,10 +304,24 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 		return false;
 	}
 
+	// read the file through a mapping if possible, then the compressed data is used in place
+	long int MappedSize = 0;
+	const char *pMappedFile = (const char *) io_map(File, &MappedSize);
+
 	// take the hashes of the file and store them
 	SHA256_CTX Sha256Ctx;
 	sha256_init(&Sha256Ctx);
 	unsigned Crc = crc32(0L, 0x0, 0);
+	if(pMappedFile)
+	{
+		for(long int Offset = 0; Offset < MappedSize; Offset += 1024 * 1024)
+		{
+			unsigned Bytes = minimum(MappedSize - Offset, 1024l * 1024);
+			sha256_update(&Sha256Ctx, pMappedFile + Offset, Bytes);
+			Crc = crc32(Crc, (const Bytef *) pMappedFile + Offset, Bytes);
+		}
+	}
+	else
 	{
 		enum
 		{
@@ -107,12 +344,17 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 
 	// TODO: change this header
 	CDatafileHeader Header;
-	io_read(File, &Header, sizeof(Header));
+	mem_zero(&Header, sizeof(Header));
+	if(pMappedFile)
+		mem_copy(&Header, pMappedFile, minimum(MappedSize, (long int) sizeof(Header)));
+	else
+		io_read(File, &Header, sizeof(Header));
 	if(Header.m_aID[0] != 'A' || Header.m_aID[1] != 'T' || Header.m_aID[2] != 'A' || Header.m_aID[3] != 'D')
 	{
 		if(Header.m_aID[0] != 'D' || Header.m_aID[1] != 'A' || Header.m_aID[2] != 'T' || Header.m_aID[3] != 'A')
 		{
 			dbg_msg("datafile", "wrong signature. %x %x %x %x", Header.m_aID[0], Header.m_aID[1], Header.m_aID[2], Header.m_aID[3]);
+			io_unmap((void *) pMappedFile, MappedSize);
 			io_close(File);
 			return 0;
 		}
@@ -124,6 +366,7 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	if(Header.m_Version != 3 && Header.m_Version != 4)
 	{
 		dbg_msg("datafile", "wrong version. version=%x", Header.m_Version);
+		io_unmap((void *) pMappedFile, MappedSize);
 		io_close(File);
 		return 0;
 	}
@@ -142,6 +385,7 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	AllocSize += Header.m_NumRawData * sizeof(int); // add space for data sizes
 	if(Size > (int64(1) << 31) || Header.m_NumItemTypes < 0 || Header.m_NumItems < 0 || Header.m_NumRawData < 0 || Header.m_ItemSize < 0)
 	{
+		io_unmap((void *) pMappedFile, MappedSize);
 		io_close(File);
 		dbg_msg("datafile", "unable to load file, invalid file information");
 		return false;
@@ -154,6 +398,8 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	pTmpDataFile->m_pDataSizes = (int *) (pTmpDataFile->m_ppDataPtrs + Header.m_NumRawData);
 	pTmpDataFile->m_pData = (char *) (pTmpDataFile->m_pDataSizes + Header.m_NumRawData);
 	pTmpDataFile->m_File = File;
+	pTmpDataFile->m_pMappedFile = pMappedFile;
+	pTmpDataFile->m_MappedSize = MappedSize;
 	pTmpDataFile->m_Sha256 = sha256_finish(&Sha256Ctx);
 	pTmpDataFile->m_Crc = Crc;
 
@@ -162,9 +408,17 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	mem_zero(pTmpDataFile->m_pDataSizes, Header.m_NumRawData * sizeof(int));
 
 	// read types, offsets, sizes and item data
-	unsigned ReadSize = io_read(File, pTmpDataFile->m_pData, Size);
+	unsigned ReadSize;
+	if(pMappedFile)
+	{
+		ReadSize = clamp((int64) MappedSize - (int64) sizeof(CDatafileHeader), (int64) 0, Size);
+		mem_copy(pTmpDataFile->m_pData, pMappedFile + sizeof(CDatafileHeader), ReadSize);
+	}
+	else
+		ReadSize = io_read(File, pTmpDataFile->m_pData, Size);
 	if(ReadSize != Size)
 	{
+		io_unmap((void *) pMappedFile, MappedSize);
 		io_close(pTmpDataFile->m_File);
 		mem_free(pTmpDataFile);
 		pTmpDataFile = 0;
@@ -174,6 +428,8 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 
 	Close();
 	m_pDataFile = pTmpDataFile;
+	if(Header.m_Version == 4)
+		m_pCacheEntry = FindDatafileCacheEntry(m_pDataFile->m_Sha256, Header.m_NumRawData);
 
 #if defined(CONF_ARCH_ENDIAN_BIG)
 	swap_endian(m_pDataFile->m_pData, sizeof(int), minimum(static_cast<unsigned>(Header.m_Swaplen), static_cast<unsigned>(Size)) / sizeof(int));
@@ -281,6 +537,70 @@ int CDataFileReader::GetDataSize(int Index) const
 	return m_pDataFile->m_pDataSizes[Index];
 }
 
+int CDataFileReader::LoadData(int Index)
+{
+	// fetch the data size
+	int DataSize = GetFileDataSize(Index);
+	int Offset = m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index];
+	const char *pMapped = 0;
+	if(m_pDataFile->m_pMappedFile)
+	{
+		if(Offset < 0 || DataSize < 0 || Offset + (int64) DataSize > m_pDataFile->m_MappedSize)
+		{
+			dbg_msg("datafile", "data index=%d is out of the file", Index);
+			return 0;
+		}
+		pMapped = m_pDataFile->m_pMappedFile + Offset;
+	}
+
+	if(m_pDataFile->m_Header.m_Version == 4)
+	{
+		// v4 has compressed data
+		int UncompressedSize = m_pDataFile->m_Info.m_pDataSizes[Index];
+		if(DEBUG)
+			dbg_msg("datafile", "loading data index=%d size=%d uncompressed=%d", Index, DataSize, UncompressedSize);
+
+		int ResultSize;
+		if(Index < (int) m_vpLoadJobs.size() && m_vpLoadJobs[Index])
+		{
+			// take the result of the prefetch
+			std::shared_ptr<CDatafileLoadJob> pJob = std::move(m_vpLoadJobs[Index]);
+			pJob->Wait();
+			m_pDataFile->m_ppDataPtrs[Index] = pJob->m_pData;
+			ResultSize = pJob->m_DataSize;
+		}
+		else if(pMapped)
+		{
+			m_pDataFile->m_ppDataPtrs[Index] = DecompressData(m_pCacheEntry.get(), Index, pMapped, DataSize, UncompressedSize, &ResultSize);
+		}
+		else
+		{
+			// read the compressed data
+			char *pTemp = (char *) mem_alloc(DataSize);
+			io_seek(m_pDataFile->m_File, Offset, IOSEEK_START);
+			io_read(m_pDataFile->m_File, pTemp, DataSize);
+			m_pDataFile->m_ppDataPtrs[Index] = DecompressData(m_pCacheEntry.get(), Index, pTemp, DataSize, UncompressedSize, &ResultSize);
+			mem_free(pTemp);
+		}
+		m_pDataFile->m_pDataSizes[Index] = m_pDataFile->m_ppDataPtrs[Index] ? UncompressedSize : 0;
+		return ResultSize;
+	}
+
+	// load the data
+	if(DEBUG)
+		dbg_msg("datafile", "loading data index=%d size=%d", Index, DataSize);
+	m_pDataFile->m_ppDataPtrs[Index] = (char *) mem_alloc(DataSize);
+	m_pDataFile->m_pDataSizes[Index] = DataSize;
+	if(pMapped)
+		mem_copy(m_pDataFile->m_ppDataPtrs[Index], pMapped, DataSize);
+	else
+	{
+		io_seek(m_pDataFile->m_File, Offset, IOSEEK_START);
+		io_read(m_pDataFile->m_File, m_pDataFile->m_ppDataPtrs[Index], DataSize);
+	}
+	return DataSize;
+}
+
 void *CDataFileReader::GetDataImpl(int Index, int Swap)
 {
 	if(!m_pDataFile)
@@ -294,54 +614,67 @@ void *CDataFileReader::GetDataImpl(int Index, int Swap)
 	// load it if needed
 	if(!m_pDataFile->m_ppDataPtrs[Index])
 	{
-		// fetch the data size
-		int DataSize = GetFileDataSize(Index);
+		int SwapSize = LoadData(Index);
 #if defined(CONF_ARCH_ENDIAN_BIG)
-		int SwapSize = DataSize;
+		if(Swap && SwapSize)
+			swap_endian(m_pDataFile->m_ppDataPtrs[Index], sizeof(int), SwapSize / sizeof(int));
+#else
+		(void) SwapSize;
 #endif
+	}
 
-		if(m_pDataFile->m_Header.m_Version == 4)
-		{
-			// v4 has compressed data
-			void *pTemp = (char *) mem_alloc(DataSize);
-			unsigned long UncompressedSize = m_pDataFile->m_Info.m_pDataSizes[Index];
-			unsigned long s;
+	return m_pDataFile->m_ppDataPtrs[Index];
+}
 
-			dbg_msg("datafile", "loading data index=%d size=%d uncompressed=%lu", Index, DataSize, UncompressedSize);
-			m_pDataFile->m_ppDataPtrs[Index] = (char *) mem_alloc(UncompressedSize);
-			m_pDataFile->m_pDataSizes[Index] = UncompressedSize;
+void CDataFileReader::Prefetch(IEngine *pEngine, int Index)
+{
+	// only mapped data can be read from other threads
+	if(!m_pDataFile || !m_pDataFile->m_pMappedFile || m_pDataFile->m_Header.m_Version != 4 || Index < 0 || Index >= m_pDataFile->m_Header.m_NumRawData)
+		return;
+	if(m_pDataFile->m_ppDataPtrs[Index] || (Index < (int) m_vpLoadJobs.size() && m_vpLoadJobs[Index]))
+		return;
 
-			// read the compressed data
-			io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START);
-			io_read(m_pDataFile->m_File, pTemp, DataSize);
+	int DataSize = GetFileDataSize(Index);
+	int Offset = m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index];
+	if(Offset < 0 || DataSize < 0 || Offset + (int64) DataSize > m_pDataFile->m_MappedSize)
+		return;
 
-			// decompress the data, TODO: check for errors
-			s = UncompressedSize;
-			uncompress((Bytef *) m_pDataFile->m_ppDataPtrs[Index], &s, (Bytef *) pTemp, DataSize);
-#if defined(CONF_ARCH_ENDIAN_BIG)
-			SwapSize = s;
-#endif
+	m_vpLoadJobs.resize(m_pDataFile->m_Header.m_NumRawData);
+	m_vpLoadJobs[Index] = std::make_shared<CDatafileLoadJob>(m_pCacheEntry, Index, m_pDataFile->m_pMappedFile + Offset, DataSize, m_pDataFile->m_Info.m_pDataSizes[Index]);
+	pEngine->AddJob(m_vpLoadJobs[Index]);
+}
 
-			// clean up the temporary buffers
-			mem_free(pTemp);
-		}
-		else
-		{
-			// load the data
-			dbg_msg("datafile", "loading data index=%d size=%d", Index, DataSize);
-			m_pDataFile->m_ppDataPtrs[Index] = (char *) mem_alloc(DataSize);
-			m_pDataFile->m_pDataSizes[Index] = DataSize;
-			io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START);
-			io_read(m_pDataFile->m_File, m_pDataFile->m_ppDataPtrs[Index], DataSize);
-		}
+void CDataFileReader::PrefetchAll(IEngine *pEngine)
+{
+	for(int i = 0; i < NumData(); i++)
+		Prefetch(pEngine, i);
+}
 
-#if defined(CONF_ARCH_ENDIAN_BIG)
-		if(Swap && SwapSize)
-			swap_endian(m_pDataFile->m_ppDataPtrs[Index], sizeof(int), SwapSize / sizeof(int));
-#endif
+void CDataFileReader::Unmap()
+{
+	if(!m_pDataFile || !m_pDataFile->m_pMappedFile)
+		return;
+
+	// the jobs read from the mapping, their results are still taken by GetData
+	for(auto &pJob : m_vpLoadJobs)
+	{
+		if(pJob)
+			pJob->Wait();
 	}
+	io_unmap((void *) m_pDataFile->m_pMappedFile, m_pDataFile->m_MappedSize);
+	m_pDataFile->m_pMappedFile = 0;
+	m_pDataFile->m_MappedSize = 0;
+}
 
-	return m_pDataFile->m_ppDataPtrs[Index];
+void CDataFileReader::DropLoadJob(int Index)
+{
+	if(Index >= (int) m_vpLoadJobs.size() || !m_vpLoadJobs[Index])
+		return;
+
+	// the job uses the mapped file, so it has to be finished
+	std::shared_ptr<CDatafileLoadJob> pJob = std::move(m_vpLoadJobs[Index]);
+	pJob->Wait();
+	mem_free(pJob->m_pData);
 }
 
 void *CDataFileReader::GetData(int Index)
@@ -372,6 +705,8 @@ void CDataFileReader::UnloadData(int Index)
 	if(Index < 0 || Index >= m_pDataFile->m_Header.m_NumRawData)
 		return;
 
+	DropLoadJob(Index);
+
 	mem_free(m_pDataFile->m_ppDataPtrs[Index]);
 	m_pDataFile->m_ppDataPtrs[Index] = 0x0;
 	m_pDataFile->m_pDataSizes[Index] = 0;
@@ -470,10 +805,14 @@ bool CDataFileReader::Close()
 	int i;
 	for(i = 0; i < m_pDataFile->m_Header.m_NumRawData; i++)
 	{
+		DropLoadJob(i);
 		mem_free(m_pDataFile->m_ppDataPtrs[i]);
 		m_pDataFile->m_pDataSizes[i] = 0;
 	}
+	m_vpLoadJobs.clear();
+	m_pCacheEntry = nullptr;
 
+	io_unmap((void *) m_pDataFile->m_pMappedFile, m_pDataFile->m_MappedSize);
 	io_close(m_pDataFile->m_File);
 	mem_free(m_pDataFile);
 	m_pDataFile = 0;
@@ -517,7 +856,17 @@ bool CDataFileReader::CheckSha256(IOHANDLE Handle, const void *pSha256)
 
 CDataFileWriter::CDataFileWriter()
 {
+	m_pStorage = 0;
+	m_pEngine = 0;
 	m_File = 0;
+	m_SpillFile = 0;
+	m_aSpillFilename[0] = 0;
+	m_aFilename[0] = 0;
+	m_Failed = false;
+	m_NumItems = 0;
+	m_NumDatas = 0;
+	m_NumStoredDatas = 0;
+	m_BufferedDataSize = 0;
 	m_pItemTypes = static_cast<CItemTypeInfo *>(mem_alloc(sizeof(CItemTypeInfo) * MAX_ITEM_TYPES));
 	m_pItems = static_cast<CItemInfo *>(mem_alloc(sizeof(CItemInfo) * MAX_ITEMS));
 	m_pDatas = static_cast<CDataInfo *>(mem_alloc(sizeof(CDataInfo) * MAX_DATAS));
@@ -525,6 +874,14 @@ CDataFileWriter::CDataFileWriter()
 
 CDataFileWriter::~CDataFileWriter()
 {
+	if(m_File)
+	{
+		// never finished, drop everything
+		io_close(m_File);
+		m_File = 0;
+		Reset();
+	}
+
 	mem_free(m_pItemTypes);
 	m_pItemTypes = 0;
 	mem_free(m_pItems);
@@ -533,15 +890,22 @@ CDataFileWriter::~CDataFileWriter()
 	m_pDatas = 0;
 }
 
-bool CDataFileWriter::Open(class IStorage *pStorage, const char *pFilename)
+bool CDataFileWriter::Open(class IStorage *pStorage, const char *pFilename, int CompressionLevel, IEngine *pEngine)
 {
 	dbg_assert(!m_File, "a file already exists");
+	dbg_assert(CompressionLevel == COMPRESSION_DEFAULT || (CompressionLevel >= 0 && CompressionLevel <= COMPRESSION_BEST), "invalid compression level");
 	m_File = pStorage->OpenFile(pFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
 	if(!m_File)
 		return false;
 
+	m_pStorage = pStorage;
+	m_pEngine = pEngine;
+	m_CompressionLevel = CompressionLevel;
+	m_Failed = false;
 	m_NumItems = 0;
 	m_NumDatas = 0;
+	m_NumStoredDatas = 0;
+	m_BufferedDataSize = 0;
 	m_NumItemTypes = 0;
 	mem_zero(m_pItemTypes, sizeof(CItemTypeInfo) * MAX_ITEM_TYPES);
 
@@ -551,6 +915,79 @@ bool CDataFileWriter::Open(class IStorage *pStorage, const char *pFilename)
 		m_pItemTypes[i].m_Last = -1;
 	}
 
+	// compressed data that doesn't fit into memory goes next to the file
+	str_copy(m_aFilename, pFilename, sizeof(m_aFilename));
+	str_format(m_aSpillFilename, sizeof(m_aSpillFilename), "%s.tmp", pFilename);
+
+	return true;
+}
+
+void CDataFileWriter::Reset()
+{
+	// jobs still queued in the engine own their data and are dropped when they're done
+	m_vpCompressJobs.clear();
+
+	for(int i = 0; i < m_NumItems; i++)
+		mem_free(m_pItems[i].m_pData);
+	for(int i = 0; i < m_NumStoredDatas; ++i)
+		mem_free(m_pDatas[i].m_pCompressedData);
+	m_NumItems = 0;
+	m_NumDatas = 0;
+	m_NumStoredDatas = 0;
+	m_BufferedDataSize = 0;
+
+	if(m_SpillFile)
+	{
+		io_close(m_SpillFile);
+		m_SpillFile = 0;
+		m_pStorage->RemoveFile(m_aSpillFilename, IStorage::TYPE_SAVE);
+	}
+}
+
+bool CDataFileWriter::StoreDatas(bool Wait)
+{
+	if(m_Failed)
+		return false;
+
+	// store in order, so the spill file only has to be appended to
+	while(m_NumStoredDatas < m_NumDatas)
+	{
+		std::shared_ptr<CDatafileCompressJob> &pJob = m_vpCompressJobs[m_NumStoredDatas];
+		if(!Wait && !pJob->Finished())
+			break;
+		pJob->Wait();
+
+		CDataInfo *pInfo = &m_pDatas[m_NumStoredDatas];
+		pInfo->m_CompressedSize = pJob->m_CompressedSize;
+		pInfo->m_pCompressedData = 0;
+		if(!m_SpillFile && m_BufferedDataSize + pJob->m_CompressedSize <= MAX_BUFFERED_DATA)
+		{
+			pInfo->m_pCompressedData = pJob->m_pCompressedData;
+			pJob->m_pCompressedData = 0;
+			m_BufferedDataSize += pInfo->m_CompressedSize;
+		}
+		else
+		{
+			if(!m_SpillFile)
+			{
+				m_SpillFile = m_pStorage->OpenFile(m_aSpillFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+				if(!m_SpillFile)
+				{
+					dbg_msg("datafile", "could not open the temporary file '%s'", m_aSpillFilename);
+					m_Failed = true;
+					return false;
+				}
+			}
+			if(io_write(m_SpillFile, pJob->m_pCompressedData, pJob->m_CompressedSize) != (unsigned) pJob->m_CompressedSize)
+			{
+				dbg_msg("datafile", "could not write to the temporary file '%s'", m_aSpillFilename);
+				m_Failed = true;
+				return false;
+			}
+		}
+		pJob.reset();
+		m_NumStoredDatas++;
+	}
 	return true;
 }
 
@@ -598,24 +1035,22 @@ int CDataFileWriter::AddData(int Size, const void *pData)
 
 	dbg_assert(m_NumDatas < 1024, "too much data");
 
-	CDataInfo *pInfo = &m_pDatas[m_NumDatas];
-	unsigned long s = compressBound(Size);
-	void *pCompData = mem_alloc(s); // temporary buffer that we use during compression
-
-	int Result = compress((Bytef *) pCompData, &s, (Bytef *) pData, Size);
-	if(Result != Z_OK)
-	{
-		dbg_msg("datafile", "compression error %d", Result);
-		dbg_assert(0, "zlib error");
-	}
+	m_pDatas[m_NumDatas].m_UncompressedSize = Size;
+	m_pDatas[m_NumDatas].m_CompressedSize = 0;
+	m_pDatas[m_NumDatas].m_pCompressedData = 0;
 
-	pInfo->m_UncompressedSize = Size;
-	pInfo->m_CompressedSize = (int) s;
-	pInfo->m_pCompressedData = mem_alloc(pInfo->m_CompressedSize);
-	mem_copy(pInfo->m_pCompressedData, pCompData, pInfo->m_CompressedSize);
-	mem_free(pCompData);
+	void *pCopy = mem_alloc(Size);
+	mem_copy(pCopy, pData, Size);
+	std::shared_ptr<CDatafileCompressJob> pJob = std::make_shared<CDatafileCompressJob>(pCopy, Size, m_CompressionLevel);
+	m_vpCompressJobs.push_back(pJob);
+	if(m_pEngine)
+		m_pEngine->AddJob(pJob);
+	else
+		pJob->Wait();
 
 	m_NumDatas++;
+	if(!StoreDatas(false))
+		return -1;
 	return m_NumDatas - 1;
 }
 
@@ -635,6 +1070,17 @@ int CDataFileWriter::AddDataSwapped(int Size, const void *pData)
 #endif
 }
 
+int CDataFileWriter::Abort()
+{
+	Reset();
+	io_close(m_File);
+	m_File = 0;
+
+	// don't leave anything incomplete behind
+	m_pStorage->RemoveFile(m_aFilename, IStorage::TYPE_SAVE);
+	return 0;
+}
+
 int CDataFileWriter::Finish()
 {
 	if(!m_File)
@@ -645,6 +1091,11 @@ int CDataFileWriter::Finish()
 	int DataSize = 0;
 	CDatafileHeader Header;
 
+	// wait for the remaining compression jobs
+	if(!StoreDatas(true))
+		return Abort();
+	m_vpCompressJobs.clear();
+
 	// we should now write this file!
 	if(DEBUG)
 		dbg_msg("datafile", "writing");
@@ -793,19 +1244,35 @@ int CDataFileWriter::Finish()
 		}
 	}
 
-	// write data
-	for(int i = 0; i < m_NumDatas; i++)
+	// write data, the buffered blocks come first
+	int NumBuffered = 0;
+	for(; NumBuffered < m_NumDatas && m_pDatas[NumBuffered].m_pCompressedData; NumBuffered++)
 	{
 		if(DEBUG)
-			dbg_msg("datafile", "writing data id=%d size=%d", i, m_pDatas[i].m_CompressedSize);
-		io_write(m_File, m_pDatas[i].m_pCompressedData, m_pDatas[i].m_CompressedSize);
+			dbg_msg("datafile", "writing data id=%d size=%d", NumBuffered, m_pDatas[NumBuffered].m_CompressedSize);
+		io_write(m_File, m_pDatas[NumBuffered].m_pCompressedData, m_pDatas[NumBuffered].m_CompressedSize);
+	}
+	if(m_SpillFile)
+	{
+		if(DEBUG)
+			dbg_msg("datafile", "copying data id=%d-%d from '%s'", NumBuffered, m_NumDatas - 1, m_aSpillFilename);
+		io_close(m_SpillFile);
+		m_SpillFile = m_pStorage->OpenFile(m_aSpillFilename, IOFLAG_READ, IStorage::TYPE_SAVE);
+		if(!m_SpillFile)
+		{
+			dbg_msg("datafile", "could not reopen the temporary file '%s'", m_aSpillFilename);
+			m_pStorage->RemoveFile(m_aSpillFilename, IStorage::TYPE_SAVE);
+			return Abort();
+		}
+
+		char aBuffer[64 * 1024];
+		unsigned Bytes;
+		while((Bytes = io_read(m_SpillFile, aBuffer, sizeof(aBuffer))) > 0)
+			io_write(m_File, aBuffer, Bytes);
 	}
 
 	// free data
-	for(int i = 0; i < m_NumItems; i++)
-		mem_free(m_pItems[i].m_pData);
-	for(int i = 0; i < m_NumDatas; ++i)
-		mem_free(m_pDatas[i].m_pCompressedData);
+	Reset();
 
 	io_close(m_File);
 	m_File = 0;
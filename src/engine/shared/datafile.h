@@ -6,11 +6,18 @@
 #include <base/hash.h>
 #include <base/system.h>
 
+#include <memory>
+#include <vector>
+
 // raw datafile access
 class CDataFileReader
 {
 	struct CDatafile *m_pDataFile;
+	std::shared_ptr<class CDatafileCacheEntry> m_pCacheEntry;
+	std::vector<std::shared_ptr<class CDatafileLoadJob>> m_vpLoadJobs;
 	void *GetDataImpl(int Index, int Swap);
+	int LoadData(int Index);
+	void DropLoadJob(int Index);
 	int GetFileDataSize(int Index) const;
 	int GetFileItemSize(int Index) const;
 
@@ -24,6 +31,12 @@ public:
 	bool Open(class IStorage *pStorage, const char *pFilename, int StorageType);
 	bool Close();
 
+	// decompresses data of a mapped file in the job pool of the engine, GetData waits for it if needed
+	void Prefetch(class IEngine *pEngine, int Index);
+	void PrefetchAll(class IEngine *pEngine);
+	// finishes the prefetches and releases the mapping, data that isn't loaded yet is read from the file then
+	void Unmap();
+
 	void *GetData(int Index);
 	void *GetDataSwapped(int Index); // makes sure that the data is 32bit LE ints when saved
 	int GetDataSize(int Index) const;
@@ -50,7 +63,7 @@ class CDataFileWriter
 	{
 		int m_UncompressedSize;
 		int m_CompressedSize;
-		void *m_pCompressedData;
+		void *m_pCompressedData; // 0 if it was moved to the spill file
 	};
 
 	struct CItemInfo
@@ -75,8 +88,12 @@ class CDataFileWriter
 		MAX_ITEM_TYPES = 0xffff,
 		MAX_ITEMS = 1024,
 		MAX_DATAS = 1024,
+
+		// compressed data beyond this is written to a temporary file until Finish
+		MAX_BUFFERED_DATA = 16 * 1024 * 1024,
 	};
 
+	class IStorage *m_pStorage;
 	IOHANDLE m_File;
 	int m_NumItems;
 	int m_NumDatas;
@@ -85,13 +102,38 @@ class CDataFileWriter
 	CItemInfo *m_pItems;
 	CDataInfo *m_pDatas;
 
+	// data is compressed in jobs and stored in order
+	int m_CompressionLevel;
+	class IEngine *m_pEngine;
+	std::vector<std::shared_ptr<class CDatafileCompressJob>> m_vpCompressJobs;
+	int m_NumStoredDatas;
+	int m_BufferedDataSize;
+	IOHANDLE m_SpillFile;
+	char m_aSpillFilename[IO_MAX_PATH_LENGTH];
+	char m_aFilename[IO_MAX_PATH_LENGTH];
+	bool m_Failed;
+
+	bool StoreDatas(bool Wait);
+	void Reset();
+	int Abort();
+
 public:
+	enum
+	{
+		COMPRESSION_DEFAULT = -1,
+		COMPRESSION_FAST = 1,
+		COMPRESSION_BEST = 9,
+	};
+
 	CDataFileWriter();
 	~CDataFileWriter();
-	bool Open(class IStorage *pStorage, const char *Filename);
+	// the compression level is a zlib level. with an engine the data is compressed in its job pool, otherwise in AddData
+	bool Open(class IStorage *pStorage, const char *Filename, int CompressionLevel = COMPRESSION_DEFAULT, class IEngine *pEngine = 0);
+	// returns -1 if the data couldn't be stored, Finish fails then as well
 	int AddData(int Size, const void *pData);
 	int AddDataSwapped(int Size, const void *pData);
 	int AddItem(int Type, int ID, int Size, const void *pData);
+	// returns 0 on failure, the unfinished file is removed then
 	int Finish();
 };
 
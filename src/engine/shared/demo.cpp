@@ -20,14 +20,56 @@ static const unsigned char gs_VersionTickCompression = 5; // demo files with thi
 static const int gs_LengthOffset = 152;
 static const int gs_NumMarkersOffset = 176;
 
+// the keyframe index is only read by the machine which wrote it
+static const unsigned char gs_aIndexMarker[4] = {'T', 'W', 'D', 'I'};
+static const int gs_IndexVersion = 1;
+static const int gs_IndexByteOrder = 0x01020304;
+
+struct CDemoIndexHeader
+{
+	unsigned char m_aMarker[4];
+	int m_Version;
+	int m_ByteOrder;
+	int m_KeyFrameSize;
+	int64 m_DemoSize;
+	int m_FirstTick;
+	int m_LastTick;
+	int m_NumKeyFrames;
+};
+
 CDemoRecorder::CDemoRecorder(class CSnapshotDelta *pSnapshotDelta)
 {
+	m_pSnapshotDelta = pSnapshotDelta;
+	m_Recording = false;
+	m_WantedKeyframeInterval = SERVER_TICK_SPEED * 5;
+	m_FirstTick = -1;
+	m_LastTick = -1;
+	m_NumTimelineMarkers = 0;
+	m_QueueHead = 0;
+	m_QueueTail = 0;
+	sphore_init(&m_QueuedChunks);
+	sphore_init(&m_FreeChunks);
+	for(int i = 0; i < MAX_QUEUED_CHUNKS; i++)
+		sphore_signal(&m_FreeChunks);
+	m_pWriterThread = 0;
 	m_File = 0;
+	m_MapFile = 0;
 	m_LastTickMarker = -1;
-	m_pSnapshotDelta = pSnapshotDelta;
+	m_LastKeyFrame = -1;
 	m_Huffman.Init();
 }
 
+CDemoRecorder::~CDemoRecorder()
+{
+	if(m_Recording)
+	{
+		m_Recording = false;
+		StopWriter();
+	}
+	sphore_destroy(&m_QueuedChunks);
+	sphore_destroy(&m_FreeChunks);
+}
+
 void CDemoRecorder::Init(class IConsole *pConsole, class IStorage *pStorage)
 {
 	m_pConsole = pConsole;
@@ -38,7 +80,7 @@ void CDemoRecorder::Init(class IConsole *pConsole, class IStorage *pStorage)
 int CDemoRecorder::Start(const char *pFilename, const char *pNetVersion, const char *pMap, SHA256_DIGEST Sha256, unsigned Crc, const char *pType)
 {
 	CDemoHeader Header;
-	if(m_File)
+	if(m_Recording)
 	{
 		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", "Demo recording is already active");
 		return -1;
@@ -79,6 +121,11 @@ int CDemoRecorder::Start(const char *pFilename, const char *pNetVersion, const c
 		return -1;
 	}
 
+	// the index of an earlier demo with this name is stale now
+	char aIndexFilename[IO_MAX_PATH_LENGTH];
+	DemoIndexFilename(pFilename, aIndexFilename, sizeof(aIndexFilename));
+	m_pStorage->RemoveFile(aIndexFilename, IStorage::TYPE_SAVE);
+
 	IOHANDLE DemoFile = m_pStorage->OpenFile(pFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
 	if(!DemoFile)
 	{
@@ -106,26 +153,26 @@ int CDemoRecorder::Start(const char *pFilename, const char *pNetVersion, const c
 	// Header.m_aTimelineMarkers - add this on stop
 	io_write(DemoFile, &Header, sizeof(Header));
 
-	// write map data
-	unsigned char aChunk[1024 * 64];
-	while(1)
-	{
-		int Bytes = io_read(MapFile, &aChunk, sizeof(aChunk));
-		if(Bytes <= 0)
-			break;
-		io_write(DemoFile, &aChunk, Bytes);
-	}
-	io_close(MapFile);
-
+	m_File = DemoFile;
+	m_MapFile = MapFile;
+	str_copy(m_aFilename, pFilename, sizeof(m_aFilename));
+	m_KeyframeInterval = m_WantedKeyframeInterval;
+	m_FirstTickMarker = -1;
 	m_LastKeyFrame = -1;
 	m_LastTickMarker = -1;
+	m_vKeyFrames.clear();
+
+	m_Recording = true;
 	m_FirstTick = -1;
+	m_LastTick = -1;
 	m_NumTimelineMarkers = 0;
 
+	// the writer copies the map data first, recording doesn't wait for it
+	m_pWriterThread = thread_init(WriterThread, this);
+
 	char aBuf[256];
 	str_format(aBuf, sizeof(aBuf), "Recording to '%s'", pFilename);
 	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", aBuf);
-	m_File = DemoFile;
 
 	return 0;
 }
@@ -160,6 +207,39 @@ enum
 	CHUNKFLAG_BIGSIZE = 0x10
 };
 
+void CDemoRecorder::WriterThread(void *pUser)
+{
+	CDemoRecorder *pSelf = static_cast<CDemoRecorder *>(pUser);
+
+	// write map data
+	while(1)
+	{
+		int Bytes = io_read(pSelf->m_MapFile, pSelf->m_aCompressBuffer, sizeof(pSelf->m_aCompressBuffer));
+		if(Bytes <= 0)
+			break;
+		io_write(pSelf->m_File, pSelf->m_aCompressBuffer, Bytes);
+	}
+	io_close(pSelf->m_MapFile);
+	pSelf->m_MapFile = 0;
+
+	while(1)
+	{
+		sphore_wait(&pSelf->m_QueuedChunks);
+		CQueuedChunk *pChunk = &pSelf->m_aQueue[pSelf->m_QueueHead];
+		const bool Stop = pChunk->m_Type == QUEUED_STOP;
+		if(pChunk->m_Type == QUEUED_SNAPSHOT)
+			pSelf->WriteSnapshot(pChunk->m_Tick, pChunk->m_vData.data(), pChunk->m_vData.size());
+		else if(pChunk->m_Type == QUEUED_MESSAGE)
+			pSelf->Write(CHUNKTYPE_MESSAGE, pChunk->m_vData.data(), pChunk->m_vData.size());
+		else
+			pSelf->WriteStop(pChunk);
+		pSelf->m_QueueHead = (pSelf->m_QueueHead + 1) % MAX_QUEUED_CHUNKS;
+		sphore_signal(&pSelf->m_FreeChunks);
+		if(Stop)
+			break;
+	}
+}
+
 void CDemoRecorder::WriteTickMarker(int Tick, int Keyframe)
 {
 	if(m_LastTickMarker == -1 || Tick - m_LastTickMarker > CHUNKMASK_TICK || Keyframe)
@@ -181,33 +261,27 @@ void CDemoRecorder::WriteTickMarker(int Tick, int Keyframe)
 	}
 
 	m_LastTickMarker = Tick;
-	if(m_FirstTick < 0)
-		m_FirstTick = Tick;
+	if(m_FirstTickMarker < 0)
+		m_FirstTickMarker = Tick;
 }
 
 void CDemoRecorder::Write(int Type, const void *pData, int Size)
 {
-	if(!m_File)
-		return;
-
-	char aBuffer[64 * 1024];
-	char aBuffer2[64 * 1024];
-
 	/* pad the data with 0 so we get an alignment of 4,
 	else the compression won't work and miss some bytes */
-	mem_copy(aBuffer2, pData, Size);
+	mem_copy(m_aCompressBuffer2, pData, Size);
 	while(Size & 3)
-		aBuffer2[Size++] = 0;
-	Size = CVariableInt::Compress(aBuffer2, Size, aBuffer, sizeof(aBuffer)); // buffer2 -> buffer
+		m_aCompressBuffer2[Size++] = 0;
+	Size = CVariableInt::Compress(m_aCompressBuffer2, Size, m_aCompressBuffer, sizeof(m_aCompressBuffer)); // buffer2 -> buffer
 	if(Size < 0)
 	{
-		m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_recorder", "error during intpack compression");
+		dbg_msg("demo_recorder", "error during intpack compression");
 		return;
 	}
-	Size = m_Huffman.Compress(aBuffer, Size, aBuffer2, sizeof(aBuffer2)); // buffer -> buffer2
+	Size = m_Huffman.Compress(m_aCompressBuffer, Size, m_aCompressBuffer2, sizeof(m_aCompressBuffer2)); // buffer -> buffer2
 	if(Size < 0)
 	{
-		m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_recorder", "error during network compression");
+		dbg_msg("demo_recorder", "error during network compression");
 		return;
 	}
 
@@ -235,21 +309,23 @@ void CDemoRecorder::Write(int Type, const void *pData, int Size)
 		}
 	}
 
-	io_write(m_File, aBuffer2, Size);
+	io_write(m_File, m_aCompressBuffer2, Size);
 }
 
-void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
+void CDemoRecorder::WriteSnapshot(int Tick, const void *pData, int Size)
 {
-	char aTmpData[CSnapshot::MAX_SIZE];
-
-	if(m_LastKeyFrame == -1 || (Tick - m_LastKeyFrame) > SERVER_TICK_SPEED * 5)
+	if(m_LastKeyFrame == -1 || (Tick - m_LastKeyFrame) > m_KeyframeInterval)
 	{
 		// write full tickmarker
+		CDemoKeyFrame KeyFrame;
+		KeyFrame.m_Filepos = io_tell(m_File);
+		KeyFrame.m_Tick = Tick;
+		m_vKeyFrames.push_back(KeyFrame);
 		WriteTickMarker(Tick, 1);
 
 		// write snapshot
-		int SnapSize = ((CSnapshot *) pData)->Serialize(aTmpData);
-		Write(CHUNKTYPE_SNAPSHOT, aTmpData, SnapSize);
+		int SnapSize = ((CSnapshot *) pData)->Serialize(m_aSnapshotBuffer);
+		Write(CHUNKTYPE_SNAPSHOT, m_aSnapshotBuffer, SnapSize);
 
 		m_LastKeyFrame = Tick;
 		mem_copy(m_aLastSnapshotData, pData, Size);
@@ -260,53 +336,125 @@ void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
 		WriteTickMarker(Tick, 0);
 
 		// create delta
-		int DeltaSize = m_pSnapshotDelta->CreateDelta((CSnapshot *) m_aLastSnapshotData, (CSnapshot *) pData, &aTmpData);
+		int DeltaSize = m_pSnapshotDelta->CreateDelta((CSnapshot *) m_aLastSnapshotData, (CSnapshot *) pData, m_aSnapshotBuffer);
 		if(DeltaSize)
 		{
 			// record delta
-			Write(CHUNKTYPE_DELTA, aTmpData, DeltaSize);
+			Write(CHUNKTYPE_DELTA, m_aSnapshotBuffer, DeltaSize);
 			mem_copy(m_aLastSnapshotData, pData, Size);
 		}
 	}
 }
 
-void CDemoRecorder::RecordMessage(const void *pData, int Size)
+// the stop chunk carries the length as its tick and the timeline markers as its data
+void CDemoRecorder::WriteStop(const CQueuedChunk *pChunk)
 {
-	Write(CHUNKTYPE_MESSAGE, pData, Size);
-}
-
-int CDemoRecorder::Stop()
-{
-	if(!m_File)
-	{
-		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", "No active demo recording to stop");
-		return -1;
-	}
+	const long DemoSize = io_tell(m_File);
 
 	// add the demo length to the header
 	io_seek(m_File, gs_LengthOffset, IOSEEK_START);
 	unsigned char aLength[4];
-	int_to_bytes_be(aLength, Length());
+	int_to_bytes_be(aLength, pChunk->m_Tick);
 	io_write(m_File, aLength, sizeof(aLength));
 
 	// add the timeline markers to the header
 	io_seek(m_File, gs_NumMarkersOffset, IOSEEK_START);
 	unsigned char aNumMarkers[4];
-	int_to_bytes_be(aNumMarkers, m_NumTimelineMarkers);
+	int_to_bytes_be(aNumMarkers, pChunk->m_vData.size() / sizeof(int));
 	io_write(m_File, aNumMarkers, sizeof(aNumMarkers));
-	for(int i = 0; i < m_NumTimelineMarkers; i++)
+	for(unsigned i = 0; i < pChunk->m_vData.size() / sizeof(int); i++)
 	{
 		unsigned char aMarker[4];
-		int_to_bytes_be(aMarker, m_aTimelineMarkers[i]);
+		int_to_bytes_be(aMarker, ((const int *) pChunk->m_vData.data())[i]);
 		io_write(m_File, aMarker, sizeof(aMarker));
 	}
 
 	io_close(m_File);
 	m_File = 0;
+	WriteIndex(DemoSize);
 	m_LastKeyFrame = -1;
 	m_LastTickMarker = -1;
+}
+
+void CDemoRecorder::WriteIndex(long DemoSize)
+{
+	char aFilename[IO_MAX_PATH_LENGTH];
+	DemoIndexFilename(m_aFilename, aFilename, sizeof(aFilename));
+	IOHANDLE File = m_pStorage->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+	{
+		dbg_msg("demo_recorder", "failed to open '%s' for writing", aFilename);
+		return;
+	}
+
+	CDemoIndexHeader Header;
+	mem_zero(&Header, sizeof(Header));
+	mem_copy(Header.m_aMarker, gs_aIndexMarker, sizeof(Header.m_aMarker));
+	Header.m_Version = gs_IndexVersion;
+	Header.m_ByteOrder = gs_IndexByteOrder;
+	Header.m_KeyFrameSize = sizeof(CDemoKeyFrame);
+	Header.m_DemoSize = DemoSize;
+	Header.m_FirstTick = m_FirstTickMarker;
+	Header.m_LastTick = m_LastTickMarker;
+	Header.m_NumKeyFrames = m_vKeyFrames.size();
+	io_write(File, &Header, sizeof(Header));
+	if(!m_vKeyFrames.empty())
+		io_write(File, m_vKeyFrames.data(), m_vKeyFrames.size() * sizeof(CDemoKeyFrame));
+	io_close(File);
+}
+
+// blocks while the writer thread is MAX_QUEUED_CHUNKS behind
+void CDemoRecorder::Enqueue(int Type, int Tick, const void *pData, int Size)
+{
+	sphore_wait(&m_FreeChunks);
+	CQueuedChunk *pChunk = &m_aQueue[m_QueueTail];
+	pChunk->m_Type = Type;
+	pChunk->m_Tick = Tick;
+	pChunk->m_vData.assign((const char *) pData, (const char *) pData + Size);
+	m_QueueTail = (m_QueueTail + 1) % MAX_QUEUED_CHUNKS;
+	sphore_signal(&m_QueuedChunks);
+}
+
+void CDemoRecorder::StopWriter()
+{
+	Enqueue(QUEUED_STOP, Length(), m_aTimelineMarkers, m_NumTimelineMarkers * sizeof(int));
+	thread_wait(m_pWriterThread);
+	m_pWriterThread = 0;
 	m_FirstTick = -1;
+	m_LastTick = -1;
 	m_NumTimelineMarkers = 0;
+}
+
+void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
+{
+	if(!m_Recording)
+		return;
+
+	Enqueue(QUEUED_SNAPSHOT, Tick, pData, Size);
+	m_LastTick = Tick;
+	if(m_FirstTick < 0)
+		m_FirstTick = Tick;
+}
+
+void CDemoRecorder::RecordMessage(const void *pData, int Size)
+{
+	if(!m_Recording)
+		return;
+
+	Enqueue(QUEUED_MESSAGE, 0, pData, Size);
+}
+
+int CDemoRecorder::Stop()
+{
+	if(!m_Recording)
+	{
+		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", "No active demo recording to stop");
+		return -1;
+	}
+
+	// wait for the writer, so the demo is complete once stopped
+	m_Recording = false;
+	StopWriter();
 	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", "Stopped recording");
 
 	return 0;
@@ -314,7 +462,7 @@ int CDemoRecorder::Stop()
 
 void CDemoRecorder::AddDemoMarker()
 {
-	if(m_LastTickMarker < 0)
+	if(m_LastTick < 0)
 	{
 		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", "Cannot add timeline marker: demo recording not active");
 		return;
@@ -328,7 +476,7 @@ void CDemoRecorder::AddDemoMarker()
 	// not more than 1 marker in a second
 	if(m_NumTimelineMarkers > 0)
 	{
-		int Diff = m_LastTickMarker - m_aTimelineMarkers[m_NumTimelineMarkers - 1];
+		int Diff = m_LastTick - m_aTimelineMarkers[m_NumTimelineMarkers - 1];
 		if(Diff < SERVER_TICK_SPEED * 1.0f)
 		{
 			m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", "Cannot add timeline marker: marker is too close to previous marker");
@@ -336,7 +484,7 @@ void CDemoRecorder::AddDemoMarker()
 		}
 	}
 
-	m_aTimelineMarkers[m_NumTimelineMarkers++] = m_LastTickMarker;
+	m_aTimelineMarkers[m_NumTimelineMarkers++] = m_LastTick;
 
 	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", "Added timeline marker");
 }
@@ -349,11 +497,23 @@ CDemoPlayer::CDemoPlayer(class CSnapshotDelta *pSnapshotDelta)
 	m_File = 0;
 	m_aErrorMsg[0] = 0;
 	m_pKeyFrames = 0;
+	m_pMappedIndex = 0;
+	m_MappedIndexSize = 0;
+
+	m_FastForward = false;
+	m_pDecodedChunks = 0;
+	m_pDecoderThread = 0;
 
 	m_pSnapshotDelta = pSnapshotDelta;
 	m_LastSnapshotDataSize = -1;
 }
 
+CDemoPlayer::~CDemoPlayer()
+{
+	StopDecoder();
+	mem_free(m_pDecodedChunks);
+}
+
 void CDemoPlayer::Init(class IConsole *pConsole, class IStorage *pStorage)
 {
 	m_pConsole = pConsole;
@@ -469,20 +629,66 @@ void CDemoPlayer::ScanFile()
 
 	// copy all the frames to an array instead for fast access
 	int i;
-	m_pKeyFrames = (CKeyFrame *) mem_alloc(m_Info.m_SeekablePoints * sizeof(CKeyFrame));
+	CDemoKeyFrame *pKeyFrames = (CDemoKeyFrame *) mem_alloc(m_Info.m_SeekablePoints * sizeof(CDemoKeyFrame));
 	for(pCurrentKey = pFirstKey, i = 0; pCurrentKey; pCurrentKey = pCurrentKey->m_pNext, i++)
-		m_pKeyFrames[i] = pCurrentKey->m_Frame;
+		pKeyFrames[i] = pCurrentKey->m_Frame;
+	m_pKeyFrames = pKeyFrames;
 
 	// destroy the temporary heap and seek back to the start
 	io_seek(m_File, StartPos, IOSEEK_START);
 }
 
+int CDemoPlayer::ReadChunk(int *pType, int *pTick, char *pData, int *pDataSize)
+{
+	int ChunkSize;
+	*pDataSize = 0;
+	if(ReadChunkHeader(pType, &ChunkSize, pTick))
+		return CHUNKERROR_EOF;
+
+	// read the chunk
+	if(ChunkSize)
+	{
+		if(io_read(m_File, m_aCompressedData, ChunkSize) != (unsigned) ChunkSize)
+			return CHUNKERROR_READ;
+
+		int DataSize = m_Huffman.Decompress(m_aCompressedData, ChunkSize, m_aDecompressed, sizeof(m_aDecompressed));
+		if(DataSize < 0)
+			return CHUNKERROR_NETWORK;
+
+		DataSize = CVariableInt::Decompress(m_aDecompressed, DataSize, pData, CSnapshot::MAX_SIZE);
+		if(DataSize < 0)
+			return CHUNKERROR_INTPACK;
+		*pDataSize = DataSize;
+	}
+	return 0;
+}
+
+// takes the next chunk from the decoder thread, or reads it directly
+int CDemoPlayer::NextChunk(int *pType, int *pTick, char *pData, int *pDataSize)
+{
+	if(!m_pDecoderThread)
+		return ReadChunk(pType, pTick, pData, pDataSize);
+
+	sphore_wait(&m_DecodedChunks);
+	const CDecodedChunk *pChunk = &m_pDecodedChunks[m_NumConsumed % NUM_DECODED_CHUNKS];
+	const int Result = pChunk->m_Result;
+	*pType = pChunk->m_Type;
+	*pTick = pChunk->m_Tick;
+	*pDataSize = pChunk->m_Size;
+	mem_copy(pData, pChunk->m_aData, pChunk->m_Size);
+	m_NumConsumed++;
+	sphore_signal(&m_FreeDecodedChunks);
+
+	// the decoder stops after an error, continue without it
+	if(Result)
+		StopDecoder();
+	return Result;
+}
+
 void CDemoPlayer::DoTick()
 {
-	static char aCompressedData[CSnapshot::MAX_SIZE];
-	static char aDecompressed[CSnapshot::MAX_SIZE];
-	static char aData[CSnapshot::MAX_SIZE];
-	static char aNewSnap[CSnapshot::MAX_SIZE];
+	char *pData = m_aChunkData;
+	char *pNewSnap = m_aNewSnapshotData;
 	bool GotSnapshot = false;
 
 	// update ticks
@@ -492,9 +698,9 @@ void CDemoPlayer::DoTick()
 
 	while(1)
 	{
-		int DataSize = 0;
-		int ChunkType, ChunkSize;
-		if(ReadChunkHeader(&ChunkType, &ChunkSize, &ChunkTick))
+		int DataSize, ChunkType;
+		const int Result = NextChunk(&ChunkType, &ChunkTick, pData, &DataSize);
+		if(Result == CHUNKERROR_EOF)
 		{
 			// stop on error or eof
 			m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_player", "end of file");
@@ -507,34 +713,17 @@ void CDemoPlayer::DoTick()
 				Pause();
 			break;
 		}
-
-		// read the chunk
-		if(ChunkSize)
+		else if(Result)
 		{
-			if(io_read(m_File, aCompressedData, ChunkSize) != (unsigned) ChunkSize)
-			{
-				// stop on error or eof
+			// stop on error
+			if(Result == CHUNKERROR_READ)
 				m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_player", "error reading chunk");
-				Stop();
-				break;
-			}
-
-			DataSize = m_Huffman.Decompress(aCompressedData, ChunkSize, aDecompressed, sizeof(aDecompressed));
-			if(DataSize < 0)
-			{
-				// stop on error or eof
+			else if(Result == CHUNKERROR_NETWORK)
 				m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_player", "error during network decompression");
-				Stop();
-				break;
-			}
-
-			DataSize = CVariableInt::Decompress(aDecompressed, DataSize, aData, sizeof(aData));
-			if(DataSize < 0)
-			{
+			else
 				m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_player", "error during intpack decompression");
-				Stop();
-				break;
-			}
+			Stop();
+			break;
 		}
 
 		if(ChunkType == CHUNKTYPE_DELTA)
@@ -546,14 +735,14 @@ void CDemoPlayer::DoTick()
 			if(m_LastSnapshotDataSize == -1)
 				continue;
 
-			DataSize = m_pSnapshotDelta->UnpackDelta((CSnapshot *) m_aLastSnapshotData, (CSnapshot *) aNewSnap, aData, DataSize);
+			DataSize = m_pSnapshotDelta->UnpackDelta((CSnapshot *) m_aLastSnapshotData, (CSnapshot *) pNewSnap, pData, DataSize);
 			if(DataSize >= 0)
 			{
 				if(m_pListener)
-					m_pListener->OnDemoPlayerSnapshot(aNewSnap, DataSize);
+					m_pListener->OnDemoPlayerSnapshot(pNewSnap, DataSize);
 
 				m_LastSnapshotDataSize = DataSize;
-				mem_copy(m_aLastSnapshotData, aNewSnap, DataSize);
+				mem_copy(m_aLastSnapshotData, pNewSnap, DataSize);
 			}
 			else
 			{
@@ -568,17 +757,17 @@ void CDemoPlayer::DoTick()
 			CSnapshotBuilder Builder;
 			GotSnapshot = true;
 
-			if(Builder.UnserializeSnap(aData, DataSize))
-				DataSize = Builder.Finish(aNewSnap);
+			if(Builder.UnserializeSnap(pData, DataSize))
+				DataSize = Builder.Finish(pNewSnap);
 			else
 				DataSize = -1;
 
 			if(DataSize >= 0)
 			{
 				m_LastSnapshotDataSize = DataSize;
-				mem_copy(m_aLastSnapshotData, aNewSnap, DataSize);
+				mem_copy(m_aLastSnapshotData, pNewSnap, DataSize);
 				if(m_pListener)
-					m_pListener->OnDemoPlayerSnapshot(aNewSnap, DataSize);
+					m_pListener->OnDemoPlayerSnapshot(pNewSnap, DataSize);
 			}
 			else
 			{
@@ -604,12 +793,20 @@ void CDemoPlayer::DoTick()
 			}
 			else if(ChunkType == CHUNKTYPE_MESSAGE && m_pListener && m_LastSnapshotDataSize != -1)
 			{
-				m_pListener->OnDemoPlayerMessage(aData, DataSize);
+				m_pListener->OnDemoPlayerMessage(pData, DataSize);
 			}
 		}
 	}
 }
 
+bool CDemoPlayer::DecodeTick()
+{
+	if(!IsPlaying() || m_Info.m_Info.m_Paused)
+		return false;
+	DoTick();
+	return IsPlaying() && !m_Info.m_Info.m_Paused;
+}
+
 void CDemoPlayer::Pause()
 {
 	m_Info.m_Info.m_Paused = true;
@@ -706,8 +903,11 @@ const char *CDemoPlayer::Load(const char *pFilename, int StorageType, const char
 
 		// save map
 		MapFile = m_pStorage->OpenFile(aMapFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
-		io_write(MapFile, pMapData, MapSize);
-		io_close(MapFile);
+		if(MapFile)
+		{
+			io_write(MapFile, pMapData, MapSize);
+			io_close(MapFile);
+		}
 
 		// free data
 		mem_free(pMapData);
@@ -718,13 +918,110 @@ const char *CDemoPlayer::Load(const char *pFilename, int StorageType, const char
 	for(int i = 0; i < m_Info.m_Info.m_NumTimelineMarkers; i++)
 		m_Info.m_Info.m_aTimelineMarkers[i] = bytes_be_to_int(m_Info.m_Header.m_aTimelineMarkers[i]);
 
-	// scan the file for interesting points
-	ScanFile();
+	// use the index of the keyframes or scan the file for them
+	if(!LoadIndex(StorageType))
+		ScanFile();
 
 	// ready for playback
 	return 0;
 }
 
+bool CDemoPlayer::LoadIndex(int StorageType)
+{
+	char aFilename[IO_MAX_PATH_LENGTH];
+	DemoIndexFilename(m_aFilename, aFilename, sizeof(aFilename));
+	IOHANDLE File = m_pStorage->OpenFile(aFilename, IOFLAG_READ, StorageType);
+	if(!File)
+		return false;
+	long int Size = 0;
+	void *pData = io_map(File, &Size);
+	io_close(File);
+	if(!pData)
+		return false;
+
+	const long StartPos = io_tell(m_File);
+	const long DemoSize = io_length(m_File);
+	io_seek(m_File, StartPos, IOSEEK_START);
+
+	// an index of another demo or a demo which was cut off doesn't fit
+	const CDemoIndexHeader *pHeader = static_cast<const CDemoIndexHeader *>(pData);
+	const bool Valid = Size >= (long int) sizeof(CDemoIndexHeader) && mem_comp(pHeader->m_aMarker, gs_aIndexMarker, sizeof(gs_aIndexMarker)) == 0 &&
+			   pHeader->m_Version == gs_IndexVersion && pHeader->m_ByteOrder == gs_IndexByteOrder &&
+			   pHeader->m_KeyFrameSize == (int) sizeof(CDemoKeyFrame) && pHeader->m_DemoSize == DemoSize && pHeader->m_NumKeyFrames >= 0 &&
+			   Size == (long int) sizeof(CDemoIndexHeader) + pHeader->m_NumKeyFrames * (long int) sizeof(CDemoKeyFrame);
+	if(!Valid)
+	{
+		m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_player", "ignoring stale keyframe index");
+		io_unmap(pData, Size);
+		return false;
+	}
+
+	m_pMappedIndex = pData;
+	m_MappedIndexSize = Size;
+	m_pKeyFrames = reinterpret_cast<const CDemoKeyFrame *>(pHeader + 1);
+	m_Info.m_SeekablePoints = pHeader->m_NumKeyFrames;
+	m_Info.m_Info.m_FirstTick = pHeader->m_FirstTick;
+	m_Info.m_Info.m_LastTick = pHeader->m_LastTick;
+	return true;
+}
+
+void CDemoPlayer::DecoderThread(void *pUser)
+{
+	CDemoPlayer *pSelf = static_cast<CDemoPlayer *>(pUser);
+	int NumDecoded = pSelf->m_NumDecoded;
+	while(1)
+	{
+		sphore_wait(&pSelf->m_FreeDecodedChunks);
+		if(pSelf->m_StopDecoder)
+			break;
+
+		CDecodedChunk *pChunk = &pSelf->m_pDecodedChunks[NumDecoded % NUM_DECODED_CHUNKS];
+		pChunk->m_Filepos = io_tell(pSelf->m_File);
+		pChunk->m_Result = pSelf->ReadChunk(&pChunk->m_Type, &pSelf->m_DecoderTick, pChunk->m_aData, &pChunk->m_Size);
+		pChunk->m_Tick = pSelf->m_DecoderTick;
+		pSelf->m_NumDecoded = ++NumDecoded;
+		sphore_signal(&pSelf->m_DecodedChunks);
+		if(pChunk->m_Result)
+			break;
+	}
+}
+
+void CDemoPlayer::StartDecoder()
+{
+	if(m_pDecoderThread || !m_File)
+		return;
+
+	if(!m_pDecodedChunks)
+		m_pDecodedChunks = (CDecodedChunk *) mem_alloc(NUM_DECODED_CHUNKS * sizeof(CDecodedChunk));
+	m_NumDecoded = 0;
+	m_NumConsumed = 0;
+	// tick markers are relative to the last one which was played
+	m_DecoderTick = m_Info.m_NextTick;
+	sphore_init(&m_DecodedChunks);
+	sphore_init(&m_FreeDecodedChunks);
+	for(int i = 0; i < NUM_DECODED_CHUNKS; i++)
+		sphore_signal(&m_FreeDecodedChunks);
+	m_StopDecoder = false;
+	m_pDecoderThread = thread_init(DecoderThread, this);
+}
+
+void CDemoPlayer::StopDecoder()
+{
+	if(!m_pDecoderThread)
+		return;
+
+	m_StopDecoder = true;
+	sphore_signal(&m_FreeDecodedChunks);
+	thread_wait(m_pDecoderThread);
+	m_pDecoderThread = 0;
+	sphore_destroy(&m_DecodedChunks);
+	sphore_destroy(&m_FreeDecodedChunks);
+
+	// continue reading after the last chunk which was played
+	if(m_NumDecoded > m_NumConsumed)
+		io_seek(m_File, m_pDecodedChunks[m_NumConsumed % NUM_DECODED_CHUNKS].m_Filepos, IOSEEK_START);
+}
+
 int CDemoPlayer::Play()
 {
 	// fill in previous and next tick
@@ -761,11 +1058,14 @@ int CDemoPlayer::SetPos(int WantedTick)
 		Keyframe--;
 
 	// seek to the correct keyframe
+	StopDecoder();
 	io_seek(m_File, m_pKeyFrames[Keyframe].m_Filepos, IOSEEK_START);
 
 	m_Info.m_NextTick = -1;
 	m_Info.m_Info.m_CurrentTick = -1;
 	m_Info.m_PreviousTick = -1;
+	if(m_FastForward)
+		StartDecoder();
 
 	// playback everything until we hit our tick
 	while(m_Info.m_NextTick < WantedTick)
@@ -779,6 +1079,11 @@ int CDemoPlayer::SetPos(int WantedTick)
 void CDemoPlayer::SetSpeed(float Speed)
 {
 	m_Info.m_Info.m_Speed = Speed;
+	m_FastForward = Speed > 1.0f;
+	if(m_FastForward)
+		StartDecoder();
+	else
+		StopDecoder();
 }
 
 void CDemoPlayer::SetSpeedIndex(int Offset)
@@ -840,9 +1145,16 @@ int CDemoPlayer::Stop()
 		return -1;
 
 	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_player", "Stopped playback");
+	StopDecoder();
+	m_FastForward = false;
 	io_close(m_File);
 	m_File = 0;
-	mem_free(m_pKeyFrames);
+	if(m_pMappedIndex)
+		io_unmap(m_pMappedIndex, m_MappedIndexSize);
+	else
+		mem_free((void *) m_pKeyFrames);
+	m_pMappedIndex = 0;
+	m_MappedIndexSize = 0;
 	m_pKeyFrames = 0;
 	m_aFilename[0] = '\0';
 	return 0;
@@ -3,31 +3,94 @@
 #ifndef ENGINE_SHARED_DEMO_H
 #define ENGINE_SHARED_DEMO_H
 
+#include <base/hash.h>
+
 #include <engine/demo.h>
 #include <engine/shared/protocol.h>
 
 #include "huffman.h"
 #include "snapshot.h"
 
+#include <atomic>
+#include <vector>
+
+// position of a keyframe in a demo, also the record of the keyframe index
+struct CDemoKeyFrame
+{
+	long m_Filepos;
+	int m_Tick;
+};
+
 class CDemoRecorder : public IDemoRecorder
 {
+	enum
+	{
+		// chunks waiting for the writer thread, recording blocks when it falls this far behind
+		MAX_QUEUED_CHUNKS = 256,
+	};
+
+	enum
+	{
+		QUEUED_SNAPSHOT = 0,
+		QUEUED_MESSAGE,
+		QUEUED_STOP,
+	};
+
+	struct CQueuedChunk
+	{
+		int m_Type;
+		int m_Tick;
+		std::vector<char> m_vData;
+	};
+
 	class IConsole *m_pConsole;
 	class IStorage *m_pStorage;
+	class CSnapshotDelta *m_pSnapshotDelta;
+
+	// state of the recording thread
+	bool m_Recording;
+	int m_WantedKeyframeInterval;
+	int m_FirstTick;
+	int m_LastTick;
+	int m_NumTimelineMarkers;
+	int m_aTimelineMarkers[MAX_TIMELINE_MARKERS];
+
+	// ring of chunks, filled by the recording thread and emptied by the writer thread
+	CQueuedChunk m_aQueue[MAX_QUEUED_CHUNKS];
+	int m_QueueHead;
+	int m_QueueTail;
+	SEMAPHORE m_QueuedChunks;
+	SEMAPHORE m_FreeChunks;
+	void *m_pWriterThread;
+
+	// state of the writer thread
 	CHuffman m_Huffman;
 	IOHANDLE m_File;
+	IOHANDLE m_MapFile;
+	char m_aFilename[IO_MAX_PATH_LENGTH];
+	int m_KeyframeInterval;
+	int m_FirstTickMarker;
 	int m_LastTickMarker;
 	int m_LastKeyFrame;
-	int m_FirstTick;
+	std::vector<CDemoKeyFrame> m_vKeyFrames;
 	unsigned char m_aLastSnapshotData[CSnapshot::MAX_SIZE];
-	class CSnapshotDelta *m_pSnapshotDelta;
-	int m_NumTimelineMarkers;
-	int m_aTimelineMarkers[MAX_TIMELINE_MARKERS];
+	char m_aSnapshotBuffer[CSnapshot::MAX_SIZE];
+	char m_aCompressBuffer[64 * 1024];
+	char m_aCompressBuffer2[64 * 1024];
 
+	static void WriterThread(void *pUser);
+	void WriteSnapshot(int Tick, const void *pData, int Size);
 	void WriteTickMarker(int Tick, int Keyframe);
 	void Write(int Type, const void *pData, int Size);
+	void WriteStop(const CQueuedChunk *pChunk);
+	void WriteIndex(long DemoSize);
+
+	void Enqueue(int Type, int Tick, const void *pData, int Size);
+	void StopWriter();
 
 public:
 	CDemoRecorder(class CSnapshotDelta *pSnapshotDelta);
+	~CDemoRecorder();
 	void Init(class IConsole *pConsole, class IStorage *pStorage);
 
 	int Start(const char *pFilename, const char *pNetversion, const char *pMap, SHA256_DIGEST MapSha256, unsigned MapCrc, const char *pType);
@@ -37,9 +100,12 @@ public:
 	void RecordSnapshot(int Tick, const void *pData, int Size);
 	void RecordMessage(const void *pData, int Size);
 
-	bool IsRecording() const { return m_File != 0; }
+	// ticks between keyframes of the next recording, denser keyframes make seeking faster
+	void SetKeyframeInterval(int Ticks) { m_WantedKeyframeInterval = Ticks; }
+
+	bool IsRecording() const { return m_Recording; }
 
-	int Length() const { return (m_LastTickMarker - m_FirstTick) / SERVER_TICK_SPEED; }
+	int Length() const { return (m_LastTick - m_FirstTick) / SERVER_TICK_SPEED; }
 };
 
 class CDemoPlayer : public IDemoPlayer
@@ -77,16 +143,31 @@ private:
 	IListener *m_pListener;
 
 	// Playback
-	struct CKeyFrame
+	struct CKeyFrameSearch
 	{
-		long m_Filepos;
-		int m_Tick;
+		CDemoKeyFrame m_Frame;
+		CKeyFrameSearch *m_pNext;
 	};
 
-	struct CKeyFrameSearch
+	enum
 	{
-		CKeyFrame m_Frame;
-		CKeyFrameSearch *m_pNext;
+		// chunks the decoder thread reads ahead while fast-forwarding
+		NUM_DECODED_CHUNKS = 32,
+
+		CHUNKERROR_EOF = 1,
+		CHUNKERROR_READ,
+		CHUNKERROR_NETWORK,
+		CHUNKERROR_INTPACK,
+	};
+
+	struct CDecodedChunk
+	{
+		int m_Result;
+		int m_Type;
+		int m_Tick;
+		int m_Size;
+		long m_Filepos;
+		char m_aData[CSnapshot::MAX_SIZE];
 	};
 
 	class IConsole *m_pConsole;
@@ -95,7 +176,24 @@ private:
 	IOHANDLE m_File;
 	char m_aFilename[256];
 	char m_aErrorMsg[256];
-	CKeyFrame *m_pKeyFrames;
+	const CDemoKeyFrame *m_pKeyFrames;
+	void *m_pMappedIndex;
+	long int m_MappedIndexSize;
+	char m_aCompressedData[CSnapshot::MAX_SIZE];
+	char m_aDecompressed[CSnapshot::MAX_SIZE];
+	char m_aChunkData[CSnapshot::MAX_SIZE];
+	char m_aNewSnapshotData[CSnapshot::MAX_SIZE];
+
+	// decoder thread, reads and decompresses the chunks ahead of playback
+	bool m_FastForward;
+	CDecodedChunk *m_pDecodedChunks;
+	int m_NumDecoded;
+	int m_NumConsumed;
+	int m_DecoderTick;
+	SEMAPHORE m_DecodedChunks;
+	SEMAPHORE m_FreeDecodedChunks;
+	std::atomic<bool> m_StopDecoder;
+	void *m_pDecoderThread;
 
 	CPlaybackInfo m_Info;
 	int m_DemoType;
@@ -104,11 +202,19 @@ private:
 	class CSnapshotDelta *m_pSnapshotDelta;
 
 	int ReadChunkHeader(int *pType, int *pSize, int *pTick);
+	int ReadChunk(int *pType, int *pTick, char *pData, int *pDataSize);
+	int NextChunk(int *pType, int *pTick, char *pData, int *pDataSize);
 	void DoTick();
 	void ScanFile();
+	bool LoadIndex(int StorageType);
+
+	static void DecoderThread(void *pUser);
+	void StartDecoder();
+	void StopDecoder();
 
 public:
 	CDemoPlayer(class CSnapshotDelta *pSnapshotDelta);
+	~CDemoPlayer();
 	void Init(class IConsole *pConsole, class IStorage *pStorage);
 	void SetListener(IListener *pListener);
 
@@ -128,6 +234,14 @@ public:
 
 	int Update();
 
+	// plays the next tick right away instead of at its time, returns false at the end of the demo
+	bool DecodeTick();
+
+	// speeds above 1 decode the demo in a thread ahead of playback
+	bool IsFastForwarding() const { return m_pDecoderThread != 0; }
+	// whether the keyframes came from the index next to the demo
+	bool HasIndex() const { return m_pMappedIndex != 0; }
+
 	const CPlaybackInfo *Info() const { return &m_Info; }
 	int IsPlaying() const { return m_File != 0; }
 };
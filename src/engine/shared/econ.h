@@ -50,6 +50,8 @@ class CEcon
 
 public:
 	IConsole *Console() { return m_pConsole; }
+	// the client whose command is being executed, -1 outside of its commands
+	int UserClientID() const { return m_UserClientID; }
 
 	void Init(CConfig *pConfig, IConsole *pConsole, class CNetBan *pNetBan);
 	bool Open();
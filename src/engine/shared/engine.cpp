@@ -2,6 +2,7 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <stdlib.h> // srand
 
+#include <base/math.h>
 #include <base/system.h>
 
 #include <engine/console.h>
@@ -10,6 +11,8 @@
 #include <engine/shared/network.h>
 #include <engine/storage.h>
 
+#include <thread>
+
 void CHostLookup::CJob::Run()
 {
 	m_pParent->m_Result = net_host_lookup(m_pParent->m_aHostname, &m_pParent->m_Addr, m_pParent->m_Nettype);
@@ -46,6 +49,22 @@ public:
 		}
 	}
 
+	static void Con_StorageRefresh(IConsole::IResult *pResult, void *pUserData)
+	{
+		static_cast<CEngine *>(pUserData)->m_pStorage->RefreshIndex();
+	}
+
+	static void Con_StorageStats(IConsole::IResult *pResult, void *pUserData)
+	{
+		CEngine *pEngine = static_cast<CEngine *>(pUserData);
+		IStorage::CIndexStats Stats;
+		pEngine->m_pStorage->GetIndexStats(&Stats);
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "%d directories indexed, %lld lookups with %.1f%% hits, %lld syscalls saved, %lld invalidations, %lld watch failures",
+			Stats.m_NumDirectories, Stats.m_Lookups, Stats.m_Lookups ? Stats.m_Hits * 100.0 / Stats.m_Lookups : 0.0, Stats.m_SavedSyscalls, Stats.m_Invalidations, Stats.m_WatchFailures);
+		pEngine->m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "storage", aBuf);
+	}
+
 	CEngine(const char *pAppname)
 	{
 		srand(time_get());
@@ -62,7 +81,8 @@ public:
 		dbg_msg("engine", "unknown endian");
 #endif
 
-		m_JobPool.Init(1);
+		// a few threads, so loading jobs can run in parallel to the others
+		m_JobPool.Init(clamp((int) std::thread::hardware_concurrency() - 1, 2, 8));
 
 		m_DataLogSent = 0;
 		m_DataLogRecv = 0;
@@ -85,6 +105,8 @@ public:
 			return;
 
 		m_pConsole->Register("dbg_lognetwork", "", CFGFLAG_SERVER | CFGFLAG_CLIENT, Con_DbgLognetwork, this, "Log the network");
+		m_pConsole->Register("storage_refresh", "", CFGFLAG_SERVER | CFGFLAG_CLIENT, Con_StorageRefresh, this, "Read the indexed storage directories again");
+		m_pConsole->Register("storage_stats", "", CFGFLAG_SERVER | CFGFLAG_CLIENT, Con_StorageStats, this, "Show how many lookups the storage index answered");
 	}
 
 	void ShutdownJobs()
@@ -94,6 +116,16 @@ public:
 
 	void InitLogfile()
 	{
+		// like the log file, these only take effect on startup
+		if(m_pConfig->m_LogAsync)
+		{
+			dbg_logger_async();
+			dbg_logger_rate_limit(m_pConfig->m_LogRateLimit);
+			if(m_pConfig->m_LogCrashDump)
+				dbg_logger_crash_handler();
+		}
+		m_pStorage->EnableIndex(m_pConfig->m_StorageIndex);
+
 		// open logfile if needed
 		if(m_pConfig->m_Logfile[0])
 		{
@@ -3,6 +3,7 @@
 
 #include <base/math.h>
 
+#include <engine/demo.h>
 #include <engine/storage.h>
 
 #include "filecollection.h"
@@ -142,6 +143,12 @@ void CFileCollection::AddEntry(int64 Timestamp)
 			BuildTimestring(m_aTimestamps[0], aTimestring);
 			str_format(aBuf, sizeof(aBuf), "%s/%s_%s%s", m_aPath, m_aFileDesc, aTimestring, m_aFileExt);
 			m_pStorage->RemoveFile(aBuf, IStorage::TYPE_SAVE);
+			if(str_comp(m_aFileExt, ".demo") == 0)
+			{
+				char aIndex[IO_MAX_PATH_LENGTH];
+				DemoIndexFilename(aBuf, aIndex, sizeof(aIndex));
+				m_pStorage->RemoveFile(aIndex, IStorage::TYPE_SAVE);
+			}
 		}
 
 		// add entry to the sorted list
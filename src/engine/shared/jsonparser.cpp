@@ -2,6 +2,11 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include "jsonparser.h"
 
+#include <base/math.h>
+
+#include <cerrno>
+#include <cstdlib>
+
 CJsonParser::CJsonParser() :
 	m_pParsedJson(0x0)
 {
@@ -49,3 +54,432 @@ json_value *CJsonParser::ParseString(const char *pString, const char *pContext)
 {
 	return ParseData(pString, str_length(pString), pContext);
 }
+
+CJsonReader::CJsonReader()
+{
+	m_File = 0;
+	m_pCur = 0;
+	m_pEnd = 0;
+	SetData("", 0);
+}
+
+CJsonReader::~CJsonReader()
+{
+	if(m_File)
+		io_close(m_File);
+}
+
+bool CJsonReader::OpenFile(const char *pFilename, IStorage *pStorage, int StorageType)
+{
+	SetData("", 0, pFilename);
+	m_File = pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType);
+	if(!m_File)
+	{
+		str_format(m_aError, sizeof(m_aError), "Failed to read '%s'", pFilename);
+		m_Token = TOKEN_ERROR;
+		return false;
+	}
+	m_vReadBuffer.resize(READ_BUFFER_SIZE);
+	return true;
+}
+
+void CJsonReader::SetData(const void *pData, unsigned Size, const char *pContext)
+{
+	if(m_File)
+		io_close(m_File);
+	m_File = 0;
+	m_pCur = static_cast<const char *>(pData);
+	m_pEnd = m_pCur + Size;
+	m_Line = 1;
+
+	m_State = STATE_VALUE;
+	m_Depth = 0;
+	m_Token = TOKEN_END;
+	if((int) m_vString.size() < STRING_BUFFER_SIZE)
+		m_vString.resize(STRING_BUFFER_SIZE);
+	m_vString[0] = '\0';
+	m_StringLength = 0;
+	m_Integer = 0;
+	m_Double = 0.0;
+	m_Boolean = false;
+
+	str_copy(m_aContext, pContext, sizeof(m_aContext));
+	m_aError[0] = '\0';
+}
+
+bool CJsonReader::Refill()
+{
+	if(!m_File)
+		return false;
+	const unsigned Read = io_read(m_File, m_vReadBuffer.data(), m_vReadBuffer.size());
+	m_pCur = m_vReadBuffer.data();
+	m_pEnd = m_pCur + Read;
+	return Read > 0;
+}
+
+void CJsonReader::SkipWhitespace()
+{
+	while(true)
+	{
+		const int Char = Peek();
+		if(Char == '\n')
+			m_Line++;
+		else if(Char != ' ' && Char != '\t' && Char != '\r')
+			return;
+		m_pCur++;
+	}
+}
+
+CJsonReader::EToken CJsonReader::Fail(const char *pMessage)
+{
+	if(m_Token != TOKEN_ERROR)
+		str_format(m_aError, sizeof(m_aError), "Failed to parse '%s': %d: %s", m_aContext, m_Line, pMessage);
+	m_Token = TOKEN_ERROR;
+	return m_Token;
+}
+
+CJsonReader::EToken CJsonReader::AfterValue(EToken Token)
+{
+	m_State = m_Depth == 0 ? STATE_DONE : STATE_COMMA_OR_END;
+	m_Token = Token;
+	return m_Token;
+}
+
+CJsonReader::EToken CJsonReader::Next()
+{
+	if(m_Token == TOKEN_ERROR)
+		return m_Token;
+
+	while(true)
+	{
+		SkipWhitespace();
+		const int Char = Peek();
+		switch(m_State)
+		{
+		case STATE_DONE:
+			if(Char != -1)
+				return Fail("trailing data after the document");
+			m_Token = TOKEN_END;
+			return m_Token;
+		case STATE_COMMA_OR_END:
+			if(Char != ',')
+				return ReadEnd(Char);
+			m_pCur++;
+			m_State = m_aIsObject[m_Depth - 1] ? STATE_KEY : STATE_VALUE;
+			continue;
+		case STATE_KEY_OR_END:
+			if(Char == '}')
+				return ReadEnd(Char);
+			[[fallthrough]];
+		case STATE_KEY:
+			if(Char != '"')
+				return Fail("expected a key");
+			m_pCur++;
+			if(!ReadString())
+				return m_Token;
+			SkipWhitespace();
+			if(Get() != ':')
+				return Fail("expected ':' after a key");
+			m_State = STATE_VALUE;
+			m_Token = TOKEN_KEY;
+			return m_Token;
+		case STATE_VALUE_OR_END:
+			if(Char == ']')
+				return ReadEnd(Char);
+			[[fallthrough]];
+		case STATE_VALUE:
+			return ReadValue(Char);
+		}
+	}
+}
+
+CJsonReader::EToken CJsonReader::ReadEnd(int Char)
+{
+	const bool IsObject = m_aIsObject[m_Depth - 1];
+	if(Char != (IsObject ? '}' : ']'))
+		return Fail(IsObject ? "expected ',' or '}'" : "expected ',' or ']'");
+	m_pCur++;
+	m_Depth--;
+	return AfterValue(IsObject ? TOKEN_END_OBJECT : TOKEN_END_ARRAY);
+}
+
+CJsonReader::EToken CJsonReader::ReadValue(int Char)
+{
+	switch(Char)
+	{
+	case '{':
+	case '[':
+		if(m_Depth == MAX_DEPTH)
+			return Fail("too deeply nested");
+		m_pCur++;
+		m_aIsObject[m_Depth++] = Char == '{';
+		m_State = Char == '{' ? STATE_KEY_OR_END : STATE_VALUE_OR_END;
+		m_Token = Char == '{' ? TOKEN_BEGIN_OBJECT : TOKEN_BEGIN_ARRAY;
+		return m_Token;
+	case '"':
+		m_pCur++;
+		if(!ReadString())
+			return m_Token;
+		return AfterValue(TOKEN_STRING);
+	case 't':
+		return ReadLiteral("true", TOKEN_BOOLEAN);
+	case 'f':
+		return ReadLiteral("false", TOKEN_BOOLEAN);
+	case 'n':
+		return ReadLiteral("null", TOKEN_NULL);
+	case -1:
+		return Fail("unexpected end of data");
+	default:
+		if(Char == '-' || (Char >= '0' && Char <= '9'))
+			return ReadNumber();
+		return Fail("unexpected character");
+	}
+}
+
+void CJsonReader::AppendString(const char *pData, int Size)
+{
+	// one more for the null termination
+	if(m_StringLength + Size >= (int) m_vString.size())
+		m_vString.resize(maximum<int>(m_vString.size() * 2, m_StringLength + Size + 1));
+	mem_copy(m_vString.data() + m_StringLength, pData, Size);
+	m_StringLength += Size;
+}
+
+bool CJsonReader::ReadString()
+{
+	m_StringLength = 0;
+	while(true)
+	{
+		// copy the plain characters in one go
+		const char *pStart = m_pCur;
+		while(m_pCur != m_pEnd && *m_pCur != '"' && *m_pCur != '\\' && (unsigned char) *m_pCur >= 0x20)
+			m_pCur++;
+		if(m_pCur != pStart)
+			AppendString(pStart, m_pCur - pStart);
+
+		const int Char = Get();
+		if(Char == '"')
+			break;
+		else if(Char == '\\')
+		{
+			if(!ReadEscape())
+				return false;
+		}
+		else if(Char == -1)
+		{
+			Fail("unterminated string");
+			return false;
+		}
+		else if(Char < 0x20)
+		{
+			Fail("control character in string");
+			return false;
+		}
+		else
+			m_pCur--; // the chunk ended, continue in the next one
+	}
+	m_vString[m_StringLength] = '\0';
+	return true;
+}
+
+static int HexValue(int Char)
+{
+	if(Char >= '0' && Char <= '9')
+		return Char - '0';
+	if(Char >= 'a' && Char <= 'f')
+		return Char - 'a' + 10;
+	if(Char >= 'A' && Char <= 'F')
+		return Char - 'A' + 10;
+	return -1;
+}
+
+bool CJsonReader::ReadEscape()
+{
+	char Escaped;
+	switch(Get())
+	{
+	case '"': Escaped = '"'; break;
+	case '\\': Escaped = '\\'; break;
+	case '/': Escaped = '/'; break;
+	case 'b': Escaped = '\b'; break;
+	case 'f': Escaped = '\f'; break;
+	case 'n': Escaped = '\n'; break;
+	case 'r': Escaped = '\r'; break;
+	case 't': Escaped = '\t'; break;
+	case 'u': Escaped = 0; break;
+	default:
+		Fail("invalid escape sequence");
+		return false;
+	}
+	if(Escaped)
+	{
+		AppendString(&Escaped, 1);
+		return true;
+	}
+
+	int aCodes[2] = {0, 0};
+	for(int i = 0; i < 2; i++)
+	{
+		// the second code only follows a high surrogate
+		if(i == 1 && (Get() != '\\' || Get() != 'u'))
+		{
+			Fail("unpaired surrogate in string");
+			return false;
+		}
+		for(int j = 0; j < 4; j++)
+		{
+			const int Value = HexValue(Get());
+			if(Value < 0)
+			{
+				Fail("invalid unicode escape");
+				return false;
+			}
+			aCodes[i] = aCodes[i] << 4 | Value;
+		}
+		if(aCodes[i] < 0xD800 || aCodes[i] > 0xDBFF)
+			break;
+	}
+
+	int Code = aCodes[0];
+	if(Code >= 0xD800 && Code <= 0xDBFF)
+	{
+		if(aCodes[1] < 0xDC00 || aCodes[1] > 0xDFFF)
+		{
+			Fail("unpaired surrogate in string");
+			return false;
+		}
+		Code = 0x10000 + ((Code - 0xD800) << 10) + (aCodes[1] - 0xDC00);
+	}
+	else if(Code >= 0xDC00 && Code <= 0xDFFF)
+	{
+		Fail("unpaired surrogate in string");
+		return false;
+	}
+
+	char aEncoded[4];
+	const int Length = str_utf8_encode(aEncoded, Code);
+	AppendString(aEncoded, Length);
+	return true;
+}
+
+CJsonReader::EToken CJsonReader::ReadNumber()
+{
+	char aNumber[MAX_NUMBER_LENGTH];
+	int Length = 0;
+	while(true)
+	{
+		const int Char = Peek();
+		if(!((Char >= '0' && Char <= '9') || Char == '-' || Char == '+' || Char == '.' || Char == 'e' || Char == 'E'))
+			break;
+		if(Length == MAX_NUMBER_LENGTH - 1)
+			return Fail("number too long");
+		aNumber[Length++] = Char;
+		m_pCur++;
+	}
+	aNumber[Length] = '\0';
+
+	// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+	const char *p = aNumber;
+	bool Integer = true;
+	if(*p == '-')
+		p++;
+	if(*p == '0')
+		p++;
+	else if(*p >= '1' && *p <= '9')
+		while(*p >= '0' && *p <= '9')
+			p++;
+	else
+		return Fail("invalid number");
+	if(*p == '.')
+	{
+		Integer = false;
+		if(*++p < '0' || *p > '9')
+			return Fail("invalid number");
+		while(*p >= '0' && *p <= '9')
+			p++;
+	}
+	if(*p == 'e' || *p == 'E')
+	{
+		Integer = false;
+		if(*++p == '+' || *p == '-')
+			p++;
+		if(*p < '0' || *p > '9')
+			return Fail("invalid number");
+		while(*p >= '0' && *p <= '9')
+			p++;
+	}
+	if(*p)
+		return Fail("invalid number");
+
+	m_Double = strtod(aNumber, 0);
+	if(Integer)
+	{
+		errno = 0;
+		m_Integer = strtoll(aNumber, 0, 10);
+		if(errno != ERANGE)
+			return AfterValue(TOKEN_INTEGER);
+	}
+	return AfterValue(TOKEN_DOUBLE);
+}
+
+CJsonReader::EToken CJsonReader::ReadLiteral(const char *pLiteral, EToken Token)
+{
+	m_Boolean = str_comp(pLiteral, "true") == 0;
+	for(; *pLiteral; pLiteral++)
+	{
+		if(Get() != *pLiteral)
+			return Fail("unexpected character");
+	}
+	return AfterValue(Token);
+}
+
+bool CJsonReader::NextValue(EToken Token)
+{
+	if(Next() == Token)
+		return true;
+	Skip();
+	return false;
+}
+
+bool CJsonReader::Skip()
+{
+	if(m_Token != TOKEN_BEGIN_OBJECT && m_Token != TOKEN_BEGIN_ARRAY)
+		return m_Token != TOKEN_ERROR;
+	const int Depth = m_Depth;
+	while(m_Depth >= Depth)
+	{
+		if(Next() == TOKEN_ERROR)
+			return false;
+	}
+	return true;
+}
+
+bool CJsonReader::SkipValue()
+{
+	Next();
+	return Skip();
+}
+
+bool CJsonReader::ReadString(char *pBuffer, int BufferSize)
+{
+	if(!NextValue(TOKEN_STRING))
+		return false;
+	str_copy(pBuffer, String(), BufferSize);
+	return true;
+}
+
+bool CJsonReader::ReadInteger(int64 *pValue)
+{
+	if(!NextValue(TOKEN_INTEGER))
+		return false;
+	*pValue = m_Integer;
+	return true;
+}
+
+bool CJsonReader::ReadBoolean(bool *pValue)
+{
+	if(!NextValue(TOKEN_BOOLEAN))
+		return false;
+	*pValue = m_Boolean;
+	return true;
+}
@@ -7,6 +7,8 @@
 
 #include <engine/external/json-parser/json.h>
 
+#include <vector>
+
 class CJsonParser
 {
 	char m_aError[256];
@@ -22,4 +24,114 @@ public:
 	const char *Error() const { return m_aError; }
 };
 
+// pulls the tokens of a document one after another instead of building a tree of it.
+// files are read in chunks, memory stays bounded by the longest string of the document.
+class CJsonReader
+{
+public:
+	enum EToken
+	{
+		TOKEN_ERROR = -1,
+		TOKEN_END,
+		TOKEN_BEGIN_OBJECT,
+		TOKEN_END_OBJECT,
+		TOKEN_BEGIN_ARRAY,
+		TOKEN_END_ARRAY,
+		TOKEN_KEY,
+		TOKEN_STRING,
+		TOKEN_INTEGER,
+		TOKEN_DOUBLE,
+		TOKEN_BOOLEAN,
+		TOKEN_NULL,
+	};
+
+private:
+	enum
+	{
+		MAX_DEPTH = 64,
+		READ_BUFFER_SIZE = 16 * 1024,
+		STRING_BUFFER_SIZE = 256,
+		MAX_NUMBER_LENGTH = 64,
+	};
+
+	enum EState
+	{
+		STATE_VALUE,
+		STATE_VALUE_OR_END,
+		STATE_KEY,
+		STATE_KEY_OR_END,
+		STATE_COMMA_OR_END,
+		STATE_DONE,
+	};
+
+	IOHANDLE m_File;
+	std::vector<char> m_vReadBuffer;
+	const char *m_pCur;
+	const char *m_pEnd;
+	int m_Line;
+
+	EState m_State;
+	int m_Depth;
+	bool m_aIsObject[MAX_DEPTH];
+
+	EToken m_Token;
+	// grows but never shrinks, the string is null terminated after m_StringLength
+	std::vector<char> m_vString;
+	int m_StringLength;
+	int64 m_Integer;
+	double m_Double;
+	bool m_Boolean;
+
+	char m_aContext[IO_MAX_PATH_LENGTH];
+	char m_aError[256];
+
+	bool Refill();
+	int Peek() { return m_pCur != m_pEnd || Refill() ? (unsigned char) *m_pCur : -1; }
+	int Get() { return m_pCur != m_pEnd || Refill() ? (unsigned char) *m_pCur++ : -1; }
+	void SkipWhitespace();
+	EToken Fail(const char *pMessage);
+	EToken AfterValue(EToken Token);
+	EToken ReadEnd(int Char);
+	EToken ReadValue(int Char);
+	void AppendString(const char *pData, int Size);
+	bool ReadString();
+	bool ReadEscape();
+	EToken ReadNumber();
+	EToken ReadLiteral(const char *pLiteral, EToken Token);
+
+public:
+	CJsonReader();
+	~CJsonReader();
+
+	bool OpenFile(const char *pFilename, IStorage *pStorage, int StorageType = IStorage::TYPE_ALL);
+	// the data has to stay around while reading
+	void SetData(const void *pData, unsigned Size, const char *pContext = "rawdata");
+
+	EToken Next();
+	// reads the next key of an object, false at the end of the object
+	bool NextKey() { return Next() == TOKEN_KEY; }
+	// reads the next value, a value of another type is skipped and false returned
+	bool NextValue(EToken Token);
+	// skips the rest of the object or array the current token begins
+	bool Skip();
+	bool SkipValue();
+
+	bool ReadString(char *pBuffer, int BufferSize);
+	bool ReadInteger(int64 *pValue);
+	bool ReadBoolean(bool *pValue);
+
+	EToken Token() const { return m_Token; }
+	// string of a key or a string value, valid until the next token
+	const char *String() const { return m_vString.data(); }
+	bool IsKey(const char *pKey) const { return m_Token == TOKEN_KEY && str_comp(m_vString.data(), pKey) == 0; }
+	int64 Integer() const { return m_Integer; }
+	double Double() const { return m_Double; }
+	bool Boolean() const { return m_Boolean; }
+	int Depth() const { return m_Depth; }
+	int MemoryUsage() const { return sizeof(*this) + m_vReadBuffer.capacity() + m_vString.capacity(); }
+
+	bool Failed() const { return m_Token == TOKEN_ERROR; }
+	const char *Error() const { return m_aError; }
+};
+
 #endif
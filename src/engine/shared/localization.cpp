@@ -10,7 +10,9 @@
 #include "memheap.h"
 
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 class CString
 {
@@ -42,6 +44,11 @@ public:
 	void Init() override;
 	const char *Localize(const char *pCode, const char *pStr, const char *pContext) override;
 
+	int FindLanguage(const char *pCode) override;
+	int RegisterString(const char *pStr, const char *pContext) override;
+	const char *Localize(int Language, int String) override;
+	const char *Localize(int Language, const char *pStr, const char *pContext) override;
+
 	int GetLanguagesInfo(SLanguageInfo **ppInfo) override;
 
 private:
@@ -62,16 +69,40 @@ private:
 		void Load(IStorage *pStorage, IConsole *pConsole);
 
 		const char *FindString(unsigned Hash, unsigned ContextHash) const;
-		const char *Localize(const char *pStr, const char *pContext) const;
 
 		const char *Code() { return m_aCode; }
 		const char *Name() { return m_aName; }
 		const char *Parent() { return m_aParent; }
 		inline bool IsLoaded() { return m_Loaded; }
+
+		// every string id resolved to the translation with the parent fallback applied or
+		// the source string, null if not resolved yet
+		std::vector<const char *> m_vpStrings;
+	};
+	std::vector<std::shared_ptr<CLanguage>> m_vpLanguages;
+	std::unordered_map<Uuid, int> m_LanguageHandles;
+	CUuidCache m_LanguageUuids;
+
+	enum
+	{
+		// arbitrary text passed in must not grow the tables forever
+		MAX_STRINGS = 8192,
+	};
+
+	struct CSourceString
+	{
+		unsigned m_Hash;
+		unsigned m_ContextHash;
+		const char *m_pStr;
 	};
-	std::unordered_map<Uuid, std::shared_ptr<CLanguage>> m_vpLanguages;
+
+	// the registered source strings by id, in order of registration
+	std::vector<CSourceString> m_vSourceStrings;
+	std::unordered_map<unsigned long long, int> m_StringIDs;
+	CHeap m_SourceHeap;
 
 	void AddLanguage(const char *pCode, const char *pName, const char *pParent);
+	const char *Resolve(int Language, unsigned Hash, unsigned ContextHash);
 };
 
 CLocalization::CLocalization(IStorage *pStorage, IConsole *pConsole, CConfig *pConfig) :
@@ -82,47 +113,136 @@ CLocalization::CLocalization(IStorage *pStorage, IConsole *pConsole, CConfig *pC
 	m_pConfig = pConfig;
 
 	m_vpLanguages.clear();
+	m_LanguageHandles.clear();
 }
 
 void CLocalization::Init()
 {
-	CJsonParser JsonParser;
-	const json_value *pJsonData = JsonParser.ParseFile("data/languages/index.json", Storage());
-	if(pJsonData == nullptr)
+	CJsonReader Reader;
+	if(!Reader.OpenFile("data/languages/index.json", Storage()))
 	{
-		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "l10n", JsonParser.Error());
+		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "l10n", Reader.Error());
 		return;
 	}
-	const json_value &rStart = (*pJsonData)["languages"];
-	if(rStart.type == json_array)
+	if(Reader.NextValue(CJsonReader::TOKEN_BEGIN_OBJECT))
 	{
-		for(unsigned i = 0; i < rStart.u.array.length; ++i)
+		while(Reader.NextKey())
 		{
-			const char *pCode = (const char *) rStart[i]["code"];
-			const char *pName = (const char *) rStart[i]["name"];
-			const char *pParent = nullptr;
-			if(rStart[i]["parent"].type == json_string)
-				pParent = (const char *) rStart[i]["parent"];
-			AddLanguage(pCode, pName, pParent);
+			if(!Reader.IsKey("languages"))
+			{
+				Reader.SkipValue();
+				continue;
+			}
+			if(!Reader.NextValue(CJsonReader::TOKEN_BEGIN_ARRAY))
+				continue;
+			while(Reader.Next() == CJsonReader::TOKEN_BEGIN_OBJECT)
+			{
+				char aCode[16] = "";
+				char aName[64] = "";
+				char aParent[16] = "";
+				while(Reader.NextKey())
+				{
+					if(Reader.IsKey("code"))
+						Reader.ReadString(aCode, sizeof(aCode));
+					else if(Reader.IsKey("name"))
+						Reader.ReadString(aName, sizeof(aName));
+					else if(Reader.IsKey("parent"))
+						Reader.ReadString(aParent, sizeof(aParent));
+					else
+						Reader.SkipValue();
+				}
+				AddLanguage(aCode, aName, aParent[0] ? aParent : nullptr);
+			}
 		}
 	}
+	if(Reader.Failed() || Reader.Next() != CJsonReader::TOKEN_END)
+	{
+		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "l10n", Reader.Error());
+		return;
+	}
 	Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "l10n", "initialized l10n");
 }
 
 const char *CLocalization::Localize(const char *pCode, const char *pStr, const char *pContext)
+{
+	return Localize(FindLanguage(pCode), pStr, pContext);
+}
+
+int CLocalization::FindLanguage(const char *pCode)
 {
 	if(str_comp(pCode, "en") == 0)
-		return pStr;
+		return -1;
 
-	Uuid LanguageUuid = CalculateUuid(pCode);
-	if(!m_vpLanguages.count(LanguageUuid))
+	auto Handle = m_LanguageHandles.find(m_LanguageUuids.Get(pCode));
+	if(Handle == m_LanguageHandles.end())
+		return -1;
+	return Handle->second;
+}
+
+int CLocalization::RegisterString(const char *pStr, const char *pContext)
+{
+	const unsigned Hash = str_quickhash(pStr);
+	const unsigned ContextHash = str_quickhash(pContext);
+	const unsigned long long Key = (unsigned long long) Hash << 32 | ContextHash;
+	auto ID = m_StringIDs.find(Key);
+	if(ID != m_StringIDs.end())
+		return ID->second;
+	if(m_vSourceStrings.size() >= MAX_STRINGS)
+		return -1;
+
+	const int String = m_vSourceStrings.size();
+	m_vSourceStrings.push_back(CSourceString{Hash, ContextHash, m_SourceHeap.StoreString(pStr)});
+	m_StringIDs[Key] = String;
+	return String;
+}
+
+const char *CLocalization::Localize(int Language, int String)
+{
+	const CSourceString &Source = m_vSourceStrings[String];
+	if(Language < 0)
+		return Source.m_pStr;
+
+	// the tables grow with the registered strings and are filled on first use
+	std::vector<const char *> &vpStrings = m_vpLanguages[Language]->m_vpStrings;
+	if(String >= (int) vpStrings.size())
+		vpStrings.resize(m_vSourceStrings.size(), nullptr);
+	if(!vpStrings[String])
+	{
+		const char *pNewStr = Resolve(Language, Source.m_Hash, Source.m_ContextHash);
+		vpStrings[String] = pNewStr ? pNewStr : Source.m_pStr;
+	}
+	return vpStrings[String];
+}
+
+const char *CLocalization::Localize(int Language, const char *pStr, const char *pContext)
+{
+	if(Language < 0)
 		return pStr;
-	if(!m_vpLanguages[LanguageUuid]->IsLoaded())
-		m_vpLanguages[LanguageUuid]->Load(Storage(), Console());
-	const char *pNewStr = m_vpLanguages[LanguageUuid]->Localize(pStr, pContext);
-	if(!pNewStr)
-		return Localize(m_vpLanguages[LanguageUuid]->Parent(), pStr, pContext);
-	return pNewStr;
+
+	const int String = RegisterString(pStr, pContext);
+	if(String < 0)
+	{
+		const char *pNewStr = Resolve(Language, str_quickhash(pStr), str_quickhash(pContext));
+		return pNewStr ? pNewStr : pStr;
+	}
+	const char *pNewStr = Localize(Language, String);
+	return pNewStr == m_vSourceStrings[String].m_pStr ? pStr : pNewStr;
+}
+
+const char *CLocalization::Resolve(int Language, unsigned Hash, unsigned ContextHash)
+{
+	// follow the parents, the depth limit guards against cycles in index.json
+	for(int Depth = 0; Language >= 0 && Depth < 8; Depth++)
+	{
+		CLanguage *pLanguage = m_vpLanguages[Language].get();
+		if(!pLanguage->IsLoaded())
+			pLanguage->Load(Storage(), Console());
+		const char *pNewStr = pLanguage->FindString(Hash, ContextHash);
+		if(pNewStr)
+			return pNewStr;
+		Language = FindLanguage(pLanguage->Parent());
+	}
+	return nullptr;
 }
 
 CLocalization::CLanguage::CLanguage(const char *pCode, const char *pName, const char *pParent)
@@ -153,57 +273,84 @@ void CLocalization::CLanguage::Load(IStorage *pStorage, IConsole *pConsole)
 	char aPath[IO_MAX_PATH_LENGTH];
 	str_format(aPath, sizeof(aPath), "data/languages/%s.json", m_aCode);
 
-	CJsonParser JsonParser;
-	const json_value *pJsonData = JsonParser.ParseFile(aPath, pStorage);
-	if(pJsonData == nullptr)
+	// the strings go right from the file into the heap
+	CJsonReader Reader;
+	if(!Reader.OpenFile(aPath, pStorage))
 	{
-		pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "l10n", JsonParser.Error());
+		pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "l10n", Reader.Error());
 		return;
 	}
 
 	char aBuf[256];
-	str_format(aBuf, sizeof(aBuf), "loaded '%s'", aPath);
-	pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "l10n", aBuf);
 	m_Strings.clear();
 	m_StringsHeap.Reset();
 
 	// extract data
-	const json_value &rStart = (*pJsonData)["translated strings"];
-	if(rStart.type == json_array)
+	std::string Key, Value, Context;
+	if(Reader.NextValue(CJsonReader::TOKEN_BEGIN_OBJECT))
 	{
-		for(unsigned i = 0; i < rStart.u.array.length; ++i)
+		while(Reader.NextKey())
 		{
-			bool Valid = true;
-			const char *pKey = (const char *) rStart[i]["key"];
-			const char *pValue = (const char *) rStart[i]["value"];
-			while(pKey[0] && pValue[0])
+			if(!Reader.IsKey("translated strings"))
 			{
-				for(; pKey[0] && pKey[0] != '%'; ++pKey)
-					;
-				for(; pValue[0] && pValue[0] != '%'; ++pValue)
-					;
-				if(pKey[0] && pValue[0] && ((pKey[1] == ' ' && pValue[1] == 0) || (pKey[1] == 0 && pValue[1] == ' '))) // skip  false positive
-					break;
-				if((pKey[0] && (!pValue[0] || pKey[1] != pValue[1])) || (pValue[0] && (!pKey[0] || pValue[1] != pKey[1])))
+				Reader.SkipValue();
+				continue;
+			}
+			if(!Reader.NextValue(CJsonReader::TOKEN_BEGIN_ARRAY))
+				continue;
+			while(Reader.Next() == CJsonReader::TOKEN_BEGIN_OBJECT)
+			{
+				Key.clear();
+				Value.clear();
+				Context.clear();
+				while(Reader.NextKey())
 				{
-					Valid = false;
-					str_format(aBuf, sizeof(aBuf), "skipping invalid entry key:'%s', value:'%s'", (const char *) rStart[i]["key"], (const char *) rStart[i]["value"]);
-					pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "l10n", aBuf);
-					break;
+					std::string *pTarget = Reader.IsKey("key") ? &Key : Reader.IsKey("value") ? &Value : Reader.IsKey("context") ? &Context : nullptr;
+					if(!pTarget)
+						Reader.SkipValue();
+					else if(Reader.NextValue(CJsonReader::TOKEN_STRING))
+						*pTarget = Reader.String();
 				}
-				if(pKey[0])
-					++pKey;
-				if(pValue[0])
-					++pValue;
+
+				bool Valid = true;
+				const char *pKey = Key.c_str();
+				const char *pValue = Value.c_str();
+				while(pKey[0] && pValue[0])
+				{
+					for(; pKey[0] && pKey[0] != '%'; ++pKey)
+						;
+					for(; pValue[0] && pValue[0] != '%'; ++pValue)
+						;
+					if(pKey[0] && pValue[0] && ((pKey[1] == ' ' && pValue[1] == 0) || (pKey[1] == 0 && pValue[1] == ' '))) // skip  false positive
+						break;
+					if((pKey[0] && (!pValue[0] || pKey[1] != pValue[1])) || (pValue[0] && (!pKey[0] || pValue[1] != pKey[1])))
+					{
+						Valid = false;
+						str_format(aBuf, sizeof(aBuf), "skipping invalid entry key:'%s', value:'%s'", Key.c_str(), Value.c_str());
+						pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "l10n", aBuf);
+						break;
+					}
+					if(pKey[0])
+						++pKey;
+					if(pValue[0])
+						++pValue;
+				}
+				if(Valid)
+					AddString(Key.c_str(), Value.c_str(), Context.c_str());
 			}
-			if(Valid)
-				AddString((const char *) rStart[i]["key"], (const char *) rStart[i]["value"], (const char *) rStart[i]["context"]);
 		}
 	}
+	if(Reader.Failed() || Reader.Next() != CJsonReader::TOKEN_END)
+	{
+		pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "l10n", Reader.Error());
+		m_Strings.clear();
+		m_StringsHeap.Reset();
+		return;
+	}
 
+	str_format(aBuf, sizeof(aBuf), "loaded '%s'", aPath);
+	pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "l10n", aBuf);
 	m_Loaded = true;
-
-	return;
 }
 
 const char *CLocalization::CLanguage::FindString(unsigned Hash, unsigned ContextHash) const
@@ -230,19 +377,13 @@ const char *CLocalization::CLanguage::FindString(unsigned Hash, unsigned Context
 	return r.index(DefaultIndex).m_pReplacement;
 }
 
-const char *CLocalization::CLanguage::Localize(const char *pStr, const char *pContext) const
-{
-	const char *pNewStr = FindString(str_quickhash(pStr), str_quickhash(pContext));
-	return pNewStr;
-}
-
 int CLocalization::GetLanguagesInfo(SLanguageInfo **ppInfo)
 {
 	if(*ppInfo)
 		return 0; // should be a null pointer
 	*ppInfo = new SLanguageInfo[m_vpLanguages.size()];
 	size_t Index = 0;
-	for(auto &[Uuid, pLanguage] : m_vpLanguages)
+	for(auto &pLanguage : m_vpLanguages)
 	{
 		(*ppInfo)[Index] = SLanguageInfo{pLanguage->Code(), pLanguage->Name()};
 		Index++;
@@ -253,11 +394,12 @@ int CLocalization::GetLanguagesInfo(SLanguageInfo **ppInfo)
 void CLocalization::AddLanguage(const char *pCode, const char *pName, const char *pParent)
 {
 	Uuid LanguageUuid = CalculateUuid(pCode);
-	if(m_vpLanguages.count(LanguageUuid))
+	if(m_LanguageHandles.count(LanguageUuid))
 		return;
 
 	std::shared_ptr<CLanguage> pLanguage = std::make_shared<CLanguage>(pCode, pName, pParent);
-	m_vpLanguages[LanguageUuid] = pLanguage;
+	m_LanguageHandles[LanguageUuid] = m_vpLanguages.size();
+	m_vpLanguages.push_back(pLanguage);
 
 	char aBuf[256];
 	str_format(aBuf, sizeof(aBuf), "loaded language '%s'(%s)", pCode, pName);
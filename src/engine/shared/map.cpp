@@ -1,6 +1,7 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <base/system.h>
+#include <engine/engine.h>
 #include <engine/map.h>
 #include <engine/storage.h>
 #include <game/mapitems.h>
@@ -43,6 +44,16 @@ public:
 		int GroupsStart, GroupsNum, LayersStart, LayersNum;
 		m_DataFile.GetType(MAPITEMTYPE_GROUP, &GroupsStart, &GroupsNum);
 		m_DataFile.GetType(MAPITEMTYPE_LAYER, &LayersStart, &LayersNum);
+
+		// decompress the tile data in parallel first
+		IEngine *pEngine = Kernel() ? Kernel()->RequestInterface<IEngine>() : 0;
+		for(int l = 0; pEngine && l < LayersNum; l++)
+		{
+			CMapItemLayer *pLayer = static_cast<CMapItemLayer *>(m_DataFile.GetItem(LayersStart + l, 0, 0));
+			if(pLayer->m_Type == LAYERTYPE_TILES)
+				m_DataFile.Prefetch(pEngine, reinterpret_cast<CMapItemLayerTilemap *>(pLayer)->m_Data);
+		}
+
 		for(int g = 0; g < GroupsNum; g++)
 		{
 			CMapItemGroup *pGroup = static_cast<CMapItemGroup *>(m_DataFile.GetItem(GroupsStart + g, 0, 0));
@@ -88,6 +99,8 @@ public:
 			}
 		}
 
+		// the map stays loaded for long, don't keep the file mapped while it may be overwritten
+		m_DataFile.Unmap();
 		return true;
 	}
 
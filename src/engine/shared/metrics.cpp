@@ -0,0 +1,111 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include "metrics.h"
+
+CMetricsHistogram::CMetricsHistogram()
+{
+	Init(0, 0);
+}
+
+void CMetricsHistogram::Init(const double *pBounds, int NumBounds)
+{
+	dbg_assert(NumBounds <= MAX_BOUNDS, "too many histogram buckets");
+	m_NumBounds = NumBounds;
+	for(int i = 0; i < NumBounds; i++)
+	{
+		dbg_assert(i == 0 || pBounds[i] > pBounds[i - 1], "histogram bounds must be ascending");
+		m_aBounds[i] = pBounds[i];
+	}
+	mem_zero(m_aCounts, sizeof(m_aCounts));
+	m_Sum = 0.0;
+	m_Count = 0;
+}
+
+void CMetricsHistogram::Observe(double Value)
+{
+	int Bucket = 0;
+	while(Bucket < m_NumBounds && Value > m_aBounds[Bucket])
+		Bucket++;
+	m_aCounts[Bucket]++;
+	m_Sum += Value;
+	m_Count++;
+}
+
+CMetricsWriter::CMetricsWriter(FWriteLineCallback pfnWriteLine, void *pUser)
+{
+	m_pfnWriteLine = pfnWriteLine;
+	m_pUser = pUser;
+}
+
+void CMetricsWriter::WriteValue(const char *pName, const char *pLabels, const char *pValue)
+{
+	char aLine[256];
+	if(pLabels && pLabels[0])
+		str_format(aLine, sizeof(aLine), "%s{%s} %s", pName, pLabels, pValue);
+	else
+		str_format(aLine, sizeof(aLine), "%s %s", pName, pValue);
+	m_pfnWriteLine(aLine, m_pUser);
+}
+
+void CMetricsWriter::Describe(const char *pName, const char *pType, const char *pHelp)
+{
+	char aLine[256];
+	str_format(aLine, sizeof(aLine), "# HELP %s %s", pName, pHelp);
+	m_pfnWriteLine(aLine, m_pUser);
+	str_format(aLine, sizeof(aLine), "# TYPE %s %s", pName, pType);
+	m_pfnWriteLine(aLine, m_pUser);
+}
+
+void CMetricsWriter::Value(const char *pName, const char *pLabels, int64 Value)
+{
+	char aValue[32];
+	str_format(aValue, sizeof(aValue), "%lld", Value);
+	WriteValue(pName, pLabels, aValue);
+}
+
+void CMetricsWriter::Value(const char *pName, const char *pLabels, double Value)
+{
+	char aValue[32];
+	str_format(aValue, sizeof(aValue), "%.9g", Value);
+	WriteValue(pName, pLabels, aValue);
+}
+
+void CMetricsWriter::Counter(const char *pName, const char *pHelp, int64 Value)
+{
+	Describe(pName, "counter", pHelp);
+	this->Value(pName, nullptr, Value);
+}
+
+void CMetricsWriter::Gauge(const char *pName, const char *pHelp, int64 Value)
+{
+	Describe(pName, "gauge", pHelp);
+	this->Value(pName, nullptr, Value);
+}
+
+void CMetricsWriter::Histogram(const char *pName, const char *pHelp, const CMetricsHistogram *pHistogram)
+{
+	Describe(pName, "histogram", pHelp);
+
+	char aName[128];
+	char aLabels[64];
+	str_format(aName, sizeof(aName), "%s_bucket", pName);
+	// the buckets of the format count everything up to their bound
+	int64 Count = 0;
+	for(int i = 0; i < pHistogram->NumBounds(); i++)
+	{
+		Count += pHistogram->BucketCount(i);
+		str_format(aLabels, sizeof(aLabels), "le=\"%.9g\"", pHistogram->Bound(i));
+		Value(aName, aLabels, Count);
+	}
+	Value(aName, "le=\"+Inf\"", pHistogram->Count());
+
+	str_format(aName, sizeof(aName), "%s_sum", pName);
+	Value(aName, nullptr, pHistogram->Sum());
+	str_format(aName, sizeof(aName), "%s_count", pName);
+	Value(aName, nullptr, pHistogram->Count());
+}
+
+void CMetricsWriter::Finish()
+{
+	m_pfnWriteLine("# EOF", m_pUser);
+}
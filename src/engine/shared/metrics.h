@@ -0,0 +1,66 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SHARED_METRICS_H
+#define ENGINE_SHARED_METRICS_H
+
+#include <base/system.h>
+
+// a histogram with fixed bucket bounds, observing a value only counts it
+class CMetricsHistogram
+{
+public:
+	enum
+	{
+		MAX_BOUNDS = 16,
+	};
+
+private:
+	double m_aBounds[MAX_BOUNDS];
+	int64 m_aCounts[MAX_BOUNDS + 1]; // the last bucket has no upper bound
+	int m_NumBounds;
+	double m_Sum;
+	int64 m_Count;
+
+public:
+	CMetricsHistogram();
+
+	void Init(const double *pBounds, int NumBounds);
+	void Observe(double Value);
+
+	int NumBounds() const { return m_NumBounds; }
+	double Bound(int Index) const { return m_aBounds[Index]; }
+	int64 BucketCount(int Index) const { return m_aCounts[Index]; }
+	double Sum() const { return m_Sum; }
+	int64 Count() const { return m_Count; }
+};
+
+// writes metrics in the prometheus text format, one line at a time
+class CMetricsWriter
+{
+public:
+	typedef void (*FWriteLineCallback)(const char *pLine, void *pUser);
+
+private:
+	FWriteLineCallback m_pfnWriteLine;
+	void *m_pUser;
+
+	void WriteValue(const char *pName, const char *pLabels, const char *pValue);
+
+public:
+	CMetricsWriter(FWriteLineCallback pfnWriteLine, void *pUser);
+
+	// starts a metric, its values have to follow
+	void Describe(const char *pName, const char *pType, const char *pHelp);
+	// labels are given as 'name="value"' pairs separated by commas, or nullptr
+	void Value(const char *pName, const char *pLabels, int64 Value);
+	void Value(const char *pName, const char *pLabels, double Value);
+
+	void Counter(const char *pName, const char *pHelp, int64 Value);
+	void Gauge(const char *pName, const char *pHelp, int64 Value);
+	void Histogram(const char *pName, const char *pHelp, const CMetricsHistogram *pHistogram);
+
+	// marks the end, so readers know the output is complete
+	void Finish();
+};
+
+#endif
@@ -8,134 +8,286 @@
 
 #include "netban.h"
 
-CNetBan::CNetHash::CNetHash(const NETADDR *pAddr)
+unsigned CNetBan::CAddrIndex::Hash(const NETADDR *pAddr)
 {
-	if(pAddr->type == NETTYPE_IPV4)
-		m_Hash = (pAddr->ip[0] + pAddr->ip[1] + pAddr->ip[2] + pAddr->ip[3]) & 0xFF;
-	else
-		m_Hash = (pAddr->ip[0] + pAddr->ip[1] + pAddr->ip[2] + pAddr->ip[3] + pAddr->ip[4] + pAddr->ip[5] + pAddr->ip[6] + pAddr->ip[7] +
-				 pAddr->ip[8] + pAddr->ip[9] + pAddr->ip[10] + pAddr->ip[11] + pAddr->ip[12] + pAddr->ip[13] + pAddr->ip[14] + pAddr->ip[15]) &
-			 0xFF;
-	m_HashIndex = 0;
+	// fnv-1a
+	int Length = pAddr->type == NETTYPE_IPV4 ? NETADDR_SIZE_IPV4 : NETADDR_SIZE_IPV6;
+	unsigned Hash = (2166136261u ^ pAddr->type) * 16777619u;
+	for(int i = 0; i < Length; i++)
+		Hash = (Hash ^ pAddr->ip[i]) * 16777619u;
+	return Hash;
 }
 
-CNetBan::CNetHash::CNetHash(const CNetRange *pRange)
+void CNetBan::CAddrIndex::Reset()
 {
-	m_Hash = 0;
-	m_HashIndex = 0;
-	for(int i = 0; pRange->m_LB.ip[i] == pRange->m_UB.ip[i]; ++i)
-	{
-		m_Hash += pRange->m_LB.ip[i];
-		++m_HashIndex;
-	}
-	m_Hash &= 0xFF;
+	m_vpBuckets.assign(256, nullptr);
+	m_Num = 0;
+}
+
+void CNetBan::CAddrIndex::Link(CBanAddr *pBan)
+{
+	pBan->m_Slot = Hash(&pBan->m_Data) & (m_vpBuckets.size() - 1);
+	CBanAddr *&pFirst = m_vpBuckets[pBan->m_Slot];
+	if(pFirst)
+		pFirst->m_pHashPrev = pBan;
+	pBan->m_pHashPrev = 0;
+	pBan->m_pHashNext = pFirst;
+	pFirst = pBan;
 }
 
-int CNetBan::CNetHash::MakeHashArray(const NETADDR *pAddr, CNetHash aHash[17])
+void CNetBan::CAddrIndex::Insert(CBanAddr *pBan)
 {
-	int Length = pAddr->type == NETTYPE_IPV4 ? 4 : 16;
-	aHash[0].m_Hash = 0;
-	aHash[0].m_HashIndex = 0;
-	for(int i = 1, Sum = 0; i <= Length; ++i)
+	// keep at most one ban per bucket on average
+	if(++m_Num > (int) m_vpBuckets.size())
 	{
-		Sum += pAddr->ip[i - 1];
-		aHash[i].m_Hash = Sum & 0xFF;
-		aHash[i].m_HashIndex = i % Length;
+		std::vector<CBanAddr *> vpOld;
+		vpOld.swap(m_vpBuckets);
+		m_vpBuckets.assign(vpOld.size() * 2, nullptr);
+		for(CBanAddr *pOld : vpOld)
+		{
+			while(pOld)
+			{
+				CBanAddr *pNext = pOld->m_pHashNext;
+				Link(pOld);
+				pOld = pNext;
+			}
+		}
 	}
-	return Length;
+	Link(pBan);
 }
 
-template<class T, int HashCount>
-typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Add(const T *pData, const CBanInfo *pInfo, const CNetHash *pNetHash)
+void CNetBan::CAddrIndex::Remove(CBanAddr *pBan)
 {
-	if(!m_pFirstFree)
-		return 0;
-
-	// create new ban
-	CBan<T> *pBan = m_pFirstFree;
-	pBan->m_Data = *pData;
-	pBan->m_Info = *pInfo;
-	pBan->m_NetHash = *pNetHash;
-	if(pBan->m_pNext)
-		pBan->m_pNext->m_pPrev = pBan->m_pPrev;
-	if(pBan->m_pPrev)
-		pBan->m_pPrev->m_pNext = pBan->m_pNext;
+	if(pBan->m_pHashNext)
+		pBan->m_pHashNext->m_pHashPrev = pBan->m_pHashPrev;
+	if(pBan->m_pHashPrev)
+		pBan->m_pHashPrev->m_pHashNext = pBan->m_pHashNext;
 	else
-		m_pFirstFree = pBan->m_pNext;
+		m_vpBuckets[pBan->m_Slot] = pBan->m_pHashNext;
+	pBan->m_pHashNext = pBan->m_pHashPrev = 0;
+	--m_Num;
+}
 
-	// add it to the hash list
-	if(m_aapHashList[pNetHash->m_HashIndex][pNetHash->m_Hash])
-		m_aapHashList[pNetHash->m_HashIndex][pNetHash->m_Hash]->m_pHashPrev = pBan;
-	pBan->m_pHashPrev = 0;
-	pBan->m_pHashNext = m_aapHashList[pNetHash->m_HashIndex][pNetHash->m_Hash];
-	m_aapHashList[pNetHash->m_HashIndex][pNetHash->m_Hash] = pBan;
+CNetBan::CBanAddr *CNetBan::CAddrIndex::Find(const NETADDR *pAddr) const
+{
+	for(CBanAddr *pBan = m_vpBuckets[Hash(pAddr) & (m_vpBuckets.size() - 1)]; pBan; pBan = pBan->m_pHashNext)
+	{
+		if(NetComp(&pBan->m_Data, pAddr) == 0)
+			return pBan;
+	}
+	return 0;
+}
 
-	// insert it into the used list
-	if(m_pFirstUsed)
+void CNetBan::CRangeIndex::Reset()
+{
+	for(auto &vNodes : m_avNodes)
 	{
-		for(CBan<T> *p = m_pFirstUsed;; p = p->m_pNext)
+		vNodes.clear();
+		vNodes.push_back(CNode{{0, 0}, {}});
+	}
+}
+
+template<class F>
+bool CNetBan::CRangeIndex::ForEachBlock(const CNetRange *pRange, bool Create, F &&pfnVisit)
+{
+	struct CBlock
+	{
+		int m_Node;
+		int m_Depth;
+		bool m_AtLB; // the block starts with the bits of the lower bound, so it limits the block
+		bool m_AtUB;
+	};
+
+	std::vector<CNode> &vNodes = m_avNodes[Trie(&pRange->m_LB)];
+	const int Bits = NumBits(&pRange->m_LB);
+	CBlock aStack[2 * 128 + 1];
+	int NumStack = 0;
+	aStack[NumStack++] = CBlock{0, 0, true, true};
+	while(NumStack)
+	{
+		const CBlock Block = aStack[--NumStack];
+
+		// the whole block is in the range if the bounds don't cut into it
+		bool Covered = true;
+		for(int i = Block.m_Depth; i < Bits && Covered; i++)
+			Covered = (!Block.m_AtLB || !Bit(&pRange->m_LB, i)) && (!Block.m_AtUB || Bit(&pRange->m_UB, i));
+		if(Covered)
+		{
+			pfnVisit(Block.m_Node);
+			continue;
+		}
+
+		for(int b = 1; b >= 0; b--)
 		{
-			if(p->m_Info.m_Expires == CBanInfo::EXPIRES_NEVER || (pInfo->m_Expires != CBanInfo::EXPIRES_NEVER && pInfo->m_Expires <= p->m_Info.m_Expires))
+			if((Block.m_AtLB && b < Bit(&pRange->m_LB, Block.m_Depth)) || (Block.m_AtUB && b > Bit(&pRange->m_UB, Block.m_Depth)))
+				continue;
+			int Child = vNodes[Block.m_Node].m_aChildren[b];
+			if(!Child)
 			{
-				// insert before
-				pBan->m_pNext = p;
-				pBan->m_pPrev = p->m_pPrev;
-				if(p->m_pPrev)
-					p->m_pPrev->m_pNext = pBan;
-				else
-					m_pFirstUsed = pBan;
-				p->m_pPrev = pBan;
-				break;
+				if(!Create)
+					return false;
+				Child = vNodes.size();
+				vNodes[Block.m_Node].m_aChildren[b] = Child;
+				vNodes.push_back(CNode{{0, 0}, {}});
 			}
+			aStack[NumStack++] = CBlock{Child, Block.m_Depth + 1, Block.m_AtLB && b == Bit(&pRange->m_LB, Block.m_Depth), Block.m_AtUB && b == Bit(&pRange->m_UB, Block.m_Depth)};
+		}
+	}
+	return true;
+}
+
+void CNetBan::CRangeIndex::Insert(CBanRange *pBan)
+{
+	std::vector<CNode> &vNodes = m_avNodes[Trie(&pBan->m_Data.m_LB)];
+	ForEachBlock(&pBan->m_Data, true, [&](int Node) { vNodes[Node].m_vpBans.push_back(pBan); });
+}
 
-			if(!p->m_pNext)
+void CNetBan::CRangeIndex::Remove(CBanRange *pBan)
+{
+	std::vector<CNode> &vNodes = m_avNodes[Trie(&pBan->m_Data.m_LB)];
+	ForEachBlock(&pBan->m_Data, false, [&](int Node) {
+		std::vector<CBanRange *> &vpBans = vNodes[Node].m_vpBans;
+		for(unsigned i = 0; i < vpBans.size(); i++)
+		{
+			if(vpBans[i] == pBan)
 			{
-				// last entry
-				p->m_pNext = pBan;
-				pBan->m_pPrev = p;
-				pBan->m_pNext = 0;
+				vpBans[i] = vpBans.back();
+				vpBans.pop_back();
 				break;
 			}
 		}
+	});
+}
+
+CNetBan::CBanRange *CNetBan::CRangeIndex::Find(const CNetRange *pRange) const
+{
+	// every block of the range has the ban, so looking at one of them is enough
+	int FirstNode = -1;
+	if(!const_cast<CRangeIndex *>(this)->ForEachBlock(pRange, false, [&](int Node) { if(FirstNode < 0) FirstNode = Node; }))
+		return 0;
+	for(CBanRange *pBan : m_avNodes[Trie(&pRange->m_LB)][FirstNode].m_vpBans)
+	{
+		if(NetComp(&pBan->m_Data, pRange) == 0)
+			return pBan;
 	}
-	else
+	return 0;
+}
+
+CNetBan::CBanRange *CNetBan::CRangeIndex::Match(const NETADDR *pAddr) const
+{
+	// the blocks on the path contain the address, the deepest one is the most specific
+	const std::vector<CNode> &vNodes = m_avNodes[Trie(pAddr)];
+	CBanRange *pMatch = 0;
+	int Node = 0;
+	for(int i = 0;; i++)
 	{
-		m_pFirstUsed = pBan;
-		pBan->m_pNext = pBan->m_pPrev = 0;
+		if(!vNodes[Node].m_vpBans.empty())
+			pMatch = vNodes[Node].m_vpBans.front();
+
+		if(i == NumBits(pAddr) || !vNodes[Node].m_aChildren[Bit(pAddr, i)])
+			break;
+		Node = vNodes[Node].m_aChildren[Bit(pAddr, i)];
 	}
+	return pMatch;
+}
 
-	// update ban count
-	++m_CountUsed;
+template<class T, class TIndex>
+CNetBan::CBanPool<T, TIndex>::CBanPool()
+{
+	m_pFirstFree = 0;
+	Reset();
+}
 
-	return pBan;
+template<class T, class TIndex>
+CNetBan::CBanPool<T, TIndex>::~CBanPool()
+{
+	for(CBan<T> *pBlock : m_vpBlocks)
+		delete[] pBlock;
 }
 
-template<class T, int HashCount>
-int CNetBan::CBanPool<T, HashCount>::Remove(CBan<T> *pBan)
+template<class T, class TIndex>
+void CNetBan::CBanPool<T, TIndex>::LinkUsed(CBan<T> *pBan)
 {
-	if(pBan == 0)
-		return -1;
+	// find the last ban which expires before this one, scanning from the end as new bans usually expire last
+	CBan<T> *pPrev;
+	if(pBan->m_Info.m_Expires == CBanInfo::EXPIRES_NEVER)
+		pPrev = m_pLastUsed;
+	else
+	{
+		pPrev = m_pFirstNever ? m_pFirstNever->m_pPrev : m_pLastUsed;
+		while(pPrev && pBan->m_Info.m_Expires < pPrev->m_Info.m_Expires)
+			pPrev = pPrev->m_pPrev;
+	}
 
-	// remove from hash list
-	if(pBan->m_pHashNext)
-		pBan->m_pHashNext->m_pHashPrev = pBan->m_pHashPrev;
-	if(pBan->m_pHashPrev)
-		pBan->m_pHashPrev->m_pHashNext = pBan->m_pHashNext;
+	// insert after it
+	pBan->m_pPrev = pPrev;
+	pBan->m_pNext = pPrev ? pPrev->m_pNext : m_pFirstUsed;
+	if(pBan->m_pNext)
+		pBan->m_pNext->m_pPrev = pBan;
 	else
-		m_aapHashList[pBan->m_NetHash.m_HashIndex][pBan->m_NetHash.m_Hash] = pBan->m_pHashNext;
-	pBan->m_pHashNext = pBan->m_pHashPrev = 0;
+		m_pLastUsed = pBan;
+	if(pPrev)
+		pPrev->m_pNext = pBan;
+	else
+		m_pFirstUsed = pBan;
 
-	// remove from used list
+	if(pBan->m_Info.m_Expires == CBanInfo::EXPIRES_NEVER && !m_pFirstNever)
+		m_pFirstNever = pBan;
+}
+
+template<class T, class TIndex>
+void CNetBan::CBanPool<T, TIndex>::UnlinkUsed(CBan<T> *pBan)
+{
+	if(m_pFirstNever == pBan)
+		m_pFirstNever = pBan->m_pNext;
 	if(pBan->m_pNext)
 		pBan->m_pNext->m_pPrev = pBan->m_pPrev;
+	else
+		m_pLastUsed = pBan->m_pPrev;
 	if(pBan->m_pPrev)
 		pBan->m_pPrev->m_pNext = pBan->m_pNext;
 	else
 		m_pFirstUsed = pBan->m_pNext;
+}
+
+template<class T, class TIndex>
+typename CNetBan::CBan<T> *CNetBan::CBanPool<T, TIndex>::Add(const T *pData, const CBanInfo *pInfo)
+{
+	if(!m_pFirstFree)
+	{
+		// allocate another block of bans
+		CBan<T> *pBlock = new CBan<T>[BLOCK_SIZE];
+		m_vpBlocks.push_back(pBlock);
+		for(int i = 0; i < BLOCK_SIZE; ++i)
+			pBlock[i].m_pNext = i + 1 < BLOCK_SIZE ? &pBlock[i + 1] : 0;
+		m_pFirstFree = pBlock;
+	}
+
+	// create new ban
+	CBan<T> *pBan = m_pFirstFree;
+	m_pFirstFree = pBan->m_pNext;
+	pBan->m_Data = *pData;
+	pBan->m_Info = *pInfo;
+
+	m_Index.Insert(pBan);
+	LinkUsed(pBan);
+
+	// update ban count
+	++m_CountUsed;
+
+	return pBan;
+}
+
+template<class T, class TIndex>
+int CNetBan::CBanPool<T, TIndex>::Remove(CBan<T> *pBan)
+{
+	if(pBan == 0)
+		return -1;
+
+	m_Index.Remove(pBan);
+	UnlinkUsed(pBan);
 
 	// add to recycle list
-	if(m_pFirstFree)
-		m_pFirstFree->m_pPrev = pBan;
 	pBan->m_pPrev = 0;
 	pBan->m_pNext = m_pFirstFree;
 	m_pFirstFree = pBan;
@@ -146,75 +298,38 @@ int CNetBan::CBanPool<T, HashCount>::Remove(CBan<T> *pBan)
 	return 0;
 }
 
-template<class T, int HashCount>
-void CNetBan::CBanPool<T, HashCount>::Update(CBan<CDataType> *pBan, const CBanInfo *pInfo)
+template<class T, class TIndex>
+void CNetBan::CBanPool<T, TIndex>::Update(CBan<CDataType> *pBan, const CBanInfo *pInfo)
 {
+	UnlinkUsed(pBan);
 	pBan->m_Info = *pInfo;
-
-	// remove from used list
-	if(pBan->m_pNext)
-		pBan->m_pNext->m_pPrev = pBan->m_pPrev;
-	if(pBan->m_pPrev)
-		pBan->m_pPrev->m_pNext = pBan->m_pNext;
-	else
-		m_pFirstUsed = pBan->m_pNext;
-
-	// insert it into the used list
-	if(m_pFirstUsed)
-	{
-		for(CBan<T> *p = m_pFirstUsed;; p = p->m_pNext)
-		{
-			if(p->m_Info.m_Expires == CBanInfo::EXPIRES_NEVER || (pInfo->m_Expires != CBanInfo::EXPIRES_NEVER && pInfo->m_Expires <= p->m_Info.m_Expires))
-			{
-				// insert before
-				pBan->m_pNext = p;
-				pBan->m_pPrev = p->m_pPrev;
-				if(p->m_pPrev)
-					p->m_pPrev->m_pNext = pBan;
-				else
-					m_pFirstUsed = pBan;
-				p->m_pPrev = pBan;
-				break;
-			}
-
-			if(!p->m_pNext)
-			{
-				// last entry
-				p->m_pNext = pBan;
-				pBan->m_pPrev = p;
-				pBan->m_pNext = 0;
-				break;
-			}
-		}
-	}
-	else
-	{
-		m_pFirstUsed = pBan;
-		pBan->m_pNext = pBan->m_pPrev = 0;
-	}
+	LinkUsed(pBan);
 }
 
-template<class T, int HashCount>
-void CNetBan::CBanPool<T, HashCount>::Reset()
+template<class T, class TIndex>
+void CNetBan::CBanPool<T, TIndex>::Reset()
 {
-	mem_zero(m_aapHashList, sizeof(m_aapHashList));
-	mem_zero(m_aBans, sizeof(m_aBans));
-	m_pFirstUsed = 0;
-	m_CountUsed = 0;
-
-	for(int i = 1; i < MAX_BANS - 1; ++i)
+	// keep the first block
+	for(unsigned i = 1; i < m_vpBlocks.size(); ++i)
+		delete[] m_vpBlocks[i];
+	m_vpBlocks.resize(minimum((int) m_vpBlocks.size(), 1));
+	m_pFirstFree = 0;
+	if(!m_vpBlocks.empty())
 	{
-		m_aBans[i].m_pNext = &m_aBans[i + 1];
-		m_aBans[i].m_pPrev = &m_aBans[i - 1];
+		for(int i = 0; i < BLOCK_SIZE; ++i)
+			m_vpBlocks[0][i].m_pNext = i + 1 < BLOCK_SIZE ? &m_vpBlocks[0][i + 1] : 0;
+		m_pFirstFree = m_vpBlocks[0];
 	}
 
-	m_aBans[0].m_pNext = &m_aBans[1];
-	m_aBans[MAX_BANS - 1].m_pPrev = &m_aBans[MAX_BANS - 2];
-	m_pFirstFree = &m_aBans[0];
+	m_Index.Reset();
+	m_pFirstUsed = 0;
+	m_pLastUsed = 0;
+	m_pFirstNever = 0;
+	m_CountUsed = 0;
 }
 
-template<class T, int HashCount>
-typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Get(int Index) const
+template<class T, class TIndex>
+typename CNetBan::CBan<T> *CNetBan::CBanPool<T, TIndex>::Get(int Index) const
 {
 	if(Index < 0 || Index >= Num())
 		return 0;
@@ -301,8 +416,7 @@ int CNetBan::Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, c
 	str_copy(Info.m_aReason, pReason, sizeof(Info.m_aReason));
 
 	// check if it already exists
-	CNetHash NetHash(pData);
-	CBan<typename T::CDataType> *pBan = pBanPool->Find(pData, &NetHash);
+	CBan<typename T::CDataType> *pBan = pBanPool->Find(pData);
 	if(pBan)
 	{
 		// adjust the ban
@@ -310,28 +424,23 @@ int CNetBan::Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, c
 		char aBuf[128];
 		MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_LIST);
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+		OnBan(pBan);
 		return 1;
 	}
 
 	// add ban and print result
-	pBan = pBanPool->Add(pData, &Info, &NetHash);
-	if(pBan)
-	{
-		char aBuf[128];
-		MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_BANADD);
-		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
-		return 0;
-	}
-	else
-		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban failed (full banlist)");
-	return -1;
+	pBan = pBanPool->Add(pData, &Info);
+	char aBuf[128];
+	MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_BANADD);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+	OnBan(pBan);
+	return 0;
 }
 
 template<class T>
 int CNetBan::Unban(T *pBanPool, const typename T::CDataType *pData)
 {
-	CNetHash NetHash(pData);
-	CBan<typename T::CDataType> *pBan = pBanPool->Find(pData, &NetHash);
+	CBan<typename T::CDataType> *pBan = pBanPool->Find(pData);
 	if(pBan)
 	{
 		char aBuf[256];
@@ -360,6 +469,8 @@ void CNetBan::Init(IConsole *pConsole, IStorage *pStorage)
 	Console()->Register("unban_all", "", CFGFLAG_SERVER | CFGFLAG_MASTER | CFGFLAG_STORE, ConUnbanAll, this, "Unban all entries");
 	Console()->Register("bans", "", CFGFLAG_SERVER | CFGFLAG_MASTER | CFGFLAG_STORE, ConBans, this, "Show banlist");
 	Console()->Register("bans_save", "s[file]", CFGFLAG_SERVER | CFGFLAG_MASTER | CFGFLAG_STORE, ConBansSave, this, "Save banlist in a file");
+	Console()->Register("bans_export", "s[file]", CFGFLAG_SERVER | CFGFLAG_MASTER | CFGFLAG_STORE, ConBansExport, this, "Save banlist in a binary file for bans_import");
+	Console()->Register("bans_import", "s[file]", CFGFLAG_SERVER | CFGFLAG_MASTER | CFGFLAG_STORE, ConBansImport, this, "Add the bans of a binary banlist file");
 }
 
 void CNetBan::Update()
@@ -460,11 +571,8 @@ bool CNetBan::IsBannable(const T *pData)
 
 bool CNetBan::IsBanned(const NETADDR *pAddr, char *pBuf, unsigned BufferSize, int *pLastInfoQuery)
 {
-	CNetHash aHash[17];
-	int Length = CNetHash::MakeHashArray(pAddr, aHash);
-
 	// check ban addresses
-	CBanAddr *pBan = m_BanAddrPool.Find(pAddr, &aHash[Length]);
+	CBanAddr *pBan = m_BanAddrPool.Find(pAddr);
 	if(pBan)
 	{
 		MakeBanInfo(pBan, pBuf, BufferSize, MSGTYPE_PLAYER, pLastInfoQuery);
@@ -472,19 +580,136 @@ bool CNetBan::IsBanned(const NETADDR *pAddr, char *pBuf, unsigned BufferSize, in
 	}
 
 	// check ban ranges
-	for(int i = Length - 1; i >= 0; --i)
+	CBanRange *pBanRange = m_BanRangePool.Match(pAddr);
+	if(pBanRange)
 	{
-		for(CBanRange *pBan = m_BanRangePool.First(&aHash[i]); pBan; pBan = pBan->m_pHashNext)
+		MakeBanInfo(pBanRange, pBuf, BufferSize, MSGTYPE_PLAYER, pLastInfoQuery);
+		return true;
+	}
+
+	return false;
+}
+
+/*
+	The binary ban list is "BANS", a version and the number of bans, each as 4 byte big endian integer, followed by the bans:
+	1 byte kind (0 address, 1 range), 1 byte address type (0 ipv4, 1 ipv6), the address or the lower and the upper bound
+	of the range (4 or 16 bytes each), the expiry timestamp as 4 byte big endian integer (-1 never), 1 byte reason length
+	and the reason without null termination.
+*/
+static const unsigned char gs_aBanListMagic[4] = {'B', 'A', 'N', 'S'};
+static const int BANLIST_VERSION = 1;
+
+static void WriteBanAddr(std::vector<unsigned char> *pvData, const NETADDR *pAddr)
+{
+	const int Length = pAddr->type == NETTYPE_IPV4 ? NETADDR_SIZE_IPV4 : NETADDR_SIZE_IPV6;
+	pvData->insert(pvData->end(), pAddr->ip, pAddr->ip + Length);
+}
+
+template<class T>
+static void WriteBan(std::vector<unsigned char> *pvData, int Kind, const NETADDR *pAddr, const NETADDR *pUpper, const T *pInfo)
+{
+	pvData->push_back(Kind);
+	pvData->push_back(pAddr->type == NETTYPE_IPV4 ? 0 : 1);
+	WriteBanAddr(pvData, pAddr);
+	if(pUpper)
+		WriteBanAddr(pvData, pUpper);
+
+	unsigned char aExpires[4];
+	int_to_bytes_be(aExpires, pInfo->m_Expires);
+	pvData->insert(pvData->end(), aExpires, aExpires + sizeof(aExpires));
+
+	int ReasonLength = str_length(pInfo->m_aReason);
+	pvData->push_back(ReasonLength);
+	pvData->insert(pvData->end(), pInfo->m_aReason, pInfo->m_aReason + ReasonLength);
+}
+
+void CNetBan::ExportBans(std::vector<unsigned char> *pvData) const
+{
+	unsigned char aHeader[12];
+	mem_copy(aHeader, gs_aBanListMagic, sizeof(gs_aBanListMagic));
+	int_to_bytes_be(&aHeader[4], BANLIST_VERSION);
+	int_to_bytes_be(&aHeader[8], m_BanAddrPool.Num() + m_BanRangePool.Num());
+	pvData->assign(aHeader, aHeader + sizeof(aHeader));
+
+	for(CBanAddr *pBan = m_BanAddrPool.First(); pBan; pBan = pBan->m_pNext)
+		WriteBan(pvData, 0, &pBan->m_Data, 0, &pBan->m_Info);
+	for(CBanRange *pBan = m_BanRangePool.First(); pBan; pBan = pBan->m_pNext)
+		WriteBan(pvData, 1, &pBan->m_Data.m_LB, &pBan->m_Data.m_UB, &pBan->m_Info);
+}
+
+int CNetBan::ImportBans(const unsigned char *pData, int Size)
+{
+	if(Size < 12 || mem_comp(pData, gs_aBanListMagic, sizeof(gs_aBanListMagic)) != 0 || bytes_be_to_int(&pData[4]) != BANLIST_VERSION)
+		return -1;
+
+	const int Num = bytes_be_to_int(&pData[8]);
+	const int Now = time_timestamp();
+	const unsigned char *pEnd = pData + Size;
+	pData += 12;
+
+	int Imported = 0;
+	for(int i = 0; i < Num; i++)
+	{
+		if(pEnd - pData < 2 || pData[0] > 1 || pData[1] > 1)
+			return -1;
+		const bool Range = pData[0] == 1;
+		const int Type = pData[1] == 0 ? NETTYPE_IPV4 : NETTYPE_IPV6;
+		const int Length = Type == NETTYPE_IPV4 ? NETADDR_SIZE_IPV4 : NETADDR_SIZE_IPV6;
+		pData += 2;
+
+		CNetRange Data;
+		mem_zero(&Data, sizeof(Data));
+		Data.m_LB.type = Data.m_UB.type = Type;
+		if(pEnd - pData < Length * (Range ? 2 : 1) + 5)
+			return -1;
+		mem_copy(Data.m_LB.ip, pData, Length);
+		pData += Length;
+		if(Range)
 		{
-			if(NetMatch(&pBan->m_Data, pAddr, i, Length))
-			{
-				MakeBanInfo(pBan, pBuf, BufferSize, MSGTYPE_PLAYER, pLastInfoQuery);
-				return true;
-			}
+			mem_copy(Data.m_UB.ip, pData, Length);
+			pData += Length;
+		}
+
+		CBanInfo Info;
+		Info.m_Expires = bytes_be_to_int(pData);
+		Info.m_LastInfoQuery = Now;
+		const int ReasonLength = pData[4];
+		pData += 5;
+		if(pEnd - pData < ReasonLength)
+			return -1;
+		str_truncate(Info.m_aReason, sizeof(Info.m_aReason), (const char *) pData, ReasonLength);
+		pData += ReasonLength;
+
+		if(Info.m_Expires != CBanInfo::EXPIRES_NEVER && Info.m_Expires < Now)
+			continue;
+
+		// same as banning, but without a message per ban
+		if(Range)
+		{
+			if(!Data.IsValid() || !IsBannable(&Data))
+				continue;
+			CBanRange *pBan = m_BanRangePool.Find(&Data);
+			if(pBan)
+				m_BanRangePool.Update(pBan, &Info);
+			else
+				pBan = m_BanRangePool.Add(&Data, &Info);
+			OnBan(pBan);
 		}
+		else
+		{
+			if(!IsBannable(&Data.m_LB))
+				continue;
+			CBanAddr *pBan = m_BanAddrPool.Find(&Data.m_LB);
+			if(pBan)
+				m_BanAddrPool.Update(pBan, &Info);
+			else
+				pBan = m_BanAddrPool.Add(&Data.m_LB, &Info);
+			OnBan(pBan);
+		}
+		Imported++;
 	}
 
-	return false;
+	return Imported;
 }
 
 void CNetBan::ConBan(IConsole::IResult *pResult, void *pUser)
@@ -619,10 +844,61 @@ void CNetBan::ConBansSave(IConsole::IResult *pResult, void *pUser)
 	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
 }
 
+void CNetBan::ConBansExport(IConsole::IResult *pResult, void *pUser)
+{
+	CNetBan *pThis = static_cast<CNetBan *>(pUser);
+	char aBuf[256];
+	const char *pFilename = pResult->GetString(0);
+
+	IOHANDLE File = pThis->Storage()->OpenFile(pFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+	{
+		str_format(aBuf, sizeof(aBuf), "failed to export banlist to '%s'", pFilename);
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+		return;
+	}
+
+	std::vector<unsigned char> vData;
+	pThis->ExportBans(&vData);
+	io_write(File, vData.data(), vData.size());
+	io_close(File);
+
+	str_format(aBuf, sizeof(aBuf), "exported %d bans to '%s'", pThis->m_BanAddrPool.Num() + pThis->m_BanRangePool.Num(), pFilename);
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+}
+
+void CNetBan::ConBansImport(IConsole::IResult *pResult, void *pUser)
+{
+	CNetBan *pThis = static_cast<CNetBan *>(pUser);
+	char aBuf[256];
+	const char *pFilename = pResult->GetString(0);
+
+	IOHANDLE File = pThis->Storage()->OpenFile(pFilename, IOFLAG_READ, IStorage::TYPE_ALL);
+	if(!File)
+	{
+		str_format(aBuf, sizeof(aBuf), "failed to open banlist '%s'", pFilename);
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+		return;
+	}
+
+	std::vector<unsigned char> vData(maximum(io_length(File), 0l));
+	vData.resize(io_read(File, vData.data(), vData.size()));
+	io_close(File);
+
+	int Imported = pThis->ImportBans(vData.data(), vData.size());
+	if(Imported < 0)
+		str_format(aBuf, sizeof(aBuf), "failed to import banlist '%s' (invalid file)", pFilename);
+	else
+		str_format(aBuf, sizeof(aBuf), "imported %d bans from '%s'", Imported, pFilename);
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+}
+
 // explicitly instantiate template for src/engine/server/server.cpp
+template class CNetBan::CBanPool<NETADDR, CNetBan::CAddrIndex>;
+template class CNetBan::CBanPool<CNetRange, CNetBan::CRangeIndex>;
 template void CNetBan::MakeBanInfo<CNetRange>(CBan<CNetRange> *pBan, char *pBuf, unsigned BufferSize, int Type, int *pLastInfoQuery);
 template void CNetBan::MakeBanInfo<NETADDR>(CBan<NETADDR> *pBan, char *pBuf, unsigned BufferSize, int Type, int *pLastInfoQuery);
-template int CNetBan::Ban<CNetBan::CBanPool<NETADDR, 1>>(CNetBan::CBanPool<NETADDR, 1> *pBanPool, const NETADDR *pData, int Seconds, const char *pReason);
-template int CNetBan::Ban<CNetBan::CBanPool<CNetRange, 16>>(CNetBan::CBanPool<CNetRange, 16> *pBanPool, const CNetRange *pData, int Seconds, const char *pReason);
+template int CNetBan::Ban<CNetBan::CBanAddrPool>(CNetBan::CBanAddrPool *pBanPool, const NETADDR *pData, int Seconds, const char *pReason);
+template int CNetBan::Ban<CNetBan::CBanRangePool>(CNetBan::CBanRangePool *pBanPool, const CNetRange *pData, int Seconds, const char *pReason);
 template bool CNetBan::IsBannable<NETADDR>(const NETADDR *pData);
 template bool CNetBan::IsBannable<CNetRange>(const CNetRange *pData);
@@ -5,6 +5,8 @@
 
 #include <base/system.h>
 
+#include <vector>
+
 inline int NetComp(const NETADDR *pAddr1, const NETADDR *pAddr2)
 {
 	return net_addr_comp(pAddr1, pAddr2, false);
@@ -27,18 +29,18 @@ inline int NetComp(const CNetRange *pRange1, const CNetRange *pRange2)
 class CNetBan
 {
 protected:
-	bool NetMatch(const NETADDR *pAddr1, const NETADDR *pAddr2) const
+	static bool NetMatch(const NETADDR *pAddr1, const NETADDR *pAddr2)
 	{
 		return NetComp(pAddr1, pAddr2) == 0;
 	}
 
-	bool NetMatch(const CNetRange *pRange, const NETADDR *pAddr, int Start, int Length) const
+	static bool NetMatch(const CNetRange *pRange, const NETADDR *pAddr, int Start, int Length)
 	{
 		return pRange->m_LB.type == pAddr->type && (Start == 0 || mem_comp(&pRange->m_LB.ip[0], &pAddr->ip[0], Start) == 0) &&
 		       mem_comp(&pRange->m_LB.ip[Start], &pAddr->ip[Start], Length - Start) <= 0 && mem_comp(&pRange->m_UB.ip[Start], &pAddr->ip[Start], Length - Start) >= 0;
 	}
 
-	bool NetMatch(const CNetRange *pRange, const NETADDR *pAddr) const
+	static bool NetMatch(const CNetRange *pRange, const NETADDR *pAddr)
 	{
 		return NetMatch(pRange, pAddr, 0, pRange->m_LB.type == NETTYPE_IPV4 ? 4 : 16);
 	}
@@ -60,19 +62,6 @@ protected:
 		return pBuffer;
 	}
 
-	class CNetHash
-	{
-	public:
-		int m_Hash;
-		int m_HashIndex; // matching parts for ranges, 0 for addr
-
-		CNetHash() {}
-		CNetHash(const NETADDR *pAddr);
-		CNetHash(const CNetRange *pRange);
-
-		static int MakeHashArray(const NETADDR *pAddr, CNetHash aHash[17]);
-	};
-
 	struct CBanInfo
 	{
 		enum
@@ -90,60 +79,103 @@ protected:
 	{
 		T m_Data;
 		CBanInfo m_Info;
-		CNetHash m_NetHash;
 
-		// hash list
+		// address index list, m_Slot is the hash bucket
 		CBan *m_pHashNext;
 		CBan *m_pHashPrev;
+		int m_Slot;
 
 		// used or free list
 		CBan *m_pNext;
 		CBan *m_pPrev;
 	};
 
-	template<class T, int HashCount>
+	// exact addresses in a hash table which grows with the number of bans
+	class CAddrIndex
+	{
+		std::vector<CBan<NETADDR> *> m_vpBuckets;
+		int m_Num;
+
+		static unsigned Hash(const NETADDR *pAddr);
+		void Link(CBan<NETADDR> *pBan);
+
+	public:
+		void Reset();
+		void Insert(CBan<NETADDR> *pBan);
+		void Remove(CBan<NETADDR> *pBan);
+		CBan<NETADDR> *Find(const NETADDR *pAddr) const;
+		CBan<NETADDR> *Match(const NETADDR *pAddr) const { return Find(pAddr); }
+	};
+
+	// ranges in a binary trie per address type. a range is split into the prefix blocks it covers, at most two per
+	// bit, and stored at the nodes of these blocks, so the ranges containing an address are all on the path of its bits
+	class CRangeIndex
+	{
+		struct CNode
+		{
+			int m_aChildren[2];
+			std::vector<CBan<CNetRange> *> m_vpBans;
+		};
+		std::vector<CNode> m_avNodes[2];
+
+		static int Trie(const NETADDR *pAddr) { return pAddr->type == NETTYPE_IPV4 ? 0 : 1; }
+		static int NumBits(const NETADDR *pAddr) { return pAddr->type == NETTYPE_IPV4 ? 32 : 128; }
+		static int Bit(const NETADDR *pAddr, int Index) { return (pAddr->ip[Index / 8] >> (7 - Index % 8)) & 1; }
+		// calls pfnVisit with the node of every block of the range, false if a node is missing and Create isn't set
+		template<class F>
+		bool ForEachBlock(const CNetRange *pRange, bool Create, F &&pfnVisit);
+
+	public:
+		void Reset();
+		void Insert(CBan<CNetRange> *pBan);
+		void Remove(CBan<CNetRange> *pBan);
+		CBan<CNetRange> *Find(const CNetRange *pRange) const;
+		// the most specific range containing the address
+		CBan<CNetRange> *Match(const NETADDR *pAddr) const;
+	};
+
+	template<class T, class TIndex>
 	class CBanPool
 	{
 	public:
 		typedef T CDataType;
 
-		CBan<CDataType> *Add(const CDataType *pData, const CBanInfo *pInfo, const CNetHash *pNetHash);
+		CBanPool();
+		~CBanPool();
+
+		CBan<CDataType> *Add(const CDataType *pData, const CBanInfo *pInfo);
 		int Remove(CBan<CDataType> *pBan);
 		void Update(CBan<CDataType> *pBan, const CBanInfo *pInfo);
 		void Reset();
 
 		int Num() const { return m_CountUsed; }
-		bool IsFull() const { return m_CountUsed == MAX_BANS; }
 
 		CBan<CDataType> *First() const { return m_pFirstUsed; }
-		CBan<CDataType> *First(const CNetHash *pNetHash) const { return m_aapHashList[pNetHash->m_HashIndex][pNetHash->m_Hash]; }
-		CBan<CDataType> *Find(const CDataType *pData, const CNetHash *pNetHash) const
-		{
-			for(CBan<CDataType> *pBan = m_aapHashList[pNetHash->m_HashIndex][pNetHash->m_Hash]; pBan; pBan = pBan->m_pHashNext)
-			{
-				if(NetComp(&pBan->m_Data, pData) == 0)
-					return pBan;
-			}
-
-			return 0;
-		}
+		CBan<CDataType> *Find(const CDataType *pData) const { return m_Index.Find(pData); }
+		CBan<CDataType> *Match(const NETADDR *pAddr) const { return m_Index.Match(pAddr); }
 		CBan<CDataType> *Get(int Index) const;
 
 	private:
 		enum
 		{
-			MAX_BANS = 1024,
+			BLOCK_SIZE = 1024,
 		};
 
-		CBan<CDataType> *m_aapHashList[HashCount][256];
-		CBan<CDataType> m_aBans[MAX_BANS];
+		// sorted by expiry, bans which never expire at the end
+		void LinkUsed(CBan<CDataType> *pBan);
+		void UnlinkUsed(CBan<CDataType> *pBan);
+
+		std::vector<CBan<CDataType> *> m_vpBlocks;
+		TIndex m_Index;
 		CBan<CDataType> *m_pFirstFree;
 		CBan<CDataType> *m_pFirstUsed;
+		CBan<CDataType> *m_pLastUsed;
+		CBan<CDataType> *m_pFirstNever;
 		int m_CountUsed;
 	};
 
-	typedef CBanPool<NETADDR, 1> CBanAddrPool;
-	typedef CBanPool<CNetRange, 16> CBanRangePool;
+	typedef CBanPool<NETADDR, CAddrIndex> CBanAddrPool;
+	typedef CBanPool<CNetRange, CRangeIndex> CBanRangePool;
 	typedef CBan<NETADDR> CBanAddr;
 	typedef CBan<CNetRange> CBanRange;
 
@@ -154,6 +186,10 @@ protected:
 	template<class T>
 	int Unban(T *pBanPool, const typename T::CDataType *pData);
 
+	// called for every added or updated ban, including imported ones
+	virtual void OnBan(CBanAddr *pBan) {}
+	virtual void OnBan(CBanRange *pBan) {}
+
 	class IConsole *m_pConsole;
 	class IStorage *m_pStorage;
 	CBanAddrPool m_BanAddrPool;
@@ -186,11 +222,18 @@ public:
 	bool IsBannable(const T *pData);
 	bool IsBanned(const NETADDR *pAddr, char *pBuf, unsigned BufferSize, int *pLastInfoQuery);
 
+	// compact binary ban list with absolute expiry times, to share bans between servers
+	void ExportBans(std::vector<unsigned char> *pvData) const;
+	// returns the number of imported bans or -1 if the data is corrupt
+	int ImportBans(const unsigned char *pData, int Size);
+
 	static void ConBan(class IConsole::IResult *pResult, void *pUser);
 	static void ConUnban(class IConsole::IResult *pResult, void *pUser);
 	static void ConUnbanAll(class IConsole::IResult *pResult, void *pUser);
 	static void ConBans(class IConsole::IResult *pResult, void *pUser);
 	static void ConBansSave(class IConsole::IResult *pResult, void *pUser);
+	static void ConBansExport(class IConsole::IResult *pResult, void *pUser);
+	static void ConBansImport(class IConsole::IResult *pResult, void *pUser);
 };
 
 #endif
@@ -88,7 +88,9 @@ enum
 	// token
 	NET_SEEDTIME = 16,
 
-	NET_TOKENCACHE_SIZE = 64,
+	NET_TOKENCACHE_SIZE = 1024,
+	NET_TOKENCACHE_HASHSIZE = 256,
+	NET_TOKENCACHE_MAXPACKETS = 256,
 	NET_TOKENCACHE_ADDRESSEXPIRY = NET_SEEDTIME,
 	NET_TOKENCACHE_PACKETEXPIRY = 5,
 };
@@ -275,6 +277,35 @@ public:
 	void Update();
 
 private:
+	// entries in the order they were added, which is the order they expire in, and chained per address hash.
+	// removed entries are kept for reuse
+	template<class T>
+	class CQueue
+	{
+	public:
+		CQueue();
+		~CQueue();
+		void Reset();
+
+		T *New();
+		void PushBack(T *pEntry);
+		void Remove(T *pEntry);
+
+		int Num() const { return m_Num; }
+		T *First() const { return m_pFirst; }
+		// broadcast addresses share one bucket, whatever their port
+		T *FirstInBucket(const NETADDR *pAddr) const { return m_apBuckets[Hash(pAddr)]; }
+		static unsigned Hash(const NETADDR *pAddr);
+
+	private:
+		T *m_apBuckets[NET_TOKENCACHE_HASHSIZE];
+		T *m_apBucketsLast[NET_TOKENCACHE_HASHSIZE];
+		T *m_pFirst;
+		T *m_pLast;
+		T *m_pFirstFree;
+		int m_Num;
+	};
+
 	class CConnlessPacketInfo
 	{
 	private:
@@ -289,10 +320,19 @@ private:
 		char m_aData[NET_MAX_PAYLOAD];
 		int64 m_Expiry;
 		int64 m_LastTokenRequest;
-		const int m_TrackID;
+		int m_TrackID;
 		FSendCallback m_pfnCallback;
 		void *m_pCallbackUser;
+
 		CConnlessPacketInfo *m_pNext;
+		CConnlessPacketInfo *m_pPrev;
+		CConnlessPacketInfo *m_pHashNext;
+		CConnlessPacketInfo *m_pHashPrev;
+		unsigned m_Hash;
+		CConnlessPacketInfo *m_pTrackNext;
+		CConnlessPacketInfo *m_pTrackPrev;
+
+		void NewTrackID() { m_TrackID = CConnlessPacketInfo::m_UniqueID++; }
 	};
 
 	struct CAddressInfo
@@ -300,15 +340,23 @@ private:
 		NETADDR m_Addr;
 		TOKEN m_Token;
 		int64 m_Expiry;
+
+		CAddressInfo *m_pNext;
+		CAddressInfo *m_pPrev;
+		CAddressInfo *m_pHashNext;
+		CAddressInfo *m_pHashPrev;
+		unsigned m_Hash;
 	};
 
-	TStaticRingBuffer<CAddressInfo,
-		NET_TOKENCACHE_SIZE * sizeof(CAddressInfo),
-		CRingBufferBase::FLAG_RECYCLE>
-		m_TokenCache;
+	CAddressInfo *FindAddressInfo(const NETADDR *pAddr) const;
+	void SendStoredPackets(const NETADDR *pBucketAddr, const NETADDR *pAddr, TOKEN Token, bool AllowBroadcast);
+	void RemoveStoredPacket(CConnlessPacketInfo *pInfo);
+
+	CQueue<CAddressInfo> m_TokenCache;
+	CQueue<CConnlessPacketInfo> m_ConnlessPackets;
+	// the stored packets chained by track id, the ids are consecutive so they spread evenly
+	CConnlessPacketInfo *m_apTrackBuckets[NET_TOKENCACHE_HASHSIZE];
 
-	CConnlessPacketInfo *m_pConnlessPacketList; // TODO: enhance this, dynamic linked lists
-						    // are bad for performance
 	CNetBase *m_pNetBase;
 	const CNetTokenManager *m_pTokenManager;
 };
@@ -330,6 +378,7 @@ private:
 	bool m_BlockCloseMsg;
 
 	TStaticRingBuffer<CNetChunkResend, NET_CONN_BUFFERSIZE> m_Buffer;
+	int64 m_NumResends;
 
 	int64 m_LastUpdateTime;
 	int64 m_LastRecvTime;
@@ -391,6 +440,7 @@ public:
 	int64 ConnectTime() const { return m_LastUpdateTime; }
 
 	int AckSequence() const { return m_Ack; }
+	int64 NumResends() const { return m_NumResends; }
 	// The backroom is ack-NET_MAX_SEQUENCE/2. Used for knowing if we acked a packet or not
 	static int IsSeqInBackroom(int Seq, int Ack);
 };
@@ -485,6 +535,7 @@ public:
 
 	// status requests
 	const NETADDR *ClientAddr(int ClientID) const { return m_aSlots[ClientID].m_Connection.PeerAddress(); }
+	int64 ClientResends(int ClientID) const { return m_aSlots[ClientID].m_Connection.NumResends(); }
 	class CNetBan *NetBan() const { return m_pNetBan; }
 
 	TOKEN GetGlobalToken();
@@ -133,30 +133,132 @@ bool CNetTokenManager::CheckToken(const NETADDR *pAddr, TOKEN Token, TOKEN Respo
 	return false;
 }
 
+template<class T>
+CNetTokenCache::CQueue<T>::CQueue()
+{
+	m_pFirstFree = 0;
+	m_pFirst = 0;
+	Reset();
+}
+
+template<class T>
+CNetTokenCache::CQueue<T>::~CQueue()
+{
+	Reset();
+	while(m_pFirstFree)
+	{
+		T *pNext = m_pFirstFree->m_pNext;
+		delete m_pFirstFree;
+		m_pFirstFree = pNext;
+	}
+}
+
+template<class T>
+void CNetTokenCache::CQueue<T>::Reset()
+{
+	while(m_pFirst)
+		Remove(m_pFirst);
+	for(int i = 0; i < NET_TOKENCACHE_HASHSIZE; i++)
+		m_apBuckets[i] = m_apBucketsLast[i] = 0;
+	m_pFirst = 0;
+	m_pLast = 0;
+	m_Num = 0;
+}
+
+template<class T>
+unsigned CNetTokenCache::CQueue<T>::Hash(const NETADDR *pAddr)
+{
+	// fnv-1a, broadcasts are sent to several ports and matched without it
+	int Length = (pAddr->type & NETTYPE_IPV4) ? NETADDR_SIZE_IPV4 : NETADDR_SIZE_IPV6;
+	unsigned Hash = (2166136261u ^ pAddr->type) * 16777619u;
+	for(int i = 0; i < Length; i++)
+		Hash = (Hash ^ pAddr->ip[i]) * 16777619u;
+	if(!(pAddr->type & NETTYPE_LINK_BROADCAST))
+	{
+		Hash = (Hash ^ (pAddr->port & 0xff)) * 16777619u;
+		Hash = (Hash ^ (pAddr->port >> 8)) * 16777619u;
+	}
+	return (Hash ^ (Hash >> 16)) % NET_TOKENCACHE_HASHSIZE;
+}
+
+template<class T>
+T *CNetTokenCache::CQueue<T>::New()
+{
+	if(!m_pFirstFree)
+		return new T();
+	T *pEntry = m_pFirstFree;
+	m_pFirstFree = pEntry->m_pNext;
+	return pEntry;
+}
+
+template<class T>
+void CNetTokenCache::CQueue<T>::PushBack(T *pEntry)
+{
+	pEntry->m_pNext = 0;
+	pEntry->m_pPrev = m_pLast;
+	if(m_pLast)
+		m_pLast->m_pNext = pEntry;
+	else
+		m_pFirst = pEntry;
+	m_pLast = pEntry;
+
+	pEntry->m_Hash = Hash(&pEntry->m_Addr);
+	pEntry->m_pHashNext = 0;
+	pEntry->m_pHashPrev = m_apBucketsLast[pEntry->m_Hash];
+	if(pEntry->m_pHashPrev)
+		pEntry->m_pHashPrev->m_pHashNext = pEntry;
+	else
+		m_apBuckets[pEntry->m_Hash] = pEntry;
+	m_apBucketsLast[pEntry->m_Hash] = pEntry;
+
+	++m_Num;
+}
+
+template<class T>
+void CNetTokenCache::CQueue<T>::Remove(T *pEntry)
+{
+	if(pEntry->m_pNext)
+		pEntry->m_pNext->m_pPrev = pEntry->m_pPrev;
+	else
+		m_pLast = pEntry->m_pPrev;
+	if(pEntry->m_pPrev)
+		pEntry->m_pPrev->m_pNext = pEntry->m_pNext;
+	else
+		m_pFirst = pEntry->m_pNext;
+
+	if(pEntry->m_pHashNext)
+		pEntry->m_pHashNext->m_pHashPrev = pEntry->m_pHashPrev;
+	else
+		m_apBucketsLast[pEntry->m_Hash] = pEntry->m_pHashPrev;
+	if(pEntry->m_pHashPrev)
+		pEntry->m_pHashPrev->m_pHashNext = pEntry->m_pHashNext;
+	else
+		m_apBuckets[pEntry->m_Hash] = pEntry->m_pHashNext;
+
+	// keep it for reuse
+	pEntry->m_pNext = m_pFirstFree;
+	m_pFirstFree = pEntry;
+
+	--m_Num;
+}
+
 CNetTokenCache::CNetTokenCache()
 {
 	m_pTokenManager = 0;
-	m_pConnlessPacketList = 0;
+	for(int i = 0; i < NET_TOKENCACHE_HASHSIZE; i++)
+		m_apTrackBuckets[i] = 0;
 }
 
 CNetTokenCache::~CNetTokenCache()
 {
-	// delete the linked list
-	while(m_pConnlessPacketList)
-	{
-		CConnlessPacketInfo *pTemp = m_pConnlessPacketList->m_pNext;
-		delete m_pConnlessPacketList;
-		m_pConnlessPacketList = pTemp;
-	}
-	m_pConnlessPacketList = 0;
 }
 
 void CNetTokenCache::Init(CNetBase *pNetBase, const CNetTokenManager *pTokenManager)
 {
-	// call the destructor to clear the linked list
-	this->~CNetTokenCache();
-
-	m_TokenCache.Init();
+	m_TokenCache.Reset();
+	m_ConnlessPackets.Reset();
+	for(int i = 0; i < NET_TOKENCACHE_HASHSIZE; i++)
+		m_apTrackBuckets[i] = 0;
 	m_pNetBase = pNetBase;
 	m_pTokenManager = pTokenManager;
 }
@@ -172,73 +274,79 @@ void CNetTokenCache::SendPacketConnless(const NETADDR *pAddr, const void *pData,
 	{
 		FetchToken(pAddr);
 
+		// drop the oldest packet instead of growing without limit
+		if(m_ConnlessPackets.Num() >= NET_TOKENCACHE_MAXPACKETS)
+			RemoveStoredPacket(m_ConnlessPackets.First());
+
 		// store the packet for future sending
-		CConnlessPacketInfo **ppInfo = &m_pConnlessPacketList;
-		while(*ppInfo)
-			ppInfo = &(*ppInfo)->m_pNext;
-		*ppInfo = new CConnlessPacketInfo();
-		mem_copy((*ppInfo)->m_aData, pData, DataSize);
-		(*ppInfo)->m_Addr = *pAddr;
-		(*ppInfo)->m_DataSize = DataSize;
+		CConnlessPacketInfo *pInfo = m_ConnlessPackets.New();
+		pInfo->NewTrackID();
+		mem_copy(pInfo->m_aData, pData, DataSize);
+		pInfo->m_Addr = *pAddr;
+		pInfo->m_DataSize = DataSize;
 		int64 Now = time_get();
-		(*ppInfo)->m_Expiry = Now + time_freq() * NET_TOKENCACHE_PACKETEXPIRY;
-		(*ppInfo)->m_LastTokenRequest = Now;
-		(*ppInfo)->m_pNext = 0;
+		pInfo->m_Expiry = Now + time_freq() * NET_TOKENCACHE_PACKETEXPIRY;
+		pInfo->m_LastTokenRequest = Now;
 		if(pCallbackData)
 		{
-			(*ppInfo)->m_pfnCallback = pCallbackData->m_pfnCallback;
-			(*ppInfo)->m_pCallbackUser = pCallbackData->m_pCallbackUser;
-			pCallbackData->m_TrackID = (*ppInfo)->m_TrackID;
+			pInfo->m_pfnCallback = pCallbackData->m_pfnCallback;
+			pInfo->m_pCallbackUser = pCallbackData->m_pCallbackUser;
+			pCallbackData->m_TrackID = pInfo->m_TrackID;
 		}
 		else
 		{
-			(*ppInfo)->m_pfnCallback = 0;
-			(*ppInfo)->m_pCallbackUser = 0;
+			pInfo->m_pfnCallback = 0;
+			pInfo->m_pCallbackUser = 0;
 		}
+		m_ConnlessPackets.PushBack(pInfo);
+
+		CConnlessPacketInfo **ppTrackBucket = &m_apTrackBuckets[(unsigned) pInfo->m_TrackID % NET_TOKENCACHE_HASHSIZE];
+		pInfo->m_pTrackPrev = 0;
+		pInfo->m_pTrackNext = *ppTrackBucket;
+		if(*ppTrackBucket)
+			(*ppTrackBucket)->m_pTrackPrev = pInfo;
+		*ppTrackBucket = pInfo;
 	}
 }
 
+void CNetTokenCache::RemoveStoredPacket(CConnlessPacketInfo *pInfo)
+{
+	if(pInfo->m_pTrackNext)
+		pInfo->m_pTrackNext->m_pTrackPrev = pInfo->m_pTrackPrev;
+	if(pInfo->m_pTrackPrev)
+		pInfo->m_pTrackPrev->m_pTrackNext = pInfo->m_pTrackNext;
+	else
+		m_apTrackBuckets[(unsigned) pInfo->m_TrackID % NET_TOKENCACHE_HASHSIZE] = pInfo->m_pTrackNext;
+	m_ConnlessPackets.Remove(pInfo);
+}
+
 void CNetTokenCache::PurgeStoredPacket(int TrackID)
 {
-	CConnlessPacketInfo *pPrevInfo = 0;
-	CConnlessPacketInfo *pInfo = m_pConnlessPacketList;
-	while(pInfo)
+	for(CConnlessPacketInfo *pInfo = m_apTrackBuckets[(unsigned) TrackID % NET_TOKENCACHE_HASHSIZE]; pInfo; pInfo = pInfo->m_pTrackNext)
 	{
 		if(pInfo->m_TrackID == TrackID)
 		{
 			// purge desired packet
-			CConnlessPacketInfo *pNext = pInfo->m_pNext;
-			if(pPrevInfo)
-				pPrevInfo->m_pNext = pNext;
-			if(pInfo == m_pConnlessPacketList)
-				m_pConnlessPacketList = pNext;
-			delete pInfo;
-
+			RemoveStoredPacket(pInfo);
 			break;
 		}
-		else
-		{
-			if(pPrevInfo)
-				pPrevInfo = pPrevInfo->m_pNext;
-			else
-				pPrevInfo = pInfo;
-			pInfo = pInfo->m_pNext;
-		}
 	}
 }
 
-TOKEN CNetTokenCache::GetToken(const NETADDR *pAddr)
+CNetTokenCache::CAddressInfo *CNetTokenCache::FindAddressInfo(const NETADDR *pAddr) const
 {
-	// traverse the list in the reverse direction
-	// newest caches are the best
-	CAddressInfo *pInfo = m_TokenCache.Last();
-	while(pInfo)
+	for(CAddressInfo *pInfo = m_TokenCache.FirstInBucket(pAddr); pInfo; pInfo = pInfo->m_pHashNext)
 	{
 		if(net_addr_comp(&pInfo->m_Addr, pAddr, true) == 0)
-			return pInfo->m_Token;
-		pInfo = m_TokenCache.Prev(pInfo);
+			return pInfo;
 	}
-	return NET_TOKEN_NONE;
+	return 0;
+}
+
+TOKEN CNetTokenCache::GetToken(const NETADDR *pAddr)
+{
+	CAddressInfo *pInfo = FindAddressInfo(pAddr);
+	return pInfo ? pInfo->m_Token : NET_TOKEN_NONE;
 }
 
 void CNetTokenCache::FetchToken(const NETADDR *pAddr)
@@ -246,52 +354,56 @@ void CNetTokenCache::FetchToken(const NETADDR *pAddr)
 	m_pNetBase->SendControlMsgWithToken(pAddr, NET_TOKEN_NONE, 0, NET_CTRLMSG_TOKEN, m_pTokenManager->GenerateToken(pAddr), true);
 }
 
-void CNetTokenCache::AddToken(const NETADDR *pAddr, TOKEN Token, int TokenFLag)
+void CNetTokenCache::SendStoredPackets(const NETADDR *pBucketAddr, const NETADDR *pAddr, TOKEN Token, bool AllowBroadcast)
 {
-	if(Token == NET_TOKEN_NONE)
-		return;
+	NETADDR NullAddr = {0};
+	NullAddr.type = 7; // cover broadcasts
 
-	// search the list of packets to be sent
-	// for this address
-	CConnlessPacketInfo *pPrevInfo = 0;
-	CConnlessPacketInfo *pInfo = m_pConnlessPacketList;
-	bool Found = false;
+	CConnlessPacketInfo *pInfo = m_ConnlessPackets.FirstInBucket(pBucketAddr);
 	while(pInfo)
 	{
-		NETADDR NullAddr = {0};
-		NullAddr.type = 7; // cover broadcasts
-		if(net_addr_comp(&pInfo->m_Addr, pAddr, true) == 0 || ((TokenFLag & NET_TOKENFLAG_ALLOWBROADCAST) && net_addr_comp(&pInfo->m_Addr, &NullAddr, false) == 0))
+		CConnlessPacketInfo *pNext = pInfo->m_pHashNext;
+		if(net_addr_comp(&pInfo->m_Addr, pAddr, true) == 0 || (AllowBroadcast && net_addr_comp(&pInfo->m_Addr, &NullAddr, false) == 0))
 		{
 			// notify the user that the packet gets delivered
 			if(pInfo->m_pfnCallback)
 				pInfo->m_pfnCallback(pInfo->m_TrackID, pInfo->m_pCallbackUser);
 			m_pNetBase->SendPacketConnless(&(pInfo->m_Addr), Token, m_pTokenManager->GenerateToken(pAddr), pInfo->m_aData, pInfo->m_DataSize);
-			CConnlessPacketInfo *pNext = pInfo->m_pNext;
-			if(pPrevInfo)
-				pPrevInfo->m_pNext = pNext;
-			if(pInfo == m_pConnlessPacketList)
-				m_pConnlessPacketList = pNext;
-			delete pInfo;
-			pInfo = pNext;
-		}
-		else
-		{
-			if(pPrevInfo)
-				pPrevInfo = pPrevInfo->m_pNext;
-			else
-				pPrevInfo = pInfo;
-			pInfo = pInfo->m_pNext;
+			RemoveStoredPacket(pInfo);
 		}
+		pInfo = pNext;
 	}
+}
+
+void CNetTokenCache::AddToken(const NETADDR *pAddr, TOKEN Token, int TokenFLag)
+{
+	if(Token == NET_TOKEN_NONE)
+		return;
+
+	// send the packets stored for this address, and those for
+	// broadcasts which are in a different bucket
+	const bool AllowBroadcast = TokenFLag & NET_TOKENFLAG_ALLOWBROADCAST;
+	SendStoredPackets(pAddr, pAddr, Token, AllowBroadcast);
+	NETADDR NullAddr = {0};
+	NullAddr.type = 7;
+	if(AllowBroadcast && CQueue<CConnlessPacketInfo>::Hash(&NullAddr) != CQueue<CConnlessPacketInfo>::Hash(pAddr))
+		SendStoredPackets(&NullAddr, pAddr, Token, AllowBroadcast);
 
 	// add the token
-	if(Found || !(TokenFLag & NET_TOKENFLAG_RESPONSEONLY))
+	if(!(TokenFLag & NET_TOKENFLAG_RESPONSEONLY))
 	{
-		CAddressInfo Info;
-		Info.m_Addr = *pAddr;
-		Info.m_Token = Token;
-		Info.m_Expiry = time_get() + time_freq() * NET_TOKENCACHE_ADDRESSEXPIRY;
-		(*m_TokenCache.Allocate(sizeof(Info))) = Info;
+		// an address has one entry, repeated tokens only refresh it
+		CAddressInfo *pInfo = FindAddressInfo(pAddr);
+		if(pInfo)
+			m_TokenCache.Remove(pInfo);
+		else if(m_TokenCache.Num() >= NET_TOKENCACHE_SIZE)
+			m_TokenCache.Remove(m_TokenCache.First());
+
+		pInfo = m_TokenCache.New();
+		pInfo->m_Addr = *pAddr;
+		pInfo->m_Token = Token;
+		pInfo->m_Expiry = time_get() + time_freq() * NET_TOKENCACHE_ADDRESSEXPIRY;
+		m_TokenCache.PushBack(pInfo);
 	}
 }
 
@@ -302,25 +414,20 @@ void CNetTokenCache::Update()
 	// drop expired address info
 	CAddressInfo *pAddrInfo;
 	while((pAddrInfo = m_TokenCache.First()) && (pAddrInfo->m_Expiry <= Now))
-		m_TokenCache.PopFirst();
+		m_TokenCache.Remove(pAddrInfo);
 
 	// try to fetch the token again for stored packets
-	CConnlessPacketInfo *pEntry = m_pConnlessPacketList;
-	while(pEntry)
+	for(CConnlessPacketInfo *pEntry = m_ConnlessPackets.First(); pEntry; pEntry = pEntry->m_pNext)
 	{
 		if(pEntry->m_LastTokenRequest + 2 * time_freq() <= Now)
 		{
 			FetchToken(&pEntry->m_Addr);
 			pEntry->m_LastTokenRequest = Now;
 		}
-		pEntry = pEntry->m_pNext;
 	}
 
 	// drop expired packets
-	while(m_pConnlessPacketList && m_pConnlessPacketList->m_Expiry <= Now)
-	{
-		CConnlessPacketInfo *pNewList = m_pConnlessPacketList->m_pNext;
-		delete m_pConnlessPacketList;
-		m_pConnlessPacketList = pNewList;
-	}
+	CConnlessPacketInfo *pPacketInfo;
+	while((pPacketInfo = m_ConnlessPackets.First()) && pPacketInfo->m_Expiry <= Now)
+		RemoveStoredPacket(pPacketInfo);
 }
@@ -3,6 +3,7 @@
 #include <base/math.h>
 #include <base/system.h>
 #include <engine/external/json-parser/json.h>
+#include <engine/shared/jsonparser.h>
 
 #include <cstdio>
 
@@ -142,6 +143,208 @@ bool CServerInfo2::FromJsonRaw(CServerInfo2 *pOut, const json_value *pJson)
 	return false;
 }
 
+// reads an object like {"name": "..."} and copies the string of one of its members
+static bool ReadMemberString(CJsonReader *pReader, const char *pMember, char *pBuffer, int BufferSize)
+{
+	if(!pReader->NextValue(CJsonReader::TOKEN_BEGIN_OBJECT))
+		return false;
+	bool Found = false;
+	while(pReader->NextKey())
+	{
+		if(pReader->IsKey(pMember))
+			Found = pReader->ReadString(pBuffer, BufferSize);
+		else
+			pReader->SkipValue();
+	}
+	return Found && !pReader->Failed();
+}
+
+static bool ReadClient(CJsonReader *pReader, CServerInfo2::CClient *pClient)
+{
+	enum
+	{
+		FIELD_NAME = 1,
+		FIELD_CLAN = 2,
+		FIELD_COUNTRY = 4,
+		FIELD_SCORE = 8,
+		FIELD_ISPLAYER = 16,
+		FIELDS_REQUIRED = 31,
+	};
+
+	int Fields = 0;
+	bool Error = false;
+	while(pReader->NextKey())
+	{
+		int64 Value = 0;
+		if(pReader->IsKey("name"))
+		{
+			Fields |= FIELD_NAME;
+			Error = Error || !pReader->ReadString(pClient->m_aName, sizeof(pClient->m_aName));
+		}
+		else if(pReader->IsKey("clan"))
+		{
+			Fields |= FIELD_CLAN;
+			if(pReader->Next() == CJsonReader::TOKEN_BEGIN_OBJECT)
+			{
+				while(pReader->NextKey())
+				{
+					if(pReader->IsKey("name"))
+						pReader->ReadString(pClient->m_aClan, sizeof(pClient->m_aClan));
+					else
+						pReader->SkipValue();
+				}
+			}
+			else if(pReader->Token() != CJsonReader::TOKEN_NULL)
+			{
+				pReader->Skip();
+				Error = true;
+			}
+		}
+		else if(pReader->IsKey("country"))
+		{
+			Fields |= FIELD_COUNTRY;
+			if(!pReader->NextValue(CJsonReader::TOKEN_BEGIN_OBJECT))
+				Error = true;
+			else
+			{
+				while(pReader->NextKey())
+				{
+					if(!pReader->IsKey("code"))
+						pReader->SkipValue();
+					else if(pReader->ReadInteger(&Value))
+						pClient->m_Country = Value;
+				}
+			}
+		}
+		else if(pReader->IsKey("score"))
+		{
+			Fields |= FIELD_SCORE;
+			Error = Error || !pReader->ReadInteger(&Value);
+			pClient->m_Score = Value;
+		}
+		else if(pReader->IsKey("isPlayer"))
+		{
+			Fields |= FIELD_ISPLAYER;
+			Error = Error || !pReader->ReadBoolean(&pClient->m_IsPlayer);
+		}
+		else
+			pReader->SkipValue();
+	}
+	return !Error && Fields == FIELDS_REQUIRED && !pReader->Failed();
+}
+
+bool CServerInfo2::FromJsonReader(CServerInfo2 *pOut, CJsonReader *pReader, bool (*pfnUnknownKey)(CJsonReader *pReader, void *pUser), void *pUser)
+{
+	enum
+	{
+		FIELD_MAXCLIENTS = 1,
+		FIELD_MAXPLAYERS = 2,
+		FIELD_PASSWORDED = 4,
+		FIELD_GAMETYPE = 8,
+		FIELD_NAME = 16,
+		FIELD_MAP = 32,
+		FIELD_VERSION = 64,
+		FIELD_CLIENTS = 128,
+		FIELDS_REQUIRED = 255,
+	};
+
+	mem_zero(pOut, sizeof(*pOut));
+	pOut->m_ClientScoreKind = CServerInfo2::CLIENT_SCORE_KIND_UNSPECIFIED;
+
+	// keep reading after an error, the keys of the callback might still follow
+	int Fields = 0;
+	bool Error = false;
+	while(pReader->NextKey())
+	{
+		int64 Value = 0;
+		if(pReader->IsKey("maxClients"))
+		{
+			Fields |= FIELD_MAXCLIENTS;
+			Error = Error || !pReader->ReadInteger(&Value);
+			pOut->m_MaxClients = Value;
+		}
+		else if(pReader->IsKey("maxPlayers"))
+		{
+			Fields |= FIELD_MAXPLAYERS;
+			Error = Error || !pReader->ReadInteger(&Value);
+			pOut->m_MaxPlayers = Value;
+		}
+		else if(pReader->IsKey("clientScoreKind"))
+		{
+			pReader->Next();
+			if(pReader->Token() == CJsonReader::TOKEN_STRING && str_startswith(pReader->String(), "points"))
+				pOut->m_ClientScoreKind = CServerInfo2::CLIENT_SCORE_KIND_POINTS;
+			else if(pReader->Token() == CJsonReader::TOKEN_STRING && str_startswith(pReader->String(), "time"))
+				pOut->m_ClientScoreKind = CServerInfo2::CLIENT_SCORE_KIND_TIME;
+			else if(pReader->Token() != CJsonReader::TOKEN_STRING && pReader->Token() != CJsonReader::TOKEN_NULL)
+			{
+				pReader->Skip();
+				Error = true;
+			}
+		}
+		else if(pReader->IsKey("hasPassword"))
+		{
+			Fields |= FIELD_PASSWORDED;
+			Error = Error || !pReader->ReadBoolean(&pOut->m_Passworded);
+		}
+		else if(pReader->IsKey("gameType"))
+		{
+			Fields |= FIELD_GAMETYPE;
+			Error = Error || !ReadMemberString(pReader, "name", pOut->m_aGameType, sizeof(pOut->m_aGameType));
+		}
+		else if(pReader->IsKey("name"))
+		{
+			Fields |= FIELD_NAME;
+			Error = Error || !pReader->ReadString(pOut->m_aName, sizeof(pOut->m_aName));
+		}
+		else if(pReader->IsKey("map"))
+		{
+			Fields |= FIELD_MAP;
+			Error = Error || !ReadMemberString(pReader, "name", pOut->m_aMapName, sizeof(pOut->m_aMapName));
+		}
+		else if(pReader->IsKey("version"))
+		{
+			Fields |= FIELD_VERSION;
+			Error = Error || !ReadMemberString(pReader, "version", pOut->m_aVersion, sizeof(pOut->m_aVersion));
+		}
+		else if(pReader->IsKey("clients"))
+		{
+			Fields |= FIELD_CLIENTS;
+			if(!pReader->NextValue(CJsonReader::TOKEN_BEGIN_ARRAY))
+				Error = true;
+			else
+			{
+				// like FromJsonRaw, only the first MAX_CLIENTS clients are kept
+				CClient Ignored;
+				while(pReader->Next() == CJsonReader::TOKEN_BEGIN_OBJECT)
+				{
+					CClient *pClient = pOut->m_NumClients < MAX_CLIENTS ? &pOut->m_aClients[pOut->m_NumClients] : &Ignored;
+					mem_zero(pClient, sizeof(*pClient));
+					if(!ReadClient(pReader, pClient))
+						Error = true;
+					else if(pClient != &Ignored)
+					{
+						if(pClient->m_IsPlayer)
+							pOut->m_NumPlayers++;
+						pOut->m_NumClients++;
+					}
+				}
+				if(pReader->Token() != CJsonReader::TOKEN_END_ARRAY)
+				{
+					pReader->Skip();
+					Error = true;
+				}
+			}
+		}
+		else if(!pfnUnknownKey || !pfnUnknownKey(pReader, pUser))
+			pReader->SkipValue();
+	}
+
+	if(Error || Fields != FIELDS_REQUIRED || pReader->Failed())
+		return true;
+	return pOut->Validate();
+}
+
 bool CServerInfo2::operator==(const CServerInfo2 &Other) const
 {
 	bool Unequal;
@@ -7,6 +7,7 @@
 #include <engine/serverbrowser.h>
 
 typedef struct _json_value json_value;
+class CJsonReader;
 class CServerInfo;
 
 class CServerInfo2
@@ -45,6 +46,9 @@ public:
 	bool operator!=(const CServerInfo2 &Other) const { return !(*this == Other); }
 	static bool FromJson(CServerInfo2 *pOut, const json_value *pJson);
 	static bool FromJsonRaw(CServerInfo2 *pOut, const json_value *pJson);
+	// reads the object the reader just began up to its end, returns true on error like FromJson.
+	// keys which aren't part of the info are passed to the callback, which returns false to skip them
+	static bool FromJsonReader(CServerInfo2 *pOut, CJsonReader *pReader, bool (*pfnUnknownKey)(CJsonReader *pReader, void *pUser) = nullptr, void *pUser = nullptr);
 	bool Validate() const;
 
 	operator CServerInfo() const;
@@ -1,11 +1,18 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <base/hash_ctxt.h>
+#include <base/lock.h>
 #include <base/system.h>
 #include <engine/storage.h>
 #include "linereader.h"
 #include <zlib.h>
 
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 // compiled-in data-dir path
 #define DATA_DIR "data"
 
@@ -24,6 +31,31 @@ public:
 	char m_aCurrentDir[IO_MAX_PATH_LENGTH];
 	char m_aAppDir[IO_MAX_PATH_LENGTH];
 
+	// listing of a directory in one of the read-only paths, shared with the
+	// callers iterating it, so changes only replace it
+	struct CIndexDir
+	{
+		std::vector<std::pair<std::string, bool>> m_vEntries; // in listing order
+		std::unordered_map<std::string, bool> m_Names; // name -> is directory
+	};
+
+	enum
+	{
+		INDEX_UNKNOWN = 0,
+		INDEX_ABSENT,
+		INDEX_PRESENT,
+	};
+
+	CLock m_IndexLock;
+	bool m_IndexEnabled GUARDED_BY(m_IndexLock);
+	// directory relative to the storage path -> listing
+	std::unordered_map<std::string, std::shared_ptr<const CIndexDir>> m_aIndex[MAX_PATHS] GUARDED_BY(m_IndexLock);
+	// watch id -> indexed directories
+	std::unordered_map<int, std::vector<std::pair<int, std::string>>> m_WatchedDirs GUARDED_BY(m_IndexLock);
+	CIndexStats m_IndexStats GUARDED_BY(m_IndexLock);
+	FS_WATCH *m_pWatch;
+	void *m_pWatchThread;
+
 	CStorage()
 	{
 		mem_zero(m_aaStoragePaths, sizeof(m_aaStoragePaths));
@@ -32,6 +64,15 @@ public:
 		m_aUserDir[0] = 0;
 		m_aCurrentDir[0] = 0;
 		m_aAppDir[0] = 0;
+		m_IndexEnabled = false;
+		mem_zero(&m_IndexStats, sizeof(m_IndexStats));
+		m_pWatch = 0;
+		m_pWatchThread = 0;
+	}
+
+	~CStorage()
+	{
+		EnableIndex(false);
 	}
 
 	int Init(const char *pApplicationName, int StorageType, int NumArgs, const char **ppArguments)
@@ -261,19 +302,272 @@ public:
 		dbg_msg("storage", "warning no data directory found");
 	}
 
+	// turns a path relative to a storage path into its key in the index, fails
+	// for paths the index can't answer
+	static bool IndexKey(const char *pPath, std::string *pKey)
+	{
+		pKey->clear();
+		while(*pPath)
+		{
+			const char *pEnd = pPath;
+			while(*pEnd && *pEnd != '/')
+				pEnd++;
+			const int Length = pEnd - pPath;
+			if(Length == 2 && pPath[0] == '.' && pPath[1] == '.')
+				return false;
+			if(Length > 0 && !(Length == 1 && pPath[0] == '.'))
+			{
+				if(!pKey->empty())
+					pKey->push_back('/');
+				pKey->append(pPath, Length);
+			}
+			pPath = *pEnd ? pEnd + 1 : pEnd;
+		}
+		return true;
+	}
+
+	static int IndexListCallback(const char *pName, int IsDir, int Type, void *pUser)
+	{
+		CIndexDir *pDir = static_cast<CIndexDir *>(pUser);
+		pDir->m_vEntries.emplace_back(pName, IsDir != 0);
+		pDir->m_Names[pName] = IsDir != 0;
+		return 0;
+	}
+
+	const CIndexDir *IndexDir(int Type, const std::string &Key, bool *pListed) REQUIRES(m_IndexLock)
+	{
+		auto It = m_aIndex[Type].find(Key);
+		if(It != m_aIndex[Type].end())
+			return It->second.get();
+
+		char aPath[IO_MAX_PATH_LENGTH];
+		GetPath(Type, Key.c_str(), aPath, sizeof(aPath));
+		// watch before listing, so no change gets lost in between. without
+		// the watch nothing would update the listing, so it isn't kept
+		const int Id = fs_watch_add(m_pWatch, aPath);
+		if(Id < 0)
+		{
+			m_IndexStats.m_WatchFailures++;
+			return nullptr;
+		}
+		std::vector<std::pair<int, std::string>> &vDirs = m_WatchedDirs[Id];
+		if(std::find(vDirs.begin(), vDirs.end(), std::make_pair(Type, Key)) == vDirs.end())
+			vDirs.emplace_back(Type, Key);
+
+		std::shared_ptr<CIndexDir> pDir = std::make_shared<CIndexDir>();
+		fs_listdir(aPath, IndexListCallback, Type, pDir.get());
+		m_aIndex[Type][Key] = pDir;
+		m_IndexStats.m_NumDirectories++;
+		*pListed = true;
+		return pDir.get();
+	}
+
+	// looks up a file or directory, listing the directories on its way if they aren't indexed yet
+	int IndexFind(int Type, const char *pPath, bool WantDir, std::shared_ptr<const CIndexDir> *ppDir = nullptr) REQUIRES(!m_IndexLock)
+	{
+		std::string Key;
+		if(Type <= TYPE_SAVE || !IndexKey(pPath, &Key))
+			return INDEX_UNKNOWN;
+
+		CLockScope LockScope(m_IndexLock);
+		if(!m_IndexEnabled)
+			return INDEX_UNKNOWN;
+
+		bool Listed = false;
+		int Result = INDEX_PRESENT;
+		const CIndexDir *pDir = IndexDir(Type, "", &Listed);
+		if(!pDir)
+			return INDEX_UNKNOWN;
+		for(size_t Start = 0; Start < Key.size();)
+		{
+			size_t End = Key.find('/', Start);
+			if(End == std::string::npos)
+				End = Key.size();
+			auto It = pDir->m_Names.find(Key.substr(Start, End - Start));
+			if(It == pDir->m_Names.end() || (!It->second && (End < Key.size() || WantDir)))
+			{
+				Result = INDEX_ABSENT;
+				break;
+			}
+			if(End < Key.size() || WantDir)
+			{
+				pDir = IndexDir(Type, Key.substr(0, End), &Listed);
+				if(!pDir)
+					return INDEX_UNKNOWN;
+			}
+			Start = End + 1;
+		}
+
+		m_IndexStats.m_Lookups++;
+		if(!Listed)
+			m_IndexStats.m_Hits++;
+		if(Result == INDEX_PRESENT && ppDir)
+			*ppDir = m_aIndex[Type][Key];
+		return Result;
+	}
+
+	void IndexInvalidate(int Type, const std::string &Key) REQUIRES(m_IndexLock)
+	{
+		// the listings below it might describe a directory which was moved away
+		for(auto It = m_aIndex[Type].begin(); It != m_aIndex[Type].end();)
+		{
+			if(Key.empty() || It->first == Key || (str_startswith(It->first.c_str(), Key.c_str()) && It->first[Key.size()] == '/'))
+			{
+				It = m_aIndex[Type].erase(It);
+				m_IndexStats.m_NumDirectories--;
+				m_IndexStats.m_Invalidations++;
+			}
+			else
+				++It;
+		}
+	}
+
+	// for changes done through the storage, the watch reports them too late
+	void IndexInvalidateParent(int Type, const char *pPath) REQUIRES(!m_IndexLock)
+	{
+		std::string Key;
+		if(Type <= TYPE_SAVE || !IndexKey(pPath, &Key))
+			return;
+		const size_t Slash = Key.rfind('/');
+		Key.resize(Slash == std::string::npos ? 0 : Slash);
+		CLockScope LockScope(m_IndexLock);
+		IndexInvalidate(Type, Key);
+	}
+
+	void IndexClear() REQUIRES(m_IndexLock)
+	{
+		for(auto &Index : m_aIndex)
+		{
+			m_IndexStats.m_Invalidations += Index.size();
+			Index.clear();
+		}
+		m_IndexStats.m_NumDirectories = 0;
+	}
+
+	static void WatchThread(void *pUser)
+	{
+		CStorage *pSelf = static_cast<CStorage *>(pUser);
+		FS_WATCH_EVENT aEvents[64];
+		while(true)
+		{
+			const int NumEvents = fs_watch_wait(pSelf->m_pWatch, aEvents, sizeof(aEvents) / sizeof(aEvents[0]));
+			if(NumEvents == 0)
+				break;
+
+			CLockScope LockScope(pSelf->m_IndexLock);
+			if(NumEvents < 0)
+			{
+				// without the watch the index can't be trusted anymore
+				dbg_msg("storage", "failed to watch the indexed directories, not indexing anymore");
+				pSelf->IndexClear();
+				pSelf->m_IndexEnabled = false;
+				break;
+			}
+			for(int i = 0; i < NumEvents; i++)
+			{
+				if(aEvents[i].id == FS_WATCH_OVERFLOW)
+				{
+					pSelf->IndexClear();
+					continue;
+				}
+				auto It = pSelf->m_WatchedDirs.find(aEvents[i].id);
+				if(It != pSelf->m_WatchedDirs.end())
+				{
+					for(const auto &Dir : It->second)
+						pSelf->IndexInvalidate(Dir.first, Dir.second);
+					// the kernel dropped the watch, a new one is added when the directory is listed again
+					if(aEvents[i].removed)
+						pSelf->m_WatchedDirs.erase(It);
+				}
+			}
+		}
+	}
+
+	void EnableIndex(bool Enable) REQUIRES(!m_IndexLock) override
+	{
+		if(Enable == (m_pWatch != 0))
+			return;
+
+		if(Enable)
+		{
+			// only the watch keeps the index up to date with changes from outside
+			m_pWatch = fs_watch_create();
+			if(!m_pWatch)
+			{
+				dbg_msg("storage", "can't watch directories on this platform, not indexing the storage paths");
+				return;
+			}
+			{
+				CLockScope LockScope(m_IndexLock);
+				m_IndexEnabled = true;
+			}
+			m_pWatchThread = thread_init(WatchThread, this);
+		}
+		else
+		{
+			{
+				CLockScope LockScope(m_IndexLock);
+				m_IndexEnabled = false;
+				IndexClear();
+				m_WatchedDirs.clear();
+			}
+			fs_watch_wake(m_pWatch);
+			thread_wait(m_pWatchThread);
+			fs_watch_destroy(m_pWatch);
+			m_pWatch = 0;
+			m_pWatchThread = 0;
+		}
+	}
+
+	void RefreshIndex() REQUIRES(!m_IndexLock) override
+	{
+		CLockScope LockScope(m_IndexLock);
+		IndexClear();
+	}
+
+	void GetIndexStats(CIndexStats *pStats) REQUIRES(!m_IndexLock) override
+	{
+		CLockScope LockScope(m_IndexLock);
+		*pStats = m_IndexStats;
+	}
+
+	void ListPath(int Type, const char *pPath, FS_LISTDIR_CALLBACK pfnCallback, void *pUser)
+	{
+		std::shared_ptr<const CIndexDir> pDir;
+		const int Found = IndexFind(Type, pPath, true, &pDir);
+		if(Found == INDEX_UNKNOWN)
+		{
+			char aBuffer[IO_MAX_PATH_LENGTH];
+			fs_listdir(GetPath(Type, pPath, aBuffer, sizeof(aBuffer)), pfnCallback, Type, pUser);
+			return;
+		}
+
+		{
+			CLockScope LockScope(m_IndexLock);
+			m_IndexStats.m_SavedSyscalls++;
+		}
+		if(Found == INDEX_ABSENT)
+			return;
+		// the callback may use the storage, so it's called without holding the lock
+		for(const auto &Entry : pDir->m_vEntries)
+		{
+			if(pfnCallback(Entry.first.c_str(), Entry.second, Type, pUser))
+				break;
+		}
+	}
+
 	void ListDirectory(int Type, const char *pPath, FS_LISTDIR_CALLBACK pfnCallback, void *pUser) override
 	{
-		char aBuffer[IO_MAX_PATH_LENGTH];
 		if(Type == TYPE_ALL)
 		{
 			// list all available directories
 			for(int i = 0; i < m_NumPaths; ++i)
-				fs_listdir(GetPath(i, pPath, aBuffer, sizeof(aBuffer)), pfnCallback, i, pUser);
+				ListPath(i, pPath, pfnCallback, pUser);
 		}
 		else if(Type >= 0 && Type < m_NumPaths)
 		{
 			// list wanted directory
-			fs_listdir(GetPath(Type, pPath, aBuffer, sizeof(aBuffer)), pfnCallback, Type, pUser);
+			ListPath(Type, pPath, pfnCallback, pUser);
 		}
 	}
 
@@ -344,6 +638,12 @@ public:
 
 			for(int i = LB; i < UB; ++i)
 			{
+				if(IndexFind(i, pFilename, false) == INDEX_ABSENT)
+				{
+					CLockScope LockScope(m_IndexLock);
+					m_IndexStats.m_SavedSyscalls++;
+					continue;
+				}
 				Handle = io_open(GetPath(i, pFilename, pBuffer, BufferSize), Flags);
 				if(Handle)
 				{
@@ -411,11 +711,10 @@ public:
 				return 0;
 
 			// search within the folder
-			char aBuf[IO_MAX_PATH_LENGTH];
 			char aPath[IO_MAX_PATH_LENGTH];
 			str_format(aPath, sizeof(aPath), "%s/%s", Data.m_pPath, pName);
 			Data.m_pPath = aPath;
-			fs_listdir(Data.m_pStorage->GetPath(Type, aPath, aBuf, sizeof(aBuf)), FindFileCallback, Type, &Data);
+			Data.m_pStorage->ListPath(Type, aPath, FindFileCallback, &Data);
 			if(Data.m_pBuffer[0])
 				return 1;
 		}
@@ -450,14 +749,12 @@ public:
 
 		pCBData->m_pBuffer[0] = 0;
 
-		char aBuf[IO_MAX_PATH_LENGTH];
-
 		if(Type == TYPE_ALL)
 		{
 			// search within all available directories
 			for(int i = 0; i < m_NumPaths; ++i)
 			{
-				fs_listdir(GetPath(i, pCBData->m_pPath, aBuf, sizeof(aBuf)), FindFileCallback, i, pCBData);
+				ListPath(i, pCBData->m_pPath, FindFileCallback, pCBData);
 				if(pCBData->m_pBuffer[0])
 					return true;
 			}
@@ -465,7 +762,7 @@ public:
 		else if(Type >= 0 && Type < m_NumPaths)
 		{
 			// search within wanted directory
-			fs_listdir(GetPath(Type, pCBData->m_pPath, aBuf, sizeof(aBuf)), FindFileCallback, Type, pCBData);
+			ListPath(Type, pCBData->m_pPath, FindFileCallback, pCBData);
 		}
 
 		return pCBData->m_pBuffer[0] != 0;
@@ -507,7 +804,9 @@ public:
 			return false;
 
 		char aBuffer[IO_MAX_PATH_LENGTH];
-		return !fs_remove(GetPath(Type, pFilename, aBuffer, sizeof(aBuffer)));
+		const bool Success = !fs_remove(GetPath(Type, pFilename, aBuffer, sizeof(aBuffer)));
+		IndexInvalidateParent(Type, pFilename);
+		return Success;
 	}
 
 	bool RenameFile(const char *pOldFilename, const char *pNewFilename, int Type) override
@@ -516,7 +815,10 @@ public:
 			return false;
 		char aOldBuffer[IO_MAX_PATH_LENGTH];
 		char aNewBuffer[IO_MAX_PATH_LENGTH];
-		return !fs_rename(GetPath(Type, pOldFilename, aOldBuffer, sizeof(aOldBuffer)), GetPath(Type, pNewFilename, aNewBuffer, sizeof(aNewBuffer)));
+		const bool Success = !fs_rename(GetPath(Type, pOldFilename, aOldBuffer, sizeof(aOldBuffer)), GetPath(Type, pNewFilename, aNewBuffer, sizeof(aNewBuffer)));
+		IndexInvalidateParent(Type, pOldFilename);
+		IndexInvalidateParent(Type, pNewFilename);
+		return Success;
 	}
 
 	bool CreateFolder(const char *pFoldername, int Type) override
@@ -525,7 +827,9 @@ public:
 			return false;
 
 		char aBuffer[IO_MAX_PATH_LENGTH];
-		return !fs_makedir(GetPath(Type, pFoldername, aBuffer, sizeof(aBuffer)));
+		const bool Success = !fs_makedir(GetPath(Type, pFoldername, aBuffer, sizeof(aBuffer)));
+		IndexInvalidateParent(Type, pFoldername);
+		return Success;
 	}
 
 	void GetCompletePath(int Type, const char *pDir, char *pBuffer, unsigned BufferSize) override
@@ -22,6 +22,16 @@ public:
 
 	typedef bool (*FCheckCallback)(IOHANDLE Handle, const void *pUserData);
 
+	struct CIndexStats
+	{
+		int m_NumDirectories; // directories listed in the index
+		int64 m_Lookups; // names resolved through the index
+		int64 m_Hits; // lookups which didn't have to list a directory
+		int64 m_SavedSyscalls; // opens and directory listings that were skipped
+		int64 m_Invalidations; // directories dropped because they changed
+		int64 m_WatchFailures; // directories that couldn't be watched and weren't indexed
+	};
+
 	virtual void ListDirectory(int Type, const char *pPath, FS_LISTDIR_CALLBACK pfnCallback, void *pUser) = 0;
 	virtual void ListDirectoryFileInfo(int Type, const char *pPath, FS_LISTDIR_CALLBACK_FILEINFO pfnCallback, void *pUser) = 0;
 	virtual IOHANDLE OpenFile(const char *pFilename, int Flags, int Type, char *pBuffer = 0, int BufferSize = 0, FCheckCallback pfnCheckCB = 0, const void *pCheckCBData = 0) = 0;
@@ -37,6 +47,11 @@ public:
 	virtual bool GetFileTime(const char *pFilename, int StorageType, time_t *pCreated, time_t *pModified) = 0;
 
 	virtual const char *GetBinaryPath(const char *pFilename, char *pBuffer, unsigned BufferSize) = 0;
+
+	// the read-only paths can be indexed, so missing files are known without asking the filesystem
+	virtual void EnableIndex(bool Enable) = 0;
+	virtual void RefreshIndex() = 0;
+	virtual void GetIndexStats(CIndexStats *pStats) = 0;
 	static const char *FormatTmpPath(char *aBuf, unsigned BufSize, const char *pPath);
 };
 
@@ -8,6 +8,7 @@
 
 #include <engine/config.h>
 #include <engine/contacts.h>
+#include <engine/demo.h>
 #include <engine/editor.h>
 #include <engine/engine.h>
 #include <engine/keys.h>
@@ -1461,6 +1462,11 @@ void CMenus::RenderMenu(CUIRect Screen)
 						str_format(aPathNew, sizeof(aPathNew), "%s/%s", m_aCurrentDemoFolder, m_DemoNameInput.GetString());
 						if(Storage()->RenameFile(aBufOld, aPathNew, m_lDemos[m_DemolistSelectedIndex].m_StorageType))
 						{
+							char aIndexOld[IO_MAX_PATH_LENGTH];
+							char aIndexNew[IO_MAX_PATH_LENGTH];
+							DemoIndexFilename(aBufOld, aIndexOld, sizeof(aIndexOld));
+							DemoIndexFilename(aPathNew, aIndexNew, sizeof(aIndexNew));
+							Storage()->RenameFile(aIndexOld, aIndexNew, m_lDemos[m_DemolistSelectedIndex].m_StorageType);
 							str_copy(m_aDemolistPreviousSelection, m_DemoNameInput.GetString(), sizeof(m_aDemolistPreviousSelection));
 							DemolistPopulate();
 							DemolistOnUpdate(false);
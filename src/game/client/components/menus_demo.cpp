@@ -736,6 +736,9 @@ void CMenus::PopupConfirmDeleteDemo()
 		str_format(aBuf, sizeof(aBuf), "%s/%s", m_aCurrentDemoFolder, m_lDemos[m_DemolistSelectedIndex].m_aFilename);
 		if(Storage()->RemoveFile(aBuf, m_lDemos[m_DemolistSelectedIndex].m_StorageType))
 		{
+			char aIndex[IO_MAX_PATH_LENGTH];
+			DemoIndexFilename(aBuf, aIndex, sizeof(aIndex));
+			Storage()->RemoveFile(aIndex, m_lDemos[m_DemolistSelectedIndex].m_StorageType);
 			DemolistPopulate();
 			DemolistOnUpdate(false);
 		}
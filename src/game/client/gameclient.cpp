@@ -1568,6 +1568,8 @@ void CGameClient::OnPredict()
 		Tick <= Client()->PredGameTick();
 		Tick++)
 	{
+		World.UpdateBroadphase();
+
 		// first calculate where everyone should move
 		for(int c = 0; c < MAX_CLIENTS; c++)
 		{
@@ -10,6 +10,7 @@
 
 #include <game/collision.h>
 #include <game/layers.h>
+#include <game/mapcache.h>
 #include <game/mapitems.h>
 
 CCollision::CCollision()
@@ -18,9 +19,13 @@ CCollision::CCollision()
 	m_Width = 0;
 	m_Height = 0;
 	m_pLayers = 0;
+	m_BitplaneStride = 0;
+	for(int i = 0; i < NUM_BITPLANES; i++)
+		m_apBitplanes[i] = 0;
+	m_pDistanceField = 0;
 }
 
-void CCollision::Init(class CLayers *pLayers)
+void CCollision::Init(class CLayers *pLayers, bool DistanceField, CMapCache *pCache)
 {
 	m_pLayers = pLayers;
 	m_Width = m_pLayers->GameLayer()->m_Width;
@@ -50,6 +55,117 @@ void CCollision::Init(class CLayers *pLayers)
 				m_pTiles[i].m_Index = 0;
 		}
 	}
+
+	if(pCache && pCache->HasCollision(m_Width, m_Height, NUM_BITPLANES))
+	{
+		for(int i = 0; i < NUM_BITPLANES; i++)
+		{
+			m_avBitplanes[i].clear();
+			m_apBitplanes[i] = pCache->Bitplane(i);
+		}
+		m_vDistanceField.clear();
+		m_BitplaneStride = pCache->BitplaneStride();
+		m_pDistanceField = DistanceField ? pCache->DistanceField() : 0;
+		return;
+	}
+
+	BuildBitplanes();
+	m_vDistanceField.clear();
+	if(DistanceField || pCache)
+		BuildDistanceField();
+	if(pCache)
+		pCache->SetCollision(m_Width, m_Height, NUM_BITPLANES, m_BitplaneStride, m_avBitplanes, m_vDistanceField);
+	if(!DistanceField)
+		m_vDistanceField.clear();
+	m_pDistanceField = m_vDistanceField.empty() ? 0 : m_vDistanceField.data();
+}
+
+void CCollision::BuildBitplanes()
+{
+	m_BitplaneStride = (m_Width + 31) / 32;
+	for(int i = 0; i < NUM_BITPLANES; i++)
+	{
+		m_avBitplanes[i].assign(m_BitplaneStride * m_Height, 0);
+		m_apBitplanes[i] = m_avBitplanes[i].data();
+	}
+
+	for(int y = 0; y < m_Height; y++)
+	{
+		for(int x = 0; x < m_Width; x++)
+		{
+			int Index = m_pTiles[y * m_Width + x].m_Index;
+			if(Index > 128)
+				continue;
+			for(int i = 0; i < NUM_BITPLANES; i++)
+			{
+				if(Index & (1 << i))
+					m_avBitplanes[i][y * m_BitplaneStride + x / 32] |= 1u << (x % 32);
+			}
+		}
+	}
+}
+
+// two pass chamfer transform, with unit weights for all 8 neighbours this is exact for the chebyshev metric
+void CCollision::BuildDistanceField()
+{
+	m_vDistanceField.resize(m_Width * m_Height);
+	for(int y = 0; y < m_Height; y++)
+	{
+		for(int x = 0; x < m_Width; x++)
+			m_vDistanceField[y * m_Width + x] = IsBitSet(x, y, COLFLAG_SOLID) ? 0 : MAX_DISTANCE;
+	}
+
+	const int aForward[4][2] = {{-1, 0}, {-1, -1}, {0, -1}, {1, -1}};
+	for(int y = 0; y < m_Height; y++)
+	{
+		for(int x = 0; x < m_Width; x++)
+		{
+			int Distance = m_vDistanceField[y * m_Width + x];
+			for(const auto &Offset : aForward)
+			{
+				int Nx = x + Offset[0], Ny = y + Offset[1];
+				if(Nx >= 0 && Nx < m_Width && Ny >= 0)
+					Distance = minimum(Distance, m_vDistanceField[Ny * m_Width + Nx] + 1);
+			}
+			m_vDistanceField[y * m_Width + x] = Distance;
+		}
+	}
+
+	for(int y = m_Height - 1; y >= 0; y--)
+	{
+		for(int x = m_Width - 1; x >= 0; x--)
+		{
+			int Distance = m_vDistanceField[y * m_Width + x];
+			for(const auto &Offset : aForward)
+			{
+				int Nx = x - Offset[0], Ny = y - Offset[1];
+				if(Nx >= 0 && Nx < m_Width && Ny < m_Height)
+					Distance = minimum(Distance, m_vDistanceField[Ny * m_Width + Nx] + 1);
+			}
+			m_vDistanceField[y * m_Width + x] = Distance;
+		}
+	}
+}
+
+// the memory of a map cache is shared and not counted
+int CCollision::MemoryUsage() const
+{
+	int Size = m_vDistanceField.size();
+	for(const auto &vBitplane : m_avBitplanes)
+		Size += vBitplane.size() * sizeof(unsigned);
+	return Size;
+}
+
+bool CCollision::IsBitSet(int x, int y, int Flag) const
+{
+	const int Word = y * m_BitplaneStride + x / 32;
+	const unsigned Bit = 1u << (x % 32);
+	for(int i = 0; i < NUM_BITPLANES; i++)
+	{
+		if((Flag & (1 << i)) && (m_apBitplanes[i][Word] & Bit))
+			return true;
+	}
+	return false;
 }
 
 int CCollision::GetTile(int x, int y) const
@@ -62,17 +178,91 @@ int CCollision::GetTile(int x, int y) const
 
 bool CCollision::IsTile(int x, int y, int Flag) const
 {
-	return GetTile(x, y) & Flag;
+	if(Flag & ~(COLFLAG_SOLID | COLFLAG_DEATH | COLFLAG_NOHOOK))
+		return GetTile(x, y) & Flag;
+
+	return IsBitSet(clamp(x / 32, 0, m_Width - 1), clamp(y / 32, 0, m_Height - 1), Flag);
+}
+
+int CCollision::GetTileIndex(vec2 Pos) const
+{
+	int Nx = clamp(round_to_int(Pos.x) / 32, 0, m_Width - 1);
+	int Ny = clamp(round_to_int(Pos.y) / 32, 0, m_Height - 1);
+	return Ny * m_Width + Nx;
+}
+
+// the samples of IntersectLine move monotonically through the tiles, so the samples of
+// one tile form a single run. the end of the run is estimated from the distance to the
+// next tile border (like the tMax of a grid traversal) and then searched exactly.
+int CCollision::LastSampleInTile(vec2 Pos0, vec2 Pos1, float InverseEnd, int First, int End) const
+{
+	const vec2 FirstPos = mix(Pos0, Pos1, First * InverseEnd);
+	const int Tile = GetTileIndex(FirstPos);
+	const vec2 Step = (Pos1 - Pos0) * InverseEnd;
+
+	float Samples = (float) End;
+	if(Step.x > 0.0f)
+		Samples = minimum(Samples, ((Tile % m_Width) * 32 + 31.5f - FirstPos.x) / Step.x);
+	else if(Step.x < 0.0f)
+		Samples = minimum(Samples, ((Tile % m_Width) * 32 - 0.5f - FirstPos.x) / Step.x);
+	if(Step.y > 0.0f)
+		Samples = minimum(Samples, ((Tile / m_Width) * 32 + 31.5f - FirstPos.y) / Step.y);
+	else if(Step.y < 0.0f)
+		Samples = minimum(Samples, ((Tile / m_Width) * 32 - 0.5f - FirstPos.y) / Step.y);
+
+	int Lo = First;
+	int Hi = End + 1;
+	int Probe = clamp(First + (int) maximum(Samples, 0.0f), First, End);
+	if(Probe == First || GetTileIndex(mix(Pos0, Pos1, Probe * InverseEnd)) == Tile)
+	{
+		// gallop forward until the run is left
+		Lo = Probe;
+		for(int Dist = 1; Lo < End; Dist *= 2)
+		{
+			Probe = minimum(Lo + Dist, End);
+			if(GetTileIndex(mix(Pos0, Pos1, Probe * InverseEnd)) != Tile)
+			{
+				Hi = Probe;
+				break;
+			}
+			Lo = Probe;
+		}
+	}
+	else
+	{
+		// gallop backward until the run is entered again
+		Hi = Probe;
+		for(int Dist = 1;; Dist *= 2)
+		{
+			Probe = maximum(Hi - Dist, First);
+			if(Probe == First || GetTileIndex(mix(Pos0, Pos1, Probe * InverseEnd)) == Tile)
+			{
+				Lo = Probe;
+				break;
+			}
+			Hi = Probe;
+		}
+	}
+
+	while(Hi - Lo > 1)
+	{
+		int Mid = Lo + (Hi - Lo) / 2;
+		if(GetTileIndex(mix(Pos0, Pos1, Mid * InverseEnd)) == Tile)
+			Lo = Mid;
+		else
+			Hi = Mid;
+	}
+	return Lo;
 }
 
-// TODO: rewrite this smarter!
 int CCollision::IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const
 {
 	const int End = distance(Pos0, Pos1) + 1;
 	const float InverseEnd = 1.0f / End;
-	vec2 Last = Pos0;
+	const float MaxStep = maximum(absolute(Pos1.x - Pos0.x), absolute(Pos1.y - Pos0.y)) * InverseEnd;
 
-	for(int i = 0; i <= End; i++)
+	// only test the first sample of every tile the line crosses
+	for(int i = 0; i <= End;)
 	{
 		vec2 Pos = mix(Pos0, Pos1, i * InverseEnd);
 		if(CheckPoint(Pos.x, Pos.y))
@@ -80,10 +270,22 @@ int CCollision::IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *p
 			if(pOutCollision)
 				*pOutCollision = Pos;
 			if(pOutBeforeCollision)
-				*pOutBeforeCollision = Last;
+				*pOutBeforeCollision = i > 0 ? mix(Pos0, Pos1, (i - 1) * InverseEnd) : Pos0;
 			return GetCollisionAt(Pos.x, Pos.y);
 		}
-		Last = Pos;
+
+		// every sample less than Distance - 1 tiles away is free, keep a margin for rounding
+		const int Distance = GetDistance(GetTileIndex(Pos));
+		if(Distance > 2 && MaxStep > 0.0f)
+		{
+			const int Skip = ((Distance - 2) * 32 - 2) / MaxStep;
+			if(Skip > 1)
+			{
+				i += Skip;
+				continue;
+			}
+		}
+		i = LastSampleInTile(Pos0, Pos1, InverseEnd, i, End) + 1;
 	}
 	if(pOutCollision)
 		*pOutCollision = Pos1;
@@ -131,17 +333,62 @@ void CCollision::MovePoint(vec2 *pInoutPos, vec2 *pInoutVel, float Elasticity, i
 	}
 }
 
+bool CCollision::IsBoxFree(vec2 Min, vec2 Max, int Flag, int MaxTiles) const
+{
+	const int MinTile = GetTileIndex(Min);
+	const int MaxTile = GetTileIndex(Max);
+	if((MaxTile / m_Width - MinTile / m_Width + 1) * (MaxTile % m_Width - MinTile % m_Width + 1) > MaxTiles)
+		return false;
+
+	const int MinX = MinTile % m_Width;
+	const int MaxX = MaxTile % m_Width;
+	for(int y = MinTile / m_Width; y <= MaxTile / m_Width; y++)
+	{
+		for(int Word = MinX / 32; Word <= MaxX / 32; Word++)
+		{
+			unsigned Mask = ~0u;
+			if(Word == MinX / 32)
+				Mask &= ~0u << (MinX % 32);
+			if(Word == MaxX / 32)
+				Mask &= ~0u >> (31 - MaxX % 32);
+
+			unsigned Bits = 0;
+			for(int i = 0; i < NUM_BITPLANES; i++)
+			{
+				if(Flag & (1 << i))
+					Bits |= m_apBitplanes[i][y * m_BitplaneStride + Word];
+			}
+			if(Bits & Mask)
+				return false;
+		}
+	}
+	return true;
+}
+
 bool CCollision::TestBox(vec2 Pos, vec2 Size, int Flag) const
 {
 	Size *= 0.5f;
-	if(CheckPoint(Pos.x - Size.x, Pos.y - Size.y, Flag))
-		return true;
-	if(CheckPoint(Pos.x + Size.x, Pos.y - Size.y, Flag))
-		return true;
-	if(CheckPoint(Pos.x - Size.x, Pos.y + Size.y, Flag))
-		return true;
-	if(CheckPoint(Pos.x + Size.x, Pos.y + Size.y, Flag))
-		return true;
+	if(Flag & ~(COLFLAG_SOLID | COLFLAG_DEATH | COLFLAG_NOHOOK))
+	{
+		return CheckPoint(Pos.x - Size.x, Pos.y - Size.y, Flag) || CheckPoint(Pos.x + Size.x, Pos.y - Size.y, Flag) ||
+		       CheckPoint(Pos.x - Size.x, Pos.y + Size.y, Flag) || CheckPoint(Pos.x + Size.x, Pos.y + Size.y, Flag);
+	}
+
+	// the four corners touch at most two rows and two columns of the bitplanes
+	const int x0 = clamp(round_to_int(Pos.x - Size.x) / 32, 0, m_Width - 1);
+	const int x1 = clamp(round_to_int(Pos.x + Size.x) / 32, 0, m_Width - 1);
+	const int y0 = clamp(round_to_int(Pos.y - Size.y) / 32, 0, m_Height - 1);
+	const int y1 = clamp(round_to_int(Pos.y + Size.y) / 32, 0, m_Height - 1);
+	const unsigned Bit0 = 1u << (x0 % 32), Bit1 = 1u << (x1 % 32);
+	for(int i = 0; i < NUM_BITPLANES; i++)
+	{
+		if(!(Flag & (1 << i)))
+			continue;
+		const unsigned *pRow0 = &m_apBitplanes[i][y0 * m_BitplaneStride];
+		const unsigned *pRow1 = &m_apBitplanes[i][y1 * m_BitplaneStride];
+		if((pRow0[x0 / 32] & Bit0) | (pRow0[x1 / 32] & Bit1) | (pRow1[x0 / 32] & Bit0) | (pRow1[x1 / 32] & Bit1))
+			return true;
+	}
 	return false;
 }
 
@@ -160,6 +407,25 @@ void CCollision::MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elas
 	if(Distance > 0.00001f)
 	{
 		const float Fraction = 1.0f / (Max + 1);
+
+		// most moves don't touch anything, so walk the free path first and only
+		// fall back to testing every step when the swept box contains a tile
+		vec2 FreePos = Pos;
+		vec2 SweptMin = Pos;
+		vec2 SweptMax = Pos;
+		for(int i = 0; i <= Max; i++)
+		{
+			FreePos = FreePos + Vel * Fraction;
+			SweptMin = vec2(minimum(SweptMin.x, FreePos.x), minimum(SweptMin.y, FreePos.y));
+			SweptMax = vec2(maximum(SweptMax.x, FreePos.x), maximum(SweptMax.y, FreePos.y));
+		}
+		if(IsBoxFree(SweptMin - Size * 0.5f, SweptMax + Size * 0.5f, pDeath ? COLFLAG_SOLID | COLFLAG_DEATH : COLFLAG_SOLID, 4 * (Max + 1)))
+		{
+			*pInoutPos = FreePos;
+			*pInoutVel = Vel;
+			return;
+		}
+
 		for(int i = 0; i <= Max; i++)
 		{
 			vec2 NewPos = Pos + Vel * Fraction; // TODO: this row is not nice
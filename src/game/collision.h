@@ -5,15 +5,40 @@
 
 #include <base/vmath.h>
 
+#include <vector>
+
 class CCollision
 {
+	enum
+	{
+		NUM_BITPLANES = 3,
+		MAX_DISTANCE = 255,
+	};
+
 	struct CTile *m_pTiles;
 	int m_Width;
 	int m_Height;
 	class CLayers *m_pLayers;
 
+	// one bit per tile and collision flag, rows are padded to whole words
+	int m_BitplaneStride;
+	std::vector<unsigned> m_avBitplanes[NUM_BITPLANES];
+	// chebyshev distance in tiles to the nearest solid tile, saturated at MAX_DISTANCE
+	std::vector<unsigned char> m_vDistanceField;
+	// the data in use, either the vectors above or a loaded map cache
+	const unsigned *m_apBitplanes[NUM_BITPLANES];
+	const unsigned char *m_pDistanceField;
+
+	void BuildBitplanes();
+	void BuildDistanceField();
+	bool IsBitSet(int x, int y, int Flag) const;
+	int GetDistance(int Index) const { return m_pDistanceField ? m_pDistanceField[Index] : 0; }
+
 	bool IsTile(int x, int y, int Flag = COLFLAG_SOLID) const;
 	int GetTile(int x, int y) const;
+	int GetTileIndex(vec2 Pos) const;
+	int LastSampleInTile(vec2 Pos0, vec2 Pos1, float InverseEnd, int First, int End) const;
+	bool IsBoxFree(vec2 Min, vec2 Max, int Flag, int MaxTiles) const;
 
 public:
 	enum
@@ -24,12 +49,15 @@ public:
 	};
 
 	CCollision();
-	void Init(class CLayers *pLayers);
+	// uses the data of the map cache if it has any, otherwise adds it
+	void Init(class CLayers *pLayers, bool DistanceField = true, class CMapCache *pCache = 0);
 	bool CheckPoint(float x, float y, int Flag = COLFLAG_SOLID) const { return IsTile(round_to_int(x), round_to_int(y), Flag); }
 	bool CheckPoint(vec2 Pos, int Flag = COLFLAG_SOLID) const { return CheckPoint(Pos.x, Pos.y, Flag); }
 	int GetCollisionAt(float x, float y) const { return GetTile(round_to_int(x), round_to_int(y)); }
 	int GetWidth() const { return m_Width; }
 	int GetHeight() const { return m_Height; }
+	int GetSolidDistance(vec2 Pos) const { return GetDistance(GetTileIndex(Pos)); }
+	int MemoryUsage() const;
 	int IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const;
 	void MovePoint(vec2 *pInoutPos, vec2 *pInoutVel, float Elasticity, int *pBounces) const;
 	void MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elasticity, bool *pDeath = 0) const;
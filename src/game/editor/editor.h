@@ -396,7 +396,7 @@ public:
 	void CreateDefault();
 
 	// io
-	int Save(class IStorage *pStorage, const char *pFilename);
+	int Save(class IStorage *pStorage, const char *pFilename, class IEngine *pEngine = 0);
 	int Load(class IStorage *pStorage, const char *pFilename, int StorageType);
 };
 
@@ -62,6 +62,117 @@ float VelocityRamp(float Value, float Start, float Range, float Curvature)
 	return 1.0f / powf(Curvature, (Value - Start) / Range);
 }
 
+static ivec2 BroadphaseCellOf(vec2 Pos, float CellSize)
+{
+	return ivec2((int) floorf(clamp(Pos.x / CellSize, -1e6f, 1e6f)), (int) floorf(clamp(Pos.y / CellSize, -1e6f, 1e6f)));
+}
+
+void CWorldCore::BroadphaseLink(int ClientID)
+{
+	const ivec2 Cell = BroadphaseCellOf(m_apCharacters[ClientID]->m_Pos, BROADPHASE_CELLSIZE);
+	const int Bucket = BroadphaseHash(Cell.x, Cell.y);
+
+	m_aBroadphaseCell[ClientID] = Cell;
+	m_aBroadphasePrev[ClientID] = -1;
+	m_aBroadphaseNext[ClientID] = m_aBroadphaseBucket[Bucket];
+	if(m_aBroadphaseBucket[Bucket] != -1)
+		m_aBroadphasePrev[m_aBroadphaseBucket[Bucket]] = ClientID;
+	m_aBroadphaseBucket[Bucket] = ClientID;
+	m_aBroadphaseLinked[ClientID] = true;
+}
+
+void CWorldCore::BroadphaseUnlink(int ClientID)
+{
+	if(!m_aBroadphaseLinked[ClientID])
+		return;
+
+	const int Prev = m_aBroadphasePrev[ClientID];
+	const int Next = m_aBroadphaseNext[ClientID];
+	if(Prev != -1)
+		m_aBroadphaseNext[Prev] = Next;
+	else
+		m_aBroadphaseBucket[BroadphaseHash(m_aBroadphaseCell[ClientID].x, m_aBroadphaseCell[ClientID].y)] = Next;
+	if(Next != -1)
+		m_aBroadphasePrev[Next] = Prev;
+	m_aBroadphaseLinked[ClientID] = false;
+}
+
+void CWorldCore::UpdateBroadphase()
+{
+	for(int i = 0; i < BROADPHASE_NUM_BUCKETS; i++)
+		m_aBroadphaseBucket[i] = -1;
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		m_aBroadphaseLinked[i] = false;
+		if(m_apCharacters[i])
+			BroadphaseLink(i);
+	}
+	m_BroadphaseValid = true;
+}
+
+void CWorldCore::UpdateCharacter(const CCharacterCore *pCore)
+{
+	if(!m_BroadphaseValid)
+		return;
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(m_apCharacters[i] == pCore)
+		{
+			BroadphaseUnlink(i);
+			BroadphaseLink(i);
+			return;
+		}
+	}
+}
+
+void CWorldCore::QueryCharacters(vec2 Min, vec2 Max, unsigned *pMask) const
+{
+	mem_zero(pMask, sizeof(unsigned) * CHARACTER_MASK_SIZE);
+	if(!m_BroadphaseValid)
+	{
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			if(m_apCharacters[i])
+				pMask[i / 32] |= 1u << (i % 32);
+		}
+		return;
+	}
+
+	// the slack covers the quantization of the cores after they were linked
+	const ivec2 MinCell = BroadphaseCellOf(Min - vec2(1.0f, 1.0f), BROADPHASE_CELLSIZE);
+	const ivec2 MaxCell = BroadphaseCellOf(Max + vec2(1.0f, 1.0f), BROADPHASE_CELLSIZE);
+	const int64 NumCells = (int64) (MaxCell.x - MinCell.x + 1) * (MaxCell.y - MinCell.y + 1);
+
+	if(NumCells > BROADPHASE_NUM_BUCKETS)
+	{
+		// large boxes are cheaper to test against every linked core
+		for(int b = 0; b < BROADPHASE_NUM_BUCKETS; b++)
+		{
+			for(int i = m_aBroadphaseBucket[b]; i != -1; i = m_aBroadphaseNext[i])
+			{
+				const ivec2 Cell = m_aBroadphaseCell[i];
+				if(Cell.x >= MinCell.x && Cell.x <= MaxCell.x && Cell.y >= MinCell.y && Cell.y <= MaxCell.y)
+					pMask[i / 32] |= 1u << (i % 32);
+			}
+		}
+		return;
+	}
+
+	for(int y = MinCell.y; y <= MaxCell.y; y++)
+	{
+		for(int x = MinCell.x; x <= MaxCell.x; x++)
+		{
+			for(int i = m_aBroadphaseBucket[BroadphaseHash(x, y)]; i != -1; i = m_aBroadphaseNext[i])
+			{
+				if(m_aBroadphaseCell[i].x == x && m_aBroadphaseCell[i].y == y)
+					pMask[i / 32] |= 1u << (i % 32);
+			}
+		}
+	}
+}
+
 const float CCharacterCore::PHYS_SIZE = 28.0f;
 
 void CCharacterCore::Init(CWorldCore *pWorld, CCollision *pCollision)
@@ -204,9 +315,17 @@ void CCharacterCore::Tick(bool UseInput)
 		// Check against other players first
 		if(m_pWorld && m_pWorld->m_Tuning.m_PlayerHooking)
 		{
+			const vec2 Radius(PHYS_SIZE + 2.0f, PHYS_SIZE + 2.0f);
+			unsigned aMask[CWorldCore::CHARACTER_MASK_SIZE];
+			m_pWorld->QueryCharacters(vec2(minimum(m_HookPos.x, NewPos.x), minimum(m_HookPos.y, NewPos.y)) - Radius,
+				vec2(maximum(m_HookPos.x, NewPos.x), maximum(m_HookPos.y, NewPos.y)) + Radius, aMask);
+
 			float Distance = 0.0f;
 			for(int i = 0; i < MAX_CLIENTS; i++)
 			{
+				if(!(aMask[i / 32] & (1u << (i % 32))))
+					continue;
+
 				CCharacterCore *pCharCore = m_pWorld->m_apCharacters[i];
 				if(!pCharCore || pCharCore == this)
 					continue;
@@ -298,8 +417,18 @@ void CCharacterCore::Tick(bool UseInput)
 
 	if(m_pWorld)
 	{
+		// only cores in collision range or the hooked one can influence us
+		const vec2 Radius(PHYS_SIZE * 1.25f, PHYS_SIZE * 1.25f);
+		unsigned aMask[CWorldCore::CHARACTER_MASK_SIZE];
+		m_pWorld->QueryCharacters(m_Pos - Radius, m_Pos + Radius, aMask);
+		if(m_HookedPlayer >= 0 && m_HookedPlayer < MAX_CLIENTS)
+			aMask[m_HookedPlayer / 32] |= 1u << (m_HookedPlayer % 32);
+
 		for(int i = 0; i < MAX_CLIENTS; i++)
 		{
+			if(!(aMask[i / 32] & (1u << (i % 32))))
+				continue;
+
 			CCharacterCore *pCharCore = m_pWorld->m_apCharacters[i];
 			if(!pCharCore)
 				continue;
@@ -377,19 +506,32 @@ void CCharacterCore::Move()
 
 	if(m_pWorld->m_Tuning.m_PlayerCollision)
 	{
+		// only step against the cores near the path
+		const vec2 Radius(PHYS_SIZE, PHYS_SIZE);
+		unsigned aMask[CWorldCore::CHARACTER_MASK_SIZE];
+		m_pWorld->QueryCharacters(vec2(minimum(m_Pos.x, NewPos.x), minimum(m_Pos.y, NewPos.y)) - Radius,
+			vec2(maximum(m_Pos.x, NewPos.x), maximum(m_Pos.y, NewPos.y)) + Radius, aMask);
+
+		CCharacterCore *apCandidates[MAX_CLIENTS];
+		int NumCandidates = 0;
+		for(int p = 0; p < MAX_CLIENTS; p++)
+		{
+			CCharacterCore *pCharCore = m_pWorld->m_apCharacters[p];
+			if((aMask[p / 32] & (1u << (p % 32))) && pCharCore && pCharCore != this)
+				apCandidates[NumCandidates++] = pCharCore;
+		}
+
 		// check player collision
 		float Distance = distance(m_Pos, NewPos);
-		int End = Distance + 1;
+		int End = NumCandidates ? Distance + 1 : 0;
 		vec2 LastPos = m_Pos;
 		for(int i = 0; i < End; i++)
 		{
 			float a = i / Distance;
 			vec2 Pos = mix(m_Pos, NewPos, a);
-			for(int p = 0; p < MAX_CLIENTS; p++)
+			for(int c = 0; c < NumCandidates; c++)
 			{
-				CCharacterCore *pCharCore = m_pWorld->m_apCharacters[p];
-				if(!pCharCore || pCharCore == this)
-					continue;
+				CCharacterCore *pCharCore = apCandidates[c];
 				float D = distance(Pos, pCharCore->m_Pos);
 				if(D < PHYS_SIZE && D >= 0.0f)
 				{
@@ -397,6 +539,7 @@ void CCharacterCore::Move()
 						m_Pos = LastPos;
 					else if(distance(NewPos, pCharCore->m_Pos) > D)
 						m_Pos = NewPos;
+					m_pWorld->UpdateCharacter(this);
 					return;
 				}
 			}
@@ -405,6 +548,7 @@ void CCharacterCore::Move()
 	}
 
 	m_Pos = NewPos;
+	m_pWorld->UpdateCharacter(this);
 }
 
 void CCharacterCore::Write(CNetObj_CharacterCore *pObjCore) const
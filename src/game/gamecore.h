@@ -141,14 +141,61 @@ enum
 
 class CWorldCore
 {
+	enum
+	{
+		BROADPHASE_CELLSIZE = 64,
+		BROADPHASE_NUM_BUCKETS = 256,
+	};
+
+	// hashed uniform grid over the registered cores, indexed by client id
+	bool m_BroadphaseValid;
+	int m_aBroadphaseBucket[BROADPHASE_NUM_BUCKETS];
+	int m_aBroadphaseNext[MAX_CLIENTS];
+	int m_aBroadphasePrev[MAX_CLIENTS];
+	ivec2 m_aBroadphaseCell[MAX_CLIENTS];
+	bool m_aBroadphaseLinked[MAX_CLIENTS];
+
+	static int BroadphaseHash(int x, int y) { return ((x * 73856093) ^ (y * 19349663)) & (BROADPHASE_NUM_BUCKETS - 1); }
+	void BroadphaseLink(int ClientID);
+	void BroadphaseUnlink(int ClientID);
+
 public:
+	enum
+	{
+		CHARACTER_MASK_SIZE = MAX_CLIENTS / 32,
+	};
+
 	CWorldCore()
 	{
 		mem_zero(m_apCharacters, sizeof(m_apCharacters));
+		m_BroadphaseValid = false;
 	}
 
 	CTuningParams m_Tuning;
 	class CCharacterCore *m_apCharacters[MAX_CLIENTS];
+
+	/*
+		Function: UpdateBroadphase
+			Rebuilds the broadphase from m_apCharacters. Has to be called
+			once per tick before the cores are ticked. Until it is called,
+			queries return every registered core.
+	*/
+	void UpdateBroadphase();
+
+	/*
+		Function: UpdateCharacter
+			Moves a registered core to the cell of its current position.
+			Has to be called whenever the position of a core changes
+			by more than a unit after the broadphase was built.
+	*/
+	void UpdateCharacter(const class CCharacterCore *pCore);
+
+	/*
+		Function: QueryCharacters
+			Sets the bit of every client id whose core may lie inside
+			the box. The result is a superset, callers do the exact test.
+	*/
+	void QueryCharacters(vec2 Min, vec2 Max, unsigned *pMask) const;
 };
 
 class CCharacterCore
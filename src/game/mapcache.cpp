@@ -0,0 +1,208 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include <engine/engine.h>
+#include <engine/storage.h>
+
+#include "mapcache.h"
+
+// the cache is only read by the machine which wrote it
+static const int BYTE_ORDER_MARK = 0x01020304;
+
+// write to a temporary file first, so other servers never map a partial cache
+static void WriteCache(IStorage *pStorage, const char *pFilename, const std::vector<char> &vData)
+{
+	char aTmpFilename[IO_MAX_PATH_LENGTH + 4];
+	str_format(aTmpFilename, sizeof(aTmpFilename), "%s.tmp", pFilename);
+	pStorage->CreateFolder("mapcache", IStorage::TYPE_SAVE);
+	IOHANDLE File = pStorage->OpenFile(aTmpFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+	{
+		dbg_msg("mapcache", "failed to open '%s' for writing", aTmpFilename);
+		return;
+	}
+	bool Written = io_write(File, vData.data(), vData.size()) == vData.size();
+	io_close(File);
+	if(!Written || !pStorage->RenameFile(aTmpFilename, pFilename, IStorage::TYPE_SAVE))
+	{
+		dbg_msg("mapcache", "failed to write '%s'", pFilename);
+		pStorage->RemoveFile(aTmpFilename, IStorage::TYPE_SAVE);
+	}
+}
+
+class CMapCacheSaveJob : public IJob
+{
+	IStorage *m_pStorage;
+	char m_aFilename[IO_MAX_PATH_LENGTH];
+	std::vector<char> m_vData;
+
+	void Run() override
+	{
+		WriteCache(m_pStorage, m_aFilename, m_vData);
+	}
+
+public:
+	CMapCacheSaveJob(IStorage *pStorage, const char *pFilename, std::vector<char> &&vData) :
+		m_pStorage(pStorage), m_vData(std::move(vData))
+	{
+		str_copy(m_aFilename, pFilename, sizeof(m_aFilename));
+	}
+};
+
+CMapCache::CMapCache()
+{
+	m_pMappedFile = 0;
+	m_MappedSize = 0;
+	Unload();
+}
+
+CMapCache::~CMapCache()
+{
+	Unload();
+}
+
+void CMapCache::GetPath(const SHA256_DIGEST &MapSha256, char *pBuffer, int BufferSize)
+{
+	char aSha256[SHA256_MAXSTRSIZE];
+	sha256_str(MapSha256, aSha256, sizeof(aSha256));
+	str_format(pBuffer, BufferSize, "mapcache/%s.cache", aSha256);
+}
+
+void CMapCache::Unload()
+{
+	io_unmap(m_pMappedFile, m_MappedSize);
+	m_pMappedFile = 0;
+	m_MappedSize = 0;
+
+	m_HasCollision = false;
+	m_Width = 0;
+	m_Height = 0;
+	m_NumBitplanes = 0;
+	m_BitplaneStride = 0;
+	m_pBitplanes = 0;
+	m_pDistanceField = 0;
+	m_pTileEntities = 0;
+	m_NumTileEntities = 0;
+	m_vBitplanes.clear();
+	m_vDistanceField.clear();
+	m_vTileEntities.clear();
+}
+
+bool CMapCache::Load(IStorage *pStorage, const SHA256_DIGEST &MapSha256)
+{
+	Unload();
+
+	char aFilename[IO_MAX_PATH_LENGTH];
+	GetPath(MapSha256, aFilename, sizeof(aFilename));
+	IOHANDLE File = pStorage->OpenFile(aFilename, IOFLAG_READ, IStorage::TYPE_SAVE);
+	if(!File)
+		return false;
+	long int Size = 0;
+	void *pData = io_map(File, &Size);
+	io_close(File);
+	if(!pData)
+		return false;
+
+	// everything has to fit exactly, otherwise the cache is stale
+	const CHeader *pHeader = static_cast<const CHeader *>(pData);
+	bool Valid = Size >= (long int) sizeof(CHeader) && mem_comp(pHeader->m_aID, "MCCH", sizeof(pHeader->m_aID)) == 0 &&
+		     pHeader->m_Version == VERSION && pHeader->m_ByteOrder == BYTE_ORDER_MARK &&
+		     mem_comp(pHeader->m_aSha256, MapSha256.data, sizeof(pHeader->m_aSha256)) == 0;
+	if(Valid)
+	{
+		const long int Tiles = (long int) pHeader->m_Width * pHeader->m_Height;
+		const long int BitplaneWords = (long int) pHeader->m_NumBitplanes * pHeader->m_BitplaneStride * pHeader->m_Height;
+		Valid = pHeader->m_Width > 0 && pHeader->m_Height > 0 && pHeader->m_NumBitplanes > 0 && pHeader->m_NumTileEntities >= 0 &&
+			pHeader->m_BitplaneStride == (pHeader->m_Width + 31) / 32 &&
+			Size == (long int) sizeof(CHeader) + BitplaneWords * (long int) sizeof(unsigned) + pHeader->m_NumTileEntities * (long int) sizeof(CTileEntity) + Tiles;
+	}
+	if(!Valid)
+	{
+		dbg_msg("mapcache", "ignoring stale cache '%s'", aFilename);
+		io_unmap(pData, Size);
+		return false;
+	}
+
+	m_pMappedFile = pData;
+	m_MappedSize = Size;
+	m_HasCollision = true;
+	m_Width = pHeader->m_Width;
+	m_Height = pHeader->m_Height;
+	m_NumBitplanes = pHeader->m_NumBitplanes;
+	m_BitplaneStride = pHeader->m_BitplaneStride;
+	m_NumTileEntities = pHeader->m_NumTileEntities;
+	m_pBitplanes = reinterpret_cast<const unsigned *>(pHeader + 1);
+	m_pTileEntities = reinterpret_cast<const CTileEntity *>(m_pBitplanes + m_NumBitplanes * m_BitplaneStride * m_Height);
+	m_pDistanceField = reinterpret_cast<const unsigned char *>(m_pTileEntities + m_NumTileEntities);
+	return true;
+}
+
+void CMapCache::Save(IStorage *pStorage, const SHA256_DIGEST &MapSha256, IEngine *pEngine) const
+{
+	dbg_assert(m_HasCollision, "saving an incomplete map cache");
+
+	CHeader Header;
+	mem_zero(&Header, sizeof(Header));
+	mem_copy(Header.m_aID, "MCCH", sizeof(Header.m_aID));
+	Header.m_Version = VERSION;
+	Header.m_ByteOrder = BYTE_ORDER_MARK;
+	mem_copy(Header.m_aSha256, MapSha256.data, sizeof(Header.m_aSha256));
+	Header.m_Width = m_Width;
+	Header.m_Height = m_Height;
+	Header.m_NumBitplanes = m_NumBitplanes;
+	Header.m_BitplaneStride = m_BitplaneStride;
+	Header.m_NumTileEntities = m_NumTileEntities;
+
+	const int BitplaneSize = m_NumBitplanes * m_BitplaneStride * m_Height * sizeof(unsigned);
+	const int TileEntitySize = m_NumTileEntities * sizeof(CTileEntity);
+	const int DistanceFieldSize = m_Width * m_Height;
+	std::vector<char> vData(sizeof(Header) + BitplaneSize + TileEntitySize + DistanceFieldSize);
+	char *pData = vData.data();
+	mem_copy(pData, &Header, sizeof(Header));
+	pData += sizeof(Header);
+	mem_copy(pData, m_pBitplanes, BitplaneSize);
+	pData += BitplaneSize;
+	if(TileEntitySize)
+		mem_copy(pData, m_pTileEntities, TileEntitySize);
+	pData += TileEntitySize;
+	mem_copy(pData, m_pDistanceField, DistanceFieldSize);
+
+	char aFilename[IO_MAX_PATH_LENGTH];
+	GetPath(MapSha256, aFilename, sizeof(aFilename));
+	if(pEngine)
+		pEngine->AddJob(std::make_shared<CMapCacheSaveJob>(pStorage, aFilename, std::move(vData)));
+	else
+		WriteCache(pStorage, aFilename, vData);
+}
+
+void CMapCache::SetCollision(int Width, int Height, int NumBitplanes, int BitplaneStride, const std::vector<unsigned> *pvBitplanes, const std::vector<unsigned char> &vDistanceField)
+{
+	dbg_assert(!IsLoaded(), "map cache is already loaded");
+	dbg_assert((int) vDistanceField.size() == Width * Height, "map cache needs the distance field");
+
+	m_Width = Width;
+	m_Height = Height;
+	m_NumBitplanes = NumBitplanes;
+	m_BitplaneStride = BitplaneStride;
+	m_vBitplanes.clear();
+	for(int i = 0; i < NumBitplanes; i++)
+		m_vBitplanes.insert(m_vBitplanes.end(), pvBitplanes[i].begin(), pvBitplanes[i].end());
+	m_vDistanceField = vDistanceField;
+	m_pBitplanes = m_vBitplanes.data();
+	m_pDistanceField = m_vDistanceField.data();
+	m_HasCollision = true;
+}
+
+void CMapCache::AddTileEntity(int Index, int x, int y)
+{
+	dbg_assert(!IsLoaded(), "map cache is already loaded");
+
+	CTileEntity Entity;
+	Entity.m_Index = Index;
+	Entity.m_X = x;
+	Entity.m_Y = y;
+	m_vTileEntities.push_back(Entity);
+	m_pTileEntities = m_vTileEntities.data();
+	m_NumTileEntities = m_vTileEntities.size();
+}
@@ -0,0 +1,83 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_MAPCACHE_H
+#define GAME_MAPCACHE_H
+
+#include <base/hash.h>
+
+#include <vector>
+
+// data derived from a map which is expensive to compute on every map load.
+// it is stored as "mapcache/<sha256>.cache" in the save directory and mapped into memory.
+class CMapCache
+{
+public:
+	struct CTileEntity
+	{
+		int m_Index;
+		int m_X;
+		int m_Y;
+	};
+
+private:
+	enum
+	{
+		VERSION = 1,
+	};
+
+	struct CHeader
+	{
+		char m_aID[4];
+		int m_Version;
+		int m_ByteOrder;
+		unsigned char m_aSha256[SHA256_DIGEST_LENGTH];
+		int m_Width;
+		int m_Height;
+		int m_NumBitplanes;
+		int m_BitplaneStride;
+		int m_NumTileEntities;
+	};
+
+	void *m_pMappedFile;
+	long int m_MappedSize;
+
+	bool m_HasCollision;
+	int m_Width;
+	int m_Height;
+	int m_NumBitplanes;
+	int m_BitplaneStride;
+	const unsigned *m_pBitplanes;
+	const unsigned char *m_pDistanceField;
+	const CTileEntity *m_pTileEntities;
+	int m_NumTileEntities;
+
+	// data of a cache which is being built
+	std::vector<unsigned> m_vBitplanes;
+	std::vector<unsigned char> m_vDistanceField;
+	std::vector<CTileEntity> m_vTileEntities;
+
+	static void GetPath(const SHA256_DIGEST &MapSha256, char *pBuffer, int BufferSize);
+
+public:
+	CMapCache();
+	~CMapCache();
+
+	// maps the cache of the map, fails if there is none or it is stale
+	bool Load(class IStorage *pStorage, const SHA256_DIGEST &MapSha256);
+	// writes the built cache, in a job if an engine is given
+	void Save(class IStorage *pStorage, const SHA256_DIGEST &MapSha256, class IEngine *pEngine) const;
+	void Unload();
+	bool IsLoaded() const { return m_pMappedFile != 0; }
+
+	bool HasCollision(int Width, int Height, int NumBitplanes) const { return m_HasCollision && m_Width == Width && m_Height == Height && m_NumBitplanes == NumBitplanes; }
+	void SetCollision(int Width, int Height, int NumBitplanes, int BitplaneStride, const std::vector<unsigned> *pvBitplanes, const std::vector<unsigned char> &vDistanceField);
+	int BitplaneStride() const { return m_BitplaneStride; }
+	const unsigned *Bitplane(int Index) const { return m_pBitplanes + Index * m_BitplaneStride * m_Height; }
+	const unsigned char *DistanceField() const { return m_pDistanceField; }
+
+	void AddTileEntity(int Index, int x, int y);
+	int NumTileEntities() const { return m_NumTileEntities; }
+	const CTileEntity *TileEntity(int Index) const { return &m_pTileEntities[Index]; }
+};
+
+#endif
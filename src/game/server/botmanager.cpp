@@ -23,8 +23,14 @@ CBotManager::CBotManager(CGameContext *pGameServer)
 	m_pGameServer = pGameServer;
 	m_pWorldCore = new CWorldCore();
 
+	m_GridWidth = 1;
+	m_GridHeight = 1;
+
 	m_vMarkedAsDestroy.clear();
-	m_vpBots.clear();
+	m_vBotSlots.clear();
+	m_vFreeSlots.clear();
+	m_NumBots = 0;
+	mem_zero(m_aaBotIDMaps, sizeof(m_aaBotIDMaps));
 	ClearPlayerMap(-1);
 }
 
@@ -38,7 +44,7 @@ void CBotManager::ClearPlayerMap(int ClientID)
 {
 	if(ClientID == -1)
 	{
-		for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
+		for(int i = 0; i < NUM_VIEWS; i++)
 		{
 			ClearPlayerMap(i);
 		}
@@ -47,159 +53,317 @@ void CBotManager::ClearPlayerMap(int ClientID)
 
 	for(int i = 0; i < MAX_BOTS; i++)
 	{
-		m_aaBotIDMaps[ClientID][i] = UUID_ZEROED;
+		SetMapSlot(ClientID, i, BOTHANDLE_INVALID);
 	}
+	m_aSlotChurn[ClientID] = 0;
 }
 
-bool DistanceCompare(std::pair<float, Uuid> a, std::pair<float, Uuid> b)
+CBotManager::CBotSlot *CBotManager::GetSlot(BOTHANDLE Handle)
 {
-	return (a.first < b.first);
+	int Index = HandleIndex(Handle);
+	if(Index >= (int) m_vBotSlots.size())
+		return nullptr;
+
+	CBotSlot *pSlot = &m_vBotSlots[Index];
+	if(!pSlot->m_Used || pSlot->m_Generation != HandleGeneration(Handle))
+		return nullptr;
+	return pSlot;
 }
 
-void CBotManager::UpdatePlayerMap(int ClientID)
+void CBotManager::ReleaseSlot(BOTHANDLE Handle)
 {
-	Uuid aLastMap[MAX_BOTS];
-	mem_copy(aLastMap, m_aaBotIDMaps[ClientID], sizeof(m_aaBotIDMaps[ClientID]));
+	CBotSlot *pSlot = GetSlot(Handle);
+	if(!pSlot)
+		return;
 
-	Uuid *pMap = m_aaBotIDMaps[ClientID];
-	for(int i = 0; i < MAX_BOTS; i++)
+	// stale handles left in the player maps are dropped by the next UpdatePlayerMap
+	pSlot->m_pBot = nullptr;
+	pSlot->m_Used = false;
+	pSlot->m_Generation = pSlot->m_Generation % 0xffff + 1;
+	m_vFreeSlots.push_back(HandleIndex(Handle));
+	m_NumBots--;
+}
+
+void CBotManager::SetMapSlot(int ClientID, int Slot, BOTHANDLE Handle)
+{
+	BOTHANDLE &Current = m_aaBotIDMaps[ClientID][Slot];
+	if(Current == Handle)
+		return;
+
+	if(CBotSlot *pOld = GetSlot(Current))
+		pOld->m_aClientSlot[ClientID] = -1;
+	if(CBotSlot *pNew = GetSlot(Handle))
+		pNew->m_aClientSlot[ClientID] = Slot;
+	Current = Handle;
+}
+
+int CBotManager::GridCell(vec2 Pos) const
+{
+	int x = clamp((int) (Pos.x / BOTGRID_CELLSIZE), 0, m_GridWidth - 1);
+	int y = clamp((int) (Pos.y / BOTGRID_CELLSIZE), 0, m_GridHeight - 1);
+	return y * m_GridWidth + x;
+}
+
+void CBotManager::BuildBotGrid()
+{
+	m_GridWidth = maximum(1, GameServer()->Collision()->GetWidth() * 32 / BOTGRID_CELLSIZE + 1);
+	m_GridHeight = maximum(1, GameServer()->Collision()->GetHeight() * 32 / BOTGRID_CELLSIZE + 1);
+
+	// counting sort of the bots into their cells
+	m_vGridStart.assign(m_GridWidth * m_GridHeight + 1, 0);
+	int NumBots = 0;
+	for(auto &Slot : m_vBotSlots)
 	{
-		if(pMap[i] != UUID_ZEROED && !m_vpBots.count(pMap[i]))
-			pMap[i] = UUID_ZEROED;
+		if(!Slot.m_pBot)
+			continue;
+		m_vGridStart[GridCell(Slot.m_pBot->GetPos()) + 1]++;
+		NumBots++;
 	}
+	for(int i = 1; i < (int) m_vGridStart.size(); i++)
+		m_vGridStart[i] += m_vGridStart[i - 1];
 
-	std::vector<std::pair<float, Uuid>> Distances;
-	for(auto &[BotID, pBot] : m_vpBots)
+	m_vpGridBots.resize(NumBots);
+	std::vector<int> vCursor(m_vGridStart.begin(), m_vGridStart.end() - 1);
+	for(auto &Slot : m_vBotSlots)
 	{
-		if(!pBot)
+		if(!Slot.m_pBot)
 			continue;
+		m_vpGridBots[vCursor[GridCell(Slot.m_pBot->GetPos())]++] = Slot.m_pBot;
+	}
+}
 
-		std::pair<float, Uuid> Temp;
-		Temp.first = distance(GameServer()->m_apPlayers[ClientID]->m_ViewPos, pBot->GetPos());
-		Temp.second = BotID;
+bool DistanceCompare(const std::pair<float, CBotEntity *> &a, const std::pair<float, CBotEntity *> &b)
+{
+	return (a.first < b.first);
+}
 
-		Distances.push_back(Temp);
+int CBotManager::FindNearestBots(vec2 Pos, std::pair<float, CBotEntity *> *pOut, int Max) const
+{
+	// ring search around the cell of Pos, pOut is kept as a max-heap while searching
+	int Num = 0;
+	int Cell = GridCell(Pos);
+	int CellX = Cell % m_GridWidth;
+	int CellY = Cell / m_GridWidth;
+	int MaxRing = maximum(maximum(CellX, m_GridWidth - 1 - CellX), maximum(CellY, m_GridHeight - 1 - CellY));
+
+	for(int Ring = 0; Ring <= MaxRing; Ring++)
+	{
+		// every bot in this ring is at least (Ring - 1) cells away
+		if(Num == Max && (Ring - 1) * (float) BOTGRID_CELLSIZE > pOut[0].first)
+			break;
+
+		for(int y = CellY - Ring; y <= CellY + Ring; y++)
+		{
+			if(y < 0 || y >= m_GridHeight)
+				continue;
+
+			bool Edge = y == CellY - Ring || y == CellY + Ring;
+			for(int x = CellX - Ring; x <= CellX + Ring; x += Edge ? 1 : 2 * Ring)
+			{
+				if(x >= 0 && x < m_GridWidth)
+				{
+					int Index = y * m_GridWidth + x;
+					for(int i = m_vGridStart[Index]; i < m_vGridStart[Index + 1]; i++)
+					{
+						std::pair<float, CBotEntity *> Entry(distance(Pos, m_vpGridBots[i]->GetPos()), m_vpGridBots[i]);
+						if(Num < Max)
+						{
+							pOut[Num++] = Entry;
+							std::push_heap(pOut, pOut + Num, DistanceCompare);
+						}
+						else if(Entry.first < pOut[0].first)
+						{
+							std::pop_heap(pOut, pOut + Num, DistanceCompare);
+							pOut[Num - 1] = Entry;
+							std::push_heap(pOut, pOut + Num, DistanceCompare);
+						}
+					}
+				}
+				if(Ring == 0)
+					break;
+			}
+		}
 	}
-	std::sort(Distances.begin(), Distances.end(), DistanceCompare);
 
+	std::sort_heap(pOut, pOut + Num, DistanceCompare);
+	return Num;
+}
+
+void CBotManager::UpdatePlayerMap(int ClientID)
+{
+	BOTHANDLE aLastMap[MAX_BOTS];
+	mem_copy(aLastMap, m_aaBotIDMaps[ClientID], sizeof(m_aaBotIDMaps[ClientID]));
+
+	vec2 ViewPos = GameServer()->m_apPlayers[ClientID]->m_ViewPos;
+	const BOTHANDLE *pMap = m_aaBotIDMaps[ClientID];
+	float aSlotDistance[MAX_BOTS];
 	for(int i = 0; i < MAX_BOTS; i++)
 	{
-		if(pMap[i] == UUID_ZEROED)
+		aSlotDistance[i] = 0.0f;
+		if(pMap[i] == BOTHANDLE_INVALID)
 			continue;
 
-		bool Found = false;
-		int FoundID;
+		CBotEntity *pBot = GetBot(pMap[i]);
+		if(!pBot)
+			SetMapSlot(ClientID, i, BOTHANDLE_INVALID);
+		else
+			aSlotDistance[i] = distance(ViewPos, pBot->GetPos());
+	}
+
+	std::pair<float, CBotEntity *> aNearest[MAX_BOTS];
+	int NumNearest = FindNearestBots(ViewPos, aNearest, MAX_BOTS);
 
-		for(FoundID = 0; FoundID < minimum((int) Distances.size(), (int) MAX_BOTS); FoundID++)
+	// keep the current slots, unless a closer bot beats the farthest one by the hysteresis margin
+	const float Margin = (float) Config()->m_SvBotSlotHysteresis;
+	for(int n = 0; n < NumNearest; n++)
+	{
+		BOTHANDLE BotID = aNearest[n].second->GetBotID();
+		if(GetSlot(BotID)->m_aClientSlot[ClientID] != -1)
+			continue;
+
+		int FreeSlot = -1;
+		int FarthestSlot = -1;
+		for(int i = 0; i < MAX_BOTS; i++)
 		{
-			if(Distances[FoundID].second == pMap[i])
+			if(pMap[i] == BOTHANDLE_INVALID)
 			{
-				Found = true;
-				break;
+				if(FreeSlot == -1)
+					FreeSlot = i;
 			}
+			else if(FarthestSlot == -1 || aSlotDistance[i] > aSlotDistance[FarthestSlot])
+				FarthestSlot = i;
 		}
 
-		if(Found)
-		{
-			Distances.erase(Distances.begin() + FoundID);
-		}
-		else
-		{
-			pMap[i] = UUID_ZEROED;
-		}
+		int Slot = FreeSlot;
+		if(Slot == -1 && FarthestSlot != -1 && aNearest[n].first + Margin < aSlotDistance[FarthestSlot])
+			Slot = FarthestSlot;
+		if(Slot == -1)
+			continue;
+
+		SetMapSlot(ClientID, Slot, BotID);
+		aSlotDistance[Slot] = aNearest[n].first;
 	}
 
-	int Index = 0;
+	// only tell the client about slots which really changed
 	for(int i = 0; i < MAX_BOTS; i++)
 	{
-		if(Index >= (int) Distances.size())
-			break;
+		if(aLastMap[i] == pMap[i])
+			continue;
+
+		m_aSlotChurn[ClientID]++;
 
-		if(pMap[i] == UUID_ZEROED)
+		// the id is removed, we need to send drop message
+		if(aLastMap[i] != BOTHANDLE_INVALID)
 		{
-			pMap[i] = Distances[Index].second;
-			Index++;
+			CNetMsg_Sv_ClientDrop DropInfo;
+			DropInfo.m_ClientID = i + SERVER_MAX_CLIENTS;
+			DropInfo.m_pReason = "";
+			DropInfo.m_Silent = true;
+
+			Server()->SendPackMsg(&DropInfo, MSGFLAG_VITAL | MSGFLAG_NORECORD, ClientID);
 		}
-	}
 
-	// skip self
-	for(int i = 0; i < MAX_BOTS; i++)
-	{
-		if(aLastMap[i] != pMap[i])
-		{
-			// the id is removed, we need to send drop message
-			bool SendDrop = pMap[i] != UUID_ZEROED;
-			if(!SendDrop || aLastMap[i] != UUID_ZEROED)
-			{
-				CNetMsg_Sv_ClientDrop DropInfo;
-				DropInfo.m_ClientID = i + SERVER_MAX_CLIENTS;
-				DropInfo.m_pReason = "";
-				DropInfo.m_Silent = true;
+		if(pMap[i] == BOTHANDLE_INVALID)
+			continue;
 
-				Server()->SendPackMsg(&DropInfo, MSGFLAG_VITAL | MSGFLAG_NORECORD, ClientID);
+		CBotEntity *pBot = GetBot(pMap[i]);
 
-				if(!SendDrop)
-					continue;
-			}
+		CNetMsg_Sv_ClientInfo NewInfo;
+		NewInfo.m_ClientID = i + SERVER_MAX_CLIENTS;
+		NewInfo.m_Local = 0;
+		// do not show bot
+		NewInfo.m_Team = TEAM_BLUE;
 
-			if(!m_vpBots.count(pMap[i]))
-				continue;
-			CBotEntity *pBot = m_vpBots[pMap[i]];
+		NewInfo.m_pName = "";
+		NewInfo.m_pClan = "";
+		NewInfo.m_Country = -1;
+		NewInfo.m_Silent = true;
 
-			CNetMsg_Sv_ClientInfo NewInfo;
-			NewInfo.m_ClientID = i + SERVER_MAX_CLIENTS;
-			NewInfo.m_Local = 0;
-			// do not show bot
-			NewInfo.m_Team = TEAM_BLUE;
+		for(int p = 0; p < NUM_SKINPARTS; p++)
+		{
+			NewInfo.m_apSkinPartNames[p] = pBot->GetTeeInfos()->m_aaSkinPartNames[p];
+			NewInfo.m_aUseCustomColors[p] = pBot->GetTeeInfos()->m_aUseCustomColors[p];
+			NewInfo.m_aSkinPartColors[p] = pBot->GetTeeInfos()->m_aSkinPartColors[p];
+		}
 
-			NewInfo.m_pName = "";
-			NewInfo.m_pClan = "";
-			NewInfo.m_Country = -1;
-			NewInfo.m_Silent = true;
+		Server()->SendPackMsg(&NewInfo, MSGFLAG_VITAL | MSGFLAG_NORECORD, ClientID);
+	}
+}
 
-			for(int p = 0; p < NUM_SKINPARTS; p++)
-			{
-				NewInfo.m_apSkinPartNames[p] = pBot->GetTeeInfos()->m_aaSkinPartNames[p];
-				NewInfo.m_aUseCustomColors[p] = pBot->GetTeeInfos()->m_aUseCustomColors[p];
-				NewInfo.m_aSkinPartColors[p] = pBot->GetTeeInfos()->m_aSkinPartColors[p];
-			}
+void CBotManager::UpdateDemoMap()
+{
+	// keep the ids of the bots stable and give the free ones to new bots, the demo
+	// gets the bot infos with the snapshots so no messages are needed
+	BOTHANDLE *pMap = m_aaBotIDMaps[VIEW_DEMO];
+	for(int i = 0; i < MAX_BOTS; i++)
+	{
+		if(pMap[i] != BOTHANDLE_INVALID && !GetBot(pMap[i]))
+			SetMapSlot(VIEW_DEMO, i, BOTHANDLE_INVALID);
+	}
 
-			Server()->SendPackMsg(&NewInfo, MSGFLAG_VITAL | MSGFLAG_NORECORD, ClientID);
-		}
+	int FreeSlot = 0;
+	for(auto &Slot : m_vBotSlots)
+	{
+		if(!Slot.m_pBot || Slot.m_aClientSlot[VIEW_DEMO] != -1)
+			continue;
+		while(FreeSlot < MAX_BOTS && pMap[FreeSlot] != BOTHANDLE_INVALID)
+			FreeSlot++;
+		if(FreeSlot == MAX_BOTS)
+			break;
+		SetMapSlot(VIEW_DEMO, FreeSlot, Slot.m_pBot->GetBotID());
+		m_aSlotChurn[VIEW_DEMO]++;
 	}
 }
 
 bool CBotManager::CreateBot()
 {
-	// find first free bot id
-	Uuid FreeID = RandomUuid();
-	for(; m_vpBots.count(FreeID); FreeID = RandomUuid()) {}
-
 	vec2 SpawnPos;
 	if(!GameServer()->GameController()->CanSpawn(TEAM_BLUE, &SpawnPos))
 		return false;
 
+	// reuse the first free bot slot
+	int Index;
+	if(!m_vFreeSlots.empty())
+	{
+		Index = m_vFreeSlots.back();
+		m_vFreeSlots.pop_back();
+	}
+	else
+	{
+		dbg_assert(m_vBotSlots.size() < 0xffff, "too many bots");
+		Index = m_vBotSlots.size();
+		m_vBotSlots.emplace_back();
+		m_vBotSlots[Index].m_Generation = 1;
+	}
+
+	CBotSlot *pSlot = &m_vBotSlots[Index];
+	pSlot->m_Used = true;
+	for(int i = 0; i < NUM_VIEWS; i++)
+		pSlot->m_aClientSlot[i] = -1;
+	m_NumBots++;
+
+	BOTHANDLE FreeID = (pSlot->m_Generation << 16) | Index;
 	CBotEntity *pBot = new CBotEntity(GameWorld(), SpawnPos, FreeID, GenerateRandomSkin());
 	pBot->SetMaxHealth(10);
 	pBot->SetMaxArmor(10);
 	pBot->IncreaseHealth(10);
 	pBot->IncreaseArmor(5);
-	m_vpBots[FreeID] = pBot;
+	pSlot->m_pBot = pBot;
 	return true;
 }
 
 void CBotManager::Tick()
 {
-	while(m_vpBots.size() < GameController()->m_aNumSpawnPoints[2])
+	while(m_NumBots < (int) GameController()->m_aNumSpawnPoints[2])
 	{
 		if(!CreateBot())
 			break;
 	}
 }
 
-void CBotManager::CreateDamage(vec2 Pos, Uuid BotID, vec2 Source, int HealthAmount, int ArmorAmount, bool Self)
+void CBotManager::CreateDamage(vec2 Pos, BOTHANDLE BotID, vec2 Source, int HealthAmount, int ArmorAmount, bool Self)
 {
-	for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
+	for(int i = 0; i < NUM_VIEWS; i++)
 	{
 		int ClientID = FindClientID(i, BotID);
 		if(ClientID == -1)
@@ -209,9 +373,9 @@ void CBotManager::CreateDamage(vec2 Pos, Uuid BotID, vec2 Source, int HealthAmou
 	}
 }
 
-void CBotManager::CreateDeath(vec2 Pos, Uuid BotID)
+void CBotManager::CreateDeath(vec2 Pos, BOTHANDLE BotID)
 {
-	for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
+	for(int i = 0; i < NUM_VIEWS; i++)
 	{
 		int ClientID = FindClientID(i, BotID);
 		if(ClientID == -1)
@@ -221,26 +385,43 @@ void CBotManager::CreateDeath(vec2 Pos, Uuid BotID)
 	}
 }
 
-int CBotManager::FindClientID(int ClientID, Uuid BotID)
+CBotEntity *CBotManager::GetBot(BOTHANDLE BotID)
 {
-	dbg_assert(ClientID >= 0, "Server demo is hard-coded disabled now.");
+	CBotSlot *pSlot = GetSlot(BotID);
+	return pSlot ? pSlot->m_pBot : nullptr;
+}
+
+int CBotManager::FindClientID(int ClientID, BOTHANDLE BotID)
+{
+	if(ClientID == -1)
+		ClientID = VIEW_DEMO;
+
+	CBotSlot *pSlot = GetSlot(BotID);
+	if(!pSlot || pSlot->m_aClientSlot[ClientID] == -1)
+		return -1;
+	return pSlot->m_aClientSlot[ClientID] + SERVER_MAX_CLIENTS;
+}
 
-	int FindID = -1 - SERVER_MAX_CLIENTS;
+int CBotManager::NumVisibleBots(int ClientID) const
+{
+	int Num = 0;
 	for(int i = 0; i < MAX_BOTS; i++)
 	{
-		if(m_aaBotIDMaps[ClientID][i] == BotID)
-		{
-			FindID = i;
-			break;
-		}
+		if(m_aaBotIDMaps[ClientID][i] != BOTHANDLE_INVALID)
+			Num++;
 	}
-	return FindID + SERVER_MAX_CLIENTS;
+	return Num;
 }
 
-void CBotManager::OnBotDeath(Uuid BotID)
+void CBotManager::OnBotDeath(BOTHANDLE BotID)
 {
+	// keep the slot until the snap is done, so events can still be mapped
+	CBotSlot *pSlot = GetSlot(BotID);
+	if(!pSlot)
+		return;
+
 	m_vMarkedAsDestroy.push_back(BotID);
-	m_vpBots[BotID] = nullptr;
+	pSlot->m_pBot = nullptr;
 }
 
 void CBotManager::OnClientRefresh(int ClientID)
@@ -257,13 +438,18 @@ void CBotManager::PostSnap()
 	{
 		for(auto &DestroyID : m_vMarkedAsDestroy)
 		{
-			m_vpBots.erase(DestroyID);
+			ReleaseSlot(DestroyID);
 		}
 		m_vMarkedAsDestroy.clear();
 	}
+	BuildBotGrid();
 	for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
 	{
 		if(Server()->ClientIngame(i) && GameServer()->m_apPlayers[i])
 			UpdatePlayerMap(i);
 	}
+	if(Server()->DemoRecorder_IsRecording())
+		UpdateDemoMap();
+	else
+		ClearPlayerMap(VIEW_DEMO);
 }
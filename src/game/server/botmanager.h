@@ -1,28 +1,73 @@
 #ifndef GAME_SERVER_BOTMANAGER_H
 #define GAME_SERVER_BOTMANAGER_H
 
-#include <base/uuid.h>
 #include <base/vmath.h>
 #include <engine/shared/protocol.h>
 
-#include <unordered_map>
 #include <vector>
 
 class CGameContext;
 class CGameController;
 class CGameWorld;
 
+// low 16 bits: index into the bot slots, high 16 bits: generation of that slot
+typedef unsigned int BOTHANDLE;
+
+enum
+{
+	BOTHANDLE_INVALID = 0,
+};
+
 class CBotManager
 {
+	enum
+	{
+		BOTGRID_CELLSIZE = 512,
+
+		// the server demo sees the bots like a free view spectator
+		VIEW_DEMO = SERVER_MAX_CLIENTS,
+		NUM_VIEWS,
+	};
+
+	struct CBotSlot
+	{
+		class CBotEntity *m_pBot;
+		int m_Generation;
+		bool m_Used;
+		// visible slot of this bot for every client and the demo, -1 if not visible
+		signed char m_aClientSlot[NUM_VIEWS];
+	};
+
 	CGameContext *m_pGameServer;
 	class CWorldCore *m_pWorldCore;
-	Uuid m_aaBotIDMaps[SERVER_MAX_CLIENTS][MAX_BOTS];
+	BOTHANDLE m_aaBotIDMaps[NUM_VIEWS][MAX_BOTS];
+	int m_aSlotChurn[NUM_VIEWS];
+
+	std::vector<BOTHANDLE> m_vMarkedAsDestroy;
+	std::vector<CBotSlot> m_vBotSlots;
+	std::vector<int> m_vFreeSlots;
+	int m_NumBots;
+
+	// uniform grid over the alive bots, rebuilt once per snap
+	int m_GridWidth;
+	int m_GridHeight;
+	std::vector<int> m_vGridStart;
+	std::vector<class CBotEntity *> m_vpGridBots;
+
+	static int HandleIndex(BOTHANDLE Handle) { return Handle & 0xffff; }
+	static int HandleGeneration(BOTHANDLE Handle) { return Handle >> 16; }
+
+	CBotSlot *GetSlot(BOTHANDLE Handle);
+	void ReleaseSlot(BOTHANDLE Handle);
+	void SetMapSlot(int ClientID, int Slot, BOTHANDLE Handle);
 
-	std::vector<Uuid> m_vMarkedAsDestroy;
-	std::unordered_map<Uuid, class CBotEntity *> m_vpBots;
+	int GridCell(vec2 Pos) const;
+	void BuildBotGrid();
+	int FindNearestBots(vec2 Pos, std::pair<float, class CBotEntity *> *pOut, int Max) const;
 
 	void ClearPlayerMap(int ClientID);
 	void UpdatePlayerMap(int ClientID);
+	void UpdateDemoMap();
 	bool CreateBot();
 
 public:
@@ -39,12 +84,16 @@ public:
 
 	void Tick();
 
-	void CreateDamage(vec2 Pos, Uuid BotID, vec2 Source, int HealthAmount, int ArmorAmount, bool Self);
-	void CreateDeath(vec2 Pos, Uuid BotID);
+	void CreateDamage(vec2 Pos, BOTHANDLE BotID, vec2 Source, int HealthAmount, int ArmorAmount, bool Self);
+	void CreateDeath(vec2 Pos, BOTHANDLE BotID);
 
-	int FindClientID(int ClientID, Uuid BotID);
+	class CBotEntity *GetBot(BOTHANDLE BotID);
+	// -1 is the server demo
+	int FindClientID(int ClientID, BOTHANDLE BotID);
+	int GetSlotChurn(int ClientID) const { return m_aSlotChurn[ClientID]; }
+	int NumVisibleBots(int ClientID) const;
 
-	void OnBotDeath(Uuid BotID);
+	void OnBotDeath(BOTHANDLE BotID);
 	void OnClientRefresh(int ClientID);
 
 	void PostSnap();
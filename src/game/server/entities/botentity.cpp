@@ -11,7 +11,7 @@
 #include "botentity.h"
 #include "character.h"
 
-CBotEntity::CBotEntity(CGameWorld *pWorld, vec2 Pos, Uuid BotID, STeeInfo TeeInfos) :
+CBotEntity::CBotEntity(CGameWorld *pWorld, vec2 Pos, BOTHANDLE BotID, STeeInfo TeeInfos) :
 	CHealthEntity(pWorld, CGameWorld::ENTTYPE_BOTENTITY, Pos, ms_PhysSize)
 {
 	m_BotID = BotID;
@@ -349,12 +349,14 @@ void CBotEntity::DoWeapon()
 
 	vec2 ProjStartPos = m_Pos + Direction * GetProximityRadius() * 0.75f;
 
-	static Uuid HammerUuid = CalculateUuid("Hammer");
+	constexpr Uuid HammerUuid = CalculateConstUuid("Hammer");
+	static const int s_HammerHandle = WeaponManager()->FindWeapon(HammerUuid);
+	const CWeaponInfo &Hammer = WeaponManager()->WeaponInfo(s_HammerHandle);
 
-	WeaponManager()->GetWeapon(HammerUuid)->OnFire(this, GameWorld(), ProjStartPos, Direction, &m_ReloadTimer);
+	Hammer.m_pWeapon->OnFire(this, GameWorld(), ProjStartPos, Direction, &m_ReloadTimer);
 
 	m_AttackTick = Server()->Tick();
 
 	if(!m_ReloadTimer)
-		m_ReloadTimer = WeaponManager()->GetWeapon(HammerUuid)->FireDelay() * Server()->TickSpeed() / 1000;
+		m_ReloadTimer = Hammer.m_FireDelay * Server()->TickSpeed() / 1000;
 }
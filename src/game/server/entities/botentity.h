@@ -1,11 +1,10 @@
 #ifndef GAME_SERVER_ENTITIES_BOTENTITY_H
 #define GAME_SERVER_ENTITIES_BOTENTITY_H
 
-#include <base/uuid.h>
-
 #include <generated/protocol.h>
 
 #include <game/gamecore.h>
+#include <game/server/botmanager.h>
 #include <game/server/entity.h>
 #include <game/server/teeinfo.h>
 
@@ -14,7 +13,7 @@ class CBotEntity : public CHealthEntity<CEntity>
 public:
 	// same as character's size
 	static const int ms_PhysSize = 28;
-	CBotEntity(CGameWorld *pWorld, vec2 Pos, Uuid BotID, STeeInfo TeeInfos);
+	CBotEntity(CGameWorld *pWorld, vec2 Pos, BOTHANDLE BotID, STeeInfo TeeInfos);
 
 	void Tick() override;
 	void TickDefered() override;
@@ -25,12 +24,12 @@ public:
 	bool TakeDamage(vec2 Force, vec2 Source, int Dmg, CEntity *pFrom, int Weapon) override;
 	void Die(CEntity *pKiller, int Weapon) override;
 
-	Uuid GetBotID() const { return m_BotID; }
+	BOTHANDLE GetBotID() const { return m_BotID; }
 	STeeInfo *GetTeeInfos() { return &m_TeeInfos; }
 
 private:
 	STeeInfo m_TeeInfos;
-	Uuid m_BotID;
+	BOTHANDLE m_BotID;
 	int m_Emote;
 
 	int m_TriggeredEvents;
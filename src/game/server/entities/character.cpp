@@ -124,6 +124,7 @@ void CCharacter::HandleNinja()
 		m_Core.m_Vel = m_Ninja.m_ActivationDir * g_pData->m_Weapons.m_Ninja.m_Velocity;
 		vec2 OldPos = m_Pos;
 		GameServer()->Collision()->MoveBox(&m_Core.m_Pos, &m_Core.m_Vel, vec2(GetProximityRadius(), GetProximityRadius()), 0.f);
+		GameWorld()->m_Core.UpdateCharacter(&m_Core);
 
 		// reset velocity so the client doesn't predict stuff
 		m_Core.m_Vel = vec2(0.f, 0.f);
@@ -226,7 +227,7 @@ void CCharacter::FireWeapon()
 	DoWeaponSwitch();
 	vec2 Direction = normalize(vec2(m_LatestInput.m_TargetX, m_LatestInput.m_TargetY));
 
-	bool FullAuto = WeaponManager()->GetWeapon(m_aWeapons[m_ActiveWeapon].m_Weapon)->FullAuto();
+	bool FullAuto = WeaponManager()->WeaponInfo(m_aWeapons[m_ActiveWeapon].m_WeaponHandle).m_FullAuto;
 
 	// check if we gonna fire
 	bool WillFire = false;
@@ -257,11 +258,11 @@ void CCharacter::FireWeapon()
 	if(Config()->m_Debug)
 	{
 		char aBuf[256];
-		str_format(aBuf, sizeof(aBuf), "shot player='%d:%s' team=%d weapon=%s", m_pPlayer->GetCID(), Server()->ClientName(m_pPlayer->GetCID()), m_pPlayer->GetTeam(), WeaponManager()->GetWeapon(m_aWeapons[m_ActiveWeapon].m_Weapon)->Name());
+		str_format(aBuf, sizeof(aBuf), "shot player='%d:%s' team=%d weapon=%s", m_pPlayer->GetCID(), Server()->ClientName(m_pPlayer->GetCID()), m_pPlayer->GetTeam(), WeaponManager()->WeaponInfo(m_aWeapons[m_ActiveWeapon].m_WeaponHandle).m_pName);
 		GameServer()->Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "game", aBuf);
 	}
 
-	WeaponManager()->GetWeapon(m_aWeapons[m_ActiveWeapon].m_Weapon)->OnFire(this, GameWorld(), ProjStartPos, Direction, &m_ReloadTimer);
+	WeaponManager()->WeaponInfo(m_aWeapons[m_ActiveWeapon].m_WeaponHandle).m_pWeapon->OnFire(this, GameWorld(), ProjStartPos, Direction, &m_ReloadTimer);
 
 	m_AttackTick = Server()->Tick();
 
@@ -269,7 +270,7 @@ void CCharacter::FireWeapon()
 		m_aWeapons[m_ActiveWeapon].m_Ammo--;
 
 	if(!m_ReloadTimer)
-		m_ReloadTimer = WeaponManager()->GetWeapon(m_aWeapons[m_ActiveWeapon].m_Weapon)->FireDelay() * Server()->TickSpeed() / 1000;
+		m_ReloadTimer = WeaponManager()->WeaponInfo(m_aWeapons[m_ActiveWeapon].m_WeaponHandle).m_FireDelay * Server()->TickSpeed() / 1000;
 }
 
 void CCharacter::HandleWeapons()
@@ -288,7 +289,7 @@ void CCharacter::HandleWeapons()
 	FireWeapon();
 
 	// ammo regen
-	int AmmoRegenTime = WeaponManager()->GetWeapon(m_aWeapons[m_ActiveWeapon].m_Weapon)->AmmoRegenTime();
+	int AmmoRegenTime = WeaponManager()->WeaponInfo(m_aWeapons[m_ActiveWeapon].m_WeaponHandle).m_AmmoRegenTime;
 	if(AmmoRegenTime && m_aWeapons[m_ActiveWeapon].m_Ammo >= 0)
 	{
 		// If equipped and not active, regen ammo?
@@ -301,7 +302,7 @@ void CCharacter::HandleWeapons()
 			{
 				// Add some ammo
 				m_aWeapons[m_ActiveWeapon].m_Ammo = minimum(m_aWeapons[m_ActiveWeapon].m_Ammo + 1,
-					WeaponManager()->GetWeapon(m_aWeapons[m_ActiveWeapon].m_Weapon)->MaxAmmo());
+					WeaponManager()->WeaponInfo(m_aWeapons[m_ActiveWeapon].m_WeaponHandle).m_MaxAmmo);
 				m_aWeapons[m_ActiveWeapon].m_AmmoRegenStart = -1;
 			}
 		}
@@ -322,7 +323,7 @@ bool CCharacter::GiveWeapon(Uuid WeaponID, int Ammo)
 			continue;
 		if(m_aWeapons[i].m_Weapon == WeaponID)
 		{
-			m_aWeapons[i].m_Ammo = minimum(WeaponManager()->GetWeapon(WeaponID)->MaxAmmo(), m_aWeapons[i].m_Ammo + Ammo);
+			m_aWeapons[i].m_Ammo = minimum(WeaponManager()->WeaponInfo(m_aWeapons[i].m_WeaponHandle).m_MaxAmmo, m_aWeapons[i].m_Ammo + Ammo);
 			return true;
 		}
 	}
@@ -336,7 +337,8 @@ void CCharacter::SetWeapon(int Place, Uuid WeaponID, int Ammo)
 
 	m_aWeapons[Place].m_Got = true;
 	m_aWeapons[Place].m_Weapon = WeaponID;
-	m_aWeapons[Place].m_Ammo = minimum(WeaponManager()->GetWeapon(WeaponID)->MaxAmmo(), Ammo);
+	m_aWeapons[Place].m_WeaponHandle = WeaponManager()->FindWeapon(WeaponID);
+	m_aWeapons[Place].m_Ammo = minimum(WeaponManager()->WeaponInfo(m_aWeapons[Place].m_WeaponHandle).m_MaxAmmo, Ammo);
 }
 
 void CCharacter::GiveNinja()
@@ -449,6 +451,7 @@ void CCharacter::Tick()
 			m_Core.m_Pos = m_SitPos;
 			m_Pos = m_SitPos;
 		}
+		GameWorld()->m_Core.UpdateCharacter(&m_Core);
 	}
 
 	// handle leaving gamelayer
@@ -688,7 +691,7 @@ void CCharacter::Snap(int SnappingClient)
 	pCharacter->m_Armor = 0;
 	pCharacter->m_TriggeredEvents = m_TriggeredEvents;
 
-	pCharacter->m_Weapon = !m_aWeapons[m_ActiveWeapon].m_Got ? -1 : WeaponManager()->GetWeapon(m_aWeapons[m_ActiveWeapon].m_Weapon)->SnapStyle();
+	pCharacter->m_Weapon = !m_aWeapons[m_ActiveWeapon].m_Got ? -1 : WeaponManager()->WeaponInfo(m_aWeapons[m_ActiveWeapon].m_WeaponHandle).m_SnapStyle;
 	pCharacter->m_AttackTick = m_AttackTick;
 
 	pCharacter->m_Direction = m_Input.m_Direction;
@@ -701,7 +704,7 @@ void CCharacter::Snap(int SnappingClient)
 		if(m_ActiveWeapon == WEAPON_NINJA)
 			pCharacter->m_AmmoCount = m_Ninja.m_ActivationTick + g_pData->m_Weapons.m_Ninja.m_Duration * Server()->TickSpeed() / 1000;
 		else if(m_aWeapons[m_ActiveWeapon].m_Ammo > 0)
-			pCharacter->m_AmmoCount = round_to_int((m_aWeapons[m_ActiveWeapon].m_Ammo / static_cast<float>(WeaponManager()->GetWeapon(m_aWeapons[m_ActiveWeapon].m_Weapon)->MaxAmmo())) * 10);
+			pCharacter->m_AmmoCount = round_to_int((m_aWeapons[m_ActiveWeapon].m_Ammo / static_cast<float>(WeaponManager()->WeaponInfo(m_aWeapons[m_ActiveWeapon].m_WeaponHandle).m_MaxAmmo)) * 10);
 	}
 
 	if(pCharacter->m_Emote == EMOTE_NORMAL)
@@ -74,6 +74,8 @@ private:
 		int m_AmmoRegenStart;
 		int m_Ammo;
 		Uuid m_Weapon;
+		// resolved from m_Weapon
+		int m_WeaponHandle;
 		bool m_Got;
 
 	} m_aWeapons[NUM_WEAPONS];
@@ -68,7 +68,7 @@ void CPickup::Tick()
 
 		case PICKUP_GRENADE:
 		{
-			Uuid WeaponID = CalculateUuid("Grenade");
+			constexpr Uuid WeaponID = CalculateConstUuid("Grenade");
 			if(pChr->GiveWeapon(WeaponID, WeaponManager()->GetWeapon(WeaponID)->MaxAmmo()))
 			{
 				Picked = true;
@@ -80,7 +80,7 @@ void CPickup::Tick()
 		break;
 		case PICKUP_SHOTGUN:
 		{
-			Uuid WeaponID = CalculateUuid("Shotgun");
+			constexpr Uuid WeaponID = CalculateConstUuid("Shotgun");
 			if(pChr->GiveWeapon(WeaponID, WeaponManager()->GetWeapon(WeaponID)->MaxAmmo()))
 			{
 				Picked = true;
@@ -92,7 +92,7 @@ void CPickup::Tick()
 		break;
 		case PICKUP_LASER:
 		{
-			Uuid WeaponID = CalculateUuid("Laser");
+			constexpr Uuid WeaponID = CalculateConstUuid("Laser");
 			if(pChr->GiveWeapon(WeaponID, WeaponManager()->GetWeapon(WeaponID)->MaxAmmo()))
 			{
 				Picked = true;
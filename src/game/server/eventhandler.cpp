@@ -11,6 +11,9 @@
 CEventHandler::CEventHandler()
 {
 	m_pGameServer = 0;
+	m_NumDropped = 0;
+	for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
+		m_aNumClientDropped[i] = 0;
 	Clear();
 }
 
@@ -19,56 +22,82 @@ void CEventHandler::SetGameServer(CGameContext *pGameServer)
 	m_pGameServer = pGameServer;
 }
 
-void CEventHandler::Create(void *pData, int Type, int Size, int ClientID)
+int CEventHandler::GetPriority(int Type)
 {
-	int &NumEvent = m_aNumEvents[ClientID];
-	if(m_aNumEvents[ClientID] == MAX_EVENTS)
-		return;
-	if(m_aCurrentOffset[ClientID] + Size >= MAX_DATASIZE)
-		return;
-
-	void *p = &m_aaData[ClientID][m_aCurrentOffset[ClientID]];
-	m_aaOffsets[ClientID][NumEvent] = m_aCurrentOffset[ClientID];
-	m_aaTypes[ClientID][NumEvent] = Type;
-	m_aaSizes[ClientID][NumEvent] = Size;
-	m_aCurrentOffset[ClientID] += Size;
-	NumEvent++;
-	mem_copy(p, pData, Size);
+	// sounds and hammer hits are only cosmetic, everything else tells the player what happened
+	switch(Type)
+	{
+	case NETEVENTTYPE_SOUNDWORLD:
+	case NETEVENTTYPE_HAMMERHIT:
+		return PRIORITY_LOW;
+	default:
+		return PRIORITY_HIGH;
+	}
 }
 
 void CEventHandler::Create(void *pData, int Type, int Size, int64 Mask)
 {
-	for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
+	if(!Mask)
+		return;
+	if(m_NumEvents == MAX_EVENTS || m_CurrentOffset + Size > MAX_DATASIZE)
 	{
-		if(CmaskIsSet(Mask, i))
-		{
-			Create(pData, Type, Size, i);
-		}
+		m_NumDropped++;
+		return;
 	}
+
+	CNetEvent_Common *pCommon = (CNetEvent_Common *) pData;
+	CEvent *pEvent = &m_aEvents[m_NumEvents++];
+	pEvent->m_Type = Type;
+	pEvent->m_Offset = m_CurrentOffset;
+	pEvent->m_Size = Size;
+	pEvent->m_Priority = GetPriority(Type);
+	pEvent->m_Pos = vec2(pCommon->m_X, pCommon->m_Y);
+	pEvent->m_Mask = Mask;
+	mem_copy(&m_aData[m_CurrentOffset], pData, Size);
+	m_CurrentOffset += Size;
 }
 
 void CEventHandler::Clear()
 {
-	for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
-	{
-		m_aNumEvents[i] = 0;
-		m_aCurrentOffset[i] = 0;
-	}
+	m_NumEvents = 0;
+	m_CurrentOffset = 0;
 }
 
 void CEventHandler::Snap(int SnappingClient)
 {
-	if(SnappingClient == -1)
-		return;
+	// the server demo has the mask bit after the clients
+	const int MaskBit = SnappingClient == -1 ? SERVER_MAX_CLIENTS : SnappingClient;
 
-	for(int i = 0; i < m_aNumEvents[SnappingClient]; i++)
+	int aVisible[MAX_EVENTS];
+	int NumVisible = 0;
+	int NumHigh = 0;
+	for(int i = 0; i < m_NumEvents; i++)
 	{
-		CNetEvent_Common *pEvent = (CNetEvent_Common *) &m_aaData[SnappingClient][m_aaOffsets[SnappingClient][i]];
-		if(!NetworkClipped(SnappingClient, vec2(pEvent->m_X, pEvent->m_Y), GameServer()))
+		const CEvent *pEvent = &m_aEvents[i];
+		if(!CmaskIsSet(pEvent->m_Mask, MaskBit) || NetworkClipped(SnappingClient, pEvent->m_Pos, GameServer()))
+			continue;
+		aVisible[NumVisible++] = i;
+		if(pEvent->m_Priority == PRIORITY_HIGH)
+			NumHigh++;
+	}
+
+	// over budget: keep the important events and fill the rest with cosmetic ones, in creation order
+	int HighBudget = minimum(NumHigh, MAX_CLIENT_EVENTS);
+	int LowBudget = MAX_CLIENT_EVENTS - HighBudget;
+	for(int i = 0; i < NumVisible; i++)
+	{
+		const CEvent *pEvent = &m_aEvents[aVisible[i]];
+		int &Budget = pEvent->m_Priority == PRIORITY_HIGH ? HighBudget : LowBudget;
+		if(Budget == 0)
 		{
-			void *pData = GameServer()->Server()->SnapNewItem(m_aaTypes[SnappingClient][i], i, m_aaSizes[SnappingClient][i]);
-			if(pData)
-				mem_copy(pData, &m_aaData[SnappingClient][m_aaOffsets[SnappingClient][i]], m_aaSizes[SnappingClient][i]);
+			if(SnappingClient != -1)
+				m_aNumClientDropped[SnappingClient]++;
+			continue;
 		}
+		Budget--;
+
+		void *pData = GameServer()->Server()->SnapNewItem(pEvent->m_Type, aVisible[i], pEvent->m_Size);
+		if(pData)
+			mem_copy(pData, &m_aData[pEvent->m_Offset], pEvent->m_Size);
 	}
 }
@@ -3,25 +3,45 @@
 #ifndef GAME_SERVER_EVENTHANDLER_H
 #define GAME_SERVER_EVENTHANDLER_H
 
+#include <base/vmath.h>
 #include <engine/shared/protocol.h>
-//
+
+// all events of a tick are stored once, every client snaps the ones that are meant for it
 class CEventHandler
 {
-	static const int MAX_EVENTS = 32;
-	static const int MAX_DATASIZE = 32 * 64;
-
-	// extra 1 is server demo snap.
-	int m_aaTypes[SERVER_MAX_CLIENTS][MAX_EVENTS];
-	int m_aaOffsets[SERVER_MAX_CLIENTS][MAX_EVENTS];
-	int m_aaSizes[SERVER_MAX_CLIENTS][MAX_EVENTS];
-	char m_aaData[SERVER_MAX_CLIENTS][MAX_DATASIZE];
+	static const int MAX_EVENTS = 1024;
+	static const int MAX_DATASIZE = MAX_EVENTS * 32;
+	// events that fit into the snapshot of a single client
+	static const int MAX_CLIENT_EVENTS = 64;
+
+	enum
+	{
+		PRIORITY_LOW = 0,
+		PRIORITY_HIGH,
+	};
+
+	struct CEvent
+	{
+		int m_Type;
+		int m_Offset;
+		int m_Size;
+		int m_Priority;
+		vec2 m_Pos;
+		int64 m_Mask;
+	};
+
+	CEvent m_aEvents[MAX_EVENTS];
+	char m_aData[MAX_DATASIZE];
+	int m_NumEvents;
+	int m_CurrentOffset;
 
 	class CGameContext *m_pGameServer;
 
-	int m_aCurrentOffset[SERVER_MAX_CLIENTS];
-	int m_aNumEvents[SERVER_MAX_CLIENTS];
+	// dropped events since the server started
+	int m_NumDropped;
+	int m_aNumClientDropped[SERVER_MAX_CLIENTS];
 
-	void Create(void *pData, int Type, int Size, int ClientID);
+	static int GetPriority(int Type);
 
 public:
 	CGameContext *GameServer() const { return m_pGameServer; }
@@ -31,6 +51,10 @@ public:
 	void Create(void *pData, int Type, int Size, int64 Mask = -1);
 	void Clear();
 	void Snap(int SnappingClient);
+
+	int NumDropped() const { return m_NumDropped; }
+	int NumClientDropped(int ClientID) const { return m_aNumClientDropped[ClientID]; }
+	void ResetClientDropped(int ClientID) { m_aNumClientDropped[ClientID] = 0; }
 };
 
 #endif
@@ -2,10 +2,12 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <base/math.h>
 
+#include <engine/engine.h>
 #include <engine/map.h>
 #include <engine/shared/config.h>
 #include <engine/shared/jsonwriter.h>
 #include <engine/shared/memheap.h>
+#include <engine/shared/metrics.h>
 #include <engine/storage.h>
 
 #include <game/collision.h>
@@ -42,6 +44,15 @@ void CGameContext::Construct(int Resetting)
 	m_pVoteOptionFirst = nullptr;
 	m_pVoteOptionLast = nullptr;
 	m_NumVoteOptions = 0;
+	mem_zero(m_aVoteAddr, sizeof(m_aVoteAddr));
+	mem_zero(m_aVoteAddrHash, sizeof(m_aVoteAddrHash));
+	for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
+	{
+		m_aVoteAddrGroup[i] = 0;
+		m_aVoteGroupCounted[i] = false;
+		m_aVoteGroupChoice[i] = 0;
+	}
+	m_VoteTotal = m_VoteYes = m_VoteNo = 0;
 
 	if(Resetting == NO_RESET)
 	{
@@ -66,6 +77,8 @@ CGameContext::~CGameContext()
 {
 	for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
 		delete m_apPlayers[i];
+	for(auto &Line : m_VoteCommandLines)
+		delete Line.second;
 	if(!m_Resetting)
 	{
 		delete m_pVoteOptionHeap;
@@ -220,17 +233,16 @@ void CGameContext::SendChat(int ChatterClientID, int Mode, int To, const char *p
 		Server()->SendPackMsg(&Msg, MSGFLAG_VITAL, -1);
 	else if(Mode == CHAT_TEAM)
 	{
-		// pack one for the recording only
-		Server()->SendPackMsg(&Msg, MSGFLAG_VITAL | MSGFLAG_NOSEND, -1);
-
 		To = m_apPlayers[ChatterClientID]->GetTeam();
 
-		// send to the clients
+		// send to the clients, packed and recorded once
+		int64 Mask = 0;
 		for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
 		{
 			if(m_apPlayers[i] && m_apPlayers[i]->GetTeam() == To)
-				Server()->SendPackMsg(&Msg, MSGFLAG_VITAL | MSGFLAG_NORECORD, i);
+				Mask |= CmaskOne(i);
 		}
+		Server()->SendPackMsgMask(&Msg, MSGFLAG_VITAL, Mask);
 	}
 	else // Mode == CHAT_WHISPER
 	{
@@ -248,6 +260,44 @@ void CGameContext::SendBroadcast(const char *pText, int ClientID)
 	Server()->SendPackMsg(&Msg, MSGFLAG_VITAL, ClientID);
 }
 
+void CGameContext::SendChatLocalized(const char *pText, int64 Mask)
+{
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "*** %s", pText);
+	Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "chat", aBuf);
+
+	// only players in the game, like SendChat
+	for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
+	{
+		if(!m_apPlayers[i])
+			Mask &= ~CmaskOne(i);
+	}
+
+	const int String = Server()->RegisterLocalizedString(pText);
+	CNetMsg_Sv_Chat Msg;
+	Msg.m_Mode = CHAT_ALL;
+	Msg.m_ClientID = -1;
+	Msg.m_TargetID = -1;
+	Server()->SendLocalizedPackMsg(&Msg, MSGFLAG_VITAL, Mask, [&](CNetMsg_Sv_Chat *pMsg, int ClientID) {
+		pMsg->m_pMessage = String < 0 ? Server()->Localize(ClientID, pText) : Server()->Localize(ClientID, String);
+	});
+}
+
+void CGameContext::SendBroadcastLocalized(const char *pText, int64 Mask)
+{
+	for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
+	{
+		if(!m_apPlayers[i])
+			Mask &= ~CmaskOne(i);
+	}
+
+	const int String = Server()->RegisterLocalizedString(pText);
+	CNetMsg_Sv_Broadcast Msg;
+	Server()->SendLocalizedPackMsg(&Msg, MSGFLAG_VITAL, Mask, [&](CNetMsg_Sv_Broadcast *pMsg, int ClientID) {
+		pMsg->m_pMessage = String < 0 ? Server()->Localize(ClientID, pText) : Server()->Localize(ClientID, String);
+	});
+}
+
 void CGameContext::SendEmoticon(int ClientID, int Emoticon)
 {
 	CNetMsg_Sv_Emoticon Msg;
@@ -371,9 +421,127 @@ void CGameContext::StartVote(const char *pDesc, const char *pCommand, const char
 	str_copy(m_aVoteCommand, pCommand, sizeof(m_aVoteCommand));
 	str_copy(m_aVoteReason, pReason, sizeof(m_aVoteReason));
 	SendVoteSet(m_VoteType, -1);
+	ResetVoteTally();
 	m_VoteUpdate = true;
 }
 
+void CGameContext::ExecuteVoteCommand(const char *pCommand)
+{
+	auto Line = m_VoteCommandLines.find(pCommand);
+	if(Line == m_VoteCommandLines.end())
+	{
+		if(m_VoteCommandLines.size() >= MAX_VOTE_COMMAND_LINES)
+		{
+			Console()->ExecuteLine(pCommand);
+			return;
+		}
+		Line = m_VoteCommandLines.emplace(pCommand, Console()->ParseLine(pCommand)).first;
+	}
+	// nothing deletes the lines while they run, the command may remove its own vote option
+	Console()->ExecuteParsedLine(Line->second);
+}
+
+static unsigned VoteAddrHash(const NETADDR *pAddr)
+{
+	// fnv-1a
+	unsigned Hash = 2166136261u;
+	Hash = (Hash ^ pAddr->type) * 16777619u;
+	for(unsigned i = 0; i < sizeof(pAddr->ip); i++)
+		Hash = (Hash ^ pAddr->ip[i]) * 16777619u;
+	return Hash;
+}
+
+void CGameContext::UpdateVoteAddrGroups(int ClientID)
+{
+	// clients which aren't ingame yet share the empty address
+	mem_zero(&m_aVoteAddr[ClientID], sizeof(m_aVoteAddr[ClientID]));
+	if(m_apPlayers[ClientID] && Server()->GetClientAddr(ClientID, &m_aVoteAddr[ClientID]))
+		m_aVoteAddr[ClientID].port = 0;
+	m_aVoteAddrHash[ClientID] = VoteAddrHash(&m_aVoteAddr[ClientID]);
+
+	for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
+	{
+		m_aVoteAddrGroup[i] = i;
+		for(int j = 0; j < i; j++)
+		{
+			if(m_aVoteAddrHash[j] == m_aVoteAddrHash[i] && net_addr_comp(&m_aVoteAddr[j], &m_aVoteAddr[i], false) == 0)
+			{
+				m_aVoteAddrGroup[i] = m_aVoteAddrGroup[j];
+				break;
+			}
+		}
+	}
+	ResetVoteTally();
+}
+
+bool CGameContext::UpdateVoteGroup(int Group)
+{
+	// only use the vote of the one who voted first for players with the same ip,
+	// the group is counted from its first player who isn't a spectator on
+	bool Counted = false;
+	int Choice = 0;
+	int ChoicePos = 0;
+	for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
+	{
+		if(!m_apPlayers[i] || m_aVoteAddrGroup[i] != Group)
+			continue;
+
+		if(!Counted)
+		{
+			if(m_apPlayers[i]->GetTeam() == TEAM_SPECTATORS) // don't count in votes by spectators
+				continue;
+			Counted = true;
+		}
+
+		if(m_apPlayers[i]->m_Vote && (!Choice || ChoicePos > m_apPlayers[i]->m_VotePos))
+		{
+			Choice = m_apPlayers[i]->m_Vote;
+			ChoicePos = m_apPlayers[i]->m_VotePos;
+		}
+	}
+
+	if(Counted == m_aVoteGroupCounted[Group] && Choice == m_aVoteGroupChoice[Group])
+		return false;
+
+	// replace what the group added to the totals
+	if(m_aVoteGroupCounted[Group])
+	{
+		m_VoteTotal--;
+		m_VoteYes -= m_aVoteGroupChoice[Group] > 0;
+		m_VoteNo -= m_aVoteGroupChoice[Group] < 0;
+	}
+	if(Counted)
+	{
+		m_VoteTotal++;
+		m_VoteYes += Choice > 0;
+		m_VoteNo += Choice < 0;
+	}
+	m_aVoteGroupCounted[Group] = Counted;
+	m_aVoteGroupChoice[Group] = Choice;
+	return true;
+}
+
+void CGameContext::UpdateVoteTally(int ClientID)
+{
+	if(UpdateVoteGroup(m_aVoteAddrGroup[ClientID]))
+		m_VoteUpdate = true;
+}
+
+void CGameContext::ResetVoteTally()
+{
+	m_VoteTotal = m_VoteYes = m_VoteNo = 0;
+	for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
+	{
+		m_aVoteGroupCounted[i] = false;
+		m_aVoteGroupChoice[i] = 0;
+	}
+	for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
+	{
+		if(m_aVoteAddrGroup[i] == i)
+			UpdateVoteGroup(i);
+	}
+}
+
 void CGameContext::EndVote(int Type, bool Force)
 {
 	m_VoteCloseTime = 0;
@@ -503,49 +671,11 @@ void CGameContext::OnTick()
 			EndVote(VOTE_END_ABORT, false);
 		else
 		{
-			int Total = 0, Yes = 0, No = 0;
-			if(m_VoteUpdate)
-			{
-				// count votes
-				char aaBuf[SERVER_MAX_CLIENTS][NETADDR_MAXSTRSIZE] = {{0}};
-				for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
-					if(m_apPlayers[i])
-						Server()->GetClientAddr(i, aaBuf[i], NETADDR_MAXSTRSIZE);
-				bool aVoteChecked[SERVER_MAX_CLIENTS] = {0};
-				for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
-				{
-					if(!m_apPlayers[i] || m_apPlayers[i]->GetTeam() == TEAM_SPECTATORS || aVoteChecked[i]) // don't count in votes by spectators
-						continue;
-
-					int ActVote = m_apPlayers[i]->m_Vote;
-					int ActVotePos = m_apPlayers[i]->m_VotePos;
-
-					// check for more players with the same ip (only use the vote of the one who voted first)
-					for(int j = i + 1; j < SERVER_MAX_CLIENTS; ++j)
-					{
-						if(!m_apPlayers[j] || aVoteChecked[j] || str_comp(aaBuf[j], aaBuf[i]))
-							continue;
-
-						aVoteChecked[j] = true;
-						if(m_apPlayers[j]->m_Vote && (!ActVote || ActVotePos > m_apPlayers[j]->m_VotePos))
-						{
-							ActVote = m_apPlayers[j]->m_Vote;
-							ActVotePos = m_apPlayers[j]->m_VotePos;
-						}
-					}
-
-					Total++;
-					if(ActVote > 0)
-						Yes++;
-					else if(ActVote < 0)
-						No++;
-				}
-			}
-
+			const int Total = m_VoteTotal, Yes = m_VoteYes, No = m_VoteNo;
 			if(m_VoteEnforce == VOTE_CHOICE_YES || (m_VoteUpdate && Yes >= Total / 2 + 1))
 			{
 				Server()->SetRconCID(IServer::RCON_CID_VOTE);
-				Console()->ExecuteLine(m_aVoteCommand);
+				ExecuteVoteCommand(m_aVoteCommand);
 				Server()->SetRconCID(IServer::RCON_CID_SERV);
 				if(m_VoteCreator != -1 && m_apPlayers[m_VoteCreator])
 					m_apPlayers[m_VoteCreator]->m_LastVoteCallTick = 0;
@@ -621,6 +751,7 @@ void CGameContext::OnClientEnter(int ClientID)
 	GameController()->OnPlayerConnect(m_apPlayers[ClientID]);
 	GameMenu()->OnClientEntered(ClientID);
 
+	UpdateVoteAddrGroups(ClientID);
 	m_VoteUpdate = true;
 
 	// update client infos (others before local)
@@ -691,6 +822,8 @@ void CGameContext::OnClientConnected(int ClientID, bool Dummy, bool AsSpec)
 	dbg_assert(!m_apPlayers[ClientID], "non-free player slot");
 
 	m_apPlayers[ClientID] = new(ClientID) CPlayer(this, ClientID, Dummy, AsSpec);
+	m_Events.ResetClientDropped(ClientID);
+	UpdateVoteTally(ClientID);
 
 	if(Dummy)
 		return;
@@ -708,6 +841,7 @@ void CGameContext::OnClientConnected(int ClientID, bool Dummy, bool AsSpec)
 
 void CGameContext::OnClientTeamChange(int ClientID)
 {
+	UpdateVoteTally(ClientID);
 	if(m_apPlayers[ClientID]->GetTeam() == TEAM_SPECTATORS)
 		AbortVoteOnTeamChange(ClientID);
 
@@ -758,6 +892,7 @@ void CGameContext::OnClientDrop(int ClientID, const char *pReason)
 	delete m_apPlayers[ClientID];
 	m_apPlayers[ClientID] = 0;
 
+	UpdateVoteAddrGroups(ClientID);
 	m_VoteUpdate = true;
 
 	Server()->ExpireServerInfo();
@@ -898,7 +1033,7 @@ void CGameContext::OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID)
 				if(pMsg->m_Force)
 				{
 					Server()->SetRconCID(ClientID);
-					Console()->ExecuteLine(aCmd);
+					ExecuteVoteCommand(aCmd);
 					Server()->SetRconCID(IServer::RCON_CID_SERV);
 					return;
 				}
@@ -925,7 +1060,7 @@ void CGameContext::OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID)
 				if(pMsg->m_Force)
 				{
 					Server()->SetRconCID(ClientID);
-					Console()->ExecuteLine(aCmd);
+					ExecuteVoteCommand(aCmd);
 					Server()->SetRconCID(IServer::RCON_CID_SERV);
 					SendForceVote(VOTE_START_SPEC, aDesc, pReason);
 					return;
@@ -940,6 +1075,7 @@ void CGameContext::OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID)
 				StartVote(aDesc, aCmd, pReason);
 				pPlayer->m_Vote = VOTE_CHOICE_YES;
 				pPlayer->m_VotePos = m_VotePos = 1;
+				UpdateVoteTally(ClientID);
 				pPlayer->m_LastVoteCallTick = Now;
 			}
 		}
@@ -956,7 +1092,7 @@ void CGameContext::OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID)
 
 				pPlayer->m_Vote = pMsg->m_Vote;
 				pPlayer->m_VotePos = ++m_VotePos;
-				m_VoteUpdate = true;
+				UpdateVoteTally(ClientID);
 			}
 			else if(m_VoteCreator == pPlayer->GetCID())
 			{
@@ -981,8 +1117,6 @@ void CGameContext::OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID)
 			// Switch team on given client and kill/respawn him
 			if(GameController()->CanJoinTeam(pMsg->m_Team, ClientID) && GameController()->CanChangeTeam(pPlayer, pMsg->m_Team))
 			{
-				if(pPlayer->GetTeam() == TEAM_SPECTATORS || pMsg->m_Team == TEAM_SPECTATORS)
-					m_VoteUpdate = true;
 				pPlayer->m_TeamChangeTick = Server()->Tick() + Server()->TickSpeed() * 3;
 				GameController()->DoTeamChange(pPlayer, pMsg->m_Team);
 			}
@@ -1171,13 +1305,13 @@ void CGameContext::ConTunes(IConsole::IResult *pResult, void *pUserData)
 void CGameContext::ConSay(IConsole::IResult *pResult, void *pUserData)
 {
 	CGameContext *pSelf = (CGameContext *) pUserData;
-	pSelf->SendChat(-1, CHAT_ALL, -1, pResult->GetString(0));
+	pSelf->SendChatLocalized(pResult->GetString(0));
 }
 
 void CGameContext::ConBroadcast(IConsole::IResult *pResult, void *pUserData)
 {
 	CGameContext *pSelf = (CGameContext *) pUserData;
-	pSelf->SendBroadcast(pResult->GetString(0), -1);
+	pSelf->SendBroadcastLocalized(pResult->GetString(0));
 }
 
 void CGameContext::ConSetTeam(IConsole::IResult *pResult, void *pUserData)
@@ -1269,6 +1403,7 @@ void CGameContext::ConAddVote(IConsole::IResult *pResult, void *pUserData)
 	char aBuf[256];
 	str_format(aBuf, sizeof(aBuf), "added option '%s' '%s'", pOption->m_aDescription, pOption->m_aCommand);
 	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+	pSelf->GameMenu()->ClearCache();
 }
 
 void CGameContext::ConRemoveVote(IConsole::IResult *pResult, void *pUserData)
@@ -1329,6 +1464,7 @@ void CGameContext::ConRemoveVote(IConsole::IResult *pResult, void *pUserData)
 	pSelf->m_pVoteOptionFirst = pVoteOptionFirst;
 	pSelf->m_pVoteOptionLast = pVoteOptionLast;
 	pSelf->m_NumVoteOptions = NumVoteOptions;
+	pSelf->GameMenu()->ClearCache();
 }
 
 void CGameContext::ConClearVotes(IConsole::IResult *pResult, void *pUserData)
@@ -1340,6 +1476,7 @@ void CGameContext::ConClearVotes(IConsole::IResult *pResult, void *pUserData)
 	pSelf->m_pVoteOptionFirst = 0;
 	pSelf->m_pVoteOptionLast = 0;
 	pSelf->m_NumVoteOptions = 0;
+	pSelf->GameMenu()->ClearCache();
 }
 
 void CGameContext::ConVote(IConsole::IResult *pResult, void *pUserData)
@@ -1359,6 +1496,41 @@ void CGameContext::ConVote(IConsole::IResult *pResult, void *pUserData)
 	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 }
 
+void CGameContext::ConBotSlots(IConsole::IResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *) pUserData;
+	if(!pSelf->BotManager())
+		return;
+
+	char aBuf[128];
+	for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
+	{
+		if(!pSelf->m_apPlayers[i] || !pSelf->Server()->ClientIngame(i))
+			continue;
+
+		str_format(aBuf, sizeof(aBuf), "id=%d name='%s' visible=%d churn=%d", i, pSelf->Server()->ClientName(i),
+			pSelf->BotManager()->NumVisibleBots(i), pSelf->BotManager()->GetSlotChurn(i));
+		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "bots", aBuf);
+	}
+}
+
+void CGameContext::ConEventStats(IConsole::IResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *) pUserData;
+
+	char aBuf[128];
+	str_format(aBuf, sizeof(aBuf), "dropped=%d", pSelf->m_Events.NumDropped());
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "events", aBuf);
+	for(int i = 0; i < SERVER_MAX_CLIENTS; i++)
+	{
+		if(!pSelf->m_apPlayers[i] || !pSelf->Server()->ClientIngame(i))
+			continue;
+
+		str_format(aBuf, sizeof(aBuf), "id=%d name='%s' dropped=%d", i, pSelf->Server()->ClientName(i), pSelf->m_Events.NumClientDropped(i));
+		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "events", aBuf);
+	}
+}
+
 void CGameContext::ConchainSpecialMotdupdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData)
 {
 	pfnCallback(pResult, pCallbackUserData);
@@ -1398,6 +1570,9 @@ void CGameContext::OnConsoleInit()
 	Console()->Register("remove_vote", "s[option]", CFGFLAG_SERVER, ConRemoveVote, this, "remove a voting option");
 	Console()->Register("clear_votes", "", CFGFLAG_SERVER, ConClearVotes, this, "Clears the voting options");
 	Console()->Register("vote", "r['yes'|'no']", CFGFLAG_SERVER, ConVote, this, "Force a vote to yes/no");
+
+	Console()->Register("bot_slots", "", CFGFLAG_SERVER, ConBotSlots, this, "Show visible bot slots and slot churn of all clients");
+	Console()->Register("event_stats", "", CFGFLAG_SERVER, ConEventStats, this, "Show events dropped by the event budget");
 }
 
 void CGameContext::NewCommandHook(const CCommandManager::CCommand *pCommand, void *pContext)
@@ -1444,7 +1619,7 @@ bool CGameContext::MenuServerVote(int ClientID, SCallVoteStatus &VoteStatus, cla
 			if(VoteStatus.m_Force)
 			{
 				pSelf->Server()->SetRconCID(ClientID);
-				pSelf->Console()->ExecuteLine(VoteStatus.m_aCmd);
+				pSelf->ExecuteVoteCommand(VoteStatus.m_aCmd);
 				pSelf->Server()->SetRconCID(IServer::RCON_CID_SERV);
 				pSelf->SendForceVote(VOTE_START_OP, VoteStatus.m_aDesc, pReason);
 				return false;
@@ -1455,14 +1630,17 @@ bool CGameContext::MenuServerVote(int ClientID, SCallVoteStatus &VoteStatus, cla
 			pSelf->StartVote(VoteStatus.m_aDesc, VoteStatus.m_aCmd, pReason);
 			pPlayer->m_Vote = VOTE_CHOICE_YES;
 			pPlayer->m_VotePos = pSelf->m_VotePos = 1;
+			pSelf->UpdateVoteTally(ClientID);
 			pPlayer->m_LastVoteCallTick = Now;
 			return false;
 		}
 	}
 
 	pMenu->ClearOptions(ClientID);
-	pMenu->AddPageTitle();
+	// the cache is cleared whenever the vote options change
+	if(pMenu->BeginCachedSection())
 	{
+		pMenu->AddPageTitle();
 		if(pSelf->m_pVoteOptionFirst)
 		{
 			for(CVoteOptionServer *pOption = pSelf->m_pVoteOptionFirst; pOption; pOption = pOption->m_pNext)
@@ -1474,6 +1652,7 @@ bool CGameContext::MenuServerVote(int ClientID, SCallVoteStatus &VoteStatus, cla
 		{
 			pMenu->AddTranslatedOption(_("There's no any server vote"), "NONE");
 		}
+		pMenu->EndCachedSection();
 	}
 
 	return true;
@@ -1502,33 +1681,54 @@ void CGameContext::OnInit()
 		Server()->SnapSetStaticsize(i, m_NetObjHandler.GetObjSize(i));
 
 	m_Layers.Init(Kernel());
-	m_Collision.Init(&m_Layers);
+
+	// the collision data and the entity tiles of known maps are loaded from the map cache
+	IEngineMap *pMap = Kernel()->RequestInterface<IEngineMap>();
+	const bool UseMapCache = Config()->m_SvMapCache;
+	const bool MapCacheLoaded = UseMapCache && m_MapCache.Load(Storage(), pMap->Sha256());
+	m_Collision.Init(&m_Layers, true, UseMapCache ? &m_MapCache : nullptr);
 
 	m_pBotManager = new CBotManager(this);
 	// select gametype
 	m_pController = new CGameController(this);
 	GameController()->RegisterChatCommands(CommandManager());
 
+	auto CreateTileEntity = [this](int Index, int x, int y) {
+		vec2 Pos(x * 32.0f + 16.0f, y * 32.0f + 16.0f);
+		if(Index < ENTITY_OFFSET)
+			GameController()->OnExtraTile(Index, Pos);
+		else
+			GameController()->OnEntity(Index - ENTITY_OFFSET, Pos);
+	};
+
 	// create all entities from the game layer
-	CMapItemLayerTilemap *pTileMap = m_Layers.GameLayer();
-	CTile *pTiles = (CTile *) Kernel()->RequestInterface<IMap>()->GetData(pTileMap->m_Data);
-	for(int y = 0; y < pTileMap->m_Height; y++)
+	if(!MapCacheLoaded)
 	{
-		for(int x = 0; x < pTileMap->m_Width; x++)
+		CMapItemLayerTilemap *pTileMap = m_Layers.GameLayer();
+		CTile *pTiles = (CTile *) pMap->GetData(pTileMap->m_Data);
+		for(int y = 0; y < pTileMap->m_Height; y++)
 		{
-			int Index = pTiles[y * pTileMap->m_Width + x].m_Index;
-
-			if(Index > TILE_NOHOOK && Index < ENTITY_OFFSET)
-			{
-				vec2 Pos(x * 32.0f + 16.0f, y * 32.0f + 16.0f);
-				GameController()->OnExtraTile(Index, Pos);
-			}
-			else if(Index >= ENTITY_OFFSET)
+			for(int x = 0; x < pTileMap->m_Width; x++)
 			{
-				vec2 Pos(x * 32.0f + 16.0f, y * 32.0f + 16.0f);
-				GameController()->OnEntity(Index - ENTITY_OFFSET, Pos);
+				int Index = pTiles[y * pTileMap->m_Width + x].m_Index;
+				if(Index <= TILE_NOHOOK)
+					continue;
+				if(UseMapCache)
+					m_MapCache.AddTileEntity(Index, x, y);
+				else
+					CreateTileEntity(Index, x, y);
 			}
 		}
+		if(UseMapCache)
+			m_MapCache.Save(Storage(), pMap->Sha256(), Kernel()->RequestInterface<IEngine>());
+	}
+	if(UseMapCache)
+	{
+		for(int i = 0; i < m_MapCache.NumTileEntities(); i++)
+		{
+			const CMapCache::CTileEntity *pEntity = m_MapCache.TileEntity(i);
+			CreateTileEntity(pEntity->m_Index, pEntity->m_X, pEntity->m_Y);
+		}
 	}
 
 	WeaponManager()->OutputRegisteredWeapons();
@@ -1619,6 +1819,20 @@ const char *CGameContext::NetVersion() const { return GAME_NETVERSION; }
 const char *CGameContext::NetVersionHashUsed() const { return GAME_NETVERSION_HASH_FORCED; }
 const char *CGameContext::NetVersionHashReal() const { return GAME_NETVERSION_HASH; }
 
+void CGameContext::OnMetrics(CMetricsWriter *pWriter)
+{
+	static const char *s_apEntityTypes[] = {"projectile", "laser", "pickup", "character", "flag", "bot"};
+	static_assert(std::size(s_apEntityTypes) == CGameWorld::NUM_ENTTYPES, "every entity type needs a name");
+	pWriter->Describe("carbon_entities", "gauge", "Entities in the game world");
+	for(int i = 0; i < CGameWorld::NUM_ENTTYPES; i++)
+	{
+		char aLabels[32];
+		str_format(aLabels, sizeof(aLabels), "type=\"%s\"", s_apEntityTypes[i]);
+		pWriter->Value("carbon_entities", aLabels, (int64) m_World.NumEntities(i));
+	}
+	pWriter->Counter("carbon_events_dropped_total", "Events dropped because the event buffer was full", m_Events.NumDropped());
+}
+
 IGameServer *CreateGameServer() { return new CGameContext; }
 
 void CGameContext::OnUpdatePlayerServerInfo(CJsonStringWriter *pJSonWriter, int Id)
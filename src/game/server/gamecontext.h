@@ -8,12 +8,15 @@
 
 #include <game/commands.h>
 #include <game/layers.h>
+#include <game/mapcache.h>
 #include <game/voting.h>
 
 #include "eventhandler.h"
 #include "gamemenu.h"
 #include "gameworld.h"
 
+#include <string>
+#include <unordered_map>
 #include <vector>
 /*
 	Tick
@@ -43,6 +46,7 @@ class CGameContext : public IGameServer
 	class IConsole *m_pConsole;
 	class IStorage *m_pStorage;
 	CLayers m_Layers;
+	CMapCache m_MapCache;
 	CCollision m_Collision;
 	CNetObjHandler m_NetObjHandler;
 	CTuningParams m_Tuning;
@@ -63,6 +67,8 @@ class CGameContext : public IGameServer
 	static void ConRemoveVote(IConsole::IResult *pResult, void *pUserData);
 	static void ConClearVotes(IConsole::IResult *pResult, void *pUserData);
 	static void ConVote(IConsole::IResult *pResult, void *pUserData);
+	static void ConBotSlots(IConsole::IResult *pResult, void *pUserData);
+	static void ConEventStats(IConsole::IResult *pResult, void *pUserData);
 	static void ConchainSpecialMotdupdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainSettingUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 
@@ -109,6 +115,14 @@ public:
 	void EndVote(int Type, bool Force);
 	void AbortVoteOnDisconnect(int ClientID);
 	void AbortVoteOnTeamChange(int ClientID);
+	void UpdateVoteAddrGroups(int ClientID);
+	// keeps the vote totals current, call it whenever a vote or the team of a player changes
+	void UpdateVoteTally(int ClientID);
+	void ResetVoteTally();
+	bool UpdateVoteGroup(int Group);
+	// runs vote commands from lines parsed on first use, the lines live until the next reset
+	void ExecuteVoteCommand(const char *pCommand);
+	std::unordered_map<std::string, IConsole::IParsedLine *> m_VoteCommandLines;
 
 	int m_VoteCreator;
 	int m_VoteType;
@@ -122,10 +136,23 @@ public:
 	int m_VoteClientID;
 	int m_NumVoteOptions;
 	int m_VoteEnforce;
+	// clients with the same ip only have one vote, ingame clients are grouped by their address without port
+	NETADDR m_aVoteAddr[SERVER_MAX_CLIENTS];
+	unsigned m_aVoteAddrHash[SERVER_MAX_CLIENTS];
+	// the lowest client id with the same address
+	int m_aVoteAddrGroup[SERVER_MAX_CLIENTS];
+	// what every group adds to the totals, the tick only reads the totals
+	bool m_aVoteGroupCounted[SERVER_MAX_CLIENTS];
+	int m_aVoteGroupChoice[SERVER_MAX_CLIENTS];
+	int m_VoteTotal;
+	int m_VoteYes;
+	int m_VoteNo;
 	enum
 	{
 		VOTE_TIME = 25,
 		VOTE_CANCEL_TIME = 10,
+		// kick and ban votes carry addresses, don't let them grow the parsed lines forever
+		MAX_VOTE_COMMAND_LINES = MAX_VOTE_OPTIONS * 2,
 
 		MIN_SKINCHANGE_CLIENTVERSION = 0x0703,
 		MIN_RACE_CLIENTVERSION = 0x0704,
@@ -145,6 +172,9 @@ public:
 	// ----- send functions -----
 	void SendChat(int ChatterClientID, int Mode, int To, const char *pText);
 	void SendBroadcast(const char *pText, int ClientID);
+	// translated for every player in the mask, packed once per language
+	void SendChatLocalized(const char *pText, int64 Mask = -1);
+	void SendBroadcastLocalized(const char *pText, int64 Mask = -1);
 	void SendEmoticon(int ClientID, int Emoticon);
 	void SendWeaponPickup(int ClientID, int Weapon);
 	void SendMotd(int ClientID);
@@ -201,8 +231,10 @@ public:
 	const char *NetVersionHashReal() const override;
 
 	void OnUpdatePlayerServerInfo(class CJsonStringWriter *pJSonWriter, int Id) override;
+	void OnMetrics(class CMetricsWriter *pWriter) override;
 };
 
+// the bit after the clients is the server demo
 inline int64 CmaskAll() { return -1; }
 inline int64 CmaskOne(int ClientID) { return (int64) 1 << ClientID; }
 inline int64 CmaskAllExceptOne(int ClientID) { return CmaskAll() ^ CmaskOne(ClientID); }
@@ -131,8 +131,10 @@ void CGameController::OnCharacterSpawn(CCharacter *pChr)
 	pChr->IncreaseHealth(10);
 
 	// give default weapons
-	pChr->SetWeapon(WEAPON_HAMMER, CalculateUuid("Hammer"), -1);
-	pChr->SetWeapon(WEAPON_GUN, CalculateUuid("Gun"), 10);
+	constexpr Uuid HammerUuid = CalculateConstUuid("Hammer");
+	constexpr Uuid GunUuid = CalculateConstUuid("Gun");
+	pChr->SetWeapon(WEAPON_HAMMER, HammerUuid, -1);
+	pChr->SetWeapon(WEAPON_GUN, GunUuid, 10);
 }
 
 void CGameController::OnFlagReturn(CFlag *pFlag)
@@ -35,6 +35,7 @@ void CGameMenu::Register(const char *pPageName, const char *pTitle, MenuCallback
 	pPage->m_ParentUuid = CalculateUuid(pParent);
 	str_copy(pPage->m_aTitle, pTitle, sizeof(pPage->m_aTitle));
 	m_vpMenuPages[pPage->m_Uuid] = pPage;
+	ClearCache();
 }
 
 void CGameMenu::OnClientEntered(int ClientID)
@@ -52,6 +53,8 @@ void CGameMenu::OnMenuVote(int ClientID, SCallVoteStatus &VoteStatus, bool Sound
 		return;
 
 	m_CurrentClientID = ClientID;
+	// set again by ClearOptions, a page that keeps its old options can't use the packed cache
+	m_aPlayerData[ClientID].m_AllCached = false;
 
 	Uuid &CurrentPage = m_aPlayerData[ClientID].m_CurrentPage;
 	if(!m_vpMenuPages.count(CurrentPage))
@@ -92,10 +95,34 @@ void CGameMenu::OnMenuVote(int ClientID, SCallVoteStatus &VoteStatus, bool Sound
 	if(!m_vpMenuPages[CurrentPage]->m_pfnCallback(ClientID, VoteStatus, this, m_vpMenuPages[CurrentPage]->m_pUserData))
 		return;
 	// add back page
-	if(CurrentPage != MENU_MAIN_PAGE_UUID)
+	if(CurrentPage != MENU_MAIN_PAGE_UUID && BeginCachedSection())
 	{
 		AddHorizontalRule();
 		AddTranslatedOption(_("Previous Page"), "PREPAGE", "=");
+		EndCachedSection();
+	}
+
+	SendOptions(ClientID);
+}
+
+void CGameMenu::SendOptions(int ClientID)
+{
+	// pages made of cached sections only are the same for every client with the same key
+	std::vector<std::vector<unsigned char>> *pvCachedMessages = nullptr;
+	if(m_aPlayerData[ClientID].m_AllCached && m_aPlayerData[ClientID].m_NumSections > 0)
+	{
+		pvCachedMessages = &m_CachedMessages[CacheKey(ClientID, m_aPlayerData[ClientID].m_NumSections)];
+		if(!pvCachedMessages->empty())
+		{
+			for(const auto &vData : *pvCachedMessages)
+			{
+				CMsgPacker Msg(NETMSGTYPE_SV_VOTEOPTIONLISTADD);
+				Msg.Reset();
+				Msg.AddRaw(vData.data(), vData.size());
+				Server()->SendMsg(&Msg, MSGFLAG_VITAL, ClientID);
+			}
+			return;
+		}
 	}
 
 	CVoteOptionServer *pCurrent = m_aPlayerData[ClientID].m_pVoteOptionFirst;
@@ -115,6 +142,8 @@ void CGameMenu::OnMenuVote(int ClientID, SCallVoteStatus &VoteStatus, bool Sound
 			pCurrent = pCurrent->m_pNext;
 		}
 		Server()->SendMsg(&Msg, MSGFLAG_VITAL, ClientID);
+		if(pvCachedMessages)
+			pvCachedMessages->emplace_back(Msg.Data(), Msg.Data() + Msg.Size());
 	}
 }
 
@@ -143,6 +172,9 @@ void CGameMenu::ClearOptions(int ClientID)
 	m_aPlayerData[ClientID].m_pVoteOptionFirst = nullptr;
 	m_aPlayerData[ClientID].m_pVoteOptionLast = nullptr;
 	m_aPlayerData[ClientID].m_NumVoteOptions = 0;
+	m_aPlayerData[ClientID].m_NumSections = 0;
+	m_aPlayerData[ClientID].m_InSection = false;
+	m_aPlayerData[ClientID].m_AllCached = true;
 }
 
 void CGameMenu::SetPlayerPage(int ClientID, Uuid Page)
@@ -158,7 +190,7 @@ void CGameMenu::SetPlayerPage(int ClientID, const char *pPage)
 {
 	if(!pPage || !pPage[0])
 		return;
-	SetPlayerPage(ClientID, CalculateUuid(pPage));
+	SetPlayerPage(ClientID, m_PageUuids.Get(pPage));
 }
 // static
 bool CGameMenu::MenuMain(int ClientID, SCallVoteStatus &VoteStatus, class CGameMenu *pMenu, void *pUserData)
@@ -188,7 +220,11 @@ bool CGameMenu::MenuMain(int ClientID, SCallVoteStatus &VoteStatus, class CGameM
 	}
 
 	pMenu->ClearOptions(ClientID);
-	pMenu->AddPageTitle();
+	if(pMenu->BeginCachedSection())
+	{
+		pMenu->AddPageTitle();
+		pMenu->EndCachedSection();
+	}
 	// TIP
 	if(!pMenu->GameServer()->m_apPlayers[ClientID]->m_HideTip)
 	{
@@ -219,11 +255,13 @@ bool CGameMenu::MenuMain(int ClientID, SCallVoteStatus &VoteStatus, class CGameM
 		}
 		pMenu->AddOption(aBuf, DisplayAddr ? "DISPLAY" : "DISPLAY ADDR", "-");
 	}
-	pMenu->AddHorizontalRule();
 	// options
+	if(pMenu->BeginCachedSection())
 	{
+		pMenu->AddHorizontalRule();
 		pMenu->AddTranslatedOption(_("Server Vote"), "PAGE SERVER VOTE", "★");
 		pMenu->AddTranslatedOption(_("Language Settings"), "PAGE LANGUAGE", "★");
+		pMenu->EndCachedSection();
 	}
 
 	return true;
@@ -244,8 +282,10 @@ bool CGameMenu::MenuLanguage(int ClientID, SCallVoteStatus &VoteStatus, class CG
 	}
 
 	pMenu->ClearOptions(ClientID);
-	pMenu->AddPageTitle();
+	// only depends on the language of the client
+	if(pMenu->BeginCachedSection())
 	{
+		pMenu->AddPageTitle();
 		SLanguageInfo *pInfo = nullptr;
 		if(size_t LanguagesNum = pMenu->Server()->GetLanguagesInfo(&pInfo))
 		{
@@ -264,6 +304,7 @@ bool CGameMenu::MenuLanguage(int ClientID, SCallVoteStatus &VoteStatus, class CG
 		{
 			pMenu->AddTranslatedOption(_("Oops, couldn't find any language. (Click to refresh)"), "DISPLAY");
 		}
+		pMenu->EndCachedSection();
 	}
 
 	return true;
@@ -299,6 +340,9 @@ void CGameMenu::AddOption(const char *pDesc, const char *pCommand, const char *p
 		return;
 	if(!pDesc[0] || !pCommand[0])
 		return;
+	if(!m_aPlayerData[m_CurrentClientID].m_InSection)
+		m_aPlayerData[m_CurrentClientID].m_AllCached = false;
+
 	// add the option
 	++m_aPlayerData[m_CurrentClientID].m_NumVoteOptions;
 	int Len = str_length(pCommand);
@@ -330,6 +374,59 @@ void CGameMenu::AddTranslatedOption(const char *pDesc, const char *pCommand, con
 	return AddOption(Localize(pDesc), pCommand, pPrefix);
 }
 
+CGameMenu::CCacheKey CGameMenu::CacheKey(int ClientID, int Section) const
+{
+	CCacheKey Key;
+	Key.m_Page = m_aPlayerData[ClientID].m_CurrentPage;
+	Key.m_Language = Server()->ClientLanguage(ClientID);
+	Key.m_Authed = Server()->IsAuthed(ClientID);
+	Key.m_Section = Section;
+	return Key;
+}
+
+bool CGameMenu::BeginCachedSection()
+{
+	if(m_CurrentClientID < 0 || m_CurrentClientID >= SERVER_MAX_CLIENTS)
+		return true;
+
+	CPlayerData &Data = m_aPlayerData[m_CurrentClientID];
+	dbg_assert(!Data.m_InSection, "cached menu sections can't be nested");
+	auto Section = m_CachedSections.find(CacheKey(m_CurrentClientID, Data.m_NumSections++));
+	Data.m_InSection = true;
+	if(Section != m_CachedSections.end())
+	{
+		for(const auto &Option : Section->second)
+			AddOption(Option.m_Description.c_str(), Option.m_Command.c_str());
+		Data.m_InSection = false;
+		return false;
+	}
+
+	Data.m_pSectionStart = Data.m_pVoteOptionLast;
+	return true;
+}
+
+void CGameMenu::EndCachedSection()
+{
+	if(m_CurrentClientID < 0 || m_CurrentClientID >= SERVER_MAX_CLIENTS)
+		return;
+
+	CPlayerData &Data = m_aPlayerData[m_CurrentClientID];
+	if(!Data.m_InSection)
+		return;
+
+	std::vector<CCachedOption> &vOptions = m_CachedSections[CacheKey(m_CurrentClientID, Data.m_NumSections - 1)];
+	vOptions.clear();
+	for(CVoteOptionServer *pOption = Data.m_pSectionStart ? Data.m_pSectionStart->m_pNext : Data.m_pVoteOptionFirst; pOption; pOption = pOption->m_pNext)
+		vOptions.push_back({pOption->m_aDescription, pOption->m_aCommand});
+	Data.m_InSection = false;
+}
+
+void CGameMenu::ClearCache()
+{
+	m_CachedSections.clear();
+	m_CachedMessages.clear();
+}
+
 const char *CGameMenu::Localize(const char *pStr, const char *pContext)
 {
 	if(m_CurrentClientID == -1)
@@ -4,10 +4,12 @@
 #include <base/uuid.h>
 #include <game/voting.h>
 
+#include <map>
 #include <memory>
+#include <string>
 #include <vector>
 
-#define MENU_MAIN_PAGE_UUID CalculateUuid("MAIN")
+static constexpr Uuid MENU_MAIN_PAGE_UUID = CalculateConstUuid("MAIN");
 #define MENU_OPTIONS_NUM 12
 
 struct SCallVoteStatus
@@ -58,6 +60,15 @@ public:
 	void AddOption(const char *pDesc, const char *pCommand, const char *pPrefix = "");
 	void AddTranslatedOption(const char *pDesc, const char *pCommand, const char *pPrefix = "");
 
+	// Options added between these only depend on the page, the language and the auth level
+	// of the client. They are generated once and replayed from the cache afterwards, generate
+	// the section only if BeginCachedSection returns true:
+	// if(pMenu->BeginCachedSection()) { pMenu->AddOption(...); pMenu->EndCachedSection(); }
+	// All clients on a page must open the same sections in the same order.
+	bool BeginCachedSection();
+	void EndCachedSection();
+	void ClearCache();
+
 	const char *Localize(const char *pStr, const char *pContext = "");
 
 private:
@@ -66,6 +77,40 @@ private:
 	static bool MenuLanguage(int ClientID, SCallVoteStatus &VoteStatus, class CGameMenu *pMenu, void *pUserData);
 
 	std::unordered_map<Uuid, std::shared_ptr<SMenuPage>> m_vpMenuPages;
+	CUuidCache m_PageUuids;
+
+	struct CCacheKey
+	{
+		Uuid m_Page;
+		std::string m_Language;
+		bool m_Authed;
+		// index of the section in the page, or the number of sections for the packed messages
+		int m_Section;
+
+		bool operator<(const CCacheKey &Other) const
+		{
+			if(m_Page != Other.m_Page)
+				return m_Page < Other.m_Page;
+			if(m_Language != Other.m_Language)
+				return m_Language < Other.m_Language;
+			if(m_Authed != Other.m_Authed)
+				return m_Authed < Other.m_Authed;
+			return m_Section < Other.m_Section;
+		}
+	};
+
+	struct CCachedOption
+	{
+		std::string m_Description;
+		std::string m_Command;
+	};
+
+	std::map<CCacheKey, std::vector<CCachedOption>> m_CachedSections;
+	// vote option messages of pages that consist of cached sections only
+	std::map<CCacheKey, std::vector<std::vector<unsigned char>>> m_CachedMessages;
+
+	CCacheKey CacheKey(int ClientID, int Section) const;
+	void SendOptions(int ClientID);
 
 	class CPlayerData
 	{
@@ -78,6 +123,12 @@ private:
 		Uuid m_CurrentPage;
 		char m_aMenuChat[48];
 
+		// state of the cached sections since the last ClearOptions
+		int m_NumSections;
+		bool m_InSection;
+		bool m_AllCached;
+		CVoteOptionServer *m_pSectionStart;
+
 		void Reset(bool Clear = false)
 		{
 			if(Clear)
@@ -89,6 +140,10 @@ private:
 
 			m_CurrentPage = MENU_MAIN_PAGE_UUID;
 			m_aMenuChat[0] = '\0';
+			m_NumSections = 0;
+			m_InSection = false;
+			m_AllCached = false;
+			m_pSectionStart = nullptr;
 		}
 
 		CPlayerData();
@@ -19,7 +19,10 @@ CGameWorld::CGameWorld()
 	m_Paused = false;
 	m_ResetRequested = false;
 	for(int i = 0; i < NUM_ENTTYPES; i++)
+	{
 		m_apFirstEntityTypes[i] = nullptr;
+		m_aNumEntities[i] = 0;
+	}
 }
 
 CGameWorld::~CGameWorld()
@@ -97,6 +100,7 @@ void CGameWorld::InsertEntity(CEntity *pEnt)
 	pEnt->m_pNextTypeEntity = m_apFirstEntityTypes[pEnt->m_ObjType];
 	pEnt->m_pPrevTypeEntity = 0x0;
 	m_apFirstEntityTypes[pEnt->m_ObjType] = pEnt;
+	m_aNumEntities[pEnt->m_ObjType]++;
 }
 
 void CGameWorld::DestroyEntity(CEntity *pEnt)
@@ -117,6 +121,7 @@ void CGameWorld::RemoveEntity(CEntity *pEnt)
 		m_apFirstEntityTypes[pEnt->m_ObjType] = pEnt->m_pNextTypeEntity;
 	if(pEnt->m_pNextTypeEntity)
 		pEnt->m_pNextTypeEntity->m_pPrevTypeEntity = pEnt->m_pPrevTypeEntity;
+	m_aNumEntities[pEnt->m_ObjType]--;
 
 	// keep list traversing valid
 	if(m_pNextTraverseEntity == pEnt)
@@ -201,6 +206,8 @@ void CGameWorld::Tick()
 	}
 	else
 	{
+		m_Core.UpdateBroadphase();
+
 		// update all objects
 		for(int i = 0; i < NUM_ENTTYPES; i++)
 			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt;)
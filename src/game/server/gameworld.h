@@ -51,6 +51,7 @@ private:
 
 	CEntity *m_pNextTraverseEntity;
 	CEntity *m_apFirstEntityTypes[NUM_ENTTYPES];
+	int m_aNumEntities[NUM_ENTTYPES];
 
 	class CGameContext *m_pGameServer;
 	class CConfig *m_pConfig;
@@ -71,6 +72,7 @@ public:
 	void SetGameServer(CGameContext *pGameServer);
 
 	CEntity *FindFirst(int Type);
+	int NumEntities(int Type) const { return m_aNumEntities[Type]; }
 
 	/*
 		Function: find_entities
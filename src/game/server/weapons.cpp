@@ -27,7 +27,7 @@ static CWeaponHand gs_WeaponHand;
 
 class CWeaponManager : public IWeaponManager
 {
-	std::unordered_map<Uuid, IWeaponInterface *> m_upWeapons;
+	std::unordered_map<Uuid, int> m_WeaponHandles;
 
 public:
 	CWeaponManager();
@@ -37,37 +37,58 @@ public:
 	void OutputRegisteredWeapons() override;
 
 	IWeaponInterface *GetWeapon(Uuid WeaponID) override;
+	int FindWeapon(Uuid WeaponID) override;
 };
 
 CWeaponManager::CWeaponManager()
 {
-	m_upWeapons.clear();
+	m_WeaponHandles.clear();
+	m_vWeaponInfos.clear();
 	RegisterWeapon("Hand", &gs_WeaponHand);
 }
 
 void CWeaponManager::RegisterWeapon(const char *pWeapon, IWeaponInterface *pClass)
 {
 	Uuid WeaponID = CalculateUuid(pWeapon);
-	if(m_upWeapons.count(WeaponID))
+	if(m_WeaponHandles.count(WeaponID))
 		return; // weapon exists
-	m_upWeapons[WeaponID] = pClass;
+
+	CWeaponInfo Info;
+	Info.m_Uuid = WeaponID;
+	Info.m_pWeapon = pClass;
+	Info.m_pName = pClass->Name();
+	Info.m_FullAuto = pClass->FullAuto();
+	Info.m_FireDelay = pClass->FireDelay();
+	Info.m_SnapStyle = pClass->SnapStyle();
+	Info.m_AmmoRegenTime = pClass->AmmoRegenTime();
+	Info.m_DefaultAmmo = pClass->DefaultAmmo();
+	Info.m_MaxAmmo = pClass->MaxAmmo();
+
+	m_WeaponHandles[WeaponID] = m_vWeaponInfos.size();
+	m_vWeaponInfos.push_back(Info);
 }
 
 void CWeaponManager::OutputRegisteredWeapons()
 {
-	for(auto &[Uuid, pWeapon] : m_upWeapons)
+	for(const CWeaponInfo &Info : m_vWeaponInfos)
 	{
 		char aUuid[UUID_MAXSTRSIZE];
-		FormatUuid(Uuid, aUuid, sizeof(aUuid));
-		dbg_msg("game/weapons", "registered weapon '%s' as uuid '%s'", pWeapon->Name(), aUuid);
+		FormatUuid(Info.m_Uuid, aUuid, sizeof(aUuid));
+		dbg_msg("game/weapons", "registered weapon '%s' as uuid '%s'", Info.m_pName, aUuid);
 	}
 }
 
 IWeaponInterface *CWeaponManager::GetWeapon(Uuid WeaponID)
 {
-	if(m_upWeapons.count(WeaponID))
-		return m_upWeapons[WeaponID];
-	return &gs_WeaponHand;
+	return m_vWeaponInfos[FindWeapon(WeaponID)].m_pWeapon;
+}
+
+int CWeaponManager::FindWeapon(Uuid WeaponID)
+{
+	auto It = m_WeaponHandles.find(WeaponID);
+	if(It == m_WeaponHandles.end())
+		return WEAPON_HAND;
+	return It->second;
 }
 
 IWeaponManager *WeaponManager()
@@ -4,6 +4,7 @@
 #include <base/uuid.h>
 #include <base/vmath.h>
 #include <condition_variable>
+#include <vector>
 
 class IWeaponInterface
 {
@@ -23,9 +24,35 @@ public:
 	virtual int MaxAmmo() = 0;
 };
 
+// the properties of a weapon which never change, read once when it is registered
+struct CWeaponInfo
+{
+	Uuid m_Uuid;
+	IWeaponInterface *m_pWeapon;
+	const char *m_pName;
+	bool m_FullAuto;
+	int m_FireDelay;
+	int m_SnapStyle;
+
+	// Ammo
+	int m_AmmoRegenTime;
+	int m_DefaultAmmo;
+	int m_MaxAmmo;
+};
+
 class IWeaponManager
 {
+protected:
+	// indexed by weapon handle
+	std::vector<CWeaponInfo> m_vWeaponInfos;
+
 public:
+	enum
+	{
+		// the handle of the weapon which is used for unknown uuids
+		WEAPON_HAND = 0,
+	};
+
 	IWeaponManager() {};
 	virtual ~IWeaponManager() {};
 
@@ -33,6 +60,11 @@ public:
 	virtual void OutputRegisteredWeapons() = 0;
 
 	virtual IWeaponInterface *GetWeapon(Uuid WeaponID) = 0;
+	// resolve the uuid once and keep the handle, it stays valid for the whole run
+	virtual int FindWeapon(Uuid WeaponID) = 0;
+
+	const CWeaponInfo &WeaponInfo(int Handle) const { return m_vWeaponInfos[Handle]; }
+	int NumWeapons() const { return m_vWeaponInfos.size(); }
 };
 
 extern IWeaponManager *WeaponManager();
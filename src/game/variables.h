@@ -131,6 +131,8 @@ MACRO_CONFIG_INT(SvVoteKickMin, sv_vote_kick_min, 0, 0, SERVER_MAX_CLIENTS, CFGF
 MACRO_CONFIG_INT(SvVoteKickBantime, sv_vote_kick_bantime, 5, 0, 1440, CFGFLAG_SAVE | CFGFLAG_SERVER, "The time to ban a player if kicked by vote. 0 makes it just use kick")
 
 MACRO_CONFIG_INT(SvHealthRegenTime, sv_health_regen_time, 500, 200, 10000, CFGFLAG_SAVE | CFGFLAG_SERVER, "The time of health regen (on the bench, in ms)")
+MACRO_CONFIG_INT(SvBotSlotHysteresis, sv_bot_slot_hysteresis, 64, 0, 1000, CFGFLAG_SAVE | CFGFLAG_SERVER, "How much closer (in units) a bot has to be to take over a visible bot slot")
+MACRO_CONFIG_INT(SvMapCache, sv_map_cache, 1, 0, 1, CFGFLAG_SAVE | CFGFLAG_SERVER, "Keep precomputed map data in the save directory to speed up map loading")
 
 // debug
 #ifdef CONF_DEBUG // this one can crash the server if not used correctly
@@ -0,0 +1,277 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/map.h>
+#include <engine/storage.h>
+
+#include <game/collision.h>
+#include <game/layers.h>
+#include <game/mapitems.h>
+
+#include <vector>
+
+// the implementations which were used before the tile traversal and the bitplanes
+static bool ReferenceCheckPoint(const CCollision *pCollision, vec2 Pos, int Flag = CCollision::COLFLAG_SOLID)
+{
+	return pCollision->GetCollisionAt(Pos.x, Pos.y) & Flag;
+}
+
+static bool ReferenceTestBox(const CCollision *pCollision, vec2 Pos, vec2 Size, int Flag = CCollision::COLFLAG_SOLID)
+{
+	Size *= 0.5f;
+	return ReferenceCheckPoint(pCollision, vec2(Pos.x - Size.x, Pos.y - Size.y), Flag) ||
+	       ReferenceCheckPoint(pCollision, vec2(Pos.x + Size.x, Pos.y - Size.y), Flag) ||
+	       ReferenceCheckPoint(pCollision, vec2(Pos.x - Size.x, Pos.y + Size.y), Flag) ||
+	       ReferenceCheckPoint(pCollision, vec2(Pos.x + Size.x, Pos.y + Size.y), Flag);
+}
+
+static int ReferenceIntersectLine(const CCollision *pCollision, vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision)
+{
+	const int End = distance(Pos0, Pos1) + 1;
+	const float InverseEnd = 1.0f / End;
+	vec2 Last = Pos0;
+
+	for(int i = 0; i <= End; i++)
+	{
+		vec2 Pos = mix(Pos0, Pos1, i * InverseEnd);
+		if(ReferenceCheckPoint(pCollision, Pos))
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			return pCollision->GetCollisionAt(Pos.x, Pos.y);
+		}
+		Last = Pos;
+	}
+	*pOutCollision = Pos1;
+	*pOutBeforeCollision = Pos1;
+	return 0;
+}
+
+static void ReferenceMoveBox(const CCollision *pCollision, vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elasticity, bool *pDeath)
+{
+	vec2 Pos = *pInoutPos;
+	vec2 Vel = *pInoutVel;
+
+	const float Distance = length(Vel);
+	const int Max = (int) Distance;
+
+	if(pDeath)
+		*pDeath = false;
+
+	if(Distance > 0.00001f)
+	{
+		const float Fraction = 1.0f / (Max + 1);
+		for(int i = 0; i <= Max; i++)
+		{
+			vec2 NewPos = Pos + Vel * Fraction;
+
+			if(pDeath && ReferenceTestBox(pCollision, vec2(NewPos.x, NewPos.y), Size * (2.0f / 3.0f), CCollision::COLFLAG_DEATH))
+				*pDeath = true;
+
+			if(ReferenceTestBox(pCollision, vec2(NewPos.x, NewPos.y), Size))
+			{
+				int Hits = 0;
+
+				if(ReferenceTestBox(pCollision, vec2(Pos.x, NewPos.y), Size))
+				{
+					NewPos.y = Pos.y;
+					Vel.y *= -Elasticity;
+					Hits++;
+				}
+
+				if(ReferenceTestBox(pCollision, vec2(NewPos.x, Pos.y), Size))
+				{
+					NewPos.x = Pos.x;
+					Vel.x *= -Elasticity;
+					Hits++;
+				}
+
+				if(Hits == 0)
+				{
+					NewPos.y = Pos.y;
+					Vel.y *= -Elasticity;
+					NewPos.x = Pos.x;
+					Vel.x *= -Elasticity;
+				}
+			}
+
+			Pos = NewPos;
+		}
+	}
+
+	*pInoutPos = Pos;
+	*pInoutVel = Vel;
+}
+
+class Collision : public ::testing::TestWithParam<const char *>
+{
+protected:
+	IStorage *m_pStorage;
+	IEngineMap *m_pMap;
+	CLayers m_Layers;
+	CCollision m_Collision;
+	unsigned m_Seed;
+
+	void SetUp() override
+	{
+		char aMap[128];
+		str_format(aMap, sizeof(aMap), "data/maps/%s.map", GetParam());
+		m_pStorage = CreateTestStorage();
+		m_pMap = CreateEngineMap();
+		m_Seed = 5678;
+		if(!m_pMap->Load(aMap, m_pStorage))
+			GTEST_SKIP() << "map " << aMap << " not found";
+		m_Layers.Init(nullptr, m_pMap);
+		m_Collision.Init(&m_Layers);
+	}
+
+	void TearDown() override
+	{
+		delete m_pMap;
+		delete m_pStorage;
+	}
+
+	float Random(float Min, float Max)
+	{
+		m_Seed = m_Seed * 1103515245 + 12345;
+		return Min + (Max - Min) * ((m_Seed >> 8) & 0xffff) / 65535.0f;
+	}
+
+	vec2 RandomPos()
+	{
+		return vec2(Random(-200.0f, m_Collision.GetWidth() * 32 + 200.0f), Random(-200.0f, m_Collision.GetHeight() * 32 + 200.0f));
+	}
+};
+
+TEST_P(Collision, IntersectLineMatchesSampling)
+{
+	for(int i = 0; i < 20000; i++)
+	{
+		vec2 Pos0 = RandomPos();
+		vec2 Pos1 = i % 4 ? Pos0 + vec2(Random(-800.0f, 800.0f), Random(-800.0f, 800.0f)) : RandomPos();
+		if(i % 100 == 0)
+			Pos1 = Pos0;
+
+		vec2 Expected, ExpectedBefore, Actual, ActualBefore;
+		int ExpectedHit = ReferenceIntersectLine(&m_Collision, Pos0, Pos1, &Expected, &ExpectedBefore);
+		int ActualHit = m_Collision.IntersectLine(Pos0, Pos1, &Actual, &ActualBefore);
+		ASSERT_EQ(ExpectedHit, ActualHit) << "from (" << Pos0.x << ", " << Pos0.y << ") to (" << Pos1.x << ", " << Pos1.y << ")";
+		ASSERT_TRUE(Expected == Actual);
+		ASSERT_TRUE(ExpectedBefore == ActualBefore);
+	}
+}
+
+TEST_P(Collision, MoveBoxMatchesStepping)
+{
+	const vec2 Size(28.0f, 28.0f);
+	for(int i = 0; i < 20000; i++)
+	{
+		vec2 Pos = RandomPos();
+		vec2 Vel = vec2(Random(-40.0f, 40.0f), Random(-40.0f, 40.0f));
+		if(i % 10 == 0)
+			Vel *= 8.0f;
+		float Elasticity = i % 2 ? 0.0f : 0.5f;
+
+		vec2 ExpectedPos = Pos, ExpectedVel = Vel, ActualPos = Pos, ActualVel = Vel;
+		bool ExpectedDeath = false, ActualDeath = false;
+		ReferenceMoveBox(&m_Collision, &ExpectedPos, &ExpectedVel, Size, Elasticity, i % 3 ? &ExpectedDeath : nullptr);
+		m_Collision.MoveBox(&ActualPos, &ActualVel, Size, Elasticity, i % 3 ? &ActualDeath : nullptr);
+		ASSERT_TRUE(ExpectedPos == ActualPos) << "at (" << Pos.x << ", " << Pos.y << ") with (" << Vel.x << ", " << Vel.y << ")";
+		ASSERT_TRUE(ExpectedVel == ActualVel);
+		ASSERT_EQ(ExpectedDeath, ActualDeath);
+	}
+}
+
+TEST_P(Collision, BitplanesMatchTiles)
+{
+	const int aFlags[] = {CCollision::COLFLAG_SOLID, CCollision::COLFLAG_DEATH, CCollision::COLFLAG_NOHOOK,
+		CCollision::COLFLAG_SOLID | CCollision::COLFLAG_DEATH, TILE_BENCH};
+	for(int y = -2; y < m_Collision.GetHeight() + 2; y++)
+	{
+		for(int x = -2; x < m_Collision.GetWidth() + 2; x++)
+		{
+			vec2 Pos(x * 32.0f + 16.0f, y * 32.0f + 16.0f);
+			for(int Flag : aFlags)
+				ASSERT_EQ(ReferenceCheckPoint(&m_Collision, Pos, Flag), m_Collision.CheckPoint(Pos, Flag)) << "tile " << x << ", " << y;
+		}
+	}
+}
+
+TEST_P(Collision, DistanceFieldMatchesRingSearch)
+{
+	for(int y = 0; y < m_Collision.GetHeight(); y++)
+	{
+		for(int x = 0; x < m_Collision.GetWidth(); x++)
+		{
+			// grow a square ring around the tile until it contains a solid tile
+			int Expected = 0;
+			for(bool Found = false; !Found && Expected < 255; Expected += !Found)
+			{
+				for(int Ny = maximum(y - Expected, 0); !Found && Ny <= minimum(y + Expected, m_Collision.GetHeight() - 1); Ny++)
+				{
+					for(int Nx = maximum(x - Expected, 0); !Found && Nx <= minimum(x + Expected, m_Collision.GetWidth() - 1); Nx++)
+						Found = ReferenceCheckPoint(&m_Collision, vec2(Nx * 32.0f + 16.0f, Ny * 32.0f + 16.0f));
+				}
+			}
+			ASSERT_EQ(Expected, m_Collision.GetSolidDistance(vec2(x * 32.0f + 16.0f, y * 32.0f + 16.0f))) << "tile " << x << ", " << y;
+		}
+	}
+}
+
+INSTANTIATE_TEST_SUITE_P(Maps, Collision, ::testing::Values("ctf5", "dm1", "dm6", "lms1"));
+
+class CollisionBenchmark : public Collision
+{
+};
+
+TEST_P(CollisionBenchmark, Throughput)
+{
+	const int NUM_QUERIES = 200000;
+	std::vector<vec2> vPoints(NUM_QUERIES * 2);
+	for(int i = 0; i < NUM_QUERIES; i++)
+	{
+		vPoints[i * 2] = RandomPos();
+		vPoints[i * 2 + 1] = vPoints[i * 2] + vec2(Random(-600.0f, 600.0f), Random(-600.0f, 600.0f));
+	}
+
+	const vec2 Size(28.0f, 28.0f);
+	int64 aaDuration[2][2];
+	int aHits[2] = {0, 0};
+	for(int New = 0; New < 2; New++)
+	{
+		int64 Start = time_get();
+		for(int i = 0; i < NUM_QUERIES; i++)
+		{
+			vec2 Out, Before;
+			if(New)
+				aHits[New] += m_Collision.IntersectLine(vPoints[i * 2], vPoints[i * 2 + 1], &Out, &Before) != 0;
+			else
+				aHits[New] += ReferenceIntersectLine(&m_Collision, vPoints[i * 2], vPoints[i * 2 + 1], &Out, &Before) != 0;
+		}
+		aaDuration[New][0] = time_get() - Start;
+
+		Start = time_get();
+		for(int i = 0; i < NUM_QUERIES * 2; i++)
+		{
+			if(New)
+				aHits[New] += m_Collision.TestBox(vPoints[i], Size);
+			else
+				aHits[New] += ReferenceTestBox(&m_Collision, vPoints[i], Size);
+		}
+		aaDuration[New][1] = time_get() - Start;
+	}
+	EXPECT_EQ(aHits[0], aHits[1]);
+
+	printf("%s %dx%d: tiles %d bytes, bitplanes and distance field %d bytes\n", GetParam(), m_Collision.GetWidth(), m_Collision.GetHeight(),
+		m_Collision.GetWidth() * m_Collision.GetHeight() * (int) sizeof(CTile), m_Collision.MemoryUsage());
+	printf("%d rays: sampling %.2fms, traversal %.2fms\n", NUM_QUERIES,
+		aaDuration[0][0] * 1000.0 / time_freq(), aaDuration[1][0] * 1000.0 / time_freq());
+	printf("%d boxes: tiles %.2fms, bitplanes %.2fms\n", NUM_QUERIES * 2,
+		aaDuration[0][1] * 1000.0 / time_freq(), aaDuration[1][1] * 1000.0 / time_freq());
+}
+
+// the largest of the bundled maps
+INSTANTIATE_TEST_SUITE_P(Maps, CollisionBenchmark, ::testing::Values("ctf5"));
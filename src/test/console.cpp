@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/console.h>
+#include <engine/shared/config.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+static const int NUM_COMMANDS = 700;
+static const int NUM_CONFIG_LINES = 2000;
+
+static void ConStore(IConsole::IResult *pResult, void *pUserData)
+{
+	int *pValue = static_cast<int *>(pUserData);
+	if(pResult->NumArguments())
+		*pValue = pResult->GetInteger(0);
+}
+
+class Console : public ::testing::Test
+{
+protected:
+	IConsole *m_pConsole;
+	std::vector<std::string> m_vNames;
+	std::vector<int> m_vValues;
+
+	void SetUp() override
+	{
+		m_pConsole = CreateConsole(CFGFLAG_SERVER);
+
+		// about as many commands as a server with all its config variables has
+		m_vNames.resize(NUM_COMMANDS);
+		m_vValues.resize(NUM_COMMANDS, -1);
+		for(int i = 0; i < NUM_COMMANDS; i++)
+		{
+			char aName[32];
+			str_format(aName, sizeof(aName), "sv_var_%d_%c", (i * 7919) % NUM_COMMANDS, 'a' + i % 26);
+			m_vNames[i] = aName;
+			m_pConsole->Register(m_vNames[i].c_str(), "?i[value]", CFGFLAG_SERVER, ConStore, &m_vValues[i], "Test variable");
+		}
+	}
+
+	void TearDown() override
+	{
+		delete m_pConsole;
+	}
+};
+
+TEST_F(Console, FindsCommandsIgnoringCase)
+{
+	for(int i = 0; i < NUM_COMMANDS; i += 13)
+	{
+		char aLine[64];
+		str_format(aLine, sizeof(aLine), "%s %d", m_vNames[i].c_str(), i);
+		for(char *p = aLine; *p; p++)
+			*p = str_uppercase(*p);
+		m_pConsole->ExecuteLine(aLine);
+		EXPECT_EQ(m_vValues[i], i) << aLine;
+	}
+
+	m_pConsole->ExecuteLine("sv_var_unknown 5");
+	EXPECT_EQ(m_pConsole->GetCommandInfo("sv_var_unknown", CFGFLAG_SERVER, false), nullptr);
+	EXPECT_NE(m_pConsole->GetCommandInfo("ECHO", CFGFLAG_SERVER, false), nullptr);
+	EXPECT_EQ(m_pConsole->GetCommandInfo("echo", CFGFLAG_CLIENT | CFGFLAG_SERVER, true), nullptr);
+}
+
+TEST_F(Console, TempCommandsStayIndexed)
+{
+	m_pConsole->RegisterTemp("temp_a", "", CFGFLAG_SERVER, "a");
+	m_pConsole->RegisterTemp("temp_b", "", CFGFLAG_SERVER, "b");
+	EXPECT_NE(m_pConsole->GetCommandInfo("TEMP_A", CFGFLAG_SERVER, true), nullptr);
+	EXPECT_EQ(m_pConsole->GetCommandInfo("temp_a", CFGFLAG_SERVER, false), nullptr);
+
+	// the recycled command is found by its new name only
+	m_pConsole->DeregisterTemp("temp_a");
+	EXPECT_EQ(m_pConsole->GetCommandInfo("temp_a", CFGFLAG_SERVER, true), nullptr);
+	m_pConsole->RegisterTemp("temp_c", "", CFGFLAG_SERVER, "c");
+	EXPECT_EQ(m_pConsole->GetCommandInfo("temp_a", CFGFLAG_SERVER, true), nullptr);
+	EXPECT_NE(m_pConsole->GetCommandInfo("temp_c", CFGFLAG_SERVER, true), nullptr);
+
+	m_pConsole->DeregisterTempAll();
+	EXPECT_EQ(m_pConsole->GetCommandInfo("temp_b", CFGFLAG_SERVER, true), nullptr);
+	EXPECT_EQ(m_pConsole->GetCommandInfo("temp_c", CFGFLAG_SERVER, true), nullptr);
+	EXPECT_EQ(m_pConsole->PossibleCommands("temp_", CFGFLAG_SERVER, true), 0);
+	EXPECT_EQ(m_pConsole->PossibleCommands("sv_var_", CFGFLAG_SERVER, false), NUM_COMMANDS);
+}
+
+TEST_F(Console, ParsedLineMatchesExecuteLine)
+{
+	char aLine[256];
+	str_format(aLine, sizeof(aLine), "%s 1; %s \"2\" # comment; %s 3", m_vNames[0].c_str(), m_vNames[1].c_str(), m_vNames[2].c_str());
+	IConsole::IParsedLine *pLine = m_pConsole->ParseLine(aLine);
+	m_pConsole->ExecuteParsedLine(pLine);
+	EXPECT_EQ(m_vValues[0], 1);
+	EXPECT_EQ(m_vValues[1], 2);
+	EXPECT_EQ(m_vValues[2], -1);
+
+	// reusable
+	m_vValues[0] = m_vValues[1] = -1;
+	m_pConsole->ExecuteParsedLine(pLine);
+	EXPECT_EQ(m_vValues[0], 1);
+	EXPECT_EQ(m_vValues[1], 2);
+	delete pLine;
+}
+
+TEST_F(Console, ParsedLineResolvesLateCommands)
+{
+	int Value = -1;
+	IConsole::IParsedLine *pLine = m_pConsole->ParseLine("late_command 7");
+	m_pConsole->ExecuteParsedLine(pLine);
+	EXPECT_EQ(Value, -1);
+
+	m_pConsole->Register("late_command", "i[value]", CFGFLAG_SERVER, ConStore, &Value, "Test command");
+	m_pConsole->ExecuteParsedLine(pLine);
+	EXPECT_EQ(Value, 7);
+
+	// the arguments don't fit anymore
+	Value = -1;
+	m_pConsole->Register("late_command", "i[value] i[other]", CFGFLAG_SERVER, ConStore, &Value, "Test command");
+	m_pConsole->ExecuteParsedLine(pLine);
+	EXPECT_EQ(Value, -1);
+	delete pLine;
+}
+
+TEST_F(Console, DuplicateNamesResolveInListOrder)
+{
+	// names only clash between flags, the first match of the case sensitively sorted list wins
+	int Upper = -1, Lower = -1;
+	m_pConsole->Register("Dup_command", "i[value]", CFGFLAG_SERVER, ConStore, &Upper, "Test command");
+	m_pConsole->Register("dup_command", "i[value]", CFGFLAG_CLIENT, ConStore, &Lower, "Test command");
+	m_pConsole->ExecuteLineFlag("dup_command 3", CFGFLAG_SERVER | CFGFLAG_CLIENT);
+	EXPECT_EQ(Upper, 3);
+	EXPECT_EQ(Lower, -1);
+	EXPECT_STREQ(m_pConsole->GetCommandInfo("DUP_COMMAND", CFGFLAG_SERVER | CFGFLAG_CLIENT, false)->m_pName, "Dup_command");
+}
+
+TEST_F(Console, ConfigExecBenchmark)
+{
+	std::vector<std::string> vLines(NUM_CONFIG_LINES);
+	for(int i = 0; i < NUM_CONFIG_LINES; i++)
+	{
+		char aLine[64];
+		str_format(aLine, sizeof(aLine), "%s %d", m_vNames[(i * 31) % NUM_COMMANDS].c_str(), i);
+		vLines[i] = aLine;
+	}
+
+	int64 Start = time_get();
+	for(const std::string &Line : vLines)
+		m_pConsole->ExecuteLine(Line.c_str());
+	int64 ExecDuration = time_get() - Start;
+
+	for(int i = 0; i < NUM_CONFIG_LINES; i++)
+		ASSERT_GE(m_vValues[(i * 31) % NUM_COMMANDS], i);
+
+	std::vector<IConsole::IParsedLine *> vpParsed;
+	for(const std::string &Line : vLines)
+		vpParsed.push_back(m_pConsole->ParseLine(Line.c_str()));
+	std::fill(m_vValues.begin(), m_vValues.end(), -1);
+
+	Start = time_get();
+	for(IConsole::IParsedLine *pLine : vpParsed)
+		m_pConsole->ExecuteParsedLine(pLine);
+	int64 ParsedDuration = time_get() - Start;
+
+	for(int i = 0; i < NUM_CONFIG_LINES; i++)
+		ASSERT_GE(m_vValues[(i * 31) % NUM_COMMANDS], i);
+	for(IConsole::IParsedLine *pLine : vpParsed)
+		delete pLine;
+
+	printf("%d commands, %d lines: exec %.2fms, parsed lines %.2fms\n", NUM_COMMANDS, NUM_CONFIG_LINES,
+		ExecDuration * 1000.0 / time_freq(), ParsedDuration * 1000.0 / time_freq());
+}
@@ -4,9 +4,71 @@
 
 #include <gtest/gtest.h>
 
+#include <base/math.h>
+
+#include <engine/engine.h>
 #include <engine/shared/datafile.h>
 #include <engine/storage.h>
 
+#include <random>
+#include <vector>
+
+static const int NUM_BENCHMARK_DATA = 64;
+static const int BENCHMARK_DATA_SIZE = 512 * 1024;
+
+// runs jobs like the engine, without its logging
+class CTestEngine : public IEngine
+{
+public:
+	CTestEngine() { m_JobPool.Init(4); }
+	void Init() override {}
+	void ShutdownJobs() override { m_JobPool.Shutdown(); }
+	void InitLogfile() override {}
+	void QueryNetLogHandles(IOHANDLE *pHDLSend, IOHANDLE *pHDLRecv) override {}
+	void HostLookup(CHostLookup *pLookup, const char *pHostname, int Nettype) override {}
+	void AddJob(std::shared_ptr<IJob> pJob) override { m_JobPool.Add(std::move(pJob)); }
+};
+
+// tile layer like data, runs of the same bytes
+static std::vector<char> MakeData(unsigned Seed, int Size)
+{
+	std::mt19937 Rng(Seed);
+	std::vector<char> vData(Size);
+	for(int i = 0; i < Size;)
+	{
+		int Run = minimum(Size - i, (int) (Rng() % 64) + 1);
+		char Value = Rng() % 3 ? 0 : Rng() % 256;
+		for(int k = 0; k < Run; k++)
+			vData[i++] = Value;
+	}
+	return vData;
+}
+
+// random bytes, barely compressible
+static std::vector<char> MakeNoise(unsigned Seed, int Size)
+{
+	std::mt19937 Rng(Seed);
+	std::vector<char> vData(Size);
+	for(char &Value : vData)
+		Value = Rng() % 256;
+	return vData;
+}
+
+static void WriteDatafile(IStorage *pStorage, const char *pFilename, unsigned Seed, int NumData, int DataSize,
+	int CompressionLevel = CDataFileWriter::COMPRESSION_DEFAULT, IEngine *pEngine = 0)
+{
+	CDataFileWriter Writer;
+	ASSERT_TRUE(Writer.Open(pStorage, pFilename, CompressionLevel, pEngine));
+	for(int i = 0; i < NumData; i++)
+	{
+		std::vector<char> vData = MakeData(Seed + i, DataSize);
+		Writer.AddData(vData.size(), vData.data());
+	}
+	int Item = 0;
+	Writer.AddItem(1, 0, sizeof(Item), &Item);
+	EXPECT_TRUE(Writer.Finish());
+}
+
 TEST(Datafile, RoundtripItemDataAndSize)
 {
 	CTestInfo Info;
@@ -65,3 +127,267 @@ TEST(Datafile, RoundtripItemDataAndSize)
 
 	EXPECT_TRUE(pStorage->RemoveFile(aFilename, IStorage::TYPE_SAVE));
 }
+
+static std::vector<char> ReadWholeFile(IStorage *pStorage, const char *pFilename)
+{
+	void *pData;
+	unsigned Size;
+	if(!pStorage->ReadFile(pFilename, IStorage::TYPE_SAVE, &pData, &Size))
+		return std::vector<char>();
+	std::vector<char> vData((char *) pData, (char *) pData + Size);
+	mem_free(pData);
+	return vData;
+}
+
+TEST(Datafile, ParallelWriteMatchesSequential)
+{
+	CTestInfo Info;
+	char aSequential[64], aParallel[64];
+	Info.Filename(aSequential, sizeof(aSequential), "-sequential.datafile");
+	Info.Filename(aParallel, sizeof(aParallel), "-parallel.datafile");
+	IStorage *pStorage = CreateTestStorage();
+	CTestEngine Engine;
+	WriteDatafile(pStorage, aSequential, 1, 32, 64 * 1024);
+	WriteDatafile(pStorage, aParallel, 1, 32, 64 * 1024, CDataFileWriter::COMPRESSION_DEFAULT, &Engine);
+
+	std::vector<char> vSequential = ReadWholeFile(pStorage, aSequential);
+	EXPECT_FALSE(vSequential.empty());
+	EXPECT_EQ(vSequential, ReadWholeFile(pStorage, aParallel));
+
+	EXPECT_TRUE(pStorage->RemoveFile(aSequential, IStorage::TYPE_SAVE));
+	EXPECT_TRUE(pStorage->RemoveFile(aParallel, IStorage::TYPE_SAVE));
+}
+
+TEST(Datafile, CompressionLevels)
+{
+	CTestInfo Info;
+	char aFast[64], aBest[64];
+	Info.Filename(aFast, sizeof(aFast), "-fast.datafile");
+	Info.Filename(aBest, sizeof(aBest), "-best.datafile");
+	IStorage *pStorage = CreateTestStorage();
+	WriteDatafile(pStorage, aFast, 1, 8, 64 * 1024, CDataFileWriter::COMPRESSION_FAST);
+	WriteDatafile(pStorage, aBest, 1, 8, 64 * 1024, CDataFileWriter::COMPRESSION_BEST);
+	EXPECT_LE(ReadWholeFile(pStorage, aBest).size(), ReadWholeFile(pStorage, aFast).size());
+
+	CDataFileReader Reader;
+	ASSERT_TRUE(Reader.Open(pStorage, aBest, IStorage::TYPE_ALL));
+	for(int i = 0; i < Reader.NumData(); i++)
+		EXPECT_TRUE(mem_comp(Reader.GetData(i), MakeData(1 + i, 64 * 1024).data(), 64 * 1024) == 0) << i;
+	EXPECT_TRUE(Reader.Close());
+
+	EXPECT_TRUE(pStorage->RemoveFile(aFast, IStorage::TYPE_SAVE));
+	EXPECT_TRUE(pStorage->RemoveFile(aBest, IStorage::TYPE_SAVE));
+}
+
+TEST(Datafile, WritesMoreDataThanBuffered)
+{
+	CTestInfo Info;
+	char aFilename[64], aSpillFilename[80];
+	Info.Filename(aFilename, sizeof(aFilename), ".datafile");
+	str_format(aSpillFilename, sizeof(aSpillFilename), "%s.tmp", aFilename);
+	IStorage *pStorage = CreateTestStorage();
+
+	// more than the 16mb kept in memory
+	const int NumData = 40;
+	const int DataSize = 512 * 1024;
+	CDataFileWriter Writer;
+	ASSERT_TRUE(Writer.Open(pStorage, aFilename));
+	for(int i = 0; i < NumData; i++)
+	{
+		std::vector<char> vData = MakeNoise(i, DataSize);
+		Writer.AddData(vData.size(), vData.data());
+	}
+	EXPECT_TRUE(Writer.Finish());
+	EXPECT_TRUE(ReadWholeFile(pStorage, aSpillFilename).empty());
+
+	CDataFileReader Reader;
+	ASSERT_TRUE(Reader.Open(pStorage, aFilename, IStorage::TYPE_ALL));
+	ASSERT_EQ(Reader.NumData(), NumData);
+	for(int i = 0; i < NumData; i++)
+	{
+		ASSERT_EQ(Reader.GetDataSize(i), DataSize);
+		EXPECT_TRUE(mem_comp(Reader.GetData(i), MakeNoise(i, DataSize).data(), DataSize) == 0) << i;
+		Reader.UnloadData(i);
+	}
+	EXPECT_TRUE(Reader.Close());
+
+	// unfinished writers clean up after themselves
+	{
+		CDataFileWriter Unfinished;
+		ASSERT_TRUE(Unfinished.Open(pStorage, aFilename));
+		for(int i = 0; i < NumData; i++)
+		{
+			std::vector<char> vData = MakeNoise(i, DataSize);
+			Unfinished.AddData(vData.size(), vData.data());
+		}
+	}
+	EXPECT_TRUE(ReadWholeFile(pStorage, aSpillFilename).empty());
+
+	EXPECT_TRUE(pStorage->RemoveFile(aFilename, IStorage::TYPE_SAVE));
+}
+
+TEST(Datafile, FailsWithoutTemporaryFile)
+{
+	CTestInfo Info;
+	char aFilename[64], aSpillFilename[80];
+	Info.Filename(aFilename, sizeof(aFilename), ".datafile");
+	str_format(aSpillFilename, sizeof(aSpillFilename), "%s.tmp", aFilename);
+	IStorage *pStorage = CreateTestStorage();
+
+	// a directory in the way of the temporary file
+	ASSERT_TRUE(pStorage->CreateFolder(aSpillFilename, IStorage::TYPE_SAVE));
+	const int DataSize = 512 * 1024;
+	CDataFileWriter Writer;
+	ASSERT_TRUE(Writer.Open(pStorage, aFilename));
+	int Result = 0;
+	for(int i = 0; i < 40 && Result >= 0; i++)
+	{
+		std::vector<char> vData = MakeNoise(i, DataSize);
+		Result = Writer.AddData(vData.size(), vData.data());
+	}
+	EXPECT_EQ(Result, -1);
+	EXPECT_FALSE(Writer.Finish());
+	EXPECT_TRUE(ReadWholeFile(pStorage, aFilename).empty());
+
+	char aPath[IO_MAX_PATH_LENGTH];
+	pStorage->GetCompletePath(IStorage::TYPE_SAVE, aSpillFilename, aPath, sizeof(aPath));
+	EXPECT_EQ(fs_remove(aPath), 0);
+}
+
+TEST(Datafile, CorruptDataIsNotCached)
+{
+	CTestInfo Info;
+	char aFilename[64];
+	Info.Filename(aFilename, sizeof(aFilename), ".datafile");
+	IStorage *pStorage = CreateTestStorage();
+	WriteDatafile(pStorage, aFilename, 1, 2, 4096);
+
+	// the data comes last, so this breaks the checksum of the second block
+	std::vector<char> vFile = ReadWholeFile(pStorage, aFilename);
+	ASSERT_FALSE(vFile.empty());
+	vFile.back() ^= 0xff;
+	IOHANDLE File = pStorage->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	ASSERT_TRUE(File);
+	io_write(File, vFile.data(), vFile.size());
+	io_close(File);
+
+	CTestEngine Engine;
+	CDataFileReader Reader;
+	for(int i = 0; i < 2; i++)
+	{
+		ASSERT_TRUE(Reader.Open(pStorage, aFilename, IStorage::TYPE_ALL));
+		if(i == 1)
+			Reader.PrefetchAll(&Engine);
+		EXPECT_TRUE(mem_comp(Reader.GetData(0), MakeData(1, 4096).data(), 4096) == 0);
+		EXPECT_EQ(Reader.GetData(1), nullptr);
+		EXPECT_TRUE(Reader.Close());
+	}
+
+	EXPECT_TRUE(pStorage->RemoveFile(aFilename, IStorage::TYPE_SAVE));
+}
+
+TEST(Datafile, PrefetchMatchesOnDemand)
+{
+	CTestInfo Info;
+	char aFilename[64];
+	Info.Filename(aFilename, sizeof(aFilename), ".datafile");
+	IStorage *pStorage = CreateTestStorage();
+	WriteDatafile(pStorage, aFilename, 1, 16, 64 * 1024);
+
+	CTestEngine Engine;
+	CDataFileReader Reader;
+	ASSERT_TRUE(Reader.Open(pStorage, aFilename, IStorage::TYPE_ALL));
+	Reader.PrefetchAll(&Engine);
+	for(int i = 0; i < Reader.NumData(); i++)
+	{
+		std::vector<char> vData = MakeData(1 + i, 64 * 1024);
+		ASSERT_EQ(Reader.GetDataSize(i), (int) vData.size());
+		EXPECT_TRUE(mem_comp(Reader.GetData(i), vData.data(), vData.size()) == 0) << i;
+	}
+
+	// unloading and closing with prefetches which may still be running
+	Reader.Close();
+	ASSERT_TRUE(Reader.Open(pStorage, aFilename, IStorage::TYPE_ALL));
+	Reader.PrefetchAll(&Engine);
+	Reader.UnloadData(3);
+	EXPECT_TRUE(mem_comp(Reader.GetData(3), MakeData(4, 64 * 1024).data(), 64 * 1024) == 0);
+	EXPECT_TRUE(Reader.Close());
+
+	// without the mapping the prefetched data is kept and the rest is read from the file
+	ASSERT_TRUE(Reader.Open(pStorage, aFilename, IStorage::TYPE_ALL));
+	for(int i = 0; i < Reader.NumData(); i += 2)
+		Reader.Prefetch(&Engine, i);
+	Reader.Unmap();
+	for(int i = 0; i < Reader.NumData(); i++)
+		EXPECT_TRUE(mem_comp(Reader.GetData(i), MakeData(1 + i, 64 * 1024).data(), 64 * 1024) == 0) << i;
+	EXPECT_TRUE(Reader.Close());
+
+	EXPECT_TRUE(pStorage->RemoveFile(aFilename, IStorage::TYPE_SAVE));
+}
+
+TEST(Datafile, LoadBenchmark)
+{
+	CTestInfo Info;
+	char aSerial[64], aParallel[64];
+	Info.Filename(aSerial, sizeof(aSerial), "-serial.datafile");
+	Info.Filename(aParallel, sizeof(aParallel), "-parallel.datafile");
+	IStorage *pStorage = CreateTestStorage();
+	WriteDatafile(pStorage, aSerial, 100, NUM_BENCHMARK_DATA, BENCHMARK_DATA_SIZE);
+	WriteDatafile(pStorage, aParallel, 200, NUM_BENCHMARK_DATA, BENCHMARK_DATA_SIZE);
+
+	CTestEngine Engine;
+	CDataFileReader Reader;
+	int64 Start = time_get();
+	ASSERT_TRUE(Reader.Open(pStorage, aSerial, IStorage::TYPE_ALL));
+	for(int i = 0; i < Reader.NumData(); i++)
+		ASSERT_TRUE(Reader.GetData(i));
+	int64 SerialDuration = time_get() - Start;
+
+	Start = time_get();
+	ASSERT_TRUE(Reader.Open(pStorage, aParallel, IStorage::TYPE_ALL));
+	Reader.PrefetchAll(&Engine);
+	for(int i = 0; i < Reader.NumData(); i++)
+		ASSERT_TRUE(Reader.GetData(i));
+	int64 ParallelDuration = time_get() - Start;
+
+	// the decompressed data of the first file is still cached
+	Start = time_get();
+	ASSERT_TRUE(Reader.Open(pStorage, aSerial, IStorage::TYPE_ALL));
+	for(int i = 0; i < Reader.NumData(); i++)
+		ASSERT_TRUE(Reader.GetData(i));
+	int64 ReloadDuration = time_get() - Start;
+	EXPECT_TRUE(mem_comp(Reader.GetData(5), MakeData(105, BENCHMARK_DATA_SIZE).data(), BENCHMARK_DATA_SIZE) == 0);
+	Reader.Close();
+
+	printf("%d x %dkb data: serial %.2fms, prefetched %.2fms, reload %.2fms\n", NUM_BENCHMARK_DATA, BENCHMARK_DATA_SIZE / 1024,
+		SerialDuration * 1000.0 / time_freq(), ParallelDuration * 1000.0 / time_freq(), ReloadDuration * 1000.0 / time_freq());
+
+	EXPECT_TRUE(pStorage->RemoveFile(aSerial, IStorage::TYPE_SAVE));
+	EXPECT_TRUE(pStorage->RemoveFile(aParallel, IStorage::TYPE_SAVE));
+}
+
+TEST(Datafile, SaveBenchmark)
+{
+	CTestInfo Info;
+	char aFilename[64];
+	Info.Filename(aFilename, sizeof(aFilename), ".datafile");
+	IStorage *pStorage = CreateTestStorage();
+
+	CTestEngine Engine;
+	int64 Start = time_get();
+	WriteDatafile(pStorage, aFilename, 300, NUM_BENCHMARK_DATA, BENCHMARK_DATA_SIZE);
+	int64 SequentialDuration = time_get() - Start;
+
+	Start = time_get();
+	WriteDatafile(pStorage, aFilename, 300, NUM_BENCHMARK_DATA, BENCHMARK_DATA_SIZE, CDataFileWriter::COMPRESSION_DEFAULT, &Engine);
+	int64 ParallelDuration = time_get() - Start;
+
+	Start = time_get();
+	WriteDatafile(pStorage, aFilename, 300, NUM_BENCHMARK_DATA, BENCHMARK_DATA_SIZE, CDataFileWriter::COMPRESSION_FAST);
+	int64 FastDuration = time_get() - Start;
+
+	printf("%d x %dkb data: sequential save %.2fms, parallel save %.2fms, fast compression %.2fms\n", NUM_BENCHMARK_DATA, BENCHMARK_DATA_SIZE / 1024,
+		SequentialDuration * 1000.0 / time_freq(), ParallelDuration * 1000.0 / time_freq(), FastDuration * 1000.0 / time_freq());
+
+	EXPECT_TRUE(pStorage->RemoveFile(aFilename, IStorage::TYPE_SAVE));
+}
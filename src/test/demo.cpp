@@ -0,0 +1,288 @@
+#include "test.h"
+
+#include <gtest/gtest.h>
+
+#include <base/hash.h>
+#include <base/system.h>
+
+#include <engine/console.h>
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/snapshot.h>
+#include <engine/storage.h>
+
+#include <map>
+
+static const char *const NET_VERSION = "0.7 test";
+static const int NUM_TICKS = SERVER_TICK_SPEED * 30;
+
+class CSnapshotListener : public CDemoPlayer::IListener
+{
+public:
+	std::map<int, int> m_SnapshotCrcs;
+	int m_NumMessages;
+
+	void OnDemoPlayerSnapshot(void *pData, int Size) override
+	{
+		// the first item carries the tick
+		const CSnapshot *pSnapshot = (CSnapshot *) pData;
+		m_SnapshotCrcs[pSnapshot->GetItem(0)->Data()[1]] = pSnapshot->Crc();
+	}
+
+	void OnDemoPlayerMessage(void *pData, int Size) override
+	{
+		m_NumMessages++;
+	}
+};
+
+class DemoRecorder : public ::testing::Test
+{
+protected:
+	CTestInfo m_Info;
+	IConsole *m_pConsole;
+	IStorage *m_pStorage;
+	CSnapshotDelta m_SnapshotDelta;
+	char m_aMapFilename[IO_MAX_PATH_LENGTH];
+	char m_aDemoFilename[IO_MAX_PATH_LENGTH];
+	SHA256_DIGEST m_MapSha256;
+	unsigned m_MapCrc;
+
+	void SetUp() override
+	{
+		m_pConsole = CreateConsole(CFGFLAG_SERVER);
+		m_pStorage = CreateTestStorage();
+
+		// any file with the right hash is a map for the recorder
+		static const char MAP_DATA[] = "not really a map";
+		m_MapSha256 = sha256(MAP_DATA, sizeof(MAP_DATA));
+		m_MapCrc = 0x12345678;
+		m_pStorage->CreateFolder("maps", IStorage::TYPE_SAVE);
+		m_pStorage->CreateFolder("downloadedmaps", IStorage::TYPE_SAVE);
+		str_format(m_aMapFilename, sizeof(m_aMapFilename), "maps/%s.map", m_Info.m_aFilename);
+		IOHANDLE File = m_pStorage->OpenFile(m_aMapFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		ASSERT_TRUE(File);
+		io_write(File, MAP_DATA, sizeof(MAP_DATA));
+		io_close(File);
+
+		m_Info.Filename(m_aDemoFilename, sizeof(m_aDemoFilename), ".demo");
+	}
+
+	void TearDown() override
+	{
+		char aDownloadedMap[IO_MAX_PATH_LENGTH];
+		str_format(aDownloadedMap, sizeof(aDownloadedMap), "downloadedmaps/%s_%08x.map", m_Info.m_aFilename, m_MapCrc);
+		m_pStorage->RemoveFile(aDownloadedMap, IStorage::TYPE_SAVE);
+		m_pStorage->RemoveFile(m_aMapFilename, IStorage::TYPE_SAVE);
+		m_pStorage->RemoveFile(m_aDemoFilename, IStorage::TYPE_SAVE);
+		char aIndex[IO_MAX_PATH_LENGTH];
+		IndexFilename(aIndex, sizeof(aIndex));
+		m_pStorage->RemoveFile(aIndex, IStorage::TYPE_SAVE);
+		delete m_pStorage;
+		delete m_pConsole;
+	}
+
+	// a few items which change with the tick, so there are deltas between the keyframes
+	static int BuildSnapshot(int Tick, char *pData)
+	{
+		CSnapshotBuilder Builder;
+		Builder.Init();
+		for(int i = 0; i < 16; i++)
+		{
+			int *pItem = (int *) Builder.NewItem(1 + i % 3, i, 4 * sizeof(int));
+			pItem[0] = i;
+			pItem[1] = i % 4 == 0 ? Tick : 0;
+			pItem[2] = Tick / 50;
+			pItem[3] = -i;
+		}
+		return Builder.Finish(pData);
+	}
+
+	void Record(int KeyframeInterval, std::map<int, int> *pExpectedCrcs)
+	{
+		CDemoRecorder Recorder(&m_SnapshotDelta);
+		Recorder.Init(m_pConsole, m_pStorage);
+		Recorder.SetKeyframeInterval(KeyframeInterval);
+		ASSERT_EQ(Recorder.Start(m_aDemoFilename, NET_VERSION, m_Info.m_aFilename, m_MapSha256, m_MapCrc, "server"), 0);
+		char aSnapshot[CSnapshot::MAX_SIZE];
+		for(int Tick = 1; Tick <= NUM_TICKS; Tick++)
+		{
+			int Size = BuildSnapshot(Tick, aSnapshot);
+			(*pExpectedCrcs)[Tick] = ((CSnapshot *) aSnapshot)->Crc();
+			Recorder.RecordSnapshot(Tick, aSnapshot, Size);
+			Recorder.RecordMessage(&Tick, sizeof(Tick));
+		}
+		ASSERT_EQ(Recorder.Stop(), 0);
+	}
+
+	void IndexFilename(char *pBuffer, int BufferSize)
+	{
+		DemoIndexFilename(m_aDemoFilename, pBuffer, BufferSize);
+	}
+};
+
+TEST_F(DemoRecorder, RecordsAndPlaysBack)
+{
+	CDemoRecorder Recorder(&m_SnapshotDelta);
+	Recorder.Init(m_pConsole, m_pStorage);
+	ASSERT_EQ(Recorder.Start(m_aDemoFilename, NET_VERSION, m_Info.m_aFilename, m_MapSha256, m_MapCrc, "server"), 0);
+	EXPECT_TRUE(Recorder.IsRecording());
+
+	// more chunks than the queue holds
+	std::map<int, int> ExpectedCrcs;
+	int NumKeyframes = 0, LastKeyframe = -1;
+	char aSnapshot[CSnapshot::MAX_SIZE];
+	for(int Tick = 1; Tick <= NUM_TICKS; Tick++)
+	{
+		int Size = BuildSnapshot(Tick, aSnapshot);
+		ExpectedCrcs[Tick] = ((CSnapshot *) aSnapshot)->Crc();
+		Recorder.RecordSnapshot(Tick, aSnapshot, Size);
+		Recorder.RecordMessage(&Tick, sizeof(Tick));
+		if(LastKeyframe == -1 || Tick - LastKeyframe > SERVER_TICK_SPEED * 5)
+		{
+			NumKeyframes++;
+			LastKeyframe = Tick;
+		}
+		if(Tick == SERVER_TICK_SPEED * 10 || Tick == SERVER_TICK_SPEED * 20)
+			Recorder.AddDemoMarker();
+	}
+	EXPECT_EQ(Recorder.Length(), (NUM_TICKS - 1) / SERVER_TICK_SPEED);
+	ASSERT_EQ(Recorder.Stop(), 0);
+	EXPECT_FALSE(Recorder.IsRecording());
+
+	CDemoPlayer Player(&m_SnapshotDelta);
+	CSnapshotListener Listener;
+	Listener.m_NumMessages = 0;
+	Player.Init(m_pConsole, m_pStorage);
+	Player.SetListener(&Listener);
+	ASSERT_EQ(Player.Load(m_aDemoFilename, IStorage::TYPE_SAVE, NET_VERSION), (const char *) 0);
+	EXPECT_EQ(Player.GetDemoType(), IDemoPlayer::DEMOTYPE_SERVER);
+	EXPECT_EQ(Player.BaseInfo()->m_FirstTick, 1);
+	EXPECT_EQ(Player.BaseInfo()->m_LastTick, NUM_TICKS);
+	EXPECT_EQ(Player.Info()->m_SeekablePoints, NumKeyframes);
+	ASSERT_EQ(Player.BaseInfo()->m_NumTimelineMarkers, 2);
+	EXPECT_EQ(Player.BaseInfo()->m_aTimelineMarkers[0], SERVER_TICK_SPEED * 10);
+	EXPECT_EQ(Player.BaseInfo()->m_aTimelineMarkers[1], SERVER_TICK_SPEED * 20);
+
+	// replays the keyframe before the wanted tick and the deltas after it
+	for(int Tick : {10, NUM_TICKS / 2, NUM_TICKS - 2})
+	{
+		Listener.m_SnapshotCrcs.clear();
+		ASSERT_EQ(Player.SetPos(Tick), 0);
+		ASSERT_FALSE(Listener.m_SnapshotCrcs.empty());
+		for(const auto &Snapshot : Listener.m_SnapshotCrcs)
+			EXPECT_EQ(Snapshot.second, ExpectedCrcs[Snapshot.first]) << "tick " << Snapshot.first;
+	}
+	EXPECT_GT(Listener.m_NumMessages, 0);
+	Player.Stop();
+}
+
+TEST_F(DemoRecorder, RestartsAfterStop)
+{
+	CDemoRecorder Recorder(&m_SnapshotDelta);
+	Recorder.Init(m_pConsole, m_pStorage);
+	char aSnapshot[CSnapshot::MAX_SIZE];
+	for(int i = 0; i < 3; i++)
+	{
+		ASSERT_EQ(Recorder.Start(m_aDemoFilename, NET_VERSION, m_Info.m_aFilename, m_MapSha256, m_MapCrc, "server"), 0);
+		EXPECT_EQ(Recorder.Start(m_aDemoFilename, NET_VERSION, m_Info.m_aFilename, m_MapSha256, m_MapCrc, "server"), -1);
+		for(int Tick = 1; Tick <= SERVER_TICK_SPEED; Tick++)
+			Recorder.RecordSnapshot(Tick, aSnapshot, BuildSnapshot(Tick, aSnapshot));
+		ASSERT_EQ(Recorder.Stop(), 0);
+		EXPECT_EQ(Recorder.Stop(), -1);
+	}
+
+	// recording on the destruction of the recorder
+	ASSERT_EQ(Recorder.Start(m_aDemoFilename, NET_VERSION, m_Info.m_aFilename, m_MapSha256, m_MapCrc, "server"), 0);
+	Recorder.RecordSnapshot(1, aSnapshot, BuildSnapshot(1, aSnapshot));
+}
+
+TEST_F(DemoRecorder, LoadsKeyframeIndex)
+{
+	std::map<int, int> ExpectedCrcs;
+	Record(SERVER_TICK_SPEED, &ExpectedCrcs);
+
+	CDemoPlayer Indexed(&m_SnapshotDelta);
+	Indexed.Init(m_pConsole, m_pStorage);
+	ASSERT_EQ(Indexed.Load(m_aDemoFilename, IStorage::TYPE_SAVE, NET_VERSION), (const char *) 0);
+	EXPECT_TRUE(Indexed.HasIndex());
+
+	// a corrupt index is ignored
+	char aIndex[IO_MAX_PATH_LENGTH];
+	IndexFilename(aIndex, sizeof(aIndex));
+	void *pData;
+	unsigned Size;
+	ASSERT_TRUE(m_pStorage->ReadFile(aIndex, IStorage::TYPE_SAVE, &pData, &Size));
+	IOHANDLE File = m_pStorage->OpenFile(aIndex, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	ASSERT_TRUE(File);
+	io_write(File, pData, Size - 1);
+	io_close(File);
+	mem_free(pData);
+
+	CDemoPlayer Scanned(&m_SnapshotDelta);
+	Scanned.Init(m_pConsole, m_pStorage);
+	ASSERT_EQ(Scanned.Load(m_aDemoFilename, IStorage::TYPE_SAVE, NET_VERSION), (const char *) 0);
+	EXPECT_FALSE(Scanned.HasIndex());
+
+	// denser keyframes
+	EXPECT_EQ(Indexed.Info()->m_SeekablePoints, (NUM_TICKS + SERVER_TICK_SPEED) / (SERVER_TICK_SPEED + 1));
+	EXPECT_EQ(Indexed.Info()->m_SeekablePoints, Scanned.Info()->m_SeekablePoints);
+	EXPECT_EQ(Indexed.BaseInfo()->m_FirstTick, Scanned.BaseInfo()->m_FirstTick);
+	EXPECT_EQ(Indexed.BaseInfo()->m_LastTick, Scanned.BaseInfo()->m_LastTick);
+
+	CSnapshotListener IndexedListener, ScannedListener;
+	IndexedListener.m_NumMessages = ScannedListener.m_NumMessages = 0;
+	Indexed.SetListener(&IndexedListener);
+	Scanned.SetListener(&ScannedListener);
+	for(int Tick : {3, NUM_TICKS / 3, NUM_TICKS - 1})
+	{
+		IndexedListener.m_SnapshotCrcs.clear();
+		ScannedListener.m_SnapshotCrcs.clear();
+		ASSERT_EQ(Indexed.SetPos(Tick), 0);
+		ASSERT_EQ(Scanned.SetPos(Tick), 0);
+		EXPECT_EQ(IndexedListener.m_SnapshotCrcs, ScannedListener.m_SnapshotCrcs);
+		// seeking replays less than the keyframe interval
+		EXPECT_LE((int) IndexedListener.m_SnapshotCrcs.size(), SERVER_TICK_SPEED + 2);
+		for(const auto &Snapshot : IndexedListener.m_SnapshotCrcs)
+			EXPECT_EQ(Snapshot.second, ExpectedCrcs[Snapshot.first]) << "tick " << Snapshot.first;
+	}
+	Indexed.Stop();
+	Scanned.Stop();
+}
+
+TEST_F(DemoRecorder, FastForwardDecodesAhead)
+{
+	std::map<int, int> ExpectedCrcs;
+	Record(SERVER_TICK_SPEED * 5, &ExpectedCrcs);
+
+	CDemoPlayer Player(&m_SnapshotDelta);
+	CSnapshotListener Listener;
+	Listener.m_NumMessages = 0;
+	Player.Init(m_pConsole, m_pStorage);
+	Player.SetListener(&Listener);
+	ASSERT_EQ(Player.Load(m_aDemoFilename, IStorage::TYPE_SAVE, NET_VERSION), (const char *) 0);
+	Player.SetSpeed(8.0f);
+	EXPECT_TRUE(Player.IsFastForwarding());
+	ASSERT_EQ(Player.SetPos(SERVER_TICK_SPEED * 3), 0);
+	Player.Unpause();
+
+	// switching the decoder off and on continues after the last played tick
+	for(int i = 0; i < 200 && Player.IsPlaying() && !Player.BaseInfo()->m_Paused; i++)
+	{
+		if(i % 7 == 3)
+			Player.SetSpeed(i % 2 ? 1.0f : 16.0f);
+		thread_sleep(5);
+		Player.Update();
+	}
+	EXPECT_GT(Listener.m_SnapshotCrcs.rbegin()->first, SERVER_TICK_SPEED * 5);
+	for(const auto &Snapshot : Listener.m_SnapshotCrcs)
+		EXPECT_EQ(Snapshot.second, ExpectedCrcs[Snapshot.first]) << "tick " << Snapshot.first;
+
+	// no tick was skipped
+	int Tick = Listener.m_SnapshotCrcs.begin()->first;
+	for(const auto &Snapshot : Listener.m_SnapshotCrcs)
+		EXPECT_EQ(Snapshot.first, Tick++);
+
+	Player.SetSpeed(1.0f);
+	EXPECT_FALSE(Player.IsFastForwarding());
+	Player.Stop();
+}
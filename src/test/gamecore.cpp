@@ -0,0 +1,167 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/map.h>
+#include <engine/storage.h>
+
+#include <game/collision.h>
+#include <game/gamecore.h>
+#include <game/layers.h>
+
+static const int NUM_TEES = 64;
+static const int NUM_TICKS = 500;
+
+class CGameCoreScene
+{
+	unsigned m_Seed;
+
+public:
+	CCharacterCore m_aCores[NUM_TEES];
+	CWorldCore m_World;
+
+	CGameCoreScene() :
+		m_Seed(1234) {}
+
+	int Random(int Max)
+	{
+		m_Seed = m_Seed * 1103515245 + 12345;
+		return (m_Seed >> 16) % Max;
+	}
+
+	// packs all tees into a small area around the first free spot near the map center
+	void Spawn(CCollision *pCollision)
+	{
+		const vec2 ColBox(CCharacterCore::PHYS_SIZE, CCharacterCore::PHYS_SIZE);
+		vec2 Center(pCollision->GetWidth() * 16.0f, pCollision->GetHeight() * 16.0f);
+		for(int i = 0; i < pCollision->GetWidth() * pCollision->GetHeight(); i++)
+		{
+			vec2 Pos((i % pCollision->GetWidth()) * 32.0f + 16.0f, (i / pCollision->GetWidth()) * 32.0f + 16.0f);
+			if(!pCollision->TestBox(Pos, ColBox * 3.0f))
+			{
+				Center = Pos;
+				break;
+			}
+		}
+
+		for(int i = 0; i < NUM_TEES; i++)
+		{
+			vec2 Pos = Center;
+			for(int Try = 0; Try < 100; Try++)
+			{
+				vec2 Candidate = Center + vec2(Random(400) - 200, Random(400) - 200);
+				if(!pCollision->TestBox(Candidate, ColBox))
+				{
+					Pos = Candidate;
+					break;
+				}
+			}
+
+			m_aCores[i].Reset();
+			m_aCores[i].Init(&m_World, pCollision);
+			m_aCores[i].m_Pos = Pos;
+			m_World.m_apCharacters[i] = &m_aCores[i];
+		}
+	}
+
+	void Tick(bool UseBroadphase)
+	{
+		if(UseBroadphase)
+			m_World.UpdateBroadphase();
+
+		for(int i = 0; i < NUM_TEES; i++)
+		{
+			CNetObj_PlayerInput &Input = m_aCores[i].m_Input;
+			mem_zero(&Input, sizeof(Input));
+			Input.m_Direction = Random(3) - 1;
+			Input.m_Jump = Random(8) == 0;
+			Input.m_Hook = Random(4) != 0;
+			Input.m_TargetX = Random(400) - 200;
+			Input.m_TargetY = Random(400) - 200;
+			m_aCores[i].Tick(true);
+		}
+
+		for(int i = 0; i < NUM_TEES; i++)
+		{
+			m_aCores[i].AddDragVelocity();
+			m_aCores[i].ResetDragVelocity();
+			m_aCores[i].Move();
+			m_aCores[i].Quantize();
+		}
+	}
+};
+
+class GameCore : public ::testing::Test
+{
+protected:
+	IStorage *m_pStorage;
+	IEngineMap *m_pMap;
+	CLayers m_Layers;
+	CCollision m_Collision;
+
+	void SetUp() override
+	{
+		m_pStorage = CreateTestStorage();
+		m_pMap = CreateEngineMap();
+		if(!m_pMap->Load("data/maps/ctf5.map", m_pStorage))
+			GTEST_SKIP() << "map data/maps/ctf5.map not found";
+		m_Layers.Init(nullptr, m_pMap);
+		m_Collision.Init(&m_Layers);
+	}
+
+	void TearDown() override
+	{
+		delete m_pMap;
+		delete m_pStorage;
+	}
+};
+
+TEST_F(GameCore, BroadphaseMatchesFullScan)
+{
+	CGameCoreScene *pReference = new CGameCoreScene();
+	CGameCoreScene *pBroadphase = new CGameCoreScene();
+	pReference->Spawn(&m_Collision);
+	pBroadphase->Spawn(&m_Collision);
+
+	for(int Tick = 0; Tick < NUM_TICKS; Tick++)
+	{
+		pReference->Tick(false);
+		pBroadphase->Tick(true);
+
+		for(int i = 0; i < NUM_TEES; i++)
+		{
+			CNetObj_CharacterCore Expected, Actual;
+			mem_zero(&Expected, sizeof(Expected));
+			mem_zero(&Actual, sizeof(Actual));
+			pReference->m_aCores[i].Write(&Expected);
+			pBroadphase->m_aCores[i].Write(&Actual);
+			ASSERT_EQ(mem_comp(&Expected, &Actual, sizeof(Expected)), 0) << "tee " << i << " diverged at tick " << Tick;
+			ASSERT_EQ(pReference->m_aCores[i].m_Vel, pBroadphase->m_aCores[i].m_Vel);
+		}
+	}
+
+	delete pReference;
+	delete pBroadphase;
+}
+
+TEST_F(GameCore, BroadphaseCrowdedBenchmark)
+{
+	int64 aDuration[2];
+	for(int UseBroadphase = 0; UseBroadphase < 2; UseBroadphase++)
+	{
+		CGameCoreScene *pScene = new CGameCoreScene();
+		pScene->Spawn(&m_Collision);
+
+		int64 Start = time_get();
+		for(int Tick = 0; Tick < NUM_TICKS; Tick++)
+			pScene->Tick(UseBroadphase);
+		aDuration[UseBroadphase] = time_get() - Start;
+
+		delete pScene;
+	}
+
+	printf("%d tees, %d ticks: full scan %.2fms, broadphase %.2fms\n", NUM_TEES, NUM_TICKS,
+		aDuration[0] * 1000.0 / time_freq(), aDuration[1] * 1000.0 / time_freq());
+}
@@ -6,6 +6,8 @@
 #include <engine/shared/jsonparser.h>
 #include <limits.h>
 
+#include <iterator>
+
 #if defined(CONF_FAMILY_WINDOWS)
 #define LINE_ENDING "\r\n"
 #else
@@ -155,3 +157,161 @@ TEST(JsonParser, Error)
 	EXPECT_FALSE(Parser.ParsedJson());
 	EXPECT_TRUE(Parser.Error()[0] != '\0');
 }
+
+TEST(JsonReader, Tokens)
+{
+	const char aJson[] = "{\"a\": [1, -2.5, \"x\", true, false, null, {}], \"b\": {\"c\": []}}";
+	CJsonReader Reader;
+	Reader.SetData(aJson, str_length(aJson));
+	const CJsonReader::EToken aExpected[] = {
+		CJsonReader::TOKEN_BEGIN_OBJECT,
+		CJsonReader::TOKEN_KEY,
+		CJsonReader::TOKEN_BEGIN_ARRAY,
+		CJsonReader::TOKEN_INTEGER,
+		CJsonReader::TOKEN_DOUBLE,
+		CJsonReader::TOKEN_STRING,
+		CJsonReader::TOKEN_BOOLEAN,
+		CJsonReader::TOKEN_BOOLEAN,
+		CJsonReader::TOKEN_NULL,
+		CJsonReader::TOKEN_BEGIN_OBJECT,
+		CJsonReader::TOKEN_END_OBJECT,
+		CJsonReader::TOKEN_END_ARRAY,
+		CJsonReader::TOKEN_KEY,
+		CJsonReader::TOKEN_BEGIN_OBJECT,
+		CJsonReader::TOKEN_KEY,
+		CJsonReader::TOKEN_BEGIN_ARRAY,
+		CJsonReader::TOKEN_END_ARRAY,
+		CJsonReader::TOKEN_END_OBJECT,
+		CJsonReader::TOKEN_END_OBJECT,
+		CJsonReader::TOKEN_END,
+	};
+	for(unsigned i = 0; i < std::size(aExpected); i++)
+		ASSERT_EQ(Reader.Next(), aExpected[i]) << "token " << i << ": " << Reader.Error();
+}
+
+TEST(JsonReader, Values)
+{
+	const char aJson[] = "[\"\\u0001\\\"'\\r\\n\\t\\/\", \"Heizölrückstoßabdämpfung\", \"\\u00e4\\ud83d\\ude00\", 2147483647, -9223372036854775808, 99999999999999999999, 1e3, true, false]";
+	CJsonReader Reader;
+	Reader.SetData(aJson, str_length(aJson));
+	ASSERT_EQ(Reader.Next(), CJsonReader::TOKEN_BEGIN_ARRAY);
+	ASSERT_EQ(Reader.Next(), CJsonReader::TOKEN_STRING);
+	EXPECT_STREQ(Reader.String(), "\x01\"'\r\n\t/");
+	ASSERT_EQ(Reader.Next(), CJsonReader::TOKEN_STRING);
+	EXPECT_STREQ(Reader.String(), "Heizölrückstoßabdämpfung");
+	ASSERT_EQ(Reader.Next(), CJsonReader::TOKEN_STRING);
+	EXPECT_STREQ(Reader.String(), "ä😀");
+	ASSERT_EQ(Reader.Next(), CJsonReader::TOKEN_INTEGER);
+	EXPECT_EQ(Reader.Integer(), INT_MAX);
+	ASSERT_EQ(Reader.Next(), CJsonReader::TOKEN_INTEGER);
+	EXPECT_EQ(Reader.Integer(), LLONG_MIN);
+	ASSERT_EQ(Reader.Next(), CJsonReader::TOKEN_DOUBLE);
+	EXPECT_DOUBLE_EQ(Reader.Double(), 1e20);
+	ASSERT_EQ(Reader.Next(), CJsonReader::TOKEN_DOUBLE);
+	EXPECT_DOUBLE_EQ(Reader.Double(), 1000.0);
+	ASSERT_EQ(Reader.Next(), CJsonReader::TOKEN_BOOLEAN);
+	EXPECT_TRUE(Reader.Boolean());
+	ASSERT_EQ(Reader.Next(), CJsonReader::TOKEN_BOOLEAN);
+	EXPECT_FALSE(Reader.Boolean());
+	EXPECT_EQ(Reader.Next(), CJsonReader::TOKEN_END_ARRAY);
+	EXPECT_EQ(Reader.Next(), CJsonReader::TOKEN_END);
+}
+
+TEST(JsonReader, Skip)
+{
+	const char aJson[] = "{\"skipped\": {\"a\": [1, [2, {\"b\": 3}]]}, \"wrong\": [4], \"wanted\": 5}";
+	CJsonReader Reader;
+	Reader.SetData(aJson, str_length(aJson));
+	ASSERT_EQ(Reader.Next(), CJsonReader::TOKEN_BEGIN_OBJECT);
+	ASSERT_TRUE(Reader.NextKey());
+	EXPECT_TRUE(Reader.SkipValue());
+	ASSERT_TRUE(Reader.NextKey());
+	EXPECT_TRUE(Reader.IsKey("wrong"));
+	int64 Value = 0;
+	EXPECT_FALSE(Reader.ReadInteger(&Value));
+	ASSERT_TRUE(Reader.NextKey());
+	EXPECT_TRUE(Reader.IsKey("wanted"));
+	EXPECT_TRUE(Reader.ReadInteger(&Value));
+	EXPECT_EQ(Value, 5);
+	EXPECT_FALSE(Reader.NextKey());
+	EXPECT_EQ(Reader.Token(), CJsonReader::TOKEN_END_OBJECT);
+	EXPECT_EQ(Reader.Depth(), 0);
+	EXPECT_EQ(Reader.Next(), CJsonReader::TOKEN_END);
+}
+
+TEST(JsonReader, Errors)
+{
+	const char *apInvalid[] = {
+		"",
+		"{[}]",
+		"[1 2]",
+		"[1,]",
+		"{\"a\" 1}",
+		"{\"a\": 1,}",
+		"{1: 2}",
+		"[\"unterminated",
+		"[\"\\x\"]",
+		"[\"\\ud83d\"]",
+		"[\"tab\tin string\"]",
+		"[01]",
+		"[1.]",
+		"[-]",
+		"[tru]",
+		"[1] [2]",
+		"[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]",
+	};
+	for(const char *pInvalid : apInvalid)
+	{
+		CJsonReader Reader;
+		Reader.SetData(pInvalid, str_length(pInvalid));
+		CJsonReader::EToken Token;
+		do
+			Token = Reader.Next();
+		while(Token != CJsonReader::TOKEN_END && Token != CJsonReader::TOKEN_ERROR);
+		EXPECT_EQ(Token, CJsonReader::TOKEN_ERROR) << pInvalid;
+		EXPECT_TRUE(Reader.Failed());
+		EXPECT_TRUE(Reader.Error()[0] != '\0');
+		// stays failed
+		EXPECT_EQ(Reader.Next(), CJsonReader::TOKEN_ERROR);
+	}
+}
+
+TEST(JsonReader, File)
+{
+	CTestInfo Info;
+	IStorage *pStorage = CreateTestStorage();
+
+	// spans several read chunks, with strings across their borders
+	const int NumStrings = 5000;
+	IOHANDLE File = pStorage->OpenFile(Info.m_aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	ASSERT_TRUE(File);
+	io_write(File, "[", 1);
+	for(int i = 0; i < NumStrings; i++)
+	{
+		char aBuf[64];
+		str_format(aBuf, sizeof(aBuf), "%s\"string \\\"%d\\\"\"" LINE_ENDING, i ? "," : "", i);
+		io_write(File, aBuf, str_length(aBuf));
+	}
+	io_write(File, "]", 1);
+	io_close(File);
+
+	CJsonReader Reader;
+	ASSERT_TRUE(Reader.OpenFile(Info.m_aFilename, pStorage, IStorage::TYPE_SAVE));
+	ASSERT_EQ(Reader.Next(), CJsonReader::TOKEN_BEGIN_ARRAY);
+	for(int i = 0; i < NumStrings; i++)
+	{
+		char aExpected[32];
+		str_format(aExpected, sizeof(aExpected), "string \"%d\"", i);
+		ASSERT_EQ(Reader.Next(), CJsonReader::TOKEN_STRING) << Reader.Error();
+		ASSERT_STREQ(Reader.String(), aExpected);
+	}
+	EXPECT_EQ(Reader.Next(), CJsonReader::TOKEN_END_ARRAY);
+	EXPECT_EQ(Reader.Next(), CJsonReader::TOKEN_END);
+	EXPECT_LT(Reader.MemoryUsage(), 64 * 1024);
+
+	pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
+	CJsonReader Missing;
+	EXPECT_FALSE(Missing.OpenFile(Info.m_aFilename, pStorage, IStorage::TYPE_SAVE));
+	EXPECT_TRUE(Missing.Failed());
+	delete pStorage;
+}
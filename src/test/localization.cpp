@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/console.h>
+#include <engine/localization.h>
+#include <engine/shared/config.h>
+#include <engine/storage.h>
+
+class Localization : public ::testing::Test
+{
+protected:
+	IStorage *m_pStorage;
+	IConsole *m_pConsole;
+	CConfig m_Config;
+	ILocalization *m_pLocalization;
+
+	void SetUp() override
+	{
+		mem_zero(&m_Config, sizeof(m_Config));
+		str_copy(m_Config.m_SvDefaultLanguage, "en", sizeof(m_Config.m_SvDefaultLanguage));
+		m_pStorage = CreateTestStorage();
+		m_pConsole = CreateConsole(CFGFLAG_SERVER);
+		m_pLocalization = CreateLocalization(m_pStorage, m_pConsole, &m_Config);
+		m_pLocalization->Init();
+		if(m_pLocalization->FindLanguage("zh-Hans") < 0)
+			GTEST_SKIP() << "data/languages/zh-Hans.json not found";
+	}
+
+	void TearDown() override
+	{
+		delete m_pLocalization;
+		delete m_pConsole;
+		delete m_pStorage;
+	}
+};
+
+TEST_F(Localization, Handles)
+{
+	EXPECT_EQ(m_pLocalization->FindLanguage("en"), -1);
+	EXPECT_EQ(m_pLocalization->FindLanguage("xx"), -1);
+	EXPECT_EQ(m_pLocalization->FindLanguage("zh-Hans"), m_pLocalization->FindLanguage("zh-Hans"));
+}
+
+TEST_F(Localization, Translate)
+{
+	const int Language = m_pLocalization->FindLanguage("zh-Hans");
+	EXPECT_STREQ(m_pLocalization->Localize(Language, "Server Vote", ""), "服务器投票");
+	EXPECT_STREQ(m_pLocalization->Localize(Language, "Server Vote", ""), "服务器投票");
+	EXPECT_STREQ(m_pLocalization->Localize("zh-Hans", "Server Vote", ""), "服务器投票");
+
+	// without a translation the caller's string comes back, in the source language too
+	const char aMissing[] = "not translated";
+	EXPECT_EQ(m_pLocalization->Localize(Language, aMissing, ""), aMissing);
+	EXPECT_EQ(m_pLocalization->Localize(Language, aMissing, ""), aMissing);
+	const char aVote[] = "Server Vote";
+	EXPECT_EQ(m_pLocalization->Localize(-1, aVote, ""), aVote);
+	EXPECT_EQ(m_pLocalization->Localize("en", aVote, ""), aVote);
+}
+
+TEST_F(Localization, StringIDs)
+{
+	const int Language = m_pLocalization->FindLanguage("zh-Hans");
+	const int Vote = m_pLocalization->RegisterString("Server Vote", "");
+	const int Missing = m_pLocalization->RegisterString("not translated", "");
+	EXPECT_GE(Vote, 0);
+	EXPECT_EQ(Missing, Vote + 1);
+	EXPECT_EQ(m_pLocalization->RegisterString("Server Vote", ""), Vote);
+	EXPECT_NE(m_pLocalization->RegisterString("Server Vote", "other"), Vote);
+
+	EXPECT_STREQ(m_pLocalization->Localize(Language, Vote), "服务器投票");
+	EXPECT_STREQ(m_pLocalization->Localize(-1, Vote), "Server Vote");
+	// the table falls back to the source string
+	EXPECT_STREQ(m_pLocalization->Localize(Language, Missing), "not translated");
+	EXPECT_EQ(m_pLocalization->Localize(Language, Missing), m_pLocalization->Localize(-1, Missing));
+}
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <string>
+#include <vector>
+
+// loggers can't be removed, so all tests share one which collects the lines of the "logtest" subsystem
+class CCollectingLogger
+{
+	LOCK m_Lock;
+	std::vector<std::string> m_vLines;
+
+	static void Log(const char *pLine, void *pUser)
+	{
+		CCollectingLogger *pSelf = static_cast<CCollectingLogger *>(pUser);
+		if(!str_find(pLine, "[logtest]"))
+			return;
+		if(str_find(pLine, "block"))
+		{
+			sphore_signal(&pSelf->m_Blocked);
+			sphore_wait(&pSelf->m_Release);
+		}
+		lock_wait(pSelf->m_Lock);
+		pSelf->m_vLines.emplace_back(pLine);
+		lock_unlock(pSelf->m_Lock);
+	}
+
+	CCollectingLogger()
+	{
+		m_Lock = lock_create();
+		sphore_init(&m_Blocked);
+		sphore_init(&m_Release);
+		dbg_logger(Log, 0, this);
+		dbg_logger_async();
+	}
+
+public:
+	SEMAPHORE m_Blocked;
+	SEMAPHORE m_Release;
+
+	static CCollectingLogger *Get()
+	{
+		static CCollectingLogger *s_pLogger = new CCollectingLogger();
+		return s_pLogger;
+	}
+
+	std::vector<std::string> Take()
+	{
+		dbg_logger_flush();
+		lock_wait(m_Lock);
+		std::vector<std::string> vLines;
+		vLines.swap(m_vLines);
+		lock_unlock(m_Lock);
+		return vLines;
+	}
+};
+
+TEST(Logger, AsyncKeepsOrder)
+{
+	CCollectingLogger *pLogger = CCollectingLogger::Get();
+	pLogger->Take();
+
+	for(int i = 0; i < 500; i++)
+		dbg_msg("logtest", "line %d", i);
+	std::string Long(2000, 'x');
+	dbg_msg("logtest", "%s", Long.c_str());
+
+	std::vector<std::string> vLines = pLogger->Take();
+	ASSERT_EQ(vLines.size(), 501u);
+	for(int i = 0; i < 500; i++)
+	{
+		char aLine[32];
+		str_format(aLine, sizeof(aLine), "]: line %d", i);
+		EXPECT_TRUE(str_endswith(vLines[i].c_str(), aLine)) << vLines[i];
+	}
+	EXPECT_TRUE(str_endswith(vLines[500].c_str(), Long.c_str()));
+}
+
+TEST(Logger, DropsWhileFull)
+{
+	CCollectingLogger *pLogger = CCollectingLogger::Get();
+	pLogger->Take();
+	DBG_LOGGER_STATS Before;
+	dbg_logger_stats(&Before);
+
+	// stall the logger thread, nothing gets written until it's released
+	dbg_msg("logtest", "block");
+	sphore_wait(&pLogger->m_Blocked);
+	int64 Start = time_get();
+	for(int i = 0; i < 5000; i++)
+		dbg_msg("logtest", "line %d", i);
+	int64 Duration = time_get() - Start;
+	sphore_signal(&pLogger->m_Release);
+
+	std::vector<std::string> vLines = pLogger->Take();
+	DBG_LOGGER_STATS After;
+	dbg_logger_stats(&After);
+	EXPECT_GT(After.dropped - Before.dropped, 0u);
+	EXPECT_EQ(vLines.size() - 1 + (After.dropped - Before.dropped), 5000u);
+	EXPECT_EQ(After.queued - Before.queued, vLines.size());
+	// logging never waited for the stalled thread
+	EXPECT_LT(Duration, time_freq());
+}
+
+TEST(Logger, RateLimit)
+{
+	CCollectingLogger *pLogger = CCollectingLogger::Get();
+	pLogger->Take();
+	DBG_LOGGER_STATS Before;
+	dbg_logger_stats(&Before);
+
+	dbg_logger_rate_limit(10);
+	for(int i = 0; i < 100; i++)
+		dbg_msg("logtest", "line %d", i);
+	dbg_logger_rate_limit(0);
+
+	std::vector<std::string> vLines = pLogger->Take();
+	DBG_LOGGER_STATS After;
+	dbg_logger_stats(&After);
+	// the lines might have crossed into the next second
+	EXPECT_GE(vLines.size(), 10u);
+	EXPECT_LE(vLines.size(), 20u);
+	EXPECT_EQ(vLines.size() + (After.suppressed - Before.suppressed), 100u);
+}
@@ -0,0 +1,204 @@
+#include "test.h"
+
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/map.h>
+#include <engine/storage.h>
+
+#include <game/collision.h>
+#include <game/layers.h>
+#include <game/mapcache.h>
+#include <game/mapitems.h>
+
+#include <vector>
+
+static const int NUM_BENCHMARK_LOADS = 20;
+
+class MapCache : public ::testing::Test
+{
+protected:
+	CTestInfo m_Info;
+	IStorage *m_pStorage;
+	SHA256_DIGEST m_Sha256;
+	char m_aCacheFilename[IO_MAX_PATH_LENGTH];
+
+	void SetUp() override
+	{
+		m_pStorage = CreateTestStorage();
+
+		// a hash of its own, so tests don't share the cache file
+		m_Sha256 = sha256(m_Info.m_aFilename, str_length(m_Info.m_aFilename));
+		char aSha256[SHA256_MAXSTRSIZE];
+		sha256_str(m_Sha256, aSha256, sizeof(aSha256));
+		str_format(m_aCacheFilename, sizeof(m_aCacheFilename), "mapcache/%s.cache", aSha256);
+
+		IEngineMap *pMap = CreateEngineMap();
+		const bool Found = pMap->Load("data/maps/ctf5.map", m_pStorage);
+		delete pMap;
+		if(!Found)
+			GTEST_SKIP() << "map ctf5 not found";
+	}
+
+	void TearDown() override
+	{
+		m_pStorage->RemoveFile(m_aCacheFilename, IStorage::TYPE_SAVE);
+		delete m_pStorage;
+	}
+
+	// collision changes the tiles of the map, so every user needs a fresh one
+	IEngineMap *LoadMap()
+	{
+		IEngineMap *pMap = CreateEngineMap();
+		EXPECT_TRUE(pMap->Load("data/maps/ctf5.map", m_pStorage));
+		return pMap;
+	}
+
+	static void AddTileEntities(CLayers *pLayers, CMapCache *pCache)
+	{
+		CMapItemLayerTilemap *pTileMap = pLayers->GameLayer();
+		CTile *pTiles = (CTile *) pLayers->Map()->GetData(pTileMap->m_Data);
+		for(int y = 0; y < pTileMap->m_Height; y++)
+		{
+			for(int x = 0; x < pTileMap->m_Width; x++)
+			{
+				if(pTiles[y * pTileMap->m_Width + x].m_Index > TILE_NOHOOK)
+					pCache->AddTileEntity(pTiles[y * pTileMap->m_Width + x].m_Index, x, y);
+			}
+		}
+	}
+
+	void Build()
+	{
+		IEngineMap *pMap = LoadMap();
+		CLayers Layers;
+		Layers.Init(nullptr, pMap);
+		CCollision Collision;
+		CMapCache Cache;
+		Collision.Init(&Layers, true, &Cache);
+		AddTileEntities(&Layers, &Cache);
+		Cache.Save(m_pStorage, m_Sha256, nullptr);
+		delete pMap;
+	}
+};
+
+TEST_F(MapCache, LoadedMatchesBuilt)
+{
+	IEngineMap *pBuiltMap = LoadMap();
+	CLayers BuiltLayers;
+	BuiltLayers.Init(nullptr, pBuiltMap);
+	CCollision Built;
+	CMapCache BuiltCache;
+	Built.Init(&BuiltLayers, true, &BuiltCache);
+	EXPECT_FALSE(BuiltCache.IsLoaded());
+	AddTileEntities(&BuiltLayers, &BuiltCache);
+	EXPECT_GT(BuiltCache.NumTileEntities(), 0);
+	BuiltCache.Save(m_pStorage, m_Sha256, nullptr);
+
+	IEngineMap *pLoadedMap = LoadMap();
+	CLayers LoadedLayers;
+	LoadedLayers.Init(nullptr, pLoadedMap);
+	CCollision Loaded;
+	CMapCache LoadedCache;
+	ASSERT_TRUE(LoadedCache.Load(m_pStorage, m_Sha256));
+	Loaded.Init(&LoadedLayers, true, &LoadedCache);
+	EXPECT_LT(Loaded.MemoryUsage(), Built.MemoryUsage());
+
+	const int aFlags[] = {CCollision::COLFLAG_SOLID, CCollision::COLFLAG_DEATH, CCollision::COLFLAG_NOHOOK, TILE_BENCH};
+	for(int y = 0; y < Built.GetHeight(); y++)
+	{
+		for(int x = 0; x < Built.GetWidth(); x++)
+		{
+			vec2 Pos(x * 32.0f + 16.0f, y * 32.0f + 16.0f);
+			for(int Flag : aFlags)
+				ASSERT_EQ(Built.CheckPoint(Pos, Flag), Loaded.CheckPoint(Pos, Flag)) << "tile " << x << ", " << y;
+			ASSERT_EQ(Built.GetSolidDistance(Pos), Loaded.GetSolidDistance(Pos)) << "tile " << x << ", " << y;
+		}
+	}
+
+	ASSERT_EQ(BuiltCache.NumTileEntities(), LoadedCache.NumTileEntities());
+	for(int i = 0; i < BuiltCache.NumTileEntities(); i++)
+	{
+		EXPECT_EQ(BuiltCache.TileEntity(i)->m_Index, LoadedCache.TileEntity(i)->m_Index);
+		EXPECT_EQ(BuiltCache.TileEntity(i)->m_X, LoadedCache.TileEntity(i)->m_X);
+		EXPECT_EQ(BuiltCache.TileEntity(i)->m_Y, LoadedCache.TileEntity(i)->m_Y);
+	}
+
+	// without the distance field
+	IEngineMap *pPlainMap = LoadMap();
+	CLayers PlainLayers;
+	PlainLayers.Init(nullptr, pPlainMap);
+	CCollision Plain;
+	Plain.Init(&PlainLayers, false, &LoadedCache);
+	EXPECT_EQ(Plain.GetSolidDistance(vec2(100.0f, 100.0f)), 0);
+	EXPECT_EQ(Plain.CheckPoint(vec2(100.0f, 100.0f)), Built.CheckPoint(vec2(100.0f, 100.0f)));
+
+	delete pBuiltMap;
+	delete pLoadedMap;
+	delete pPlainMap;
+}
+
+TEST_F(MapCache, RejectsStaleCache)
+{
+	CMapCache Cache;
+	EXPECT_FALSE(Cache.Load(m_pStorage, m_Sha256));
+	Build();
+	EXPECT_TRUE(Cache.Load(m_pStorage, m_Sha256));
+
+	// another map
+	SHA256_DIGEST Other = m_Sha256;
+	Other.data[0] ^= 1;
+	EXPECT_FALSE(Cache.Load(m_pStorage, Other));
+	EXPECT_FALSE(Cache.IsLoaded());
+
+	// truncated
+	void *pData;
+	unsigned Size;
+	ASSERT_TRUE(m_pStorage->ReadFile(m_aCacheFilename, IStorage::TYPE_SAVE, &pData, &Size));
+	IOHANDLE File = m_pStorage->OpenFile(m_aCacheFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	ASSERT_TRUE(File);
+	io_write(File, pData, Size - 1);
+	io_close(File);
+	EXPECT_FALSE(Cache.Load(m_pStorage, m_Sha256));
+
+	// another version
+	((int *) pData)[1]++;
+	File = m_pStorage->OpenFile(m_aCacheFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	ASSERT_TRUE(File);
+	io_write(File, pData, Size);
+	io_close(File);
+	EXPECT_FALSE(Cache.Load(m_pStorage, m_Sha256));
+	mem_free(pData);
+}
+
+TEST_F(MapCache, Benchmark)
+{
+	Build();
+
+	int64 BuildDuration = 0, LoadDuration = 0;
+	for(int i = 0; i < NUM_BENCHMARK_LOADS; i++)
+	{
+		IEngineMap *pMap = LoadMap();
+		CLayers Layers;
+		Layers.Init(nullptr, pMap);
+		int64 Start = time_get();
+		CCollision Collision;
+		CMapCache Cache;
+		Collision.Init(&Layers, true, &Cache);
+		AddTileEntities(&Layers, &Cache);
+		BuildDuration += time_get() - Start;
+		delete pMap;
+
+		pMap = LoadMap();
+		Layers.Init(nullptr, pMap);
+		Start = time_get();
+		ASSERT_TRUE(Cache.Load(m_pStorage, m_Sha256));
+		Collision.Init(&Layers, true, &Cache);
+		LoadDuration += time_get() - Start;
+		delete pMap;
+	}
+
+	printf("ctf5 collision and entity tiles, %d loads: built %.2fms, from the cache %.2fms\n", NUM_BENCHMARK_LOADS,
+		BuildDuration * 1000.0 / time_freq(), LoadDuration * 1000.0 / time_freq());
+}
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/shared/metrics.h>
+
+#include <string>
+#include <vector>
+
+static void CollectLine(const char *pLine, void *pUser)
+{
+	static_cast<std::vector<std::string> *>(pUser)->emplace_back(pLine);
+}
+
+TEST(Metrics, Values)
+{
+	std::vector<std::string> vLines;
+	CMetricsWriter Writer(CollectLine, &vLines);
+	Writer.Counter("test_total", "A counter", 1234567890123ll);
+	Writer.Describe("test_clients", "gauge", "A gauge with labels");
+	Writer.Value("test_clients", "kind=\"bot\"", (int64) 3);
+	Writer.Value("test_clients", "", 0.5);
+	Writer.Finish();
+
+	const std::vector<std::string> vExpected = {
+		"# HELP test_total A counter",
+		"# TYPE test_total counter",
+		"test_total 1234567890123",
+		"# HELP test_clients A gauge with labels",
+		"# TYPE test_clients gauge",
+		"test_clients{kind=\"bot\"} 3",
+		"test_clients 0.5",
+		"# EOF",
+	};
+	EXPECT_EQ(vLines, vExpected);
+}
+
+TEST(Metrics, Histogram)
+{
+	static const double s_aBounds[] = {0.001, 0.01, 0.1};
+	CMetricsHistogram Histogram;
+	Histogram.Init(s_aBounds, 3);
+	Histogram.Observe(0.0005);
+	Histogram.Observe(0.001);
+	Histogram.Observe(0.05);
+	Histogram.Observe(2.0);
+
+	std::vector<std::string> vLines;
+	CMetricsWriter Writer(CollectLine, &vLines);
+	Writer.Histogram("test_seconds", "A histogram", &Histogram);
+
+	// the buckets are cumulative, the bounds are inclusive
+	const std::vector<std::string> vExpected = {
+		"# HELP test_seconds A histogram",
+		"# TYPE test_seconds histogram",
+		"test_seconds_bucket{le=\"0.001\"} 2",
+		"test_seconds_bucket{le=\"0.01\"} 2",
+		"test_seconds_bucket{le=\"0.1\"} 3",
+		"test_seconds_bucket{le=\"+Inf\"} 4",
+		"test_seconds_sum 2.0515",
+		"test_seconds_count 4",
+	};
+	EXPECT_EQ(vLines, vExpected);
+}
@@ -0,0 +1,249 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/console.h>
+#include <engine/shared/config.h>
+#include <engine/shared/netban.h>
+
+#include <random>
+#include <vector>
+
+static const int NUM_BENCHMARK_BANS = 100000;
+static const int NUM_BENCHMARK_LOOKUPS = 1000000;
+
+static NETADDR MakeAddr(unsigned Value)
+{
+	NETADDR Addr;
+	mem_zero(&Addr, sizeof(Addr));
+	Addr.type = NETTYPE_IPV4;
+	uint_to_bytes_be(Addr.ip, Value);
+	return Addr;
+}
+
+static CNetRange MakeRange(unsigned LB, unsigned UB)
+{
+	CNetRange Range;
+	Range.m_LB = MakeAddr(LB);
+	Range.m_UB = MakeAddr(UB);
+	return Range;
+}
+
+class NetBan : public ::testing::Test
+{
+protected:
+	IConsole *m_pConsole;
+	CNetBan m_Ban;
+
+	void SetUp() override
+	{
+		m_pConsole = CreateConsole(CFGFLAG_SERVER);
+		m_Ban.Init(m_pConsole, nullptr);
+	}
+
+	void TearDown() override
+	{
+		delete m_pConsole;
+	}
+
+	int BanAddr(unsigned Addr, int Seconds, const char *pReason)
+	{
+		NETADDR Data = MakeAddr(Addr);
+		return m_Ban.BanAddr(&Data, Seconds, pReason);
+	}
+
+	int BanRange(unsigned LB, unsigned UB, int Seconds, const char *pReason)
+	{
+		CNetRange Data = MakeRange(LB, UB);
+		return m_Ban.BanRange(&Data, Seconds, pReason);
+	}
+
+	int UnbanAddr(unsigned Addr)
+	{
+		NETADDR Data = MakeAddr(Addr);
+		return m_Ban.UnbanByAddr(&Data);
+	}
+
+	static bool IsBanned(CNetBan *pBan, const NETADDR &Addr)
+	{
+		char aBuf[256];
+		return pBan->IsBanned(&Addr, aBuf, sizeof(aBuf), nullptr);
+	}
+
+	bool IsBanned(const NETADDR &Addr) { return IsBanned(&m_Ban, Addr); }
+};
+
+TEST_F(NetBan, MoreThanOldPoolSize)
+{
+	for(unsigned i = 0; i < 3000; i++)
+		ASSERT_EQ(BanAddr(0x0a000000 + i * 3, 600, "test"), 0);
+	for(unsigned i = 0; i < 3000; i++)
+		ASSERT_EQ(BanRange(0x20000000 + i * 256, 0x20000000 + i * 256 + 15, 600, "test"), 0);
+
+	for(unsigned i = 0; i < 9000; i++)
+		EXPECT_EQ(IsBanned(MakeAddr(0x0a000000 + i)), i % 3 == 0) << i;
+	for(unsigned i = 0; i < 3000 * 256; i += 7)
+		EXPECT_EQ(IsBanned(MakeAddr(0x20000000 + i)), i % 256 < 16) << i;
+
+	for(unsigned i = 0; i < 3000; i += 2)
+		ASSERT_EQ(UnbanAddr(0x0a000000 + i * 3), 0);
+	for(unsigned i = 0; i < 3000; i++)
+		EXPECT_EQ(IsBanned(MakeAddr(0x0a000000 + i * 3)), i % 2 == 1) << i;
+}
+
+TEST_F(NetBan, MatchesLinearScan)
+{
+	std::mt19937 Rng(1234);
+	std::vector<NETADDR> vAddrs;
+	std::vector<CNetRange> vRanges;
+	for(int i = 0; i < 500; i++)
+	{
+		NETADDR Addr = MakeAddr(0x40000000 | (Rng() & 0xffff));
+		if(m_Ban.BanAddr(&Addr, 600, "addr") == 0)
+			vAddrs.push_back(Addr);
+
+		// nested and overlapping ranges of all sizes
+		unsigned LB = 0x40000000 | (Rng() & 0xffff);
+		unsigned UB = LB + 1 + (Rng() % (1u << (Rng() % 14)));
+		CNetRange Range = MakeRange(LB, UB);
+		if(m_Ban.BanRange(&Range, 600, "range") == 0)
+			vRanges.push_back(Range);
+	}
+
+	// unban some of both
+	for(unsigned i = 0; i < vAddrs.size(); i += 5)
+		ASSERT_EQ(m_Ban.UnbanByAddr(&vAddrs[i]), 0);
+	for(unsigned i = 0; i < vRanges.size(); i += 5)
+		ASSERT_EQ(m_Ban.UnbanByRange(&vRanges[i]), 0);
+
+	for(unsigned Value = 0x40000000; Value < 0x40000000 + 0x12000; Value++)
+	{
+		NETADDR Addr = MakeAddr(Value);
+		bool Expected = false;
+		for(unsigned i = 0; i < vAddrs.size() && !Expected; i++)
+			Expected = i % 5 != 0 && net_addr_comp(&vAddrs[i], &Addr, false) == 0;
+		for(unsigned i = 0; i < vRanges.size() && !Expected; i++)
+			Expected = i % 5 != 0 && mem_comp(vRanges[i].m_LB.ip, Addr.ip, 4) <= 0 && mem_comp(vRanges[i].m_UB.ip, Addr.ip, 4) >= 0;
+		ASSERT_EQ(IsBanned(Addr), Expected) << Value;
+	}
+}
+
+TEST_F(NetBan, RangesAcrossHighBits)
+{
+	// these have no common prefix, they are split into blocks
+	ASSERT_EQ(BanRange(0x7ffffff0, 0x80000010, 600, "across"), 0);
+	ASSERT_EQ(BanRange(0x80000001, 0xfffffffe, 600, "upper half"), 0);
+	EXPECT_EQ(BanRange(0x7ffffff0, 0x80000010, 600, "again"), 1);
+
+	EXPECT_TRUE(IsBanned(MakeAddr(0x80000001)));
+	EXPECT_TRUE(IsBanned(MakeAddr(0xfffffffe)));
+	EXPECT_TRUE(IsBanned(MakeAddr(0x80000000)));
+	EXPECT_FALSE(IsBanned(MakeAddr(0x7fffffef)));
+	EXPECT_FALSE(IsBanned(MakeAddr(0xffffffff)));
+
+	CNetRange Upper = MakeRange(0x80000001, 0xfffffffe);
+	ASSERT_EQ(m_Ban.UnbanByRange(&Upper), 0);
+	for(unsigned Value = 0x7fffffe0; Value < 0x80000020; Value++)
+		EXPECT_EQ(IsBanned(MakeAddr(Value)), Value >= 0x7ffffff0 && Value <= 0x80000010) << Value;
+}
+
+class CCountingBan : public CNetBan
+{
+public:
+	int m_NumBans = 0;
+
+protected:
+	void OnBan(CBanAddr *pBan) override { m_NumBans++; }
+	void OnBan(CBanRange *pBan) override { m_NumBans++; }
+};
+
+TEST_F(NetBan, ExportImportRoundtrip)
+{
+	NETADDR Addr6;
+	ASSERT_EQ(net_addr_from_str(&Addr6, "[2001:db8::1]"), 0);
+	CNetRange Range6;
+	ASSERT_EQ(net_addr_from_str(&Range6.m_LB, "[2001:db8:1::]"), 0);
+	ASSERT_EQ(net_addr_from_str(&Range6.m_UB, "[2001:db8:1::ffff]"), 0);
+
+	BanAddr(0x01020304, 600, "timed");
+	BanAddr(0x01020305, 0, "forever");
+	m_Ban.BanAddr(&Addr6, 1200, "");
+	BanRange(0x05000000, 0x050000ff, 0, "range");
+	m_Ban.BanRange(&Range6, 60, "range6");
+
+	std::vector<unsigned char> vData;
+	m_Ban.ExportBans(&vData);
+
+	CCountingBan Other;
+	Other.Init(m_pConsole, nullptr);
+	EXPECT_EQ(Other.ImportBans(vData.data(), vData.size()), 5);
+	EXPECT_EQ(Other.m_NumBans, 5);
+	EXPECT_TRUE(IsBanned(&Other, Addr6));
+	NETADDR Inside6 = Range6.m_LB;
+	Inside6.ip[15] = 0x42;
+	EXPECT_TRUE(IsBanned(&Other, Inside6));
+	EXPECT_TRUE(IsBanned(&Other, MakeAddr(0x05000080)));
+	EXPECT_FALSE(IsBanned(&Other, MakeAddr(0x05000100)));
+
+	std::vector<unsigned char> vOther;
+	Other.ExportBans(&vOther);
+	EXPECT_EQ(vData, vOther);
+
+	// importing again only updates the existing bans
+	EXPECT_EQ(Other.ImportBans(vData.data(), vData.size()), 5);
+	Other.ExportBans(&vOther);
+	EXPECT_EQ(vData, vOther);
+
+	// truncated data is rejected
+	for(unsigned Size = 0; Size < vData.size(); Size += 3)
+		EXPECT_EQ(Other.ImportBans(vData.data(), Size), -1) << Size;
+}
+
+TEST_F(NetBan, Benchmark)
+{
+	// encode the ban list directly, banning one by one would print every ban
+	std::vector<unsigned char> vData = {'B', 'A', 'N', 'S', 0, 0, 0, 1};
+	unsigned char aInt[4];
+	uint_to_bytes_be(aInt, NUM_BENCHMARK_BANS);
+	vData.insert(vData.end(), aInt, aInt + 4);
+	std::mt19937 Rng(42);
+	for(int i = 0; i < NUM_BENCHMARK_BANS; i++)
+	{
+		const bool Range = i % 4 == 0;
+		vData.push_back(Range ? 1 : 0);
+		vData.push_back(0);
+		unsigned LB = Rng() | 0x01000000;
+		uint_to_bytes_be(aInt, LB);
+		vData.insert(vData.end(), aInt, aInt + 4);
+		if(Range)
+		{
+			uint_to_bytes_be(aInt, LB + 1 + Rng() % 1024);
+			vData.insert(vData.end(), aInt, aInt + 4);
+		}
+		int_to_bytes_be(aInt, i % 2 ? -1 : time_timestamp() + 600 + i);
+		vData.insert(vData.end(), aInt, aInt + 4);
+		vData.push_back(5);
+		vData.insert(vData.end(), {'s', 'p', 'a', 'm', '!'});
+	}
+
+	int64 Start = time_get();
+	int Imported = m_Ban.ImportBans(vData.data(), vData.size());
+	int64 ImportDuration = time_get() - Start;
+	EXPECT_GT(Imported, NUM_BENCHMARK_BANS * 99 / 100);
+
+	std::vector<unsigned char> vExport;
+	Start = time_get();
+	m_Ban.ExportBans(&vExport);
+	int64 ExportDuration = time_get() - Start;
+
+	int Banned = 0;
+	Start = time_get();
+	for(int i = 0; i < NUM_BENCHMARK_LOOKUPS; i++)
+		Banned += IsBanned(MakeAddr(Rng()));
+	int64 LookupDuration = time_get() - Start;
+	EXPECT_GT(Banned, 0);
+
+	printf("%d bans: import %.2fms, export %.2fms, %d lookups %.2fms\n", Imported,
+		ImportDuration * 1000.0 / time_freq(), ExportDuration * 1000.0 / time_freq(),
+		NUM_BENCHMARK_LOOKUPS, LookupDuration * 1000.0 / time_freq());
+}
@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/shared/config.h>
+#include <engine/shared/network.h>
+
+#include <vector>
+
+static void PacketSent(int TrackID, void *pUser)
+{
+	static_cast<std::vector<int> *>(pUser)->push_back(TrackID);
+}
+
+class TokenCache : public ::testing::Test
+{
+protected:
+	CConfig m_Config;
+	CNetBase m_NetBase;
+	CNetTokenManager m_TokenManager;
+	CNetTokenCache m_TokenCache;
+	std::vector<int> m_vSent;
+	NETSOCKET m_Socket;
+
+	void SetUp() override
+	{
+		m_Socket.type = NETTYPE_INVALID;
+		ASSERT_EQ(secure_random_init(), 0);
+		mem_zero(&m_Config, sizeof(m_Config));
+		NETADDR BindAddr;
+		ASSERT_EQ(net_addr_from_str(&BindAddr, "127.0.0.1"), 0);
+		m_Socket = net_udp_create(BindAddr, 1);
+		ASSERT_NE(m_Socket.type, NETTYPE_INVALID);
+		m_NetBase.Init(m_Socket, &m_Config, nullptr, nullptr);
+		m_TokenManager.Init(&m_NetBase);
+		m_TokenCache.Init(&m_NetBase, &m_TokenManager);
+	}
+
+	void TearDown() override
+	{
+		if(m_Socket.type != NETTYPE_INVALID)
+			net_udp_close(m_Socket);
+	}
+
+	static NETADDR Addr(int Port)
+	{
+		NETADDR Addr;
+		net_addr_from_str(&Addr, "127.0.0.1");
+		Addr.port = Port;
+		return Addr;
+	}
+
+	int Store(const NETADDR &Addr)
+	{
+		CSendCBData CallbackData;
+		CallbackData.m_pfnCallback = PacketSent;
+		CallbackData.m_pCallbackUser = &m_vSent;
+		m_TokenCache.SendPacketConnless(&Addr, "test", 4, &CallbackData);
+		return CallbackData.m_TrackID;
+	}
+};
+
+TEST_F(TokenCache, SendsStoredPacketsForAddress)
+{
+	NETADDR A = Addr(1), B = Addr(2);
+	int TrackA1 = Store(A);
+	int TrackB = Store(B);
+	int TrackA2 = Store(A);
+	int TrackPurged = Store(A);
+	m_TokenCache.PurgeStoredPacket(TrackPurged);
+
+	m_TokenCache.AddToken(&A, 0x12345678, NET_TOKENFLAG_RESPONSEONLY);
+	EXPECT_EQ(m_vSent, (std::vector<int>{TrackA1, TrackA2}));
+	EXPECT_EQ(m_TokenCache.GetToken(&A), NET_TOKEN_NONE);
+
+	m_TokenCache.AddToken(&B, 0x1234, 0);
+	EXPECT_EQ(m_vSent, (std::vector<int>{TrackA1, TrackA2, TrackB}));
+	EXPECT_EQ(m_TokenCache.GetToken(&B), 0x1234u);
+
+	// now sent directly
+	Store(B);
+	EXPECT_EQ(m_vSent.size(), 3u);
+}
+
+TEST_F(TokenCache, SendsBroadcastsOnAllowedTokens)
+{
+	NETADDR Broadcast = {0};
+	Broadcast.type = NETTYPE_ALL | NETTYPE_LINK_BROADCAST;
+	Broadcast.port = 8303;
+	int TrackBroadcast = Store(Broadcast);
+	NETADDR A = Addr(8304);
+	int TrackA = Store(A);
+
+	NETADDR Other = Addr(8305);
+	m_TokenCache.AddToken(&Other, 0x1234, NET_TOKENFLAG_RESPONSEONLY);
+	EXPECT_TRUE(m_vSent.empty());
+
+	m_TokenCache.AddToken(&A, 0x1234, NET_TOKENFLAG_ALLOWBROADCAST | NET_TOKENFLAG_RESPONSEONLY);
+	EXPECT_EQ(m_vSent, (std::vector<int>{TrackA, TrackBroadcast}));
+}
+
+TEST_F(TokenCache, RefreshesTokensInPlace)
+{
+	NETADDR A = Addr(1);
+	m_TokenCache.AddToken(&A, 1, 0);
+
+	// repeated tokens of one address don't push out the others
+	for(int i = 0; i < NET_TOKENCACHE_SIZE * 4; i++)
+	{
+		NETADDR Flood = Addr(2);
+		m_TokenCache.AddToken(&Flood, i + 10, 0);
+	}
+	NETADDR Flood = Addr(2);
+	EXPECT_EQ(m_TokenCache.GetToken(&A), 1u);
+	EXPECT_EQ(m_TokenCache.GetToken(&Flood), (TOKEN) NET_TOKENCACHE_SIZE * 4 + 9);
+
+	// distinct addresses recycle the oldest entries
+	for(int i = 0; i < NET_TOKENCACHE_SIZE; i++)
+	{
+		NETADDR Other = Addr(100 + i);
+		m_TokenCache.AddToken(&Other, i + 10, 0);
+	}
+	EXPECT_EQ(m_TokenCache.GetToken(&A), NET_TOKEN_NONE);
+	NETADDR Last = Addr(100 + NET_TOKENCACHE_SIZE - 1);
+	EXPECT_EQ(m_TokenCache.GetToken(&Last), (TOKEN) NET_TOKENCACHE_SIZE + 9);
+}
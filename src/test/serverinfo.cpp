@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/external/json-parser/json.h>
+#include <engine/shared/jsonparser.h>
+#include <engine/shared/serverinfo.h>
+
+#include <cstdlib>
+#include <string>
+
+static const int NUM_BENCHMARK_SERVERS = 4000;
+
+static void AppendServer(std::string *pJson, int Index, int NumClients)
+{
+	char aBuf[512];
+	str_format(aBuf, sizeof(aBuf),
+		"{\"ip\": \"10.0.%d.%d\", \"port\": %d, \"supports7\": true, \"maxClients\": 64, \"maxPlayers\": 32, "
+		"\"clientScoreKind\": \"%s\", \"hasPassword\": %s, \"gameType\": {\"name\": \"DM\", \"flags\": 0}, "
+		"\"name\": \"Server \\\"%d\\\"\", \"map\": {\"name\": \"dm%d\", \"sha256\": \"00\", \"size\": 1024}, "
+		"\"version\": {\"version\": \"0.7.5\", \"extra\": [1, 2]}, \"clients\": [",
+		Index / 256, Index % 256, 8303 + Index % 10, Index % 2 ? "time" : "points", Index % 3 ? "false" : "true", Index, Index % 7);
+	*pJson += aBuf;
+	for(int i = 0; i < NumClients; i++)
+	{
+		str_format(aBuf, sizeof(aBuf),
+			"%s{\"name\": \"player %d\", \"clan\": %s, \"country\": {\"code\": %d}, \"score\": %d, \"isPlayer\": %s}",
+			i ? ", " : "", i, i % 4 ? "{\"name\": \"clan\"}" : "null", 276 + i, i * 10 - 5, i % 5 ? "true" : "false");
+		*pJson += aBuf;
+	}
+	*pJson += "]}";
+}
+
+static std::string ServerList(int NumServers)
+{
+	std::string Json = "[";
+	for(int i = 0; i < NumServers; i++)
+	{
+		if(i)
+			Json += ",\n";
+		AppendServer(&Json, i, i % 17);
+	}
+	Json += "]";
+	return Json;
+}
+
+class CAllocStats
+{
+public:
+	size_t m_Current = 0;
+	size_t m_Peak = 0;
+
+	static void *Alloc(size_t Size, int Zero, void *pUser)
+	{
+		CAllocStats *pStats = static_cast<CAllocStats *>(pUser);
+		pStats->m_Current += Size;
+		pStats->m_Peak = maximum(pStats->m_Peak, pStats->m_Current);
+		size_t *pBlock = static_cast<size_t *>(Zero ? calloc(1, Size + sizeof(size_t)) : malloc(Size + sizeof(size_t)));
+		*pBlock = Size;
+		return pBlock + 1;
+	}
+
+	static void Free(void *pData, void *pUser)
+	{
+		if(!pData)
+			return;
+		size_t *pBlock = static_cast<size_t *>(pData) - 1;
+		static_cast<CAllocStats *>(pUser)->m_Current -= *pBlock;
+		free(pBlock);
+	}
+};
+
+static json_value *ParseTree(const std::string &Json, CAllocStats *pStats)
+{
+	json_settings Settings;
+	mem_zero(&Settings, sizeof(Settings));
+	Settings.mem_alloc = CAllocStats::Alloc;
+	Settings.mem_free = CAllocStats::Free;
+	Settings.user_data = pStats;
+	char aError[json_error_max];
+	return json_parse_ex(&Settings, Json.c_str(), Json.size(), aError);
+}
+
+static void FreeTree(json_value *pJson, CAllocStats *pStats)
+{
+	json_settings Settings;
+	mem_zero(&Settings, sizeof(Settings));
+	Settings.mem_free = CAllocStats::Free;
+	Settings.user_data = pStats;
+	json_value_free_ex(&Settings, pJson);
+}
+
+TEST(ServerInfo, ReaderMatchesTree)
+{
+	const std::string Json = ServerList(200);
+	CAllocStats Stats;
+	json_value *pTree = ParseTree(Json, &Stats);
+	ASSERT_TRUE(pTree);
+
+	CJsonReader Reader;
+	Reader.SetData(Json.c_str(), Json.size());
+	ASSERT_EQ(Reader.Next(), CJsonReader::TOKEN_BEGIN_ARRAY);
+	for(unsigned i = 0; i < pTree->u.array.length; i++)
+	{
+		CServerInfo2 FromTree, FromReader;
+		ASSERT_FALSE(CServerInfo2::FromJson(&FromTree, (*pTree).u.array.values[i]));
+		ASSERT_EQ(Reader.Next(), CJsonReader::TOKEN_BEGIN_OBJECT);
+		ASSERT_FALSE(CServerInfo2::FromJsonReader(&FromReader, &Reader)) << Reader.Error();
+		EXPECT_TRUE(FromTree == FromReader) << "server " << i;
+		EXPECT_EQ(FromTree.m_NumPlayers, FromReader.m_NumPlayers);
+		EXPECT_EQ(FromTree.m_ClientScoreKind, FromReader.m_ClientScoreKind);
+		for(int c = 0; c < FromTree.m_NumClients; c++)
+			EXPECT_EQ(FromTree.m_aClients[c].m_IsPlayer, FromReader.m_aClients[c].m_IsPlayer);
+	}
+	EXPECT_EQ(Reader.Next(), CJsonReader::TOKEN_END_ARRAY);
+	EXPECT_EQ(Reader.Next(), CJsonReader::TOKEN_END);
+	FreeTree(pTree, &Stats);
+}
+
+TEST(ServerInfo, ReaderSkipsInvalidServer)
+{
+	// the broken server is skipped, the reader continues after it
+	const char aJson[] = "[{\"name\": \"broken\", \"maxClients\": \"many\", \"clients\": [{\"name\": 1}], \"ip\": \"1.2.3.4\"}, {\"other\": 1}]";
+	CJsonReader Reader;
+	Reader.SetData(aJson, str_length(aJson));
+	ASSERT_EQ(Reader.Next(), CJsonReader::TOKEN_BEGIN_ARRAY);
+
+	char aIp[32] = "";
+	auto ReadIp = [](CJsonReader *pReader, void *pUser) {
+		return pReader->IsKey("ip") && pReader->ReadString(static_cast<char *>(pUser), 32);
+	};
+	CServerInfo2 Info;
+	ASSERT_EQ(Reader.Next(), CJsonReader::TOKEN_BEGIN_OBJECT);
+	EXPECT_TRUE(CServerInfo2::FromJsonReader(&Info, &Reader, ReadIp, aIp));
+	EXPECT_FALSE(Reader.Failed());
+	EXPECT_STREQ(aIp, "1.2.3.4");
+	ASSERT_EQ(Reader.Next(), CJsonReader::TOKEN_BEGIN_OBJECT);
+	EXPECT_TRUE(CServerInfo2::FromJsonReader(&Info, &Reader));
+	EXPECT_EQ(Reader.Next(), CJsonReader::TOKEN_END_ARRAY);
+	EXPECT_EQ(Reader.Next(), CJsonReader::TOKEN_END);
+}
+
+TEST(ServerInfo, Benchmark)
+{
+	const std::string Json = ServerList(NUM_BENCHMARK_SERVERS);
+
+	int64 Start = time_get();
+	CAllocStats Stats;
+	json_value *pTree = ParseTree(Json, &Stats);
+	ASSERT_TRUE(pTree);
+	int NumTree = 0;
+	for(unsigned i = 0; i < pTree->u.array.length; i++)
+	{
+		CServerInfo2 Info;
+		NumTree += !CServerInfo2::FromJson(&Info, pTree->u.array.values[i]);
+	}
+	FreeTree(pTree, &Stats);
+	const int64 TreeDuration = time_get() - Start;
+
+	Start = time_get();
+	CJsonReader Reader;
+	Reader.SetData(Json.c_str(), Json.size());
+	int NumReader = 0;
+	ASSERT_EQ(Reader.Next(), CJsonReader::TOKEN_BEGIN_ARRAY);
+	while(Reader.Next() == CJsonReader::TOKEN_BEGIN_OBJECT)
+	{
+		CServerInfo2 Info;
+		NumReader += !CServerInfo2::FromJsonReader(&Info, &Reader);
+	}
+	const int64 ReaderDuration = time_get() - Start;
+
+	EXPECT_EQ(NumTree, NUM_BENCHMARK_SERVERS);
+	EXPECT_EQ(NumReader, NUM_BENCHMARK_SERVERS);
+	EXPECT_LT(Reader.MemoryUsage(), 64 * 1024);
+	printf("%d servers, %.2f MiB: tree %.2fms with %.2f MiB peak, reader %.2fms with %d bytes\n", NUM_BENCHMARK_SERVERS, Json.size() / 1024.0 / 1024.0,
+		TreeDuration * 1000.0 / time_freq(), Stats.m_Peak / 1024.0 / 1024.0, ReaderDuration * 1000.0 / time_freq(), Reader.MemoryUsage());
+}
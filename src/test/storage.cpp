@@ -43,3 +43,89 @@ TEST(Storage, FindFile)
 
 	EXPECT_TRUE(pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE));
 }
+
+static int CountFile(const char *pName, int IsDir, int Type, void *pUser)
+{
+	if(!IsDir && !str_comp(pName, "a.txt"))
+		(*static_cast<int *>(pUser))++;
+	return 0;
+}
+
+static bool FileExists(IStorage *pStorage, const char *pFilename)
+{
+	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_READ, IStorage::TYPE_ALL);
+	if(File)
+		io_close(File);
+	return File != 0;
+}
+
+// changes from outside reach the index through the watch thread
+static bool WaitForFile(IStorage *pStorage, const char *pFilename, bool Exists)
+{
+	for(int i = 0; i < 500 && FileExists(pStorage, pFilename) != Exists; i++)
+		thread_sleep(10);
+	return FileExists(pStorage, pFilename) == Exists;
+}
+
+TEST(Storage, Index)
+{
+#if !defined(CONF_PLATFORM_LINUX)
+	GTEST_SKIP() << "the index needs to watch directories";
+#endif
+	CTestInfo Info;
+	char aFilenameA[128], aFilenameB[128], aMissing[128];
+	str_format(aFilenameA, sizeof(aFilenameA), "%s/a.txt", Info.m_aFilename);
+	str_format(aFilenameB, sizeof(aFilenameB), "%s/b.txt", Info.m_aFilename);
+	str_format(aMissing, sizeof(aMissing), "%s/missing.txt", Info.m_aFilename);
+	ASSERT_FALSE(fs_makedir(Info.m_aFilename));
+	IOHANDLE File = io_open(aFilenameA, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	io_close(File);
+
+	// the current directory is one of the read-only paths of the basic storage
+	const char *apArgs[] = {"./testrunner"};
+	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_BASIC, 1, apArgs);
+	ASSERT_TRUE(pStorage);
+	pStorage->EnableIndex(true);
+
+	EXPECT_TRUE(FileExists(pStorage, aFilenameA));
+	EXPECT_FALSE(FileExists(pStorage, aMissing));
+	IStorage::CIndexStats Before;
+	pStorage->GetIndexStats(&Before);
+	EXPECT_GT(Before.m_NumDirectories, 0);
+	for(int i = 0; i < 100; i++)
+		EXPECT_FALSE(FileExists(pStorage, aMissing));
+	IStorage::CIndexStats After;
+	pStorage->GetIndexStats(&After);
+	EXPECT_GE(After.m_SavedSyscalls - Before.m_SavedSyscalls, 100);
+	EXPECT_EQ(After.m_Hits - Before.m_Hits, After.m_Lookups - Before.m_Lookups);
+
+	// the listings match the directory
+	int NumIndexed = 0, NumListed = 0;
+	pStorage->ListDirectory(IStorage::TYPE_ALL, Info.m_aFilename, CountFile, &NumIndexed);
+	pStorage->EnableIndex(false);
+	pStorage->ListDirectory(IStorage::TYPE_ALL, Info.m_aFilename, CountFile, &NumListed);
+	EXPECT_GT(NumIndexed, 0);
+	EXPECT_EQ(NumIndexed, NumListed);
+	pStorage->EnableIndex(true);
+
+	char aFound[128];
+	EXPECT_TRUE(pStorage->FindFile("a.txt", ".", IStorage::TYPE_ALL, aFound, sizeof(aFound)));
+	EXPECT_FALSE(pStorage->FindFile("missing.txt", ".", IStorage::TYPE_ALL, aFound, sizeof(aFound)));
+
+	File = io_open(aFilenameB, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	io_close(File);
+	EXPECT_TRUE(WaitForFile(pStorage, aFilenameB, true));
+	EXPECT_FALSE(fs_remove(aFilenameA));
+	EXPECT_TRUE(WaitForFile(pStorage, aFilenameA, false));
+
+	pStorage->RefreshIndex();
+	pStorage->GetIndexStats(&After);
+	EXPECT_EQ(After.m_NumDirectories, 0);
+	EXPECT_TRUE(FileExists(pStorage, aFilenameB));
+	delete pStorage;
+
+	EXPECT_FALSE(fs_remove(aFilenameB));
+	EXPECT_FALSE(fs_remove(Info.m_aFilename));
+}
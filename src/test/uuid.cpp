@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <base/uuid.h>
+
+TEST(Uuid, ConstMatchesRuntime)
+{
+	const char *apNames[] = {"", "a", "MAIN", "Hammer", "Gun", "Shotgun", "Grenade", "Laser", "en", "zh-CN",
+		"carbon:12345678901234567890123456789012345678", // 55 bytes with the namespace, last single block
+		"carbon:123456789012345678901234567890123456789", // 56 bytes, the length spills into a second block
+		"a name that is long enough to need more than two md5 blocks after prepending the namespace, for sure"};
+	for(const char *pName : apNames)
+	{
+		char aExpected[UUID_MAXSTRSIZE], aActual[UUID_MAXSTRSIZE];
+		FormatUuid(CalculateUuid(pName), aExpected, sizeof(aExpected));
+		FormatUuid(CalculateConstUuid(pName), aActual, sizeof(aActual));
+		EXPECT_STREQ(aExpected, aActual) << "'" << pName << "'";
+	}
+
+	char aName[64];
+	for(int i = 0; i < 1000; i++)
+	{
+		str_format(aName, sizeof(aName), "weapon%d", i * 7919);
+		EXPECT_EQ(CalculateUuid(aName), CalculateConstUuid(aName));
+	}
+}
+
+TEST(Uuid, ConstIsCompileTime)
+{
+	constexpr Uuid Hammer = CalculateConstUuid("Hammer");
+	// "350f0950-07c1-3fcd-bf66-20de2608aef3"
+	static_assert(Hammer.m_aData[0] == 0x35 && Hammer.m_aData[6] == 0x3f && Hammer.m_aData[8] == 0xbf && Hammer.m_aData[15] == 0xf3, "unexpected uuid for 'Hammer'");
+	EXPECT_EQ(Hammer, CalculateUuid("Hammer"));
+}
+
+TEST(Uuid, Cache)
+{
+	CUuidCache Cache;
+	char aName[64];
+	for(int Round = 0; Round < 2; Round++)
+	{
+		for(int i = 0; i < 100; i++)
+		{
+			str_format(aName, sizeof(aName), "page%d", i);
+			EXPECT_EQ(Cache.Get(aName), CalculateUuid(aName));
+		}
+	}
+	EXPECT_EQ(Cache.Get(""), CalculateUuid(""));
+	EXPECT_EQ(Cache.Get("a name which is too long to be stored in the cache"), CalculateUuid("a name which is too long to be stored in the cache"));
+}
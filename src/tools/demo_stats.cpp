@@ -0,0 +1,324 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/console.h>
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/jobs.h>
+#include <engine/shared/jsonwriter.h>
+#include <engine/shared/protocol.h>
+#include <engine/shared/snapshot.h>
+#include <engine/storage.h>
+
+#include <game/version.h>
+#include <generated/protocol.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// decodes demos as fast as possible and writes statistics of every tick
+
+struct CTickStats
+{
+	int m_Tick;
+	int m_NumItems;
+	int m_Size;
+	int m_NumPlayers;
+	int m_NumBots;
+	int m_NumMessages;
+};
+
+struct CItemTypeStats
+{
+	int64 m_NumItems;
+	int64 m_Size;
+};
+
+class CDemoStats : public CDemoPlayer::IListener
+{
+public:
+	enum
+	{
+		// all other types are counted as one
+		NUM_ITEM_TYPES = NUM_NETOBJTYPES + 1,
+	};
+
+	const CDemoPlayer *m_pPlayer;
+	std::vector<CTickStats> m_vTicks;
+	CItemTypeStats m_aItemTypes[NUM_ITEM_TYPES];
+	int m_NumMessages;
+	int64 m_SnapshotBytes;
+
+	CDemoStats(const CDemoPlayer *pPlayer) :
+		m_pPlayer(pPlayer)
+	{
+		mem_zero(m_aItemTypes, sizeof(m_aItemTypes));
+		m_NumMessages = 0;
+		m_SnapshotBytes = 0;
+	}
+
+	void OnDemoPlayerSnapshot(void *pData, int Size) override
+	{
+		const CSnapshot *pSnapshot = (const CSnapshot *) pData;
+		CTickStats Tick;
+		Tick.m_Tick = m_pPlayer->BaseInfo()->m_CurrentTick;
+		Tick.m_NumItems = pSnapshot->NumItems();
+		Tick.m_Size = Size;
+		Tick.m_NumPlayers = 0;
+		Tick.m_NumBots = 0;
+		Tick.m_NumMessages = m_NumMessages;
+		m_NumMessages = 0;
+		m_SnapshotBytes += Size;
+
+		for(int i = 0; i < pSnapshot->NumItems(); i++)
+		{
+			const CSnapshotItem *pItem = pSnapshot->GetItem(i);
+			const int Type = pItem->Type() < NUM_NETOBJTYPES ? pItem->Type() : NUM_NETOBJTYPES;
+			m_aItemTypes[Type].m_NumItems++;
+			m_aItemTypes[Type].m_Size += pSnapshot->GetItemSize(i);
+
+			// bots take the client ids after the players
+			if(pItem->Type() == NETOBJTYPE_CHARACTER)
+			{
+				if(pItem->ID() < SERVER_MAX_CLIENTS)
+					Tick.m_NumPlayers++;
+				else
+					Tick.m_NumBots++;
+			}
+		}
+		m_vTicks.push_back(Tick);
+	}
+
+	void OnDemoPlayerMessage(void *pData, int Size) override
+	{
+		m_NumMessages++;
+	}
+};
+
+class CDemoStatsJob : public IJob
+{
+	IStorage *m_pStorage;
+	char m_aFilename[IO_MAX_PATH_LENGTH];
+	bool m_Json;
+	SEMAPHORE *m_pDone;
+
+	void WriteCsv(IOHANDLE File, const CDemoStats &Stats)
+	{
+		char aBuf[256];
+		str_copy(aBuf, "tick,items,bytes,players,bots,messages\n", sizeof(aBuf));
+		io_write(File, aBuf, str_length(aBuf));
+		for(const CTickStats &Tick : Stats.m_vTicks)
+		{
+			str_format(aBuf, sizeof(aBuf), "%d,%d,%d,%d,%d,%d\n", Tick.m_Tick, Tick.m_NumItems, Tick.m_Size, Tick.m_NumPlayers, Tick.m_NumBots, Tick.m_NumMessages);
+			io_write(File, aBuf, str_length(aBuf));
+		}
+		io_close(File);
+	}
+
+	void WriteJson(IOHANDLE File, const CDemoStats &Stats, const CNetObjHandler &NetObjHandler)
+	{
+		CJsonFileWriter Writer(File);
+		Writer.BeginObject();
+		Writer.WriteAttribute("demo");
+		Writer.WriteStrValue(m_aFilename);
+		Writer.WriteAttribute("item_types");
+		Writer.BeginArray();
+		for(int i = 0; i < CDemoStats::NUM_ITEM_TYPES; i++)
+		{
+			if(!Stats.m_aItemTypes[i].m_NumItems)
+				continue;
+			Writer.BeginObject();
+			Writer.WriteAttribute("type");
+			Writer.WriteStrValue(i < NUM_NETOBJTYPES ? NetObjHandler.GetObjName(i) : "other");
+			Writer.WriteAttribute("items");
+			Writer.WriteIntValue((int) Stats.m_aItemTypes[i].m_NumItems);
+			Writer.WriteAttribute("bytes");
+			Writer.WriteIntValue((int) Stats.m_aItemTypes[i].m_Size);
+			Writer.EndObject();
+		}
+		Writer.EndArray();
+		Writer.WriteAttribute("ticks");
+		Writer.BeginArray();
+		for(const CTickStats &Tick : Stats.m_vTicks)
+		{
+			Writer.BeginObject();
+			Writer.WriteAttribute("tick");
+			Writer.WriteIntValue(Tick.m_Tick);
+			Writer.WriteAttribute("items");
+			Writer.WriteIntValue(Tick.m_NumItems);
+			Writer.WriteAttribute("bytes");
+			Writer.WriteIntValue(Tick.m_Size);
+			Writer.WriteAttribute("players");
+			Writer.WriteIntValue(Tick.m_NumPlayers);
+			Writer.WriteAttribute("bots");
+			Writer.WriteIntValue(Tick.m_NumBots);
+			Writer.WriteAttribute("messages");
+			Writer.WriteIntValue(Tick.m_NumMessages);
+			Writer.EndObject();
+		}
+		Writer.EndArray();
+		Writer.EndObject();
+	}
+
+	void Run() override
+	{
+		// every demo is decoded on its own, nothing is shared between the jobs but the storage
+		IConsole *pConsole = CreateConsole(CFGFLAG_SERVER);
+		CNetObjHandler NetObjHandler;
+		CSnapshotDelta SnapshotDelta;
+		for(int i = 0; i < NUM_NETOBJTYPES; i++)
+			SnapshotDelta.SetStaticsize(i, NetObjHandler.GetObjSize(i));
+		std::unique_ptr<CDemoPlayer> pPlayer = std::make_unique<CDemoPlayer>(&SnapshotDelta);
+		pPlayer->Init(pConsole, m_pStorage);
+		CDemoStats Stats(pPlayer.get());
+		pPlayer->SetListener(&Stats);
+
+		int64 Start = time_get();
+		const char *pError = pPlayer->Load(m_aFilename, IStorage::TYPE_ALL, GAME_NETVERSION);
+		if(pError)
+			dbg_msg("demo_stats", "%s: %s", m_aFilename, pError);
+		else
+		{
+			while(pPlayer->DecodeTick())
+				;
+			pPlayer->Stop();
+			m_DecodeTime = time_get() - Start;
+			m_NumSnapshots = Stats.m_vTicks.size();
+			m_SnapshotBytes = Stats.m_SnapshotBytes;
+
+			// flatten the path into the name of the output file
+			char aName[IO_MAX_PATH_LENGTH];
+			str_copy(aName, m_aFilename, sizeof(aName));
+			for(char *p = aName; *p; p++)
+			{
+				if(*p == '/' || *p == '\\')
+					*p = '_';
+			}
+			char aOutput[IO_MAX_PATH_LENGTH];
+			str_format(aOutput, sizeof(aOutput), "demostats/%s.%s", aName, m_Json ? "json" : "csv");
+			IOHANDLE File = m_pStorage->OpenFile(aOutput, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+			if(!File)
+				dbg_msg("demo_stats", "failed to open '%s' for writing", aOutput);
+			else if(m_Json)
+				WriteJson(File, Stats, NetObjHandler);
+			else
+				WriteCsv(File, Stats);
+
+			dbg_msg("demo_stats", "%s: %d snapshots, %.2f MiB in %.2fms (%.0f snapshots/s)", m_aFilename, m_NumSnapshots,
+				m_SnapshotBytes / (1024.0 * 1024.0), m_DecodeTime * 1000.0 / time_freq(), m_NumSnapshots / maximum(m_DecodeTime / (double) time_freq(), 1e-6));
+		}
+
+		pPlayer.reset();
+		delete pConsole;
+		sphore_signal(m_pDone);
+	}
+
+public:
+	int64 m_DecodeTime;
+	int m_NumSnapshots;
+	int64 m_SnapshotBytes;
+
+	CDemoStatsJob(IStorage *pStorage, const char *pFilename, bool Json, SEMAPHORE *pDone) :
+		m_pStorage(pStorage), m_Json(Json), m_pDone(pDone)
+	{
+		str_copy(m_aFilename, pFilename, sizeof(m_aFilename));
+		m_DecodeTime = 0;
+		m_NumSnapshots = 0;
+		m_SnapshotBytes = 0;
+	}
+};
+
+struct CListDemos
+{
+	const char *m_pFolder;
+	std::vector<std::string> *m_pvFilenames;
+};
+
+static int ListDemosCallback(const char *pName, int IsDir, int StorageType, void *pUser)
+{
+	CListDemos *pList = static_cast<CListDemos *>(pUser);
+	if(!IsDir && str_endswith(pName, ".demo"))
+	{
+		char aBuf[IO_MAX_PATH_LENGTH];
+		str_format(aBuf, sizeof(aBuf), "%s/%s", pList->m_pFolder, pName);
+		pList->m_pvFilenames->push_back(aBuf);
+	}
+	return 0;
+}
+
+int main(int argc, const char **argv)
+{
+	cmdline_fix(&argc, &argv);
+	dbg_logger_stdout();
+
+	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_BASIC, argc, argv);
+	if(!pStorage)
+	{
+		dbg_msg("demo_stats", "error creating the storage");
+		return -1;
+	}
+
+	int NumThreads = clamp(std::thread::hardware_concurrency(), 1u, 64u);
+	bool Json = false;
+	std::vector<std::string> vFilenames;
+	for(int i = 1; i < argc; i++)
+	{
+		if(str_comp(argv[i], "-j") == 0 && i + 1 < argc)
+			NumThreads = clamp(str_toint(argv[++i]), 1, 64);
+		else if(str_comp(argv[i], "-json") == 0)
+			Json = true;
+		else if(str_endswith(argv[i], ".demo"))
+			vFilenames.push_back(argv[i]);
+		else
+		{
+			// all demos of a folder
+			CListDemos List = {argv[i], &vFilenames};
+			pStorage->ListDirectory(IStorage::TYPE_ALL, argv[i], ListDemosCallback, &List);
+		}
+	}
+	if(vFilenames.empty())
+	{
+		dbg_msg("usage", "%s [-j <threads>] [-json] <demo or folder>...", argv[0]);
+		dbg_msg("usage", "writes the statistics of every tick to demostats/ in the save directory");
+		delete pStorage;
+		cmdline_free(argc, argv);
+		return -1;
+	}
+	pStorage->CreateFolder("demostats", IStorage::TYPE_SAVE);
+
+	SEMAPHORE Done;
+	sphore_init(&Done);
+	CJobPool Pool;
+	Pool.Init(NumThreads);
+	std::vector<std::shared_ptr<CDemoStatsJob>> vpJobs;
+	const int64 Start = time_get();
+	for(const std::string &Filename : vFilenames)
+	{
+		vpJobs.push_back(std::make_shared<CDemoStatsJob>(pStorage, Filename.c_str(), Json, &Done));
+		Pool.Add(vpJobs.back());
+	}
+	for(size_t i = 0; i < vpJobs.size(); i++)
+		sphore_wait(&Done);
+	const int64 Duration = time_get() - Start;
+	Pool.Shutdown();
+	sphore_destroy(&Done);
+
+	int64 NumSnapshots = 0, SnapshotBytes = 0, DecodeTime = 0;
+	for(const std::shared_ptr<CDemoStatsJob> &pJob : vpJobs)
+	{
+		NumSnapshots += pJob->m_NumSnapshots;
+		SnapshotBytes += pJob->m_SnapshotBytes;
+		DecodeTime += pJob->m_DecodeTime;
+	}
+	dbg_msg("demo_stats", "%d demos on %d threads: %lld snapshots, %.2f MiB in %.2fms (%.0f snapshots/s, %.0f per thread)", (int) vpJobs.size(), NumThreads,
+		(long long) NumSnapshots, SnapshotBytes / (1024.0 * 1024.0), Duration * 1000.0 / time_freq(),
+		NumSnapshots / maximum(Duration / (double) time_freq(), 1e-6), NumSnapshots / maximum(DecodeTime / (double) time_freq(), 1e-6));
+
+	delete pStorage;
+	cmdline_free(argc, argv);
+	return 0;
+}